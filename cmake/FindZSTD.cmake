@@ -0,0 +1,18 @@
+# - Try to find ZSTD
+# Once done, this will define
+#
+#  ZSTD_FOUND - system has ZSTD
+#  ZSTD_INCLUDE_DIRS - the ZSTD include directories
+#  ZSTD_LIBRARIES - link these to use ZSTD
+
+include(LibFindMacros)
+
+libfind_pkg_check_modules(ZSTD_PKGCONF libzstd)
+
+find_path(ZSTD_INCLUDE_DIR zstd.h PATHS ${ZSTD_PKGCONF_INCLUDE_DIRS})
+find_library(ZSTD_LIBRARY NAMES zstd libzstd PATHS ${ZSTD_PKGCONF_LIBRARY_DIRS})
+
+set(ZSTD_PROCESS_INCLUDES ZSTD_INCLUDE_DIR)
+set(ZSTD_PROCESS_LIBS ZSTD_LIBRARY)
+
+libfind_process(ZSTD)
@@ -34,6 +34,22 @@ void CacheManager::init( CacheManager *instance ) {
 	CacheManager::instance = instance;
 }
 
+//
+// Wrapper
+//
+
+template<typename T>
+bool CacheWrapper<T>::put_shared(const std::string &semantic_id,
+		const std::shared_ptr<const T> &item, const QueryRectangle &query, const QueryProfiler &profiler) {
+	return put(semantic_id, copy_result(*item), query, profiler);
+}
+
+template<typename T>
+std::shared_ptr<const T> CacheWrapper<T>::query_shared(GenericOperator &op,
+		const QueryRectangle &rect, QueryProfiler &profiler) {
+	return query(op, rect, profiler);
+}
+
 //
 // NOP-Wrapper
 //
@@ -52,6 +68,16 @@ bool NopCacheWrapper<T>::put(const std::string& semantic_id,
 	return false;
 }
 
+template<typename T>
+bool NopCacheWrapper<T>::put_shared(const std::string& semantic_id,
+		const std::shared_ptr<const T>& item, const QueryRectangle &query, const QueryProfiler &profiler) {
+	(void) semantic_id;
+	(void) item;
+	(void) query;
+	(void) profiler;
+	return false;
+}
+
 template<typename T>
 std::unique_ptr<T> NopCacheWrapper<T>::query(GenericOperator& op,
 		const QueryRectangle& rect, QueryProfiler &profiler) {
@@ -112,6 +138,16 @@ bool ClientCacheWrapper<T>::put(const std::string& semantic_id,
 	return false;
 }
 
+template<typename T>
+bool ClientCacheWrapper<T>::put_shared(const std::string& semantic_id,
+		const std::shared_ptr<const T>& item, const QueryRectangle &query, const QueryProfiler &profiler) {
+	(void) semantic_id;
+	(void) item;
+	(void) query;
+	(void) profiler;
+	return false;
+}
+
 template<typename T>
 std::unique_ptr<T> ClientCacheWrapper<T>::query(
 		GenericOperator& op, const QueryRectangle& rect, QueryProfiler &profiler) {
@@ -237,6 +273,13 @@ CacheWrapper<ProvenanceCollection>& ClientCacheManager::get_provenance_cache() {
 	return provenance_cache;
 }
 
+template class CacheWrapper<GenericRaster> ;
+template class CacheWrapper<PointCollection> ;
+template class CacheWrapper<LineCollection> ;
+template class CacheWrapper<PolygonCollection> ;
+template class CacheWrapper<GenericPlot> ;
+template class CacheWrapper<ProvenanceCollection> ;
+
 template class NopCacheWrapper<GenericRaster> ;
 template class NopCacheWrapper<PointCollection> ;
 template class NopCacheWrapper<LineCollection> ;
@@ -10,6 +10,7 @@
 
 #include "cache/node/node_cache.h"
 #include "cache/priv/shared.h"
+#include "cache/priv/single_flight.h"
 
 #include "operators/operator.h"
 
@@ -46,6 +47,34 @@ public:
 	 * @return the result satisfying the given query parameters
 	 */
 	virtual std::unique_ptr<T> query(GenericOperator &op, const QueryRectangle &rect, QueryProfiler &profiler) = 0;
+
+	/**
+	 * Inserts an immutable item into the cache. Implementations keeping results
+	 * in memory share the item instead of copying it.
+	 * @param semantic_id the semantic id
+	 * @param item the data-item to cache, must not be modified afterwards
+	 * @param query the query which produced the result
+	 * @param profiler the profiler which recorded the costs of the query-execution
+	 * @return whether the entry was stored in the cache or not
+	 */
+	virtual bool put_shared(const std::string &semantic_id, const std::shared_ptr<const T> &item, const QueryRectangle &query, const QueryProfiler &profiler);
+
+	/**
+	 * Queries for an item satisfying the given request.
+	 * The result may be the cached version itself and must not be modified,
+	 * use copy_result() to obtain a modifiable copy.
+	 * @param op the operator-graph of the query
+	 * @param rect the query-rectangle
+	 * @param profiler the profiler recording costs of query-execution
+	 * @return the result satisfying the given query parameters
+	 */
+	virtual std::shared_ptr<const T> query_shared(GenericOperator &op, const QueryRectangle &rect, QueryProfiler &profiler);
+
+	/**
+	 * @return the coordinator of concurrent computations after cache misses,
+	 * or nullptr if every miss is computed independently
+	 */
+	virtual SingleFlight<T>* get_single_flight() { return nullptr; }
 };
 
 /**
@@ -108,6 +137,7 @@ public:
 	NopCacheWrapper();
 
 	bool put(const std::string &semantic_id, const std::unique_ptr<T> &item, const QueryRectangle &query, const QueryProfiler &profiler);
+	bool put_shared(const std::string &semantic_id, const std::shared_ptr<const T> &item, const QueryRectangle &query, const QueryProfiler &profiler);
 	std::unique_ptr<T> query(GenericOperator &op, const QueryRectangle &rect, QueryProfiler &profiler);
 };
 
@@ -145,6 +175,7 @@ class ClientCacheWrapper : public CacheWrapper<T> {
 public:
 	ClientCacheWrapper( CacheType type, const std::string &idx_host, int idx_port );
 	bool put(const std::string &semantic_id, const std::unique_ptr<T> &item, const QueryRectangle &query, const QueryProfiler &profiler);
+	bool put_shared(const std::string &semantic_id, const std::shared_ptr<const T> &item, const QueryRectangle &query, const QueryProfiler &profiler);
 	std::unique_ptr<T> query(GenericOperator &op, const QueryRectangle &rect, QueryProfiler &profiler);
 protected:
 	std::unique_ptr<T> read_result( BinaryReadBuffer &buffer );
@@ -75,6 +75,7 @@ bool HybridCacheWrapper<T>::put(const std::string& semantic_id,
 		TIME_EXEC("CacheManager.put.remote");
 
 		Log::debug("Adding item to remote cache: %s", ref.to_string().c_str());
+		auto lock = mgr.get_worker_context().lock_index_connection();
 		idx_con.write(WorkerConnection::RESP_NEW_CACHE_ENTRY, ref);
 		return true;
 	} else {
@@ -93,10 +94,10 @@ std::unique_ptr<T> HybridCacheWrapper<T>::query(GenericOperator& op,
 		profiler.addTotalCosts(e->profile);
 	}
 
-	this->stats.add_query(qres.hit_ratio);
+	this->stats.add_query(qres.hit_ratio, qres.resampled);
 
 	// Full single local hit
-	if ( !qres.has_remainder() && qres.items.size() == 1 ) {
+	if ( !qres.has_remainder() && qres.items.size() == 1 && !qres.resampled ) {
 		this->stats.add_single_local_hit();
 		return qres.items.front()->copy_data();
 	}
@@ -112,7 +113,7 @@ std::unique_ptr<T> HybridCacheWrapper<T>::query(GenericOperator& op,
 		for ( auto &ne : qres.items )
 			items.push_back(ne->data);
 
-		return PuzzleUtil::process(op,rect,qres.remainder,items,profiler);
+		return PuzzleUtil::process(mgr,op,rect,qres.remainder,items,profiler,qres.resampled);
 	}
 	else {
 		this->stats.add_miss();
@@ -16,22 +16,37 @@
 #include "datatypes/plot.h"
 
 #include "util/log.h"
+#include "util/configuration.h"
 
 
 template<class T>
 LocalCacheWrapper<T>::LocalCacheWrapper(LocalCacheManager &mgr, const std::string &repl, size_t size, CacheType type ) :
-	NodeCacheWrapper<T>(mgr, size, type ), mgr(mgr), replacement(std::make_unique<LocalReplacement<T>>( LocalRelevanceFunction::by_name(repl))) {
+	NodeCacheWrapper<T>(mgr, size, type ), mgr(mgr), replacement(std::make_unique<LocalReplacement<T>>( LocalRelevanceFunction::by_name(repl), Configuration::get<bool>("cache.admission", false))),
+	single_flight_enabled(Configuration::get<bool>("cache.singleflight", true)),
+	single_flight([this]() { this->stats.add_coalesced(); }) {
 }
 
 template<class T>
 bool LocalCacheWrapper<T>::put(const std::string &semantic_id,
 		const std::unique_ptr<T> &item, const QueryRectangle &query, const QueryProfiler &profiler) {
-	size_t size = SizeUtil::get_byte_size(*item);
+	return insert(semantic_id, *item, [&item]() { return std::shared_ptr<const T>(item->clone()); }, query, profiler);
+}
+
+template<class T>
+bool LocalCacheWrapper<T>::put_shared(const std::string &semantic_id,
+		const std::shared_ptr<const T> &item, const QueryRectangle &query, const QueryProfiler &profiler) {
+	return insert(semantic_id, *item, [&item]() { return item; }, query, profiler);
+}
+
+template<class T>
+bool LocalCacheWrapper<T>::insert(const std::string &semantic_id, const T &item,
+		const std::function<std::shared_ptr<const T>()> &share, const QueryRectangle &query, const QueryProfiler &profiler) {
+	size_t size = SizeUtil::get_byte_size(item);
 
 	this->stats.add_result_bytes(size);
 
 	if ( mgr.get_strategy().do_cache(profiler,size) && size <= this->cache.get_max_size() ) {
-		CacheCube cube = NodeCacheWrapper<T>::get_bounds(*item, query);
+		CacheCube cube = NodeCacheWrapper<T>::get_bounds(item, query);
         // TODO: find proper way to determine min/max overview resolution
 		// Min/Max resolution hack
 //		if ( query.restype == QueryResolution::Type::PIXELS ) {
@@ -57,13 +72,19 @@ bool LocalCacheWrapper<T>::put(const std::string &semantic_id,
 		Log::trace("Adding item to local cache");
 		{
 			std::lock_guard<std::mutex> g(rem_mtx);
-			auto rems = replacement->get_removals(this->cache,size);
+			std::vector<NodeCacheKey> rems;
+			if ( !replacement->get_removals(this->cache,semantic_id,query,size,rems) ) {
+				Log::trace("Item not admitted, the entries it would replace are requested more often");
+				return false;
+			}
 			for ( auto &r : rems ) {
-				Log::trace("Dropping entry due to space requirement: %s", r.NodeCacheKey::to_string().c_str());
+				Log::trace("Dropping entry due to space requirement: %s", r.to_string().c_str());
 				this->cache.remove(r);
 			}
 		}
-		this->cache.put(semantic_id,item,CacheEntry( cube, size + sizeof(NodeCacheEntry<T>), profiler));
+		CacheEntry entry( cube, size + sizeof(NodeCacheEntry<T>), profiler);
+		auto meta = this->cache.put(semantic_id,share(),entry);
+		replacement->inserted(meta,query,entry);
 		return true;
 	}
 	return false;
@@ -72,21 +93,29 @@ bool LocalCacheWrapper<T>::put(const std::string &semantic_id,
 template<class T>
 std::unique_ptr<T> LocalCacheWrapper<T>::query(GenericOperator& op,
 		const QueryRectangle& rect, QueryProfiler &profiler) {
+	return take_result(query_shared(op, rect, profiler));
+}
+
+template<class T>
+std::shared_ptr<const T> LocalCacheWrapper<T>::query_shared(GenericOperator& op,
+		const QueryRectangle& rect, QueryProfiler &profiler) {
 	if ( mgr.get_worker_context().get_puzzle_depth() > op.getDepth() )
 		throw NoSuchElementException("No query");
 
 	CacheQueryResult<NodeCacheEntry<T>> qres = this->cache.query(op.getSemanticId(), rect);
+	replacement->queried(op.getSemanticId(), rect);
 	for ( auto &e : qres.items ) {
 		// Track costs
 		profiler.addTotalCosts(e->profile);
+		replacement->accessed(NodeCacheKey(op.getSemanticId(), e->entry_id));
 	}
 
-	this->stats.add_query(qres.hit_ratio);
+	this->stats.add_query(qres.hit_ratio, qres.resampled);
 
 	// Full single local hit
-	if ( !qres.has_remainder() && qres.items.size() == 1 ) {
+	if ( !qres.has_remainder() && qres.items.size() == 1 && !qres.resampled ) {
 		this->stats.add_single_local_hit();
-		return qres.items.front()->copy_data();
+		return qres.items.front()->data;
 	}
 	// Partial or Full puzzle
 	else if ( qres.has_hit() ) {
@@ -101,7 +130,7 @@ std::unique_ptr<T> LocalCacheWrapper<T>::query(GenericOperator& op,
 			items.push_back(ne->data);
 
 		PuzzleGuard pg(mgr.get_worker_context());
-		return PuzzleUtil::process(op,rect,qres.remainder,items,profiler);
+		return share_result(PuzzleUtil::process(mgr,op,rect,qres.remainder,items,profiler,qres.resampled));
 	}
 	else {
 		this->stats.add_miss();
@@ -125,6 +154,11 @@ void LocalCacheWrapper<T>::remove_local(const NodeCacheKey& key) {
 	throw MustNotHappenException("No external removals allowed in local cache manager!");
 }
 
+template<class T>
+SingleFlight<T>* LocalCacheWrapper<T>::get_single_flight() {
+	return single_flight_enabled ? &single_flight : nullptr;
+}
+
 template<class T>
 std::unique_ptr<T> LocalCacheWrapper<T>::process_puzzle(
 		const PuzzleRequest& request, QueryProfiler &parent_profiler) {
@@ -12,6 +12,8 @@
 #include "cache/node/manager/local_replacement.h"
 #include "cache/node/puzzle_util.h"
 
+#include <functional>
+
 
 class LocalCacheManager;
 
@@ -25,13 +27,24 @@ public:
 	LocalCacheWrapper( LocalCacheManager &mgr, const std::string &repl, size_t size, CacheType type );
 	bool put(const std::string &semantic_id, const std::unique_ptr<T> &item, const QueryRectangle &query, const QueryProfiler &profiler);
 	std::unique_ptr<T> query(GenericOperator &op, const QueryRectangle &rect, QueryProfiler &profiler);
+	bool put_shared(const std::string &semantic_id, const std::shared_ptr<const T> &item, const QueryRectangle &query, const QueryProfiler &profiler);
+	std::shared_ptr<const T> query_shared(GenericOperator &op, const QueryRectangle &rect, QueryProfiler &profiler);
 	std::unique_ptr<T> process_puzzle( const PuzzleRequest& request, QueryProfiler &parent_profiler );
 	MetaCacheEntry put_local(const std::string &semantic_id, const std::unique_ptr<T> &item, CacheEntry &&info );
 	void remove_local(const NodeCacheKey &key);
+	SingleFlight<T>* get_single_flight();
 private:
+	/**
+	 * Stores the item if the caching strategy and the capacity allow it
+	 * @param share creates the instance to store, only called if the item is stored
+	 */
+	bool insert(const std::string &semantic_id, const T &item, const std::function<std::shared_ptr<const T>()> &share, const QueryRectangle &query, const QueryProfiler &profiler);
+
 	std::mutex rem_mtx;
 	LocalCacheManager &mgr;
 	std::unique_ptr<LocalReplacement<T>> replacement;
+	bool single_flight_enabled;
+	SingleFlight<T> single_flight;
 };
 
 
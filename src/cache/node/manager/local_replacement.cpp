@@ -30,70 +30,190 @@ std::unique_ptr<LocalRelevanceFunction> LocalRelevanceFunction::by_name(
 
 }
 
-void LocalRelevanceFunction::new_turn() {
+//
+// LRU
+//
+
+void LocalLRU::inserted(const NodeCacheKey& key, const CacheEntry& entry) {
+	entries.emplace_front(key, entry.size);
+	positions[key.entry_id] = entries.begin();
+}
+
+void LocalLRU::accessed(uint64_t entry_id) {
+	auto it = positions.find(entry_id);
+	if ( it != positions.end() )
+		entries.splice(entries.begin(), entries, it->second);
+}
+
+void LocalLRU::removed(uint64_t entry_id) {
+	auto it = positions.find(entry_id);
+	if ( it != positions.end() ) {
+		entries.erase(it->second);
+		positions.erase(it);
+	}
 }
 
-bool LocalLRU::operator ()(const LocalRef& e1, const LocalRef& e2) const  {
-	return e1.last_access < e2.last_access;
+void LocalLRU::visit(const std::function<bool(const NodeCacheKey&, uint64_t)>& callback) const {
+	for ( auto it = entries.rbegin(); it != entries.rend(); ++it )
+		if ( !callback(it->key, it->size) )
+			return;
 }
 
-LocalCostLRU::LocalCostLRU() : now(0) {}
+//
+// Cost-LRU
+//
+
+LocalCostLRU::LocalCostLRU() : inflation(0) {}
+
+void LocalCostLRU::inserted(const NodeCacheKey& key, const CacheEntry& entry) {
+	double costs = CachingStrategy::get_costs(entry.profile,CachingStrategy::Type::UNCACHED);
+	double priority = inflation + costs;
+	entries.emplace(key.entry_id, Entry(key, entry.size, costs, priority));
+	order.emplace(priority, key.entry_id);
+}
+
+void LocalCostLRU::accessed(uint64_t entry_id) {
+	auto it = entries.find(entry_id);
+	if ( it == entries.end() )
+		return;
+	order.erase(std::make_pair(it->second.priority, entry_id));
+	it->second.priority = inflation + it->second.costs;
+	order.emplace(it->second.priority, entry_id);
+}
+
+void LocalCostLRU::removed(uint64_t entry_id) {
+	auto it = entries.find(entry_id);
+	if ( it == entries.end() )
+		return;
+	inflation = std::max(inflation, it->second.priority);
+	order.erase(std::make_pair(it->second.priority, entry_id));
+	entries.erase(it);
+}
+
+void LocalCostLRU::visit(const std::function<bool(const NodeCacheKey&, uint64_t)>& callback) const {
+	for ( auto &p : order ) {
+		auto &e = entries.at(p.second);
+		if ( !callback(e.key, e.size) )
+			return;
+	}
+}
+
+//
+// Frequency sketch
+//
+
+const uint8_t FrequencySketch::MAX_COUNT;
+const size_t FrequencySketch::ROWS;
 
-void LocalCostLRU::new_turn()  {
-	now = CacheCommon::time_millis();
+FrequencySketch::FrequencySketch(size_t width, size_t sample_size) :
+	counters(width * ROWS, 0), width(width), sample_size(sample_size), additions(0) {
 }
 
-bool LocalCostLRU::operator ()(const LocalRef& e1, const LocalRef& e2) const  {
-	double f1 = 1.0 - (((now - e1.last_access) / 60000) * 0.01);
-	double f2 = 1.0 - (((now - e2.last_access) / 60000) * 0.01);
+size_t FrequencySketch::index(uint64_t hash, size_t row) const {
+	// derive independent hashes for the rows (Kirsch-Mitzenmacher)
+	uint64_t h1 = hash * 0x9E3779B97F4A7C15ull;
+	uint64_t h2 = (hash ^ (hash >> 29)) * 0xBF58476D1CE4E5B9ull;
+	return row * width + ((h1 + row * (h2 | 1)) >> 17) % width;
+}
 
-	double c1 = CachingStrategy::get_costs(e1.profile,CachingStrategy::Type::UNCACHED);
-	double c2 = CachingStrategy::get_costs(e2.profile,CachingStrategy::Type::UNCACHED);
+void FrequencySketch::increment(uint64_t hash) {
+	for ( size_t r = 0; r < ROWS; r++ ) {
+		auto &c = counters[index(hash,r)];
+		if ( c < MAX_COUNT )
+			c++;
+	}
+	if ( ++additions >= sample_size ) {
+		for ( auto &c : counters )
+			c /= 2;
+		additions /= 2;
+	}
+}
 
-	return (c1 * f1) < (c2 * f2);
+uint8_t FrequencySketch::estimate(uint64_t hash) const {
+	uint8_t result = MAX_COUNT;
+	for ( size_t r = 0; r < ROWS; r++ )
+		result = std::min(result, counters[index(hash,r)]);
+	return result;
 }
 
 //
 // IMPL
 //
 template<class T>
-LocalReplacement<T>::LocalReplacement(std::unique_ptr<LocalRelevanceFunction> relevance) : relevance(std::move(relevance)) {
+LocalReplacement<T>::LocalReplacement(std::unique_ptr<LocalRelevanceFunction> relevance, bool admission_control) :
+	relevance(std::move(relevance)), admission_control(admission_control), sketch(1 << 14, 10 << 14) {
 }
 
 template<class T>
-std::vector<LocalRef> LocalReplacement<T>::get_removals(NodeCache<T>& cache,
-		size_t space_required) {
-	std::vector<LocalRef> all_entries;
+uint64_t LocalReplacement<T>::hash(const std::string& semantic_id, const QueryRectangle& query) {
+	std::hash<double> hd;
+	uint64_t result = std::hash<std::string>()(semantic_id);
+	for ( double v : {query.x1, query.y1, query.x2, query.y2, query.t1, query.t2, (double) query.xres, (double) query.yres} )
+		result = result * 31 + hd(v);
+	return result;
+}
 
-	size_t avail = (cache.get_current_size() > cache.get_max_size()) ? 0 : cache.get_max_size() - cache.get_current_size();
-	if ( avail < space_required ) {
-		CacheHandshake hs = cache.get_all();
-		for (auto &p : hs.get_items()) {
-			for (auto &e : p.second)
-				all_entries.push_back(LocalRef(p.first, e));
-		}
-		relevance->new_turn();
-		return compute_removals(all_entries, space_required-avail);
-	}
-	return all_entries;
+template<class T>
+void LocalReplacement<T>::queried(const std::string& semantic_id, const QueryRectangle& query) {
+	if ( !admission_control )
+		return;
+	std::lock_guard<std::mutex> g(mtx);
+	sketch.increment(hash(semantic_id,query));
 }
 
 template<class T>
-std::vector<LocalRef> LocalReplacement<T>::compute_removals(
-		std::vector<LocalRef>& all_entries, size_t space_required) {
+void LocalReplacement<T>::accessed(const NodeCacheKey& key) {
+	std::lock_guard<std::mutex> g(mtx);
+	relevance->accessed(key.entry_id);
+	if ( admission_control ) {
+		// a hit answers a query the entry was not necessarily produced for
+		auto it = entry_hashes.find(key.entry_id);
+		if ( it != entry_hashes.end() )
+			sketch.increment(it->second);
+	}
+}
 
-	std::vector<LocalRef> result;
-	std::sort(all_entries.begin(), all_entries.end(), std::ref(*relevance) );
+template<class T>
+bool LocalReplacement<T>::get_removals(const NodeCache<T>& cache, const std::string &semantic_id,
+		const QueryRectangle &query, size_t space_required, std::vector<NodeCacheKey> &removals) {
+	size_t avail = (cache.get_current_size() > cache.get_max_size()) ? 0 : cache.get_max_size() - cache.get_current_size();
+	if ( avail >= space_required )
+		return true;
 
+	std::lock_guard<std::mutex> g(mtx);
+	uint8_t candidate_frequency = admission_control ? sketch.estimate(hash(semantic_id,query)) : 0;
+	bool admit = true;
 	size_t space_freed = 0;
-	auto i = all_entries.begin();
-
-	while ( space_freed < space_required && i != all_entries.end() ) {
-		space_freed += i->size;
-		result.push_back( *i );
-		i++;
+	relevance->visit( [&]( const NodeCacheKey &key, uint64_t size ) {
+		if ( admission_control ) {
+			auto it = entry_hashes.find(key.entry_id);
+			if ( it != entry_hashes.end() && sketch.estimate(it->second) >= candidate_frequency ) {
+				admit = false;
+				return false;
+			}
+		}
+		removals.push_back(key);
+		space_freed += size;
+		return space_freed < space_required - avail;
+	});
+
+	if ( !admit ) {
+		removals.clear();
+		return false;
 	}
-	return result;
+	for ( auto &key : removals ) {
+		relevance->removed(key.entry_id);
+		entry_hashes.erase(key.entry_id);
+	}
+	return true;
+}
+
+template<class T>
+void LocalReplacement<T>::inserted(const NodeCacheKey& key, const QueryRectangle& query, const CacheEntry& entry) {
+	std::lock_guard<std::mutex> g(mtx);
+	relevance->inserted(key, entry);
+	if ( admission_control )
+		entry_hashes.emplace(key.entry_id, hash(key.semantic_id, query));
 }
 
 template class LocalReplacement<GenericRaster>;
@@ -10,65 +10,181 @@
 
 #include "cache/node/node_cache.h"
 #include <algorithm>
-
-class LocalRef: public NodeCacheKey, public CacheEntry {
-public:
-	LocalRef(const std::string &semantic_id, const HandshakeEntry &e) :
-			NodeCacheKey(semantic_id, e.entry_id), CacheEntry(e) {
-	}
-};
+#include <functional>
+#include <list>
+#include <set>
+#include <unordered_map>
 
 
 /**
- * Defines an ordering on cache-entries, so
- * that after sorting them, the least relevant entries
- * are at the end of the sorted structure
+ * Keeps the entries of a local cache ordered by their relevance, so
+ * the least relevant entries are found without looking at all entries.
+ * Implementations are not thread-safe.
  */
 class LocalRelevanceFunction {
 public:
 	static std::unique_ptr<LocalRelevanceFunction> by_name( const std::string &name );
 	virtual ~LocalRelevanceFunction() = default;
-	virtual void new_turn();
+
+	/**
+	 * Adds a newly cached entry
+	 * @param key the key of the entry
+	 * @param entry the meta-information of the entry
+	 */
+	virtual void inserted( const NodeCacheKey &key, const CacheEntry &entry ) = 0;
+
+	/**
+	 * Notifies about a cache-hit on the entry with the given id.
+	 * Unknown ids are ignored.
+	 * @param entry_id the id of the entry
+	 */
+	virtual void accessed( uint64_t entry_id ) = 0;
+
 	/**
-	 * Compares the given entries by their relevance. If e1 is more relevant
-	 * than e2, true is returned.
-	 * @param e1 the first entry
-	 * @param e2 the second entry
-	 * @return whether e1 is more relevant than e2
+	 * Removes the entry with the given id
+	 * @param entry_id the id of the entry
 	 */
-	virtual bool operator() ( const LocalRef &e1, const LocalRef &e2 ) const = 0;
+	virtual void removed( uint64_t entry_id ) = 0;
+
+	/**
+	 * Visits the entries starting with the least relevant one,
+	 * until the callback returns false.
+	 * @param callback called with the key and size of each entry
+	 */
+	virtual void visit( const std::function<bool(const NodeCacheKey&, uint64_t)> &callback ) const = 0;
 };
 
 /**
- * Simple LRU-Implementation of the relevance function
+ * Simple LRU-Implementation of the relevance function.
+ * Accesses move the entry to the front of a list, so all operations take constant time.
  */
 class LocalLRU : public LocalRelevanceFunction {
 public:
-	bool operator() ( const LocalRef &e1, const LocalRef &e2 ) const;
+	void inserted( const NodeCacheKey &key, const CacheEntry &entry );
+	void accessed( uint64_t entry_id );
+	void removed( uint64_t entry_id );
+	void visit( const std::function<bool(const NodeCacheKey&, uint64_t)> &callback ) const;
+private:
+	class Entry {
+	public:
+		Entry( const NodeCacheKey &key, uint64_t size ) : key(key), size(size) {};
+		NodeCacheKey key;
+		uint64_t size;
+	};
+	// most recently used first
+	std::list<Entry> entries;
+	std::unordered_map<uint64_t,std::list<Entry>::iterator> positions;
 };
 
 /**
- * A cost based LRU implementation of the relevance function.
- * Main factor for the ordering are the computation costs. They are
- * weighted with a time since the last access to the entry.
+ * A cost based LRU implementation of the relevance function (GreedyDual).
+ * Every entry has a priority of its computation costs plus an inflation value,
+ * which is raised to the priority of each evicted entry. Entries that are not
+ * accessed again are thereby overtaken by newer and recently accessed ones, while
+ * expensive results stay longer than cheap ones. The entries are kept in an ordered
+ * set, so accesses and evictions take logarithmic time.
  */
 class LocalCostLRU : public LocalRelevanceFunction {
 public:
 	LocalCostLRU();
-	void new_turn();
-	bool operator() ( const LocalRef &e1, const LocalRef &e2 ) const;
+	void inserted( const NodeCacheKey &key, const CacheEntry &entry );
+	void accessed( uint64_t entry_id );
+	void removed( uint64_t entry_id );
+	void visit( const std::function<bool(const NodeCacheKey&, uint64_t)> &callback ) const;
+private:
+	class Entry {
+	public:
+		Entry( const NodeCacheKey &key, uint64_t size, double costs, double priority ) :
+			key(key), size(size), costs(costs), priority(priority) {};
+		NodeCacheKey key;
+		uint64_t size;
+		double costs;
+		double priority;
+	};
+	double inflation;
+	// (priority, entry_id), least relevant first
+	std::set<std::pair<double,uint64_t>> order;
+	std::unordered_map<uint64_t,Entry> entries;
+};
+
+/**
+ * Estimates how often keys were requested recently (TinyLFU). The counts are
+ * kept in a count-min sketch of saturating counters, which are halved after
+ * a number of increments, so the popularity of old keys fades out.
+ */
+class FrequencySketch {
+public:
+	static const uint8_t MAX_COUNT = 15;
+	static const size_t ROWS = 4;
+
+	/**
+	 * @param width the number of counters per row
+	 * @param sample_size the number of increments after which all counters are halved
+	 */
+	FrequencySketch( size_t width, size_t sample_size );
+	void increment( uint64_t hash );
+	uint8_t estimate( uint64_t hash ) const;
 private:
-	time_t now;
+	size_t index( uint64_t hash, size_t row ) const;
+	std::vector<uint8_t> counters;
+	size_t width;
+	size_t sample_size;
+	size_t additions;
 };
 
+/**
+ * Selects the entries to evict from a local cache. Optionally, new entries are
+ * only admitted if they were requested more often than the entries they would replace,
+ * so results requested only once do not flush frequently used ones.
+ * All methods are thread-safe.
+ */
 template<class T>
 class LocalReplacement {
 public:
-	LocalReplacement( std::unique_ptr<LocalRelevanceFunction> relevance );
-	std::vector<LocalRef> get_removals(NodeCache<T> &cache, size_t space_required);
+	LocalReplacement( std::unique_ptr<LocalRelevanceFunction> relevance, bool admission_control = false );
+
+	/**
+	 * Records a query against the cache
+	 */
+	void queried( const std::string &semantic_id, const QueryRectangle &query );
+
+	/**
+	 * Records a hit on the entry with the given key
+	 */
+	void accessed( const NodeCacheKey &key );
+
+	/**
+	 * Selects the entries to remove before adding a new entry. The selected entries are
+	 * no longer considered and must be removed from the cache.
+	 * @param cache the cache
+	 * @param semantic_id the semantic id of the new entry
+	 * @param query the query which produced the new entry
+	 * @param space_required the size of the new entry
+	 * @param removals receives the keys of the entries to remove
+	 * @return whether the new entry should be added, removals is empty otherwise
+	 */
+	bool get_removals( const NodeCache<T> &cache, const std::string &semantic_id, const QueryRectangle &query,
+			size_t space_required, std::vector<NodeCacheKey> &removals );
+
+	/**
+	 * Adds an entry after it was stored in the cache
+	 * @param key the key of the entry
+	 * @param query the query which produced the entry
+	 * @param entry the meta-information of the entry
+	 */
+	void inserted( const NodeCacheKey &key, const QueryRectangle &query, const CacheEntry &entry );
+
+	/**
+	 * @return the key of the given query used for estimating its popularity
+	 */
+	static uint64_t hash( const std::string &semantic_id, const QueryRectangle &query );
 private:
-	std::vector<LocalRef> compute_removals(std::vector<LocalRef> &all_entries, size_t space_required);
+	std::mutex mtx;
 	std::unique_ptr<LocalRelevanceFunction> relevance;
+	bool admission_control;
+	FrequencySketch sketch;
+	// entry id -> hash of the query which produced the entry
+	std::unordered_map<uint64_t,uint64_t> entry_hashes;
 };
 
 #endif /* CACHE_NODE_MANAGER_LOCAL_REPLACEMENT_H_ */
@@ -76,6 +76,7 @@ bool RemoteCacheWrapper<T>::put(const std::string& semantic_id,
 		TIME_EXEC("CacheManager.put.remote");
 
 		Log::debug("Adding item to remote cache: %s", ref.to_string().c_str());
+		auto lock = mgr.get_worker_context().lock_index_connection();
 		idx_con.write(WorkerConnection::RESP_NEW_CACHE_ENTRY, ref);
 		return true;
 	} else {
@@ -99,13 +100,13 @@ std::unique_ptr<T> RemoteCacheWrapper<T>::query(GenericOperator& op,
 	CacheQueryResult < NodeCacheEntry < T >> qres = this->cache.query(op.getSemanticId(), rect);
 	// Only process locally if there is no remainder
 	if (!qres.has_remainder()) {
-		this->stats.add_query(qres.hit_ratio);
+		this->stats.add_query(qres.hit_ratio, qres.resampled);
 
 		// Track costs
 		for (auto &e : qres.items)
 			profiler.addTotalCosts(e->profile);
 
-		if (qres.items.size() == 1) {
+		if (qres.items.size() == 1 && !qres.resampled) {
 			this->stats.add_single_local_hit();
 			return qres.items.front()->copy_data();
 		}
@@ -117,7 +118,7 @@ std::unique_ptr<T> RemoteCacheWrapper<T>::query(GenericOperator& op,
 			for (auto &ne : qres.items) {
 				items.push_back(ne->data);
 			}
-			return PuzzleUtil::process(op, rect, qres.remainder, items, profiler);
+			return PuzzleUtil::process(mgr, op, rect, qres.remainder, items, profiler, qres.resampled);
 		}
 	}
 
@@ -130,9 +131,12 @@ std::unique_ptr<T> RemoteCacheWrapper<T>::query(GenericOperator& op,
 			op.getSemanticId().c_str());
 	BaseRequest cr(this->cache.type, op.getSemanticId(), rect);
 
-	std::unique_ptr<BinaryReadBuffer> resp =
-			mgr.get_worker_context().get_index_connection().write_and_read(
-					WorkerConnection::CMD_QUERY_CACHE, cr);
+	std::unique_ptr<BinaryReadBuffer> resp;
+	{
+		auto lock = mgr.get_worker_context().lock_index_connection();
+		resp = mgr.get_worker_context().get_index_connection().write_and_read(
+				WorkerConnection::CMD_QUERY_CACHE, cr);
+	}
 	uint8_t rc = resp->read<uint8_t>();
 
 	switch (rc) {
@@ -220,32 +224,8 @@ std::unique_ptr<T> RemoteCacheWrapper<T>::process_puzzle_int( GenericOperator &o
 		const PuzzleRequest& request, QueryProfiler& profiler) {
 
 	TIME_EXEC("CacheManager.puzzle");
-
-	std::vector<std::shared_ptr<const T>> parts;
-
-	std::vector<Cube<3>> rems;
-	rems.insert(rems.begin(), request.remainder.begin(), request.remainder.end());
-
-	for (auto &ref : request.parts) {
-		try {
-			parts.push_back(retriever.fetch(request.semantic_id, ref, profiler));
-		} catch ( const NoSuchElementException &nse ) {
-			Log::debug("Puzzle-piece gone, adding to remainders");
-			SpatialReference sref(request.query.crsId,ref.bounds.get_dimension(0).a,ref.bounds.get_dimension(1).a,
-					ref.bounds.get_dimension(0).b,ref.bounds.get_dimension(1).b);
-
-			rems.push_back(ref.bounds);
-		}
-	}
-
-	// All parts gone!
-	if ( parts.empty() ) {
-		throw NoSuchElementException("All puzzle pieces gone!");
-	}
-	else {
-		PuzzleGuard pg(mgr.get_worker_context());
-		return PuzzleUtil::process(op, request.query, request.remainder, parts, profiler);
-	}
+	PuzzleGuard pg(mgr.get_worker_context());
+	return PuzzleUtil::process(mgr, op, request, retriever, profiler);
 }
 
 ////////////////////////////////////////////////////////////
@@ -23,20 +23,21 @@
 //
 //////////////////////////////////////////////////////////////
 
+template<>
+std::unique_ptr<GenericRaster> copy_result( const GenericRaster &item ) {
+	// Cached rasters are kept in the CPU representation, so clone() does not modify them
+	return const_cast<GenericRaster&>(item).clone();
+}
+
 template<typename EType>
 NodeCacheEntry<EType>::NodeCacheEntry(uint64_t entry_id, const CacheEntry &meta,
-		std::shared_ptr<EType> result) :
+		std::shared_ptr<const EType> result) :
 		CacheEntry(meta), entry_id(entry_id), data(result) {
 }
 
 template<typename EType>
 std::unique_ptr<EType> NodeCacheEntry<EType>::copy_data() const {
-	return data->clone();
-}
-
-template<>
-std::unique_ptr<GenericRaster> NodeCacheEntry<GenericRaster>::copy_data() const {
-	return const_cast<GenericRaster*>(data.get())->clone();
+	return copy_result(*data);
 }
 
 
@@ -61,13 +62,14 @@ template class NodeCacheEntry<ProvenanceCollection>;
 ///////////////////////////////////////////////////////////////////
 
 template<typename EType>
-NodeCache<EType>::NodeCache(CacheType type, size_t max_size) : Cache<uint64_t,NodeCacheEntry<EType>>(false),
+NodeCache<EType>::NodeCache(CacheType type, size_t max_size, double max_resample_factor) :
+		Cache<uint64_t,NodeCacheEntry<EType>>(false, max_resample_factor),
 		type(type), max_size(max_size), current_size(0), next_id(1) {
 	Log::debug("Creating new cache with capacity: %d bytes", max_size);
 }
 
 template<>
-NodeCache<GenericPlot>::NodeCache(CacheType type, size_t max_size) : Cache(true),
+NodeCache<GenericPlot>::NodeCache(CacheType type, size_t max_size, double) : Cache(true),
 		type(type), max_size(max_size), current_size(0), next_id(1) {
 	Log::debug("Creating new cache with capacity: %d bytes", max_size);
 }
@@ -114,11 +116,15 @@ void NodeCache<EType>::remove(const NodeCacheKey& key) {
 template<typename EType>
 const MetaCacheEntry NodeCache<EType>::put(const std::string &semantic_id,
 		const std::unique_ptr<EType> &item, const CacheEntry &meta) {
+	return put(semantic_id, std::shared_ptr<const EType>(item->clone()), meta);
+}
+
+template<typename EType>
+const MetaCacheEntry NodeCache<EType>::put(const std::string &semantic_id,
+		const std::shared_ptr<const EType> &item, const CacheEntry &meta) {
 	uint64_t id = next_id++;
-	auto cpy = item->clone();
 	auto entry = std::shared_ptr<NodeCacheEntry<EType>>(
-			new NodeCacheEntry<EType>(id, meta,
-					std::shared_ptr<EType>(cpy.release())));
+			new NodeCacheEntry<EType>(id, meta, item));
 	this->put_int(semantic_id, id, entry);
 	current_size += entry->size;
 	return MetaCacheEntry(type, semantic_id, id, *entry);
@@ -19,6 +19,63 @@
 #include <memory>
 #include <mutex>
 
+class GenericRaster;
+
+/**
+ * Copies an immutable result, e.g. a cached one, so the copy may be modified
+ * @param item the result to copy
+ * @return the copy
+ */
+template<typename T>
+std::unique_ptr<T> copy_result( const T &item ) {
+	return item.clone();
+}
+
+template<>
+std::unique_ptr<GenericRaster> copy_result( const GenericRaster &item );
+
+/**
+ * Deletes a result created by share_result() unless take_result() took it back
+ */
+template<typename T>
+class SharedResultDeleter {
+public:
+	SharedResultDeleter() : taken(false) {}
+	void operator()( const T *item ) const {
+		if ( !taken )
+			delete item;
+	}
+	bool taken;
+};
+
+/**
+ * Makes a computed result immutable, so it can be shared with the cache without copying it.
+ * Rasters must be in the CPU representation, see copy_result().
+ * @param item the result
+ * @return the shared result
+ */
+template<typename T>
+std::shared_ptr<const T> share_result( std::unique_ptr<T> item ) {
+	return std::shared_ptr<const T>( item.release(), SharedResultDeleter<T>() );
+}
+
+/**
+ * Copy-on-write for shared results: hands the result back without copying it if it
+ * was created by share_result() and nobody else, e.g. the cache, holds it anymore.
+ * Otherwise returns a copy.
+ * @param item the shared result
+ * @return the result, which may be modified
+ */
+template<typename T>
+std::unique_ptr<T> take_result( std::shared_ptr<const T> item ) {
+	auto deleter = std::get_deleter<SharedResultDeleter<T>>(item);
+	if ( deleter == nullptr || item.use_count() != 1 )
+		return copy_result(*item);
+	deleter->taken = true;
+	std::unique_ptr<T> result( const_cast<T*>(item.get()) );
+	item.reset();
+	return result;
+}
 
 /**
  * Models an entry in the node-cache
@@ -33,7 +90,7 @@ public:
 	 * @param result the data to cache
 	 *
 	 */
-	NodeCacheEntry( uint64_t entry_id, const CacheEntry &meta, std::shared_ptr<EType> result );
+	NodeCacheEntry( uint64_t entry_id, const CacheEntry &meta, std::shared_ptr<const EType> result );
 
 	/**
 	 * @return a copy of the cached data
@@ -61,8 +118,10 @@ public:
 	 * Creates a new instance
 	 * @param type the type of the cached items
 	 * @param max_size the max. size this cache may use (in bytes)
+	 * @param max_resample_factor also answer raster queries from entries with a pixel-scale
+	 *        up to this factor finer than requested
 	 */
-	NodeCache( CacheType type, size_t max_size );
+	NodeCache( CacheType type, size_t max_size, double max_resample_factor = 1 );
 
 	NodeCache() = delete;
 	NodeCache( const NodeCache& ) = delete;
@@ -78,6 +137,16 @@ public:
 	 */
 	const MetaCacheEntry put( const std::string &semantic_id, const std::unique_ptr<EType> &item, const CacheEntry &meta);
 
+	/**
+	 * Adds an entry to the cache. The given data-item is shared, not copied,
+	 * so it must not be modified afterwards.
+	 * @param semantic_id the semantic id
+	 * @param item the data-item to cache
+	 * @param meta the meta-data
+	 * @return the meta-data of the newly created entry including its unique id
+	 */
+	const MetaCacheEntry put( const std::string &semantic_id, const std::shared_ptr<const EType> &item, const CacheEntry &meta);
+
 	/**
 	 * Removes the entry with the given key
 	 * @param key the key of the entry to remove
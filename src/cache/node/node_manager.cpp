@@ -18,6 +18,7 @@
 #include "datatypes/polygoncollection.h"
 #include "datatypes/plot.h"
 
+#include "util/configuration.h"
 #include "util/log.h"
 
 ////////////////////////////////////////////////////////////
@@ -71,14 +72,19 @@ void ActiveQueryStats::add_lost_put() {
 	lost_puts++;
 }
 
+void ActiveQueryStats::add_coalesced() {
+	std::lock_guard<std::mutex> g(mtx);
+	coalesced++;
+}
+
 QueryStats ActiveQueryStats::get() const {
 	std::lock_guard<std::mutex> g(mtx);
 	return QueryStats(*this);
 }
 
-void ActiveQueryStats::add_query(double ratio) {
+void ActiveQueryStats::add_query(double ratio, bool resampled) {
 	std::lock_guard<std::mutex> g(mtx);
-	QueryStats::add_query(ratio);
+	QueryStats::add_query(ratio, resampled);
 }
 
 QueryStats ActiveQueryStats::get_and_reset() {
@@ -95,7 +101,7 @@ QueryStats ActiveQueryStats::get_and_reset() {
 //
 ////////////////////////////////////////////////////////////
 
-WorkerContext::WorkerContext() : puzzling(0), index_connection(nullptr) {
+WorkerContext::WorkerContext() : puzzling(0), index_connection(nullptr), index_mtx(&own_index_mtx) {
 }
 
 BlockingConnection& WorkerContext::get_index_connection() const {
@@ -108,6 +114,10 @@ void WorkerContext::set_index_connection(BlockingConnection *con) {
 	index_connection = con;
 }
 
+std::unique_lock<std::mutex> WorkerContext::lock_index_connection() const {
+	return std::unique_lock<std::mutex>(*index_mtx);
+}
+
 ////////////////////////////////////////////////////////////
 //
 // NodeCacheWrapper
@@ -117,7 +127,7 @@ void WorkerContext::set_index_connection(BlockingConnection *con) {
 
 template<typename T>
 NodeCacheWrapper<T>::NodeCacheWrapper( NodeCacheManager &mgr, size_t size, CacheType type ) :
-	mgr(mgr), cache(type,size) {
+	mgr(mgr), cache(type,size,Configuration::get<double>("cache.max_resample_factor", 1.0)) {
 }
 
 
@@ -297,3 +307,21 @@ PuzzleGuard::PuzzleGuard(WorkerContext& ctx) : ctx(ctx) {
 PuzzleGuard::~PuzzleGuard() {
 	ctx.puzzling--;
 }
+
+DelegationGuard::DelegationGuard(WorkerContext& ctx, const WorkerContext& worker, int puzzle_depth) :
+	ctx(ctx), delegated(&ctx != &worker), puzzling(ctx.puzzling),
+	index_connection(ctx.index_connection), index_mtx(ctx.index_mtx) {
+	if ( delegated ) {
+		ctx.puzzling = puzzle_depth;
+		ctx.index_connection = worker.index_connection;
+		ctx.index_mtx = worker.index_mtx;
+	}
+}
+
+DelegationGuard::~DelegationGuard() {
+	if ( delegated ) {
+		ctx.puzzling = puzzling;
+		ctx.index_connection = index_connection;
+		ctx.index_mtx = index_mtx;
+	}
+}
@@ -16,6 +16,7 @@
 
 #include <string>
 #include <memory>
+#include <mutex>
 
 
 class NodeCacheManager;
@@ -49,10 +50,14 @@ public:
 
 	void add_lost_put();
 
+	/** Adds a request that got the result of a concurrent computation */
+	void add_coalesced();
+
 	/** Adds a full miss */
 	void add_miss();
 
-	void add_query(double ratio);
+	/** Adds a cache-query, answered from entries with a finer resolution if resampled is set */
+	void add_query(double ratio, bool resampled = false);
 
 	/**
 	 * @return the current counters
@@ -73,6 +78,7 @@ private:
  */
 class WorkerContext {
 	friend class PuzzleGuard;
+	friend class DelegationGuard;
 public:
 	/** Constructs a new instance */
 	WorkerContext();
@@ -92,12 +98,22 @@ public:
 	 */
 	BlockingConnection& get_index_connection() const;
 
+	/**
+	 * Locks this worker's connection to the index-server. The lock must be held
+	 * while using the connection, since threads working on behalf of this worker
+	 * share it.
+	 * @return the lock
+	 */
+	std::unique_lock<std::mutex> lock_index_connection() const;
+
 	bool is_puzzling() const;
 	int get_puzzle_depth() const;
 
 private:
 	int puzzling;
 	BlockingConnection* index_connection;
+	std::mutex own_index_mtx;
+	std::mutex* index_mtx;
 };
 
 class PuzzleGuard {
@@ -108,6 +124,29 @@ private:
 	WorkerContext &ctx;
 };
 
+/**
+ * Lets the current thread work on behalf of a worker, e.g. on parts of its
+ * request on the thread-pool. For the lifetime of the guard, the thread's context
+ * shares the worker's index-connection and has the given puzzle-depth.
+ * Does nothing if the thread is the worker itself.
+ */
+class DelegationGuard {
+public:
+	/**
+	 * @param ctx the context of the current thread
+	 * @param worker the context of the worker
+	 * @param puzzle_depth the worker's puzzle-depth when handing out the work
+	 */
+	DelegationGuard( WorkerContext &ctx, const WorkerContext &worker, int puzzle_depth );
+	~DelegationGuard();
+private:
+	WorkerContext &ctx;
+	bool delegated;
+	int puzzling;
+	BlockingConnection* index_connection;
+	std::mutex* index_mtx;
+};
+
 //
 // Node-Cache
 // Gives uniform access to the real cache-implementation
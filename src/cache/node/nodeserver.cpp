@@ -18,6 +18,9 @@
 #include "datatypes/plot.h"
 
 #include "util/exceptions.h"
+#include "util/bufferpool.h"
+#include "util/gdal_dataset_cache.h"
+#include "util/gdal_source_datasets.h"
 #include "util/log.h"
 
 #include <sstream>
@@ -114,23 +117,23 @@ void NodeServer::process_create_request(BlockingConnection &index_con,
 	QueryProfiler profiler;
 	switch ( request.type ) {
 		case CacheType::RASTER: {
-			auto res = op->getCachedRaster( request.query, QueryTools(profiler) );
-			finish_request( index_con, std::shared_ptr<const GenericRaster>(res.release()) );
+			auto res = op->getCachedRasterShared( request.query, QueryTools(profiler) );
+			finish_request( index_con, res );
 			break;
 		}
 		case CacheType::POINT: {
-			auto res = op->getCachedPointCollection( request.query, QueryTools(profiler) );
-			finish_request( index_con, std::shared_ptr<const PointCollection>(res.release()) );
+			auto res = op->getCachedPointCollectionShared( request.query, QueryTools(profiler) );
+			finish_request( index_con, res );
 			break;
 		}
 		case CacheType::LINE: {
-			auto res = op->getCachedLineCollection(request.query, QueryTools(profiler) );
-			finish_request( index_con, std::shared_ptr<const LineCollection>(res.release()) );
+			auto res = op->getCachedLineCollectionShared(request.query, QueryTools(profiler) );
+			finish_request( index_con, res );
 			break;
 		}
 		case CacheType::POLYGON: {
-			auto res = op->getCachedPolygonCollection(request.query, QueryTools(profiler) );
-			finish_request( index_con, std::shared_ptr<const PolygonCollection>(res.release()) );
+			auto res = op->getCachedPolygonCollectionShared(request.query, QueryTools(profiler) );
+			finish_request( index_con, res );
 			break;
 		}
 		case CacheType::PLOT: {
@@ -308,6 +311,13 @@ void NodeServer::process_control_command(BinaryReadBuffer &payload) {
 			Log::trace("Received stats-request.");
 			NodeStats stats = manager->get_stats_delta();
 			control_connection->write(ControlConnection::RESP_STATS,stats);
+			auto pool = BufferPool::getStatistics();
+			Log::debug("Raster buffer pool: %lu hits, %lu misses, %lu releases, %lu bytes retained",
+					pool.hits, pool.misses, pool.releases, pool.bytes_retained);
+			auto datasets = GDALDatasetCache::getStatistics();
+			auto descriptions = GDALSourceDataSets::getDescriptionCacheStatistics();
+			Log::debug("GDAL dataset cache: %lu hits, %lu misses, %lu evictions, %lu idle; descriptions: %lu hits, %lu misses",
+					datasets.hits, datasets.misses, datasets.evictions, datasets.idle, descriptions.hits, descriptions.misses);
 			break;
 		}
 		default: {
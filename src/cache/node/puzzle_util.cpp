@@ -17,8 +17,11 @@
 #include "datatypes/plot.h"
 #include "operators/provenance.h"
 
+#include "util/configuration.h"
 #include "util/log.h"
+#include "util/threadpool.h"
 
+#include <algorithm>
 #include <limits>
 
 /**
@@ -62,50 +65,142 @@ void AttributeArraysHelper::append_arr(AttributeArrays::AttributeArray<T>& dest,
 }
 
 template<class T>
-std::unique_ptr<T> PuzzleUtil::process(GenericOperator &op,
+std::unique_ptr<T> PuzzleUtil::process(NodeCacheManager &mgr, GenericOperator &op,
 		const QueryRectangle& query, const std::vector<Cube<3> >& remainder,
 		const std::vector<std::shared_ptr<const T> >& items,
-		QueryProfiler &profiler) {
+		QueryProfiler &profiler, bool resample) {
 
 	TIME_EXEC("PuzzleUtil.process_puzzle");
-	Log::trace("Processing puzzle-request with %ld available items and %ld remainders: %s", items.size(), remainder.size());
+	Log::trace("Processing puzzle-request with %ld available items and %ld remainders", items.size(), remainder.size());
 
 	// Create remainder
 	Log::trace("Creating remainder queries.");
 
 	auto ref = items.front();
-	auto remainders = compute_remainders<T>(query, op, *ref, remainder, profiler);
+	auto remainders = compute_remainders<T>(mgr, query, op, *ref, remainder, profiler, resample);
 
 	std::vector<std::shared_ptr<const T>> all_items = items;
+	all_items.insert(all_items.end(), remainders.begin(), remainders.end());
+	return combine(query, all_items, resample);
+}
+
+template<class T>
+std::unique_ptr<T> PuzzleUtil::process(NodeCacheManager &mgr, GenericOperator &op,
+		const PuzzleRequest &request, const PieceRetriever<T> &retriever,
+		QueryProfiler &profiler) {
+
+	TIME_EXEC("PuzzleUtil.process_puzzle");
+	Log::trace("Processing puzzle-request with %ld pieces and %ld remainders", request.parts.size(), request.remainder.size());
+
+	std::vector<std::shared_ptr<const T>> items;
+	std::vector<Cube<3>> rems;
+	std::vector<const CacheRef*> foreign;
+
+	// Local pieces are at hand and serve as reference for the remainders
+	for (auto &ref : request.parts) {
+		if (!retriever.is_local(ref))
+			foreign.push_back(&ref);
+		else {
+			try {
+				items.push_back(retriever.fetch(request.semantic_id, ref, profiler));
+			} catch ( const NoSuchElementException &nse ) {
+				Log::debug("Puzzle-piece gone, adding to remainders");
+				rems.push_back(ref.bounds);
+			}
+		}
+	}
+
+	// Fetch foreign pieces while computing the remainders
+	std::vector<QueryRectangle> rem_queries;
+	if (!items.empty())
+		rem_queries = get_remainder_queries(request.query, request.remainder, *items.front(), false);
 
-	for (auto &r : remainders)
-		all_items.push_back(std::shared_ptr<const T>(r.release()));
+	std::vector<std::shared_ptr<const T>> results(foreign.size() + rem_queries.size());
+	run_concurrently(mgr, results.size(), [&](size_t i, QueryProfiler &qp) {
+		if (i < foreign.size()) {
+			try {
+				results[i] = retriever.fetch(request.semantic_id, *foreign[i], qp);
+			} catch ( const NoSuchElementException &nse ) {
+				Log::debug("Puzzle-piece gone, adding to remainders");
+			}
+		}
+		else
+			results[i] = compute<T>(op, rem_queries[i - foreign.size()], qp);
+	}, profiler);
+
+	for (size_t i = 0; i < foreign.size(); i++) {
+		if (results[i] == nullptr)
+			rems.push_back(foreign[i]->bounds);
+	}
+	// Pieces first, the first one is the reference for puzzling
+	auto remainders_begin = std::stable_partition(results.begin(), results.begin() + foreign.size(),
+			[](const std::shared_ptr<const T> &r) { return r != nullptr; });
+	items.insert(items.end(), results.begin(), remainders_begin);
+
+	if (items.empty())
+		throw NoSuchElementException("All puzzle pieces gone!");
 
-	auto bounds = enlarge_puzzle(query, all_items);
-	auto result = puzzle(bounds, all_items);
+	// Without local pieces, the remainders are computed once the reference is fetched
+	if (rem_queries.empty())
+		rems.insert(rems.end(), request.remainder.begin(), request.remainder.end());
+	auto remainders = compute_remainders<T>(mgr, request.query, op, *items.front(), rems, profiler);
+
+	items.insert(items.end(), results.begin() + foreign.size(), results.end());
+	items.insert(items.end(), remainders.begin(), remainders.end());
+	return combine(request.query, items);
+}
+
+template<class T>
+std::unique_ptr<T> PuzzleUtil::combine(const QueryRectangle &query,
+		const std::vector<std::shared_ptr<const T> >& items, bool resample) {
+	auto bounds = enlarge_puzzle(query, items);
+	if (resample) {
+		// Downsample to the query's pixel grid, keeping the temporal validity of the pieces
+		bounds = SpatioTemporalReference(query, bounds);
+	}
+	auto result = puzzle(bounds, items, resample ? (const QueryResolution&) query : QueryResolution::none());
 	Log::trace("Finished processing puzzle-request:");
 	return result;
 }
 
-template<class T>
-std::vector<std::unique_ptr<T> > PuzzleUtil::compute_remainders(
-		const QueryRectangle& query, GenericOperator &op, const T& ref_result, const std::vector<Cube<3> >& remainder, QueryProfiler& profiler) {
-	TIME_EXEC("PuzzleUtil.compute_remainders");
-	std::vector<std::unique_ptr<T>> result;
+void PuzzleUtil::run_concurrently(NodeCacheManager &mgr, size_t n,
+		const std::function<void(size_t, QueryProfiler&)> &fn, QueryProfiler &profiler) {
+	static const size_t parallelism = Configuration::get<size_t>("cache.puzzle_parallelism", 4);
+	if (n == 0)
+		return;
+
+	// CPU time is measured per thread, so every call gets its own profiler
+	std::vector<QueryProfiler> profilers(n);
 	{
 		QueryProfilerStoppingGuard sg(profiler);
-		auto rem_queries = get_remainder_queries(query, remainder, ref_result);
-		for (auto &rqr : rem_queries) {
-			result.push_back(compute<T>(op, rqr, profiler));
-		}
+		WorkerContext &worker = mgr.get_worker_context();
+		int puzzle_depth = worker.get_puzzle_depth();
+		ThreadPool::getDefault().parallelFor(n, [&](size_t i) {
+			DelegationGuard dg(mgr.get_worker_context(), worker, puzzle_depth);
+			fn(i, profilers[i]);
+		}, parallelism);
 	}
+	for (auto &p : profilers)
+		profiler.merge(p);
+}
+
+template<class T>
+std::vector<std::shared_ptr<const T> > PuzzleUtil::compute_remainders(NodeCacheManager &mgr,
+		const QueryRectangle& query, GenericOperator &op, const T& ref_result, const std::vector<Cube<3> >& remainder, QueryProfiler& profiler, bool resample) {
+	TIME_EXEC("PuzzleUtil.compute_remainders");
+	auto rem_queries = get_remainder_queries(query, remainder, ref_result, resample);
+	std::vector<std::shared_ptr<const T>> result(rem_queries.size());
+	run_concurrently(mgr, rem_queries.size(), [&](size_t i, QueryProfiler &qp) {
+		result[i] = compute<T>(op, rem_queries[i], qp);
+	}, profiler);
 	return result;
 }
 
 template<class T>
 std::vector<QueryRectangle> PuzzleUtil::get_remainder_queries(
-		const QueryRectangle& query, const std::vector<Cube<3> >& remainder, const T& ref_result) {
+		const QueryRectangle& query, const std::vector<Cube<3> >& remainder, const T& ref_result, bool resample) {
 	(void) ref_result;
+	(void) resample;
 	std::vector<QueryRectangle> result;
 	result.reserve(remainder.size());
 
@@ -120,11 +215,17 @@ std::vector<QueryRectangle> PuzzleUtil::get_remainder_queries(
 
 template<>
 std::vector<QueryRectangle> PuzzleUtil::get_remainder_queries(
-		const QueryRectangle& query, const std::vector<Cube<3> >& remainder, const GenericRaster& ref_result) {
+		const QueryRectangle& query, const std::vector<Cube<3> >& remainder, const GenericRaster& ref_result, bool resample) {
 
 	std::vector<QueryRectangle> result;
 	result.reserve(remainder.size());
 
+	// Resampled pieces are finer than requested, so remainders are computed on the query's grid
+	double ref_x = resample ? query.x1 : ref_result.stref.x1;
+	double ref_y = resample ? query.y1 : ref_result.stref.y1;
+	double scale_x = resample ? (query.x2 - query.x1) / query.xres : ref_result.pixel_scale_x;
+	double scale_y = resample ? (query.y2 - query.y1) / query.yres : ref_result.pixel_scale_y;
+
 	for ( auto &rem : remainder ) {
 		double x1 = rem.get_dimension(0).a;
 		double x2 = rem.get_dimension(0).b;
@@ -133,18 +234,18 @@ std::vector<QueryRectangle> PuzzleUtil::get_remainder_queries(
 
 
 		// Skip useless remainders
-		if ( rem.get_dimension(0).distance() < ref_result.pixel_scale_x / 2 ||
-			 rem.get_dimension(1).distance() < ref_result.pixel_scale_y / 2)
+		if ( rem.get_dimension(0).distance() < scale_x / 2 ||
+			 rem.get_dimension(1).distance() < scale_y / 2)
 			continue;
 		// Make sure we have at least one pixel
-		snap_to_pixel_grid(x1,x2,ref_result.stref.x1,ref_result.pixel_scale_x);
-		snap_to_pixel_grid(y1,y2,ref_result.stref.y1,ref_result.pixel_scale_y);
+		snap_to_pixel_grid(x1,x2,ref_x,scale_x);
+		snap_to_pixel_grid(y1,y2,ref_y,scale_y);
 
 
 		result.push_back( QueryRectangle( SpatialReference(query.crsId, x1,y1,x2,y2),
 										  TemporalReference(query.timetype, rem.get_dimension(2).a,rem.get_dimension(2).b),
-										  QueryResolution::pixels( std::round((x2-x1) / ref_result.pixel_scale_x),
-																   std::round((y2-y1) / ref_result.pixel_scale_y) ) ) );
+										  QueryResolution::pixels( std::round((x2-x1) / scale_x),
+																   std::round((y2-y1) / scale_y) ) ) );
 	}
 	return result;
 }
@@ -228,45 +329,43 @@ SpatioTemporalReference PuzzleUtil::enlarge_puzzle(const QueryRectangle& query,
 //
 
 template<class T>
-std::unique_ptr<T> PuzzleUtil::compute(GenericOperator& op,
+std::shared_ptr<const T> PuzzleUtil::compute(GenericOperator& op,
 		const QueryRectangle& query, QueryProfiler& qp) {
 	throw OperatorException("Computation only possible for concrete instances");
 }
 
 template<>
-std::unique_ptr<GenericRaster> PuzzleUtil::compute(GenericOperator& op,
+std::shared_ptr<const GenericRaster> PuzzleUtil::compute(GenericOperator& op,
 		const QueryRectangle& query, QueryProfiler& qp) {
-	auto res = op.getCachedRaster(query, QueryTools(qp));
-	res->setRepresentation(GenericRaster::Representation::CPU);
-	return res;
+	return op.getCachedRasterShared(query, QueryTools(qp));
 }
 
 template<>
-std::unique_ptr<PointCollection> PuzzleUtil::compute(GenericOperator& op,
+std::shared_ptr<const PointCollection> PuzzleUtil::compute(GenericOperator& op,
 		const QueryRectangle& query, QueryProfiler& qp) {
-	return op.getCachedPointCollection(query, QueryTools(qp));
+	return op.getCachedPointCollectionShared(query, QueryTools(qp));
 }
 
 template<>
-std::unique_ptr<LineCollection> PuzzleUtil::compute(GenericOperator& op,
+std::shared_ptr<const LineCollection> PuzzleUtil::compute(GenericOperator& op,
 		const QueryRectangle& query, QueryProfiler& qp) {
-	return op.getCachedLineCollection(query, QueryTools(qp));
+	return op.getCachedLineCollectionShared(query, QueryTools(qp));
 }
 
 template<>
-std::unique_ptr<PolygonCollection> PuzzleUtil::compute(GenericOperator& op,
+std::shared_ptr<const PolygonCollection> PuzzleUtil::compute(GenericOperator& op,
 		const QueryRectangle& query, QueryProfiler& qp) {
-	return op.getCachedPolygonCollection(query, QueryTools(qp));
+	return op.getCachedPolygonCollectionShared(query, QueryTools(qp));
 }
 
 template<>
-std::unique_ptr<GenericPlot> PuzzleUtil::compute(GenericOperator& op,
+std::shared_ptr<const GenericPlot> PuzzleUtil::compute(GenericOperator& op,
 		const QueryRectangle& query, QueryProfiler& qp) {
 	return op.getCachedPlot(query, QueryTools(qp));
 }
 
 template<>
-std::unique_ptr<ProvenanceCollection> PuzzleUtil::compute(GenericOperator& op,
+std::shared_ptr<const ProvenanceCollection> PuzzleUtil::compute(GenericOperator& op,
 		const QueryRectangle& query, QueryProfiler& qp) {
 	return op.getCachedFullProvenance(query, QueryTools(qp));
 }
@@ -277,55 +376,64 @@ std::unique_ptr<ProvenanceCollection> PuzzleUtil::compute(GenericOperator& op,
 
 template<class T>
 std::unique_ptr<T> PuzzleUtil::puzzle(const SpatioTemporalReference& bbox,
-		const std::vector<std::shared_ptr<const T> >& items) {
+		const std::vector<std::shared_ptr<const T> >& items, const QueryResolution &resolution) {
 	(void) bbox;
 	(void) items;
+	(void) resolution;
 	throw OperatorException("Puzzling only possible for concrete instances");
 }
 
 template<>
 std::unique_ptr<PointCollection> PuzzleUtil::puzzle(const SpatioTemporalReference& bbox,
-		const std::vector<std::shared_ptr<const PointCollection> >& items) {
+		const std::vector<std::shared_ptr<const PointCollection> >& items, const QueryResolution &resolution) {
+	(void) resolution;
 	return puzzle_feature_collection(bbox,items);
 }
 
 template<>
 std::unique_ptr<LineCollection> PuzzleUtil::puzzle(const SpatioTemporalReference& bbox,
-		const std::vector<std::shared_ptr<const LineCollection> >& items) {
+		const std::vector<std::shared_ptr<const LineCollection> >& items, const QueryResolution &resolution) {
+	(void) resolution;
 	return puzzle_feature_collection(bbox,items);
 }
 
 template<>
 std::unique_ptr<PolygonCollection> PuzzleUtil::puzzle(const SpatioTemporalReference& bbox,
-		const std::vector<std::shared_ptr<const PolygonCollection> >& items) {
+		const std::vector<std::shared_ptr<const PolygonCollection> >& items, const QueryResolution &resolution) {
+	(void) resolution;
 	return puzzle_feature_collection(bbox,items);
 }
 
 template<>
 std::unique_ptr<GenericPlot> PuzzleUtil::puzzle(
 		const SpatioTemporalReference& bbox,
-		const std::vector<std::shared_ptr<const GenericPlot> >& items) {
+		const std::vector<std::shared_ptr<const GenericPlot> >& items, const QueryResolution &resolution) {
 	(void) bbox;
 	(void) items;
+	(void) resolution;
 	throw OperatorException("Puzzling not supported for plots");
 }
 
 template<>
 std::unique_ptr<ProvenanceCollection> PuzzleUtil::puzzle(
 		const SpatioTemporalReference& bbox,
-		const std::vector<std::shared_ptr<const ProvenanceCollection> >& items) {
+		const std::vector<std::shared_ptr<const ProvenanceCollection> >& items, const QueryResolution &resolution) {
 	(void) bbox;
 	(void) items;
+	(void) resolution;
 	throw OperatorException("Puzzling not supported for provenance");
 }
 
 template<>
 std::unique_ptr<GenericRaster> PuzzleUtil::puzzle(
 		const SpatioTemporalReference& bbox,
-		const std::vector<std::shared_ptr<const GenericRaster> >& items) {
+		const std::vector<std::shared_ptr<const GenericRaster> >& items, const QueryResolution &resolution) {
 	TIME_EXEC("Puzzler.puzzle");
 	Log::trace("Puzzling raster with %d pieces", items.size());
 
+	if (resolution.restype == QueryResolution::Type::PIXELS)
+		return puzzle_resampled(bbox, items, resolution);
+
 	auto &tmp = items.at(0);
 	uint32_t width = std::floor((bbox.x2 - bbox.x1) / tmp->pixel_scale_x);
 	uint32_t height = std::floor((bbox.y2 - bbox.y1) / tmp->pixel_scale_y);
@@ -356,6 +464,45 @@ std::unique_ptr<GenericRaster> PuzzleUtil::puzzle(
 	return result;
 }
 
+std::unique_ptr<GenericRaster> PuzzleUtil::puzzle_resampled(
+		const SpatioTemporalReference& bbox,
+		const std::vector<std::shared_ptr<const GenericRaster> >& items,
+		const QueryResolution &resolution) {
+	TIME_EXEC("Puzzler.puzzle_resampled");
+
+	std::unique_ptr<GenericRaster> result = GenericRaster::create(items.at(0)->dd, bbox,
+			resolution.xres, resolution.yres);
+	result->global_attributes = items[0]->global_attributes;
+
+	for (auto &raster : items) {
+		// The result's pixels whose centers lie inside the piece
+		int64_t x1 = std::max<int64_t>(0, std::ceil((raster->stref.x1 - bbox.x1) / result->pixel_scale_x - 0.5));
+		int64_t x2 = std::min<int64_t>(result->width, std::ceil((raster->stref.x2 - bbox.x1) / result->pixel_scale_x - 0.5));
+		int64_t y1 = std::max<int64_t>(0, std::ceil((raster->stref.y1 - bbox.y1) / result->pixel_scale_y - 0.5));
+		int64_t y2 = std::min<int64_t>(result->height, std::ceil((raster->stref.y2 - bbox.y1) / result->pixel_scale_y - 0.5));
+		if (x1 >= x2 || y1 >= y2) {
+			Log::debug("Puzzle piece out of result-raster: %s", CacheCommon::stref_to_string(raster->stref).c_str());
+			continue;
+		}
+
+		// Sample the piece on the result's pixel grid, the piece is already in the CPU representation
+		QueryRectangle target(
+			SpatialReference(bbox.crsId,
+				bbox.x1 + x1 * result->pixel_scale_x, bbox.y1 + y1 * result->pixel_scale_y,
+				bbox.x1 + x2 * result->pixel_scale_x, bbox.y1 + y2 * result->pixel_scale_y),
+			raster->stref, QueryResolution::pixels(x2 - x1, y2 - y1));
+		auto sampled = const_cast<GenericRaster&>(*raster).fitToQueryRectangle(target);
+		try {
+			result->blit(sampled.get(), x1, y1);
+		} catch (const MetadataException &me) {
+			Log::error("Blit error: %s\nResult: %s\npiece : %s", me.what(),
+					CacheCommon::stref_to_string(result->stref).c_str(),
+					CacheCommon::stref_to_string(raster->stref).c_str());
+		}
+	}
+	return result;
+}
+
 //
 // Feature collections
 //
@@ -457,6 +604,12 @@ std::shared_ptr<const T> LocalRetriever<T>::fetch(
 	return e->data;
 }
 
+template<class T>
+bool LocalRetriever<T>::is_local(const CacheRef& ref) const {
+	(void) ref;
+	return true;
+}
+
 /////////////////////////////////////
 //
 // RemoteRetriever
@@ -485,6 +638,11 @@ std::shared_ptr<const T> RemoteRetriever<T>::fetch(
 	}
 }
 
+template<class T>
+bool RemoteRetriever<T>::is_local(const CacheRef& ref) const {
+	return ref_handler.is_local_ref(ref);
+}
+
 template<class T>
 std::unique_ptr<T> RemoteRetriever<T>::load(const std::string& semantic_id,
 		const CacheRef& ref, QueryProfiler& qp) const {
@@ -554,12 +712,19 @@ std::unique_ptr<ProvenanceCollection> RemoteRetriever<ProvenanceCollection>::rea
 // INSTANTIATE ALL
 //
 
-template std::unique_ptr<GenericRaster> PuzzleUtil::process<GenericRaster>(GenericOperator&, const QueryRectangle&, const std::vector<Cube<3>>&, const std::vector<std::shared_ptr<const GenericRaster>>&, QueryProfiler&);
-template std::unique_ptr<PointCollection> PuzzleUtil::process<PointCollection>(GenericOperator&, const QueryRectangle&, const std::vector<Cube<3>>&, const std::vector<std::shared_ptr<const PointCollection>>&, QueryProfiler&);
-template std::unique_ptr<LineCollection> PuzzleUtil::process<LineCollection>(GenericOperator&, const QueryRectangle&, const std::vector<Cube<3>>&, const std::vector<std::shared_ptr<const LineCollection>>&, QueryProfiler&);
-template std::unique_ptr<PolygonCollection> PuzzleUtil::process<PolygonCollection>(GenericOperator&, const QueryRectangle&, const std::vector<Cube<3>>&, const std::vector<std::shared_ptr<const PolygonCollection>>&, QueryProfiler&);
-template std::unique_ptr<GenericPlot> PuzzleUtil::process<GenericPlot>(GenericOperator&, const QueryRectangle&, const std::vector<Cube<3>>&, const std::vector<std::shared_ptr<const GenericPlot>>&, QueryProfiler&);
-template std::unique_ptr<ProvenanceCollection> PuzzleUtil::process<ProvenanceCollection>(GenericOperator&, const QueryRectangle&, const std::vector<Cube<3>>&, const std::vector<std::shared_ptr<const ProvenanceCollection>>&, QueryProfiler&);
+template std::unique_ptr<GenericRaster> PuzzleUtil::process<GenericRaster>(NodeCacheManager&, GenericOperator&, const QueryRectangle&, const std::vector<Cube<3>>&, const std::vector<std::shared_ptr<const GenericRaster>>&, QueryProfiler&, bool);
+template std::unique_ptr<PointCollection> PuzzleUtil::process<PointCollection>(NodeCacheManager&, GenericOperator&, const QueryRectangle&, const std::vector<Cube<3>>&, const std::vector<std::shared_ptr<const PointCollection>>&, QueryProfiler&, bool);
+template std::unique_ptr<LineCollection> PuzzleUtil::process<LineCollection>(NodeCacheManager&, GenericOperator&, const QueryRectangle&, const std::vector<Cube<3>>&, const std::vector<std::shared_ptr<const LineCollection>>&, QueryProfiler&, bool);
+template std::unique_ptr<PolygonCollection> PuzzleUtil::process<PolygonCollection>(NodeCacheManager&, GenericOperator&, const QueryRectangle&, const std::vector<Cube<3>>&, const std::vector<std::shared_ptr<const PolygonCollection>>&, QueryProfiler&, bool);
+template std::unique_ptr<GenericPlot> PuzzleUtil::process<GenericPlot>(NodeCacheManager&, GenericOperator&, const QueryRectangle&, const std::vector<Cube<3>>&, const std::vector<std::shared_ptr<const GenericPlot>>&, QueryProfiler&, bool);
+template std::unique_ptr<ProvenanceCollection> PuzzleUtil::process<ProvenanceCollection>(NodeCacheManager&, GenericOperator&, const QueryRectangle&, const std::vector<Cube<3>>&, const std::vector<std::shared_ptr<const ProvenanceCollection>>&, QueryProfiler&, bool);
+
+template std::unique_ptr<GenericRaster> PuzzleUtil::process<GenericRaster>(NodeCacheManager&, GenericOperator&, const PuzzleRequest&, const PieceRetriever<GenericRaster>&, QueryProfiler&);
+template std::unique_ptr<PointCollection> PuzzleUtil::process<PointCollection>(NodeCacheManager&, GenericOperator&, const PuzzleRequest&, const PieceRetriever<PointCollection>&, QueryProfiler&);
+template std::unique_ptr<LineCollection> PuzzleUtil::process<LineCollection>(NodeCacheManager&, GenericOperator&, const PuzzleRequest&, const PieceRetriever<LineCollection>&, QueryProfiler&);
+template std::unique_ptr<PolygonCollection> PuzzleUtil::process<PolygonCollection>(NodeCacheManager&, GenericOperator&, const PuzzleRequest&, const PieceRetriever<PolygonCollection>&, QueryProfiler&);
+template std::unique_ptr<GenericPlot> PuzzleUtil::process<GenericPlot>(NodeCacheManager&, GenericOperator&, const PuzzleRequest&, const PieceRetriever<GenericPlot>&, QueryProfiler&);
+template std::unique_ptr<ProvenanceCollection> PuzzleUtil::process<ProvenanceCollection>(NodeCacheManager&, GenericOperator&, const PuzzleRequest&, const PieceRetriever<ProvenanceCollection>&, QueryProfiler&);
 
 template class LocalRetriever<GenericRaster> ;
 template class LocalRetriever<GenericPlot> ;
@@ -12,15 +12,75 @@
 #include "cache/priv/requests.h"
 #include "operators/operator.h"
 
+#include <functional>
+
+template<class T> class PieceRetriever;
+
+/**
+ * Combines cached pieces and computed remainders into the result of a query.
+ * Remainders are computed concurrently on the thread-pool, on behalf of the
+ * calling worker.
+ */
 class PuzzleUtil {
 	template <class T> friend class LocalCacheWrapper;
 public:
+	/**
+	 * Puzzles the result of the given query from the given pieces.
+	 * @param mgr the manager of the calling worker
+	 * @param op the operator to compute the remainders with
+	 * @param query the query-rectangle
+	 * @param remainder the parts of the query not covered by the pieces
+	 * @param parts the puzzle-pieces
+	 * @param profiler the profiler to use
+	 * @param resample whether the pieces have a finer resolution than requested
+	 *        and have to be downsampled to the query's resolution
+	 * @return the combined result
+	 */
 	template<class T>
-	static std::unique_ptr<T> process(GenericOperator &op,
+	static std::unique_ptr<T> process(NodeCacheManager &mgr, GenericOperator &op,
 			const QueryRectangle &query, const std::vector<Cube<3>> &remainder,
 			const std::vector<std::shared_ptr<const T>> &parts,
+			QueryProfiler &profiler, bool resample = false);
+
+	/**
+	 * Puzzles the result of the given puzzle-request. Pieces on foreign nodes are
+	 * fetched concurrently to computing the remainders. Pieces that are gone are
+	 * computed like remainders.
+	 * @param mgr the manager of the calling worker
+	 * @param op the operator to compute the remainders with
+	 * @param request the puzzle-request
+	 * @param retriever the retriever used for fetching the pieces
+	 * @param profiler the profiler to use
+	 * @return the combined result
+	 * @throws NoSuchElementException if all pieces are gone
+	 */
+	template<class T>
+	static std::unique_ptr<T> process(NodeCacheManager &mgr, GenericOperator &op,
+			const PuzzleRequest &request, const PieceRetriever<T> &retriever,
 			QueryProfiler &profiler);
 private:
+	/**
+	 * Executes fn(i, profiler) for all i in [0, n) on the thread-pool, on behalf of the
+	 * calling worker. Every call gets its own profiler, which are merged into the
+	 * given profiler afterwards.
+	 * @param mgr the manager of the calling worker
+	 * @param n the number of calls
+	 * @param fn the function to execute
+	 * @param profiler the profiler of the calling worker
+	 */
+	static void run_concurrently(NodeCacheManager &mgr, size_t n,
+			const std::function<void(size_t, QueryProfiler&)> &fn, QueryProfiler &profiler);
+
+	/**
+	 * Enlarges the puzzle to its maximum bounding cube and combines the items.
+	 * @param query the query-rectangle of the request
+	 * @param items the puzzle-pieces and computed remainders
+	 * @param resample whether to downsample the items to the query's resolution and extent
+	 * @return the combined result
+	 */
+	template<class T>
+	static std::unique_ptr<T> combine(const QueryRectangle &query,
+			const std::vector<std::shared_ptr<const T>>& items, bool resample = false);
 
 	/**
 	 * Enlarges the result of the puzzle-request to the maximum bounding cube.
@@ -33,21 +93,26 @@ private:
 			const std::vector<std::shared_ptr<const T>>& items);
 
 	/**
-	 * Conmputes the remainder-queries
-	 * @param semantic_id the semantic id
+	 * Computes the remainder-queries concurrently
+	 * @param mgr the manager of the calling worker
+	 * @param query the query-rectangle of the request
+	 * @param op the operator to compute the remainders with
 	 * @param ref_result a result used as reference for resolution computation
-	 * @param request the puzzle-request
-	 * @param qp the profiler to use
+	 * @param remainder the remainders
+	 * @param profiler the profiler to use
+	 * @param resample whether to compute raster remainders on the query's pixel grid
+	 *        instead of the reference's
 	 * @return the results of the remainder queries
 	 */
 	template<class T>
-	static std::vector<std::unique_ptr<T>> compute_remainders(
+	static std::vector<std::shared_ptr<const T>> compute_remainders(NodeCacheManager &mgr,
 			const QueryRectangle& query, GenericOperator &op, const T& ref_result,
-			const std::vector<Cube<3> >& remainder, QueryProfiler& profiler);
+			const std::vector<Cube<3> >& remainder, QueryProfiler& profiler, bool resample = false);
 
 	template<class T>
 	static std::vector<QueryRectangle> get_remainder_queries(
-			const QueryRectangle& query, const std::vector<Cube<3> >& remainder, const T& ref_result);
+			const QueryRectangle& query, const std::vector<Cube<3> >& remainder, const T& ref_result,
+			bool resample);
 
 	/**
 	 * Snaps the bounds of a cube to the pixel grid
@@ -60,19 +125,37 @@ private:
 	static void snap_to_pixel_grid(double &v1, double &v2, double ref,
 			double scale);
 
+	/**
+	 * Computes a remainder. The result is only read, so it is shared with the cache.
+	 */
 	template<class T>
-	static std::unique_ptr<T> compute(GenericOperator &op,
+	static std::shared_ptr<const T> compute(GenericOperator &op,
 			const QueryRectangle &query, QueryProfiler &qp);
 
 	/**
 	 * Puzzles the given items into a result with the dimensions of bbox.
 	 * @param bbox the bounding box of the result
 	 * @param items the puzzle-pieces
+	 * @param resolution the resolution of the result, rasters are resampled to it.
+	 *        Without a resolution, rasters are puzzled at the resolution of their pieces.
 	 * @return the combined result
 	 */
 	template<class T>
 	static std::unique_ptr<T> puzzle(const SpatioTemporalReference &bbox,
-			const std::vector<std::shared_ptr<const T>> &items);
+			const std::vector<std::shared_ptr<const T>> &items,
+			const QueryResolution &resolution);
+
+	/**
+	 * Samples the given raster pieces on the pixel grid of the result
+	 * (nearest neighbour), so they may have a different resolution.
+	 * @param bbox the bounding box of the result
+	 * @param items the puzzle-pieces
+	 * @param resolution the resolution of the result
+	 * @return the combined result
+	 */
+	static std::unique_ptr<GenericRaster> puzzle_resampled(const SpatioTemporalReference &bbox,
+			const std::vector<std::shared_ptr<const GenericRaster>> &items,
+			const QueryResolution &resolution);
 
 	template<class T>
 	static std::unique_ptr<T> puzzle_feature_collection(
@@ -127,6 +210,11 @@ public:
 	virtual std::shared_ptr<const T> fetch(const std::string &semantic_id,
 			const CacheRef &ref, QueryProfiler &qp) const = 0;
 
+	/**
+	 * @param ref the CacheRef to check
+	 * @return whether the entry pointed to by the given ref is fetched from the local cache
+	 */
+	virtual bool is_local(const CacheRef &ref) const = 0;
 };
 
 /**
@@ -152,6 +240,8 @@ public:
 	virtual std::shared_ptr<const T> fetch(const std::string &semantic_id,
 			const CacheRef &ref, QueryProfiler &qp) const;
 
+	virtual bool is_local(const CacheRef &ref) const;
+
 protected:
 	const NodeCacheWrapper<T> &cache;
 };
@@ -180,6 +270,8 @@ public:
 	std::shared_ptr<const T> fetch(const std::string &semantic_id,
 			const CacheRef &ref, QueryProfiler &qp) const;
 
+	bool is_local(const CacheRef &ref) const;
+
 	/**
 	 * Loads the desired item from a foreign node
 	 * @param semantic_id the semantic id
@@ -0,0 +1,476 @@
+#include "cache/priv/cache_index.h"
+
+#include <limits>
+#include <algorithm>
+
+///////////////////////////////////////////////////////////
+//
+// BOX
+//
+///////////////////////////////////////////////////////////
+
+template<typename KType>
+CubeIndex<KType>::Box::Box() {
+	lo.fill( std::numeric_limits<double>::infinity() );
+	hi.fill( -std::numeric_limits<double>::infinity() );
+}
+
+template<typename KType>
+CubeIndex<KType>::Box::Box(const Cube<3>& cube) {
+	for ( int i = 0; i < 3; i++ ) {
+		auto &d = cube.get_dimension(i);
+		lo[i] = d.a;
+		hi[i] = d.b;
+	}
+}
+
+template<typename KType>
+bool CubeIndex<KType>::Box::intersects(const Box& o) const {
+	return lo[0] <= o.hi[0] && hi[0] >= o.lo[0] &&
+		   lo[1] <= o.hi[1] && hi[1] >= o.lo[1] &&
+		   lo[2] <= o.hi[2] && hi[2] >= o.lo[2];
+}
+
+template<typename KType>
+bool CubeIndex<KType>::Box::contains(const Box& o) const {
+	return lo[0] <= o.lo[0] && hi[0] >= o.hi[0] &&
+		   lo[1] <= o.lo[1] && hi[1] >= o.hi[1] &&
+		   lo[2] <= o.lo[2] && hi[2] >= o.hi[2];
+}
+
+template<typename KType>
+typename CubeIndex<KType>::Box CubeIndex<KType>::Box::combine(const Box& o) const {
+	Box res(*this);
+	res.extend(o);
+	return res;
+}
+
+template<typename KType>
+void CubeIndex<KType>::Box::extend(const Box& o) {
+	for ( int i = 0; i < 3; i++ ) {
+		lo[i] = std::min(lo[i], o.lo[i]);
+		hi[i] = std::max(hi[i], o.hi[i]);
+	}
+}
+
+template<typename KType>
+double CubeIndex<KType>::Box::volume() const {
+	return (hi[0]-lo[0]) * (hi[1]-lo[1]) * (hi[2]-lo[2]);
+}
+
+template<typename KType>
+double CubeIndex<KType>::Box::margin() const {
+	return (hi[0]-lo[0]) + (hi[1]-lo[1]) + (hi[2]-lo[2]);
+}
+
+///////////////////////////////////////////////////////////
+//
+// NODE
+//
+///////////////////////////////////////////////////////////
+
+template<typename KType>
+CubeIndex<KType>::Node::Node() : leaf(true) {
+}
+
+template<typename KType>
+typename CubeIndex<KType>::Box CubeIndex<KType>::Node::bounds() const {
+	Box res;
+	for ( auto &b : boxes )
+		res.extend(b);
+	return res;
+}
+
+template<typename KType>
+size_t CubeIndex<KType>::Node::size() const {
+	return boxes.size();
+}
+
+///////////////////////////////////////////////////////////
+//
+// CUBE INDEX
+//
+///////////////////////////////////////////////////////////
+
+template<typename KType>
+CubeIndex<KType>::CubeIndex() : num_entries(0) {
+	root = allocate(true);
+}
+
+template<typename KType>
+uint32_t CubeIndex<KType>::allocate(bool leaf) {
+	uint32_t res;
+	if ( !free_nodes.empty() ) {
+		res = free_nodes.back();
+		free_nodes.pop_back();
+	}
+	else {
+		res = nodes.size();
+		nodes.emplace_back();
+	}
+	nodes[res].leaf = leaf;
+	return res;
+}
+
+template<typename KType>
+void CubeIndex<KType>::release(uint32_t node) {
+	Node &n = nodes[node];
+	n.boxes.clear();
+	n.children.clear();
+	n.keys.clear();
+	free_nodes.push_back(node);
+}
+
+template<typename KType>
+void CubeIndex<KType>::insert(const KType& key, const Cube<3>& bounds) {
+	Box box(bounds);
+	uint32_t sibling = insert_rec(root, key, box);
+	// Root was split -> grow tree
+	if ( sibling != NONE ) {
+		uint32_t new_root = allocate(false);
+		Box rb = nodes[root].bounds();
+		Box sb = nodes[sibling].bounds();
+		Node &nr = nodes[new_root];
+		nr.boxes.push_back(rb);
+		nr.children.push_back(root);
+		nr.boxes.push_back(sb);
+		nr.children.push_back(sibling);
+		root = new_root;
+	}
+	num_entries++;
+}
+
+template<typename KType>
+uint32_t CubeIndex<KType>::insert_rec(uint32_t node, const KType& key, const Box& box) {
+	if ( nodes[node].leaf ) {
+		nodes[node].boxes.push_back(box);
+		nodes[node].keys.push_back(key);
+	}
+	else {
+		uint32_t idx = choose_subtree(nodes[node], box);
+		uint32_t child = nodes[node].children[idx];
+		uint32_t sibling = insert_rec(child, key, box);
+
+		// Careful: nodes may have been re-allocated
+		Node &n = nodes[node];
+		if ( sibling == NONE )
+			n.boxes[idx].extend(box);
+		else {
+			n.boxes[idx] = nodes[child].bounds();
+			Box sb = nodes[sibling].bounds();
+			n.boxes.push_back(sb);
+			n.children.push_back(sibling);
+		}
+	}
+
+	if ( nodes[node].size() > MAX_ENTRIES )
+		return split(node);
+	return NONE;
+}
+
+template<typename KType>
+uint32_t CubeIndex<KType>::choose_subtree(const Node& node, const Box& box) const {
+	uint32_t best = 0;
+	double best_enl = std::numeric_limits<double>::infinity();
+	double best_marg = std::numeric_limits<double>::infinity();
+	double best_vol = std::numeric_limits<double>::infinity();
+
+	for ( uint32_t i = 0; i < node.size(); i++ ) {
+		const Box &b = node.boxes[i];
+		Box c = b.combine(box);
+		double vol = b.volume();
+		double enl = c.volume() - vol;
+		// Use margin as tie-breaker -- helps on degenerated (flat) boxes
+		double marg = c.margin() - b.margin();
+		if ( enl < best_enl ||
+			(enl == best_enl && marg < best_marg) ||
+			(enl == best_enl && marg == best_marg && vol < best_vol) ) {
+			best = i;
+			best_enl = enl;
+			best_marg = marg;
+			best_vol = vol;
+		}
+	}
+	return best;
+}
+
+template<typename KType>
+uint32_t CubeIndex<KType>::split(uint32_t node) {
+	uint32_t sibling = allocate(nodes[node].leaf);
+	Node old = std::move(nodes[node]);
+	Node &a = nodes[node];
+	Node &b = nodes[sibling];
+	a.leaf = b.leaf = old.leaf;
+	a.boxes.clear(); a.children.clear(); a.keys.clear();
+
+	auto move_entry = [&old]( Node &target, size_t i ) {
+		target.boxes.push_back(old.boxes[i]);
+		if ( old.leaf )
+			target.keys.push_back(old.keys[i]);
+		else
+			target.children.push_back(old.children[i]);
+	};
+
+	const size_t n = old.size();
+
+	// Pick seeds: the pair wasting the most space
+	size_t s1 = 0, s2 = 1;
+	double worst = -std::numeric_limits<double>::infinity();
+	for ( size_t i = 0; i < n; i++ ) {
+		for ( size_t j = i+1; j < n; j++ ) {
+			Box c = old.boxes[i].combine(old.boxes[j]);
+			double d = c.volume() - old.boxes[i].volume() - old.boxes[j].volume();
+			d += 1e-9 * (c.margin() - old.boxes[i].margin() - old.boxes[j].margin());
+			if ( d > worst ) {
+				worst = d;
+				s1 = i;
+				s2 = j;
+			}
+		}
+	}
+
+	std::vector<bool> assigned(n,false);
+	move_entry(a, s1);
+	move_entry(b, s2);
+	assigned[s1] = assigned[s2] = true;
+	Box ba = old.boxes[s1], bb = old.boxes[s2];
+	size_t remaining = n - 2;
+
+	while ( remaining > 0 ) {
+		// Ensure minimum fill
+		if ( a.size() + remaining == MIN_ENTRIES || b.size() + remaining == MIN_ENTRIES ) {
+			Node &target = (a.size() + remaining == MIN_ENTRIES) ? a : b;
+			for ( size_t i = 0; i < n; i++ )
+				if ( !assigned[i] ) {
+					move_entry(target, i);
+					assigned[i] = true;
+				}
+			break;
+		}
+
+		// Pick next: entry with the greatest preference for one group
+		size_t next = 0;
+		double max_diff = -1;
+		double next_da = 0, next_db = 0;
+		for ( size_t i = 0; i < n; i++ ) {
+			if ( assigned[i] )
+				continue;
+			double da = ba.combine(old.boxes[i]).volume() - ba.volume();
+			double db = bb.combine(old.boxes[i]).volume() - bb.volume();
+			double diff = std::abs(da-db);
+			if ( diff > max_diff ) {
+				max_diff = diff;
+				next = i;
+				next_da = da;
+				next_db = db;
+			}
+		}
+
+		bool to_a;
+		if ( next_da != next_db )
+			to_a = next_da < next_db;
+		else if ( ba.volume() != bb.volume() )
+			to_a = ba.volume() < bb.volume();
+		else
+			to_a = a.size() <= b.size();
+
+		if ( to_a ) {
+			move_entry(a, next);
+			ba.extend(old.boxes[next]);
+		}
+		else {
+			move_entry(b, next);
+			bb.extend(old.boxes[next]);
+		}
+		assigned[next] = true;
+		remaining--;
+	}
+	return sibling;
+}
+
+template<typename KType>
+bool CubeIndex<KType>::remove(const KType& key, const Cube<3>& bounds) {
+	Box box(bounds);
+	std::vector<std::pair<KType,Box>> orphans;
+	if ( !remove_rec(root, key, box, orphans) )
+		return false;
+
+	num_entries--;
+
+	// Shrink tree
+	while ( !nodes[root].leaf && nodes[root].size() == 1 ) {
+		uint32_t old_root = root;
+		root = nodes[root].children[0];
+		release(old_root);
+	}
+	if ( !nodes[root].leaf && nodes[root].size() == 0 ) {
+		release(root);
+		root = allocate(true);
+	}
+
+	// Re-insert entries of condensed nodes
+	for ( auto &o : orphans ) {
+		uint32_t sibling = insert_rec(root, o.first, o.second);
+		if ( sibling != NONE ) {
+			uint32_t new_root = allocate(false);
+			Box rb = nodes[root].bounds();
+			Box sb = nodes[sibling].bounds();
+			Node &nr = nodes[new_root];
+			nr.boxes.push_back(rb);
+			nr.children.push_back(root);
+			nr.boxes.push_back(sb);
+			nr.children.push_back(sibling);
+			root = new_root;
+		}
+	}
+	return true;
+}
+
+template<typename KType>
+bool CubeIndex<KType>::remove_rec(uint32_t node, const KType& key, const Box& box,
+		std::vector<std::pair<KType,Box>> &orphans) {
+	Node &n = nodes[node];
+	if ( n.leaf ) {
+		for ( size_t i = 0; i < n.size(); i++ ) {
+			if ( n.keys[i] == key ) {
+				n.keys.erase( n.keys.begin() + i );
+				n.boxes.erase( n.boxes.begin() + i );
+				return true;
+			}
+		}
+		return false;
+	}
+
+	for ( size_t i = 0; i < nodes[node].size(); i++ ) {
+		if ( !nodes[node].boxes[i].contains(box) )
+			continue;
+		uint32_t child = nodes[node].children[i];
+		if ( remove_rec(child, key, box, orphans) ) {
+			Node &p = nodes[node];
+			if ( nodes[child].size() < MIN_ENTRIES ) {
+				collect(child, orphans);
+				p.boxes.erase( p.boxes.begin() + i );
+				p.children.erase( p.children.begin() + i );
+			}
+			else
+				p.boxes[i] = nodes[child].bounds();
+			return true;
+		}
+	}
+	return false;
+}
+
+template<typename KType>
+void CubeIndex<KType>::collect(uint32_t node, std::vector<std::pair<KType,Box>> &orphans) {
+	Node &n = nodes[node];
+	if ( n.leaf ) {
+		for ( size_t i = 0; i < n.size(); i++ )
+			orphans.emplace_back( n.keys[i], n.boxes[i] );
+	}
+	else {
+		for ( auto c : n.children )
+			collect(c, orphans);
+	}
+	release(node);
+}
+
+template<typename KType>
+bool CubeIndex<KType>::search(const Cube<3>& bounds, const Visitor& visitor) const {
+	return search_rec(root, Box(bounds), visitor);
+}
+
+template<typename KType>
+bool CubeIndex<KType>::search_rec(uint32_t node, const Box& box, const Visitor& visitor) const {
+	const Node &n = nodes[node];
+	for ( size_t i = 0; i < n.size(); i++ ) {
+		if ( !n.boxes[i].intersects(box) )
+			continue;
+		if ( n.leaf ) {
+			if ( !visitor(n.keys[i]) )
+				return false;
+		}
+		else if ( !search_rec(n.children[i], box, visitor) )
+			return false;
+	}
+	return true;
+}
+
+template<typename KType>
+size_t CubeIndex<KType>::size() const {
+	return num_entries;
+}
+
+template<typename KType>
+bool CubeIndex<KType>::empty() const {
+	return num_entries == 0;
+}
+
+///////////////////////////////////////////////////////////
+//
+// CACHE INDEX
+//
+///////////////////////////////////////////////////////////
+
+template<typename KType>
+typename CacheIndex<KType>::PartitionKey CacheIndex<KType>::partition_key(const CacheCube& bounds) {
+	auto &ri = bounds.resolution_info;
+	return PartitionKey( bounds.crsId.authority, bounds.crsId.code, bounds.timetype, ri.restype,
+			ri.pixel_scale_x.a, ri.pixel_scale_x.b, ri.pixel_scale_y.a, ri.pixel_scale_y.b );
+}
+
+template<typename KType>
+void CacheIndex<KType>::insert(const KType& key, const CacheCube& bounds) {
+	partitions[partition_key(bounds)].insert(key, bounds);
+}
+
+template<typename KType>
+bool CacheIndex<KType>::remove(const KType& key, const CacheCube& bounds) {
+	auto it = partitions.find(partition_key(bounds));
+	if ( it == partitions.end() || !it->second.remove(key, bounds) )
+		return false;
+	if ( it->second.empty() )
+		partitions.erase(it);
+	return true;
+}
+
+template<typename KType>
+void CacheIndex<KType>::query(const QueryCube& qc, const Visitor& visitor, double max_resample_factor) const {
+	const double inf = std::numeric_limits<double>::infinity();
+	// All partitions with matching crs, time-type and resolution-type are adjacent
+	auto it = partitions.lower_bound(
+		PartitionKey(qc.crsId.authority, qc.crsId.code, qc.timetype, qc.restype, -inf, -inf, -inf, -inf) );
+
+	for ( ; it != partitions.end(); it++ ) {
+		auto &k = it->first;
+		if ( std::get<0>(k) != qc.crsId.authority || std::get<1>(k) != qc.crsId.code ||
+			 std::get<2>(k) != qc.timetype || std::get<3>(k) != qc.restype )
+			break;
+
+		// See: ResolutionInfo::matches, finer entries may be downsampled
+		if ( qc.restype != QueryResolution::Type::NONE &&
+			 !(Interval(std::get<4>(k),std::get<5>(k) * max_resample_factor).contains(qc.pixel_scale_x) &&
+			   Interval(std::get<6>(k),std::get<7>(k) * max_resample_factor).contains(qc.pixel_scale_y)) )
+			continue;
+
+		if ( !it->second.search(qc, visitor) )
+			return;
+	}
+}
+
+template<typename KType>
+void CacheIndex<KType>::query_all(const Cube<3>& cube, const Visitor& visitor) const {
+	for ( auto &p : partitions ) {
+		if ( !p.second.search(cube, visitor) )
+			return;
+	}
+}
+
+template<typename KType>
+size_t CacheIndex<KType>::num_partitions() const {
+	return partitions.size();
+}
+
+template class CubeIndex<uint64_t>;
+template class CubeIndex<std::pair<uint32_t, uint64_t>>;
+template class CacheIndex<uint64_t>;
+template class CacheIndex<std::pair<uint32_t, uint64_t>>;
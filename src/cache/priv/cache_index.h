@@ -0,0 +1,181 @@
+#ifndef CACHE_INDEX_H_
+#define CACHE_INDEX_H_
+
+#include "cache/priv/shared.h"
+
+#include <array>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <functional>
+
+/**
+ * R-Tree over the 3-dimensional (x, y, t) bounds of cache-entries.
+ * Nodes are stored in a pool and referenced by their index. Splits
+ * are performed using Guttman's quadratic split algorithm.
+ */
+template<typename KType>
+class CubeIndex {
+public:
+	/**
+	 * Visitor invoked for every entry found by a search.
+	 * Returning false stops the search.
+	 */
+	typedef std::function<bool(const KType&)> Visitor;
+
+	/**
+	 * Constructs an empty index
+	 */
+	CubeIndex();
+
+	/**
+	 * Inserts the given key with the given bounds
+	 * @param key the key of the entry
+	 * @param bounds the bounds of the entry
+	 */
+	void insert( const KType &key, const Cube<3> &bounds );
+
+	/**
+	 * Removes the entry with the given key. The bounds must be the ones
+	 * used on insertion.
+	 * @param key the key of the entry
+	 * @param bounds the bounds of the entry
+	 * @return whether an entry was removed
+	 */
+	bool remove( const KType &key, const Cube<3> &bounds );
+
+	/**
+	 * Reports all entries intersecting the given bounds to the visitor
+	 * @param bounds the bounds to search for
+	 * @param visitor the visitor to call for every intersecting entry
+	 * @return false if the search was stopped by the visitor, true otherwise
+	 */
+	bool search( const Cube<3> &bounds, const Visitor &visitor ) const;
+
+	/**
+	 * @return the number of entries stored in this index
+	 */
+	size_t size() const;
+
+	/**
+	 * @return whether this index is empty
+	 */
+	bool empty() const;
+
+private:
+	static const size_t MAX_ENTRIES = 16;
+	static const size_t MIN_ENTRIES = 6;
+	static const uint32_t NONE = 0xFFFFFFFF;
+
+	/**
+	 * Compact axis-aligned box used inside the tree
+	 */
+	class Box {
+	public:
+		Box();
+		Box( const Cube<3> &cube );
+		bool intersects( const Box &o ) const;
+		bool contains( const Box &o ) const;
+		Box combine( const Box &o ) const;
+		void extend( const Box &o );
+		double volume() const;
+		double margin() const;
+		std::array<double,3> lo;
+		std::array<double,3> hi;
+	};
+
+	/**
+	 * A node of the tree. Inner nodes use children,
+	 * leaf-nodes use keys.
+	 */
+	class Node {
+	public:
+		Node();
+		Box bounds() const;
+		size_t size() const;
+		bool leaf;
+		std::vector<Box> boxes;
+		std::vector<uint32_t> children;
+		std::vector<KType> keys;
+	};
+
+	uint32_t allocate( bool leaf );
+	void release( uint32_t node );
+
+	uint32_t insert_rec( uint32_t node, const KType &key, const Box &box );
+	uint32_t choose_subtree( const Node &node, const Box &box ) const;
+	uint32_t split( uint32_t node );
+
+	bool remove_rec( uint32_t node, const KType &key, const Box &box,
+			std::vector<std::pair<KType,Box>> &orphans );
+	void collect( uint32_t node, std::vector<std::pair<KType,Box>> &orphans );
+
+	bool search_rec( uint32_t node, const Box &box, const Visitor &visitor ) const;
+
+	std::vector<Node> nodes;
+	std::vector<uint32_t> free_nodes;
+	uint32_t root;
+	size_t num_entries;
+};
+
+/**
+ * Index over all entries of a cache-structure. Entries are partitioned by
+ * their reference-system, time-type and resolution-bounds. Each partition
+ * maintains a CubeIndex over the spatio-temporal bounds of its entries.
+ */
+template<typename KType>
+class CacheIndex {
+public:
+	typedef typename CubeIndex<KType>::Visitor Visitor;
+
+	/**
+	 * Adds an entry to the index
+	 * @param key the key of the entry
+	 * @param bounds the bounds of the entry
+	 */
+	void insert( const KType &key, const CacheCube &bounds );
+
+	/**
+	 * Removes an entry from the index
+	 * @param key the key of the entry
+	 * @param bounds the bounds of the entry
+	 * @return whether an entry was removed
+	 */
+	bool remove( const KType &key, const CacheCube &bounds );
+
+	/**
+	 * Reports all entries whose resolution matches the given query
+	 * and which intersect it
+	 * @param qc the query
+	 * @param visitor the visitor to call for every candidate
+	 * @param max_resample_factor also reports entries with a pixel-scale up to this
+	 *        factor finer than the query's
+	 */
+	void query( const QueryCube &qc, const Visitor &visitor, double max_resample_factor = 1 ) const;
+
+	/**
+	 * Reports all entries intersecting the given cube, regardless
+	 * of their reference-system and resolution
+	 * @param cube the cube to search for
+	 * @param visitor the visitor to call for every candidate
+	 */
+	void query_all( const Cube<3> &cube, const Visitor &visitor ) const;
+
+	/**
+	 * @return the number of partitions
+	 */
+	size_t num_partitions() const;
+
+private:
+	/**
+	 * Key of a partition: (crs-authority, crs-code, time-type, resolution-type,
+	 * pixel-scale-x bounds, pixel-scale-y bounds)
+	 */
+	typedef std::tuple<std::string,uint32_t,timetype_t,QueryResolution::Type,double,double,double,double> PartitionKey;
+
+	static PartitionKey partition_key( const CacheCube &bounds );
+
+	std::map<PartitionKey,CubeIndex<KType>> partitions;
+};
+
+#endif /* CACHE_INDEX_H_ */
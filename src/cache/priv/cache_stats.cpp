@@ -156,7 +156,7 @@ CacheHandshake::CacheHandshake(BinaryReadBuffer& buffer) : CacheContent(buffer)
 ///////////////////////////////////////////////////////////
 
 QueryStats::QueryStats() : single_local_hits(0), multi_local_hits(0), multi_local_partials(0),
-	single_remote_hits(0), multi_remote_hits(0), multi_remote_partials(0), misses(0), result_bytes(0), lost_puts(0), queries(0), ratios(0) {
+	single_remote_hits(0), multi_remote_hits(0), multi_remote_partials(0), misses(0), result_bytes(0), lost_puts(0), coalesced(0), resampled_hits(0), queries(0), ratios(0), resampled_ratios(0) {
 }
 
 QueryStats::QueryStats(BinaryReadBuffer& buffer) :
@@ -169,8 +169,11 @@ QueryStats::QueryStats(BinaryReadBuffer& buffer) :
 	misses(buffer.read<uint32_t>()),
 	result_bytes(buffer.read<uint64_t>()),
 	lost_puts(buffer.read<uint64_t>()),
+	coalesced(buffer.read<uint64_t>()),
+	resampled_hits(buffer.read<uint64_t>()),
 	queries(buffer.read<uint64_t>()),
-	ratios(buffer.read<double>()) {
+	ratios(buffer.read<double>()),
+	resampled_ratios(buffer.read<double>()) {
 }
 
 QueryStats QueryStats::operator +(const QueryStats& stats) const {
@@ -184,8 +187,11 @@ QueryStats QueryStats::operator +(const QueryStats& stats) const {
 	res.misses += stats.misses;
 	res.result_bytes += stats.result_bytes;
 	res.lost_puts += stats.lost_puts;
+	res.coalesced += stats.coalesced;
+	res.resampled_hits += stats.resampled_hits;
 	res.queries += stats.queries;
 	res.ratios += stats.ratios;
+	res.resampled_ratios += stats.resampled_ratios;
 	return res;
 }
 
@@ -199,26 +205,37 @@ QueryStats& QueryStats::operator +=(const QueryStats& stats) {
 	misses += stats.misses;
 	result_bytes += stats.result_bytes;
 	lost_puts += stats.lost_puts;
+	coalesced += stats.coalesced;
+	resampled_hits += stats.resampled_hits;
 	queries += stats.queries;
 	ratios += stats.ratios;
+	resampled_ratios += stats.resampled_ratios;
 	return *this;
 }
 
 void QueryStats::serialize(BinaryWriteBuffer& buffer, bool) const {
 	buffer << single_local_hits << multi_local_hits << multi_local_partials;
 	buffer << single_remote_hits << multi_remote_hits << multi_remote_partials;
-	buffer << misses << result_bytes << lost_puts << queries << ratios;
+	buffer << misses << result_bytes << lost_puts << coalesced << resampled_hits << queries << ratios << resampled_ratios;
 }
 
-void QueryStats::add_query(double ratio) {
+void QueryStats::add_query(double ratio, bool resampled) {
 	ratios += ratio;
 	queries++;
+	if ( resampled ) {
+		resampled_ratios += ratio;
+		resampled_hits++;
+	}
 }
 
 double QueryStats::get_hit_ratio() const {
 	return (queries > 0) ? (ratios/queries) : 0;
 }
 
+double QueryStats::get_resampled_hit_ratio() const {
+	return (queries > 0) ? (resampled_ratios/queries) : 0;
+}
+
 void QueryStats::reset() {
 	single_local_hits = 0;
 	multi_local_hits = 0;
@@ -229,8 +246,11 @@ void QueryStats::reset() {
 	misses = 0;
 	result_bytes = 0;
 	lost_puts = 0;
+	coalesced = 0;
+	resampled_hits = 0;
 	queries = 0;
 	ratios = 0;
+	resampled_ratios = 0;
 }
 
 std::string QueryStats::to_string() const {
@@ -244,9 +264,13 @@ std::string QueryStats::to_string() const {
 	ss << "  remote partials   : " << multi_remote_partials << std::endl;
 	ss << "  misses            : " << misses << std::endl;
 	ss << "  hit-ratio         : " << (ratios / queries) << std::endl;
+	ss << "  exact hit-ratio   : " << ((ratios - resampled_ratios) / queries) << std::endl;
+	ss << "  resampled ratio   : " << (resampled_ratios / queries) << std::endl;
+	ss << "  resampled hits    : " << resampled_hits << std::endl;
 	ss << "  cache-queries     : " << queries << std::endl;
 	ss << "  result-bytes      : " << result_bytes << std::endl;
-	ss << "  lost puts         : " << lost_puts;
+	ss << "  lost puts         : " << lost_puts << std::endl;
+	ss << "  coalesced         : " << coalesced;
 	return ss.str();
 }
 
@@ -368,6 +392,8 @@ std::string SystemStats::to_string() const {
 	ss << "  result-bytes              : " << result_bytes << std::endl;
 	ss << "  lost puts                 : " << lost_puts << std::endl;
 	ss << "  hit ratio                 : " << get_hit_ratio() << std::endl;
+	ss << "  resampled hit ratio       : " << get_resampled_hit_ratio() << std::endl;
+	ss << "  resampled hits            : " << resampled_hits << std::endl;
 	ss << "  cache-queries             : " << queries << std::endl;
 	ss << "  requests received         : " << queries_issued << std::endl;
 	ss << "  requests scheduled        : " << queries_scheduled << std::endl;
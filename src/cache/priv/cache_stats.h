@@ -155,10 +155,20 @@ public:
 	 */
 	std::string to_string() const;
 
-	void add_query( double ratio );
+	/**
+	 * Adds a cache-query
+	 * @param ratio the fraction of the query answered from the cache
+	 * @param resampled whether the query was answered from entries with a finer resolution
+	 */
+	void add_query( double ratio, bool resampled = false );
 
 	double get_hit_ratio() const;
 
+	/**
+	 * @return the average fraction of queries answered from entries with a finer resolution
+	 */
+	double get_resampled_hit_ratio() const;
+
 	/**
 	 * Resets this stats (setting all counts to 0)
 	 */
@@ -174,10 +184,15 @@ public:
 
 	uint64_t result_bytes;
 	uint64_t lost_puts;
+	// requests that waited for a concurrent computation instead of computing the result
+	uint64_t coalesced;
+	// queries answered from entries with a finer resolution
+	uint64_t resampled_hits;
 
 protected:
 	size_t queries;
 	double ratios;
+	double resampled_ratios;
 };
 
 /**
@@ -32,18 +32,18 @@
 ///////////////////////////////////////////////////////////
 
 template<typename EType>
-CacheQueryInfo<EType>::CacheQueryInfo( const std::shared_ptr<const EType> &entry, double score) :
-	entry(entry), score(score) {
+CacheQueryInfo<EType>::CacheQueryInfo( const std::shared_ptr<const EType> &entry, double score, bool resampled) :
+	entry(entry), score(score), resampled(resampled) {
 }
 
 template<typename KType>
 bool CacheQueryInfo<KType>::operator <(const CacheQueryInfo& b) const {
-	return score < b.score;
+	return score < b.score || (score == b.score && resampled && !b.resampled);
 }
 
 template<typename KType>
 std::string CacheQueryInfo<KType>::to_string() const {
-	return concat("CacheQueryInfo: ", entry->to_string(), ", score: ", score);
+	return concat("CacheQueryInfo: ", entry->to_string(), ", score: ", score, ", resampled: ", resampled);
 }
 
 ///////////////////////////////////////////////////////////
@@ -54,15 +54,15 @@ std::string CacheQueryInfo<KType>::to_string() const {
 
 template<typename EType>
 CacheQueryResult<EType>::CacheQueryResult(const QueryRectangle& query) :
-	covered(query), hit_ratio(0) {
+	covered(query), hit_ratio(0), resampled(false) {
 	remainder.push_back( Cube3(query.x1,query.x2,query.y1,query.y2,query.t1,query.t2) );
 }
 
 template<typename EType>
-CacheQueryResult<EType>::CacheQueryResult( QueryRectangle &&query, std::vector<Cube<3>> &&remainder, std::vector<std::shared_ptr<const EType>> &&items, double hit_ratio) :
+CacheQueryResult<EType>::CacheQueryResult( QueryRectangle &&query, std::vector<Cube<3>> &&remainder, std::vector<std::shared_ptr<const EType>> &&items, double hit_ratio, bool resampled) :
 	covered(query), hit_ratio(hit_ratio),
 	items(items),
-	remainder( remainder ) {
+	remainder( remainder ), resampled(resampled) {
 }
 
 template<typename EType>
@@ -82,6 +82,7 @@ std::string CacheQueryResult<EType>::to_string() const {
 	",  has_remainder: ", has_remainder(),
 	",  num remainders: ", remainder.size(),
 	",  num items: ", items.size(),
+	",  resampled: ", resampled,
 	"]");
 }
 
@@ -93,7 +94,8 @@ std::string CacheQueryResult<EType>::to_string() const {
 //////////////////////////////////////////////////////////////
 
 template<typename KType, typename EType>
-CacheStructure<KType, EType>::CacheStructure(const std::string &semantic_id, bool query_exact) : semantic_id(semantic_id), query_exact_only(query_exact), _size(0) {
+CacheStructure<KType, EType>::CacheStructure(const std::string &semantic_id, bool query_exact, double max_resample_factor) :
+	semantic_id(semantic_id), query_exact_only(query_exact), max_resample_factor(max_resample_factor), _size(0) {
 }
 
 
@@ -101,8 +103,10 @@ template<typename KType, typename EType>
 void CacheStructure<KType, EType>::put(const KType& key, const std::shared_ptr<EType>& result) {
 	ExclusiveLockGuard g(lock);
 //	Log::trace("Inserting new entry. Id: %d", key );
-	_size += result->size;
-	entries.emplace(key, result);
+	if ( entries.emplace(key, result).second ) {
+		_size += result->size;
+		index.insert(key, result->bounds);
+	}
 }
 
 template<typename KType, typename EType>
@@ -122,6 +126,7 @@ std::shared_ptr<EType> CacheStructure<KType, EType>::remove(const KType& key) {
 	if ( iter != entries.end() ) {
 		auto result = iter->second;
 		entries.erase(iter);
+		index.remove(key, result->bounds);
 		_size -= result->size;
 		return result;
 	}
@@ -148,12 +153,21 @@ const CacheQueryResult<EType> CacheStructure<KType, EType>::query_exact(
 		const QueryRectangle& spec) const {
 
 	const QueryCube qc(spec);
-	for ( auto &e : entries ) {
-		CacheCube &bounds = e.second->bounds;
-
-		if ( bounds == qc )
-			return CacheQueryResult<EType>( QueryRectangle(spec), std::vector<Cube<3>>(), std::vector<std::shared_ptr<const EType>>{e.second}, 1.0);
+	std::shared_ptr<const EType> hit;
+	{
+		SharedLockGuard g(lock);
+		index.query_all( qc, [&]( const KType &key ) {
+			auto &e = entries.at(key);
+			if ( e->bounds == qc ) {
+				hit = e;
+				return false;
+			}
+			return true;
+		});
 	}
+
+	if ( hit )
+		return CacheQueryResult<EType>( QueryRectangle(spec), std::vector<Cube<3>>(), std::vector<std::shared_ptr<const EType>>{hit}, 1.0);
 	return CacheQueryResult<EType>( spec );
 }
 
@@ -233,6 +247,9 @@ const CacheQueryResult<EType> CacheStructure<KType, EType>::query(const QueryRec
 	if ( rem_volume/ qc.volume() > 0.9 )
 		return CacheQueryResult<EType>( spec );
 
+	// All used entries share the resolution of the first one
+	bool resampled = !used_entries.front()->bounds.resolution_info.matches(qc);
+
 	double hit_ratio = 1.0 - rem_volume / qc.volume();
 
 	// Entend expected result
@@ -244,7 +261,7 @@ const CacheQueryResult<EType> CacheStructure<KType, EType>::query(const QueryRec
 			rem.set_dimension(2, new_query.t1, new_query.t2);
 	}
 
-	return CacheQueryResult<EType>( std::move(new_query), std::move(u_rems), std::move(used_entries), hit_ratio );
+	return CacheQueryResult<EType>( std::move(new_query), std::move(u_rems), std::move(used_entries), hit_ratio, resampled );
 }
 
 template<typename KType, typename EType>
@@ -254,31 +271,32 @@ std::priority_queue<CacheQueryInfo<EType>> CacheStructure<KType, EType>::get_que
 //	Log::trace("Fetching candidates for query: %s", CacheCommon::qr_to_string(spec).c_str() );
 	std::priority_queue<CacheQueryInfo<EType>> partials;
 
-	for (auto &e : entries) {
-		CacheCube &bounds = e.second->bounds;
-
-		if ( qc.crsId == bounds.crsId &&
-			 qc.timetype == bounds.timetype &&
-			 bounds.resolution_info.matches(qc) &&
-			 bounds.intersects(qc) ) {
-
-			// Raster
-			if ( qc.restype == QueryResolution::Type::PIXELS &&
-				!bounds.get_timespan().contains( qc.get_dimension(2) ) )
-				continue;
-
-			// Coverage = score for now
-			double score = bounds.intersect(qc).volume() / qc.volume();
-			Log::trace("Score for entry %s: %f", key_to_string(e.first).c_str(), score);
-			partials.push( CacheQueryInfo<EType>( e.second, score ) );
-
-			// Short circuit full hits
-			if ( (1.0-score) <= std::numeric_limits<double>::epsilon() ) {
-				break;
-			}
+	// The index only reports entries with matching crs, timetype and resolution,
+	// or a finer resolution if resampling is enabled
+	index.query( qc, [&]( const KType &key ) {
+		auto &e = entries.at(key);
+		CacheCube &bounds = e->bounds;
 
-		}
-	}
+		if ( !bounds.intersects(qc) )
+			return true;
+
+		// Raster
+		if ( qc.restype == QueryResolution::Type::PIXELS &&
+			!bounds.get_timespan().contains( qc.get_dimension(2) ) )
+			return true;
+
+		bool resampled = !bounds.resolution_info.matches(qc);
+		if ( resampled && !bounds.resolution_info.matches_resampled(qc, max_resample_factor) )
+			return true;
+
+		// Coverage = score for now
+		double score = bounds.intersect(qc).volume() / qc.volume();
+		Log::trace("Score for entry %s: %f", key_to_string(key).c_str(), score);
+		partials.push( CacheQueryInfo<EType>( e, score, resampled ) );
+
+		// Short circuit full hits with matching resolution
+		return resampled || (1.0-score) > std::numeric_limits<double>::epsilon();
+	}, max_resample_factor);
 //	Log::trace("Found %d candidates for query: %s", partials.size(), CacheCommon::qr_to_string(spec).c_str() );
 	return std::move(partials);
 }
@@ -423,7 +441,8 @@ std::string CacheStructure< std::pair<uint32_t, uint64_t>, IndexCacheEntry>::key
 
 
 template<typename KType, typename EType>
-Cache<KType, EType>::Cache(bool query_exact) : query_exact(query_exact) {
+Cache<KType, EType>::Cache(bool query_exact, double max_resample_factor) :
+	query_exact(query_exact), max_resample_factor(max_resample_factor) {
 }
 
 template<typename KType, typename EType>
@@ -481,7 +500,7 @@ CacheStructure<KType, EType>& Cache<KType, EType>::get_cache(
 	auto got = caches.find(semantic_id);
 	if (got == caches.end() && create) {
 		Log::trace("No cache-structure found for semantic_id: %s. Creating.", semantic_id.c_str() );
-		auto e = caches.emplace(semantic_id, std::make_unique<CacheStructure<KType,EType>>(semantic_id,query_exact));
+		auto e = caches.emplace(semantic_id, std::make_unique<CacheStructure<KType,EType>>(semantic_id,query_exact,max_resample_factor));
 		return *e.first->second;
 	}
 	else if (got != caches.end())
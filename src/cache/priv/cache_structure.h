@@ -9,6 +9,7 @@
 #define CACHE_STRUCTURE_H_
 
 #include "cache/priv/shared.h"
+#include "cache/priv/cache_index.h"
 #include "cache/common.h"
 
 #include <map>
@@ -27,11 +28,13 @@ class CacheQueryInfo {
 public:
 	/**
 	 * Constructs an instance with the given score, bounds and key
+	 * @param resampled whether the entry has to be downsampled to answer the query
 	 */
-	CacheQueryInfo( const std::shared_ptr<const EType> &entry, double score );
+	CacheQueryInfo( const std::shared_ptr<const EType> &entry, double score, bool resampled = false );
 
 	/**
-	 * @return if the current instance is scored lower than the given one
+	 * @return if the current instance is scored lower than the given one,
+	 *         on equal scores entries with matching resolution are preferred
 	 */
 	bool operator <(const CacheQueryInfo &b) const;
 
@@ -43,6 +46,7 @@ public:
 	std::shared_ptr<const EType> entry;
 
 	double score;
+	bool resampled;
 };
 
 /**
@@ -68,8 +72,9 @@ public:
 	 * @param query the original query
 	 * @param remainder the list of remainder queries
 	 * @param keys the list of entry-keys required
+	 * @param resampled whether the items have to be downsampled to the query's resolution
 	 */
-	CacheQueryResult( QueryRectangle &&query, std::vector<Cube<3>> &&remainder, std::vector<std::shared_ptr<const EType>> &&items, double hit_ratio );
+	CacheQueryResult( QueryRectangle &&query, std::vector<Cube<3>> &&remainder, std::vector<std::shared_ptr<const EType>> &&items, double hit_ratio, bool resampled = false );
 
 	/**
 	 * @return whether the query has at least one hit in the cache
@@ -90,6 +95,8 @@ public:
 	double hit_ratio;
 	std::vector<std::shared_ptr<const EType>> items;
 	std::vector<Cube<3>> remainder;
+	// the items have a finer resolution than requested
+	bool resampled;
 };
 
 /**
@@ -100,8 +107,12 @@ class CacheStructure {
 public:
 	/**
 	 * Creates a new instance
+	 * @param semantic_id the semantic id of the cached results
+	 * @param query_exact whether only entries matching queries exactly are reported
+	 * @param max_resample_factor also answer raster queries from entries with a pixel-scale
+	 *        up to this factor finer than requested
 	 */
-	CacheStructure( const std::string &semantic_id, bool query_exact );
+	CacheStructure( const std::string &semantic_id, bool query_exact, double max_resample_factor = 1 );
 	CacheStructure( const CacheStructure<KType,EType> & ) = delete;
 	CacheStructure( CacheStructure<KType,EType> && ) = delete;
 
@@ -194,7 +205,9 @@ public:
 	const std::string semantic_id;
 private:
 	const bool query_exact_only;
+	const double max_resample_factor;
 	std::map<KType, std::shared_ptr<EType>> entries;
+	CacheIndex<KType> index;
 	mutable RWLock lock;
 	uint64_t _size;
 };
@@ -205,7 +218,12 @@ private:
 template<typename KType, typename EType>
 class Cache {
 public:
-	Cache( bool query_exact );
+	/**
+	 * @param query_exact whether only entries matching queries exactly are reported
+	 * @param max_resample_factor also answer raster queries from entries with a pixel-scale
+	 *        up to this factor finer than requested
+	 */
+	Cache( bool query_exact, double max_resample_factor = 1 );
 	Cache( const Cache<KType,EType> & ) = delete;
 	Cache( Cache<KType,EType> && ) = delete;
 	Cache& operator=( const Cache<KType,EType> & ) = delete;
@@ -259,6 +277,7 @@ private:
 	mutable std::unordered_map<std::string,std::unique_ptr<CacheStructure<KType,EType>>> caches;
 	mutable std::mutex mtx;
 	const bool query_exact;
+	const double max_resample_factor;
 };
 
 #endif /* CACHE_STRUCTURE_H_ */
@@ -56,6 +56,13 @@ bool ResolutionInfo::matches(const QueryCube& query) const {
     );
 }
 
+bool ResolutionInfo::matches_resampled(const QueryCube& query, double max_factor) const {
+	return query.restype == QueryResolution::Type::PIXELS && restype == query.restype &&
+		!matches(query) &&
+		Interval(pixel_scale_x.a, pixel_scale_x.b * max_factor).contains(query.pixel_scale_x) &&
+		Interval(pixel_scale_y.a, pixel_scale_y.b * max_factor).contains(query.pixel_scale_y);
+}
+
 std::string ResolutionInfo::to_string() const {
 	return concat("Resolution[ x: ", actual_pixel_scale_x, ", y: ", actual_pixel_scale_y, " ranges: ", pixel_scale_x.to_string(), "x", pixel_scale_y.to_string(), "]" );
 }
@@ -59,6 +59,15 @@ public:
 	 */
 	bool matches( const QueryCube &query ) const;
 
+	/**
+	 * Checks if the resolution is finer than required by the given query, by at most the given factor.
+	 * Such results can answer the query after downsampling them.
+	 * @param query The query to check the resolution for
+	 * @param max_factor the maximum ratio between the query's and this pixel-scale
+	 * @return whether results with this resolution can be downsampled to the query's resolution
+	 */
+	bool matches_resampled( const QueryCube &query, double max_factor ) const;
+
 	/**
 	 * @return a string-representation of this resolution
 	 */
@@ -0,0 +1,152 @@
+#include "cache/priv/single_flight.h"
+#include "cache/node/node_cache.h"
+
+#include "datatypes/raster.h"
+#include "datatypes/pointcollection.h"
+#include "datatypes/linecollection.h"
+#include "datatypes/polygoncollection.h"
+#include "datatypes/plot.h"
+#include "operators/provenance.h"
+#include "util/exceptions.h"
+
+#include <cmath>
+
+template<typename T>
+SingleFlight<T>::Flight::Flight(const std::string &semantic_id, const QueryRectangle &rect) :
+	semantic_id(semantic_id), rect(rect), done(false), identical_waiters(0) {
+}
+
+template<typename T>
+SingleFlight<T>::Ticket::Ticket() : single_flight(nullptr) {
+}
+
+template<typename T>
+SingleFlight<T>::Ticket::~Ticket() {
+	release(nullptr);
+}
+
+template<typename T>
+void SingleFlight<T>::Ticket::complete(const T &result) {
+	release(&result);
+}
+
+template<typename T>
+void SingleFlight<T>::Ticket::release(const T *result) {
+	if ( single_flight == nullptr )
+		return;
+
+	std::lock_guard<std::mutex> g(single_flight->mtx);
+	auto range = single_flight->flights.equal_range(flight->semantic_id);
+	for ( auto it = range.first; it != range.second; ++it ) {
+		if ( it->second == flight ) {
+			single_flight->flights.erase(it);
+			break;
+		}
+	}
+	if ( result != nullptr ) {
+		for ( size_t i = 0; i < flight->identical_waiters; i++ )
+			flight->results.push_back(copy_result(*result));
+	}
+	flight->done = true;
+	flight->cv.notify_all();
+	single_flight = nullptr;
+	flight.reset();
+}
+
+template<typename T>
+SingleFlight<T>::SingleFlight(std::function<void()> on_coalesced) : on_coalesced(std::move(on_coalesced)) {
+}
+
+template<typename T>
+const std::chrono::milliseconds SingleFlight<T>::CANCELLATION_INTERVAL(100);
+
+template<typename T>
+std::unique_ptr<T> SingleFlight<T>::join(const std::string &semantic_id, const QueryRectangle &rect,
+		const std::function<std::unique_ptr<T>()> &lookup, Ticket &ticket, const std::function<void()> &check_cancelled) {
+	std::unique_lock<std::mutex> g(mtx);
+	while ( true ) {
+		// Prefer a computation of the same rectangle, its result is handed over directly
+		std::shared_ptr<Flight> running;
+		bool identical = false;
+		auto range = flights.equal_range(semantic_id);
+		for ( auto it = range.first; it != range.second && !identical; ++it ) {
+			if ( covers(it->second->rect, rect) ) {
+				running = it->second;
+				identical = equals(running->rect, rect);
+			}
+		}
+
+		if ( running == nullptr ) {
+			auto flight = std::make_shared<Flight>(semantic_id, rect);
+			flights.emplace(semantic_id, flight);
+			ticket.single_flight = this;
+			ticket.flight = flight;
+			return nullptr;
+		}
+
+		if ( identical )
+			running->identical_waiters++;
+		auto is_done = [&running]() { return running->done; };
+		if ( !check_cancelled )
+			running->cv.wait(g, is_done);
+		while ( !running->cv.wait_for(g, CANCELLATION_INTERVAL, is_done) ) {
+			try {
+				check_cancelled();
+			} catch ( ... ) {
+				// the computation must not hand over a copy to this request anymore
+				if ( identical )
+					running->identical_waiters--;
+				throw;
+			}
+		}
+
+		if ( identical && !running->results.empty() ) {
+			auto result = std::move(running->results.back());
+			running->results.pop_back();
+			if ( on_coalesced )
+				on_coalesced();
+			return result;
+		}
+
+		// The computation failed or its result was not cached, try again
+		g.unlock();
+		try {
+			auto result = lookup();
+			if ( on_coalesced )
+				on_coalesced();
+			return result;
+		} catch ( NoSuchElementException &nse ) {
+		}
+		g.lock();
+	}
+}
+
+template<typename T>
+bool SingleFlight<T>::covers(const QueryRectangle &a, const QueryRectangle &b) {
+	if ( !(a.crsId == b.crsId) || a.timetype != b.timetype || a.restype != b.restype )
+		return false;
+	if ( a.x1 > b.x1 || a.x2 < b.x2 || a.y1 > b.y1 || a.y2 < b.y2 || a.t1 > b.t1 || a.t2 < b.t2 )
+		return false;
+	if ( a.restype == QueryResolution::Type::PIXELS ) {
+		// Only a result with pixels of the same size can be cut
+		double a_scale_x = (a.x2 - a.x1) / a.xres, b_scale_x = (b.x2 - b.x1) / b.xres;
+		double a_scale_y = (a.y2 - a.y1) / a.yres, b_scale_y = (b.y2 - b.y1) / b.yres;
+		if ( std::abs(a_scale_x - b_scale_x) > 1e-9 * std::abs(a_scale_x) || std::abs(a_scale_y - b_scale_y) > 1e-9 * std::abs(a_scale_y) )
+			return false;
+	}
+	return true;
+}
+
+template<typename T>
+bool SingleFlight<T>::equals(const QueryRectangle &a, const QueryRectangle &b) {
+	return a.crsId == b.crsId && a.timetype == b.timetype && a.restype == b.restype &&
+		a.x1 == b.x1 && a.x2 == b.x2 && a.y1 == b.y1 && a.y2 == b.y2 && a.t1 == b.t1 && a.t2 == b.t2 &&
+		a.xres == b.xres && a.yres == b.yres;
+}
+
+template class SingleFlight<GenericRaster>;
+template class SingleFlight<PointCollection>;
+template class SingleFlight<LineCollection>;
+template class SingleFlight<PolygonCollection>;
+template class SingleFlight<GenericPlot>;
+template class SingleFlight<ProvenanceCollection>;
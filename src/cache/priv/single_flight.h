@@ -0,0 +1,104 @@
+#ifndef CACHE_SINGLE_FLIGHT_H_
+#define CACHE_SINGLE_FLIGHT_H_
+
+#include "operators/queryrectangle.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+
+/**
+ * Coordinates concurrent computations of missing cache entries.
+ *
+ * The first request missing the cache for an operator and query rectangle computes the result.
+ * Concurrent requests for the same rectangle wait for it and get a copy of its result.
+ * Concurrent requests for a covered rectangle wait for it and query the cache again.
+ */
+template<typename T>
+class SingleFlight {
+private:
+	class Flight {
+	public:
+		Flight( const std::string &semantic_id, const QueryRectangle &rect );
+		const std::string semantic_id;
+		const QueryRectangle rect;
+		bool done;
+		size_t identical_waiters;
+		std::vector<std::unique_ptr<T>> results;
+		std::condition_variable cv;
+	};
+
+public:
+	/**
+	 * The permission to compute a result. Requests waiting for the computation are
+	 * released when the ticket is completed or destroyed.
+	 */
+	class Ticket {
+		friend class SingleFlight<T>;
+	public:
+		Ticket();
+		~Ticket();
+		Ticket( const Ticket& ) = delete;
+		Ticket& operator=( const Ticket& ) = delete;
+
+		/**
+		 * Hands copies of the result to the requests waiting for the same query rectangle.
+		 * Requests for covered rectangles query the cache, so this must be called after putting the result.
+		 * Does nothing for a ticket that was not issued by SingleFlight::join().
+		 * @param result the computed result
+		 */
+		void complete( const T &result );
+	private:
+		void release( const T *result );
+		SingleFlight<T> *single_flight;
+		std::shared_ptr<Flight> flight;
+	};
+
+	/**
+	 * @param on_coalesced called for every request that got its result from another request's computation
+	 */
+	SingleFlight( std::function<void()> on_coalesced );
+
+	/**
+	 * Called after missing the cache. If the result for the same or a covering query rectangle is being
+	 * computed, waits for it and returns a copy of it or the result of lookup(), which is expected to
+	 * query the cache again. Otherwise, returns nullptr and issues the ticket for computing the result.
+	 * @param semantic_id the semantic id of the operator
+	 * @param rect the query rectangle
+	 * @param lookup queries the cache, throws a NoSuchElementException on a miss
+	 * @param ticket the ticket to issue
+	 * @param check_cancelled called every CANCELLATION_INTERVAL while waiting, stops waiting by throwing,
+	 *        e.g. if the caller's query was cancelled
+	 * @return the result or nullptr if the caller has to compute it
+	 */
+	std::unique_ptr<T> join( const std::string &semantic_id, const QueryRectangle &rect,
+			const std::function<std::unique_ptr<T>()> &lookup, Ticket &ticket,
+			const std::function<void()> &check_cancelled = nullptr );
+
+	/**
+	 * The interval of checking the cancellation of waiting requests
+	 */
+	static const std::chrono::milliseconds CANCELLATION_INTERVAL;
+
+	/**
+	 * @return whether a result computed for query rectangle a can answer queries for b
+	 */
+	static bool covers( const QueryRectangle &a, const QueryRectangle &b );
+
+	/**
+	 * @return whether the query rectangles are the same
+	 */
+	static bool equals( const QueryRectangle &a, const QueryRectangle &b );
+
+private:
+	std::mutex mtx;
+	std::unordered_multimap<std::string, std::shared_ptr<Flight>> flights;
+	std::function<void()> on_coalesced;
+};
+
+#endif /* CACHE_SINGLE_FLIGHT_H_ */
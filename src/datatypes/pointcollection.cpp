@@ -234,7 +234,7 @@ void PointCollection::featureToGeoJSONGeometry(size_t featureIndex, std::ostring
 }
 
 //TODO: include global metadata?
-std::string PointCollection::toCSV() const {
+void PointCollection::toCSV(std::ostream &output) const {
 	std::ostringstream csv;
 	csv << std::fixed; // std::setprecision(4);
 
@@ -256,7 +256,7 @@ std::string PointCollection::toCSV() const {
 	for(auto &key : value_keys) {
 		csv << ",\"" << key << "\"";
 	}
-	csv << std::endl;
+	csv << "\n";
 
 	for (auto feature : *this) {
 		for (auto & c : feature) {
@@ -276,11 +276,12 @@ std::string PointCollection::toCSV() const {
 			for(auto &key : value_keys) {
 				csv << "," << feature_attributes.numeric(key).get(feature);
 			}
-			csv << std::endl;
+			csv << "\n";
 		}
+		flushToStream(csv, output);
 	}
 
-	return csv.str();
+	flushToStream(csv, output, true);
 }
 
 void PointCollection::featureToWKT(size_t featureIndex, std::ostringstream& wkt) const {
@@ -180,7 +180,8 @@ public:
 
 	virtual SpatialReference getFeatureMBR(size_t featureIndex) const;
 
-	virtual std::string toCSV() const;
+	using SimpleFeatureCollection::toCSV;
+	virtual void toCSV(std::ostream &output) const;
 	virtual std::string toARFF(std::string layerName = "export") const;
 
 	virtual bool isSimple() const final;
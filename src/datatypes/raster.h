@@ -118,6 +118,7 @@ class GenericRaster : public GridSpatioTemporalResult {
 		virtual void toPNG(std::ostream &output, const Colorizer &colorizer, bool flipx = false, bool flipy = false, Raster2D<uint8_t> *overlay = nullptr) = 0;
 		virtual void toJPEG(const char *filename, const Colorizer &colorizer, bool flipx = false, bool flipy = false) = 0;
 		virtual void toGDAL(const char *filename, const char *driver, bool flipx = false, bool flipy = false) = 0;
+		virtual void toGeoTIFF(std::ostream &output, bool flipx = false, bool flipy = false, const std::string *header = nullptr) = 0;
 
 		virtual const void *getData() = 0;
 		virtual size_t getDataSize() const = 0;
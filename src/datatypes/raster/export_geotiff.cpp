@@ -0,0 +1,239 @@
+#include "datatypes/raster/raster_priv.h"
+#include "datatypes/raster/raster_kernels.h"
+
+#include <ogr_spatialref.h>
+
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <limits>
+#include <cstring>
+
+/*
+ * A minimal writer for uncompressed, strip organized single band GeoTIFFs.
+ *
+ * Header, IFD and all tag values are written first, so the pixel data can follow
+ * row by row as it is produced, without knowing the complete file in advance.
+ */
+
+// strips of roughly this size, like libtiff's default for uncompressed images
+static const size_t STRIP_SIZE = 8192;
+// the amount of pixel data written between two flushes of the output
+static const size_t FLUSH_SIZE = 1 << 16;
+
+enum TiffType : uint16_t {
+	TIFF_ASCII = 2,
+	TIFF_SHORT = 3,
+	TIFF_LONG = 4,
+	TIFF_DOUBLE = 12
+};
+
+namespace {
+
+struct TiffEntry {
+	uint16_t tag;
+	TiffType type;
+	uint32_t count;
+	std::vector<char> value;
+};
+
+class TiffEntries {
+	public:
+		/**
+		 * Adds an entry. Entries must be added in ascending order of their tags.
+		 * @return the index of the entry
+		 */
+		template<typename V>
+		size_t add(uint16_t tag, TiffType type, const std::vector<V> &values) {
+			TiffEntry entry{tag, type, (uint32_t) values.size(), std::vector<char>(values.size() * sizeof(V))};
+			memcpy(entry.value.data(), values.data(), entry.value.size());
+			entries.push_back(std::move(entry));
+			return entries.size() - 1;
+		}
+		void addShort(uint16_t tag, uint16_t value) { add(tag, TIFF_SHORT, std::vector<uint16_t>{value}); }
+		void addLong(uint16_t tag, uint32_t value) { add(tag, TIFF_LONG, std::vector<uint32_t>{value}); }
+		void addAscii(uint16_t tag, const std::string &value) { add(tag, TIFF_ASCII, std::vector<char>(value.c_str(), value.c_str() + value.size() + 1)); }
+
+		std::vector<TiffEntry> entries;
+};
+
+template<typename V>
+void put(std::string &out, V value) {
+	out.append((const char *) &value, sizeof(V));
+}
+
+}
+
+
+static void getSampleFormat(GDALDataType datatype, uint16_t &bits, uint16_t &format) {
+	switch (datatype) {
+		case GDT_Byte: bits = 8; format = 1; break;
+		case GDT_UInt16: bits = 16; format = 1; break;
+		case GDT_Int16: bits = 16; format = 2; break;
+		case GDT_UInt32: bits = 32; format = 1; break;
+		case GDT_Int32: bits = 32; format = 2; break;
+		case GDT_Float32: bits = 32; format = 3; break;
+		case GDT_Float64: bits = 64; format = 3; break;
+		default:
+			throw ExporterException("GeoTIFF: unsupported datatype");
+	}
+}
+
+static std::vector<uint16_t> getGeoKeys(const CrsId &crsId) {
+	const uint16_t GTModelTypeGeoKey = 1024, GTRasterTypeGeoKey = 1025, GeographicTypeGeoKey = 2048, ProjectedCSTypeGeoKey = 3072;
+	const uint16_t ModelTypeProjected = 1, ModelTypeGeographic = 2, RasterPixelIsArea = 1;
+
+	OGRSpatialReference srs(nullptr);
+	if (crsId.authority != "EPSG" || crsId.code > std::numeric_limits<uint16_t>::max() || srs.importFromEPSG(crsId.code) != OGRERR_NONE)
+		throw ExporterException(concat("GeoTIFF: cannot write the coordinate reference system ", crsId.to_string()));
+	bool geographic = srs.IsGeographic();
+
+	// the directory header (version 1.1.0, number of keys) followed by the keys, sorted by id
+	return {
+		1, 1, 0, 3,
+		GTModelTypeGeoKey, 0, 1, geographic ? ModelTypeGeographic : ModelTypeProjected,
+		GTRasterTypeGeoKey, 0, 1, RasterPixelIsArea,
+		geographic ? GeographicTypeGeoKey : ProjectedCSTypeGeoKey, 0, 1, (uint16_t) crsId.code
+	};
+}
+
+std::string createGeoTIFFHeader(const GridSpatioTemporalResult &grid, const DataDescription &dd, bool flipx, bool flipy) {
+	const uint16_t ImageWidth = 256, ImageLength = 257, BitsPerSample = 258, Compression = 259, PhotometricInterpretation = 262,
+		StripOffsets = 273, SamplesPerPixel = 277, RowsPerStrip = 278, StripByteCounts = 279, PlanarConfiguration = 284,
+		SampleFormat = 339, ModelTransformationTag = 34264, GeoKeyDirectoryTag = 34735, GDAL_NODATA = 42113;
+
+	if (grid.width == 0 || grid.height == 0)
+		throw ExporterException("GeoTIFF: cannot write an empty raster");
+	uint16_t bits, format;
+	getSampleFormat(dd.datatype, bits, format);
+
+	size_t row_bytes = (size_t) grid.width * bits / 8;
+	uint32_t rows_per_strip = std::max((size_t) 1, std::min((size_t) grid.height, STRIP_SIZE / std::max(row_bytes, (size_t) 1)));
+	uint32_t strips = (grid.height + rows_per_strip - 1) / rows_per_strip;
+
+	TiffEntries tiff;
+	tiff.addLong(ImageWidth, grid.width);
+	tiff.addLong(ImageLength, grid.height);
+	tiff.addShort(BitsPerSample, bits);
+	tiff.addShort(Compression, 1);
+	tiff.addShort(PhotometricInterpretation, 1);
+	size_t strip_offsets_entry = tiff.add(StripOffsets, TIFF_LONG, std::vector<uint32_t>(strips)); // filled in once the layout is known
+	tiff.addShort(SamplesPerPixel, 1);
+	tiff.addLong(RowsPerStrip, rows_per_strip);
+	std::vector<uint32_t> strip_bytes(strips, rows_per_strip * row_bytes);
+	strip_bytes.back() = (grid.height - (strips - 1) * rows_per_strip) * row_bytes;
+	tiff.add(StripByteCounts, TIFF_LONG, strip_bytes);
+	tiff.addShort(PlanarConfiguration, 1);
+	tiff.addShort(SampleFormat, format);
+
+	if (grid.stref.crsId != CrsId::unreferenced()) {
+		// the same transformation as the geotransform of toGDAL()
+		double scale_x = grid.pixel_scale_x * (flipx ? -1 : 1);
+		double scale_y = grid.pixel_scale_y * (flipy ? -1 : 1);
+		double origin_x = flipx ? grid.stref.x2 : grid.stref.x1;
+		double origin_y = flipy ? grid.stref.y2 : grid.stref.y1;
+		tiff.add(ModelTransformationTag, TIFF_DOUBLE, std::vector<double>{
+			scale_x, 0, 0, origin_x,
+			0, scale_y, 0, origin_y,
+			0, 0, 0, 0,
+			0, 0, 0, 1
+		});
+		tiff.add(GeoKeyDirectoryTag, TIFF_SHORT, getGeoKeys(grid.stref.crsId));
+	}
+
+	if (dd.has_no_data) {
+		std::ostringstream no_data;
+		no_data << std::setprecision(std::numeric_limits<double>::max_digits10) << dd.no_data;
+		tiff.addAscii(GDAL_NODATA, no_data.str());
+	}
+
+	// layout: header, IFD, values that do not fit into their entry (word aligned), pixels
+	uint32_t ifd_offset = 8;
+	uint64_t offset = ifd_offset + 2 + tiff.entries.size() * 12 + 4;
+	std::vector<uint32_t> value_offsets;
+	for (auto &entry : tiff.entries) {
+		value_offsets.push_back(offset);
+		if (entry.value.size() > 4)
+			offset += (entry.value.size() + 1) & ~(size_t) 1;
+	}
+	uint64_t data_offset = offset;
+	if (data_offset + (uint64_t) row_bytes * grid.height > std::numeric_limits<uint32_t>::max())
+		throw ExporterException("GeoTIFF: the raster is too large for a classic TIFF file");
+
+	std::vector<uint32_t> strip_offsets(strips);
+	for (uint32_t i = 0; i < strips; i++)
+		strip_offsets[i] = data_offset + (uint64_t) i * rows_per_strip * row_bytes;
+	memcpy(tiff.entries[strip_offsets_entry].value.data(), strip_offsets.data(), strips * sizeof(uint32_t));
+
+	// TIFF supports both byte orders, so everything is written in the native one
+	std::string header;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	header.append("II");
+#else
+	header.append("MM");
+#endif
+	put<uint16_t>(header, 42);
+	put<uint32_t>(header, ifd_offset);
+
+	put<uint16_t>(header, tiff.entries.size());
+	for (size_t i = 0; i < tiff.entries.size(); i++) {
+		auto &entry = tiff.entries[i];
+		put<uint16_t>(header, entry.tag);
+		put<uint16_t>(header, entry.type);
+		put<uint32_t>(header, entry.count);
+		if (entry.value.size() > 4)
+			put<uint32_t>(header, value_offsets[i]);
+		else {
+			// values are left-aligned in their entry
+			char inline_value[4] = {0, 0, 0, 0};
+			memcpy(inline_value, entry.value.data(), entry.value.size());
+			header.append(inline_value, 4);
+		}
+	}
+	put<uint32_t>(header, 0); // no further IFD
+
+	for (auto &entry : tiff.entries) {
+		if (entry.value.size() > 4) {
+			header.append(entry.value.data(), entry.value.size());
+			if (entry.value.size() % 2 != 0)
+				header.push_back(0);
+		}
+	}
+
+	return header;
+}
+
+void writeGeoTIFFHeader(std::ostream &output, const GridSpatioTemporalResult &grid, const DataDescription &dd, bool flipx, bool flipy) {
+	auto header = createGeoTIFFHeader(grid, dd, flipx, flipy);
+	output.write(header.data(), header.size());
+}
+
+
+template<typename T> void Raster2D<T>::toGeoTIFF(std::ostream &output, bool flipx, bool flipy, const std::string *header) {
+	this->setRepresentation(GenericRaster::Representation::CPU);
+	if (header != nullptr)
+		output.write(header->data(), header->size());
+	else
+		writeGeoTIFFHeader(output, *this, dd, flipx, flipy);
+
+	const T *data = (const T *) this->getData();
+	std::vector<T> row(flipx ? width : 0);
+	size_t unflushed = 0;
+	for (uint32_t y = 0; y < height; y++) {
+		const T *src = &data[(size_t) (flipy ? height - y - 1 : y) * width];
+		if (flipx) {
+			RasterKernels::reverse(row.data(), src, width);
+			src = row.data();
+		}
+		output.write((const char *) src, width * sizeof(T));
+		// flush regularly, so the client receives the file while it is written
+		unflushed += width * sizeof(T);
+		if (unflushed >= FLUSH_SIZE) {
+			output.flush();
+			unflushed = 0;
+		}
+	}
+	output.flush();
+}
+
+RASTER_PRIV_INSTANTIATE_ALL
@@ -1,11 +1,13 @@
 
 #include "datatypes/raster/raster_priv.h"
 #include "datatypes/raster/typejuggling.h"
+#include "datatypes/raster/raster_kernels.h"
 #ifndef MAPPING_NO_OPENCL
 #include "raster/opencl.h"
 #endif
 #include "raster/profiler.h"
 #include "util/binarystream.h"
+#include "util/bufferpool.h"
 #include "operators/operator.h" // for QueryRectangle
 
 #include <memory>
@@ -252,17 +254,14 @@ std::unique_ptr<GenericRaster> GenericRaster::clone() {
 
 
 
+// Pixel buffers are page aligned and zeroed. They come from the BufferPool, so the
+// buffers of short lived intermediate rasters are reused instead of being reallocated.
 static void * alloc_aligned_buffer(size_t size) {
-	const size_t ALIGN = 4096;
-
-	if (size % ALIGN != 0)
-		size = size - (size % ALIGN) + ALIGN;
+	return BufferPool::allocate(size);
+}
 
-	void *data = aligned_alloc(ALIGN, size);
-	if (data == nullptr)
-		throw std::bad_alloc();
-	memset(data, 0, size);
-	return data;
+static void free_aligned_buffer(void *data, size_t size) {
+	BufferPool::release(data, size);
 }
 
 
@@ -309,7 +308,7 @@ Raster<T, dimensions>::~Raster() {
 			exit(6);
 		}
 
-		free(data);
+		free_aligned_buffer(data, (getPixelCount()+1) * sizeof(T));
 		//delete [] data;
 		data = nullptr;
 	}
@@ -355,7 +354,7 @@ void Raster<T, dimensions>::setRepresentation(Representation r) {
 			);
 			RasterOpenCL::getQueue()->enqueueWriteBuffer(*clbuffer, CL_TRUE, 0, getDataSize(), data);
 			//delete [] data;
-			free(data);
+			free_aligned_buffer(data, (getPixelCount()+1) * sizeof(T));
 			data = nullptr;
 #endif
 		}
@@ -410,10 +409,7 @@ void Raster2D<T>::clear(double _value) {
 	T value = (T) _value;
 
 	setRepresentation(GenericRaster::Representation::CPU);
-	auto size = getPixelCount();
-	for (decltype(size) i=0;i<size;i++) {
-		data[i] = value;
-	}
+	RasterKernels::fill(data, getPixelCount(), value);
 }
 
 
@@ -495,7 +491,7 @@ std::unique_ptr<GenericRaster> Raster2D<T>::cut(int x1, int y1, int z1, int widt
 			outputraster->set(x, y, getSafe(x+x1, y+y1));
 #elif CUT_TYPE == 2 // 0.0246
 	for (int y=0;y<height;y++) {
-		size_t rowoffset_src = (size_t) (y+y1) * width + x1;
+		size_t rowoffset_src = (size_t) (y+y1) * this->width + x1;
 		size_t rowoffset_dest = (size_t) y * width;
 		memcpy(&outputraster->data[rowoffset_dest], &data[rowoffset_src], width * sizeof(T));
 	}
@@ -532,23 +528,21 @@ std::unique_ptr<GenericRaster> Raster2D<T>::scale(int width, int height, int dep
 
 	int64_t src_width = this->width, src_height = this->height;
 
-	for (int y=0;y<height;y++) {
-		for (int x=0;x<width;x++) {
-			int px = (int) round( ((x+0.5) * src_width / width) - 0.5 );
-			int py = (int) round( ((y+0.5) * src_height / height) - 0.5 );
-
-			/*
-			if (px < 0 || py < 0 || px >= src_width || py >= src_height) {
-				fprintf(stderr, "point outside: size (%ld, %ld) -> (%d, %d), point (%d, %d) -> (%d, %d)\n",
-					src_width, src_height, width, height,
-					x, y, px, py
-				);
-				continue;
-			}
-			*/
+	// the source column is the same for every row, so it is only calculated once
+	std::vector<uint32_t> columns(width);
+	for (int x=0;x<width;x++)
+		columns[x] = (uint32_t) round( ((x+0.5) * src_width / width) - 0.5 );
 
-			outputraster->set(x, y, get(px, py));
-		}
+	int last_py = -1;
+	for (int y=0;y<height;y++) {
+		int py = (int) round( ((y+0.5) * src_height / height) - 0.5 );
+		T *row = &outputraster->data[(size_t) y * width];
+		// when scaling up, consecutive rows are identical
+		if (py == last_py)
+			memcpy(row, row - width, width * sizeof(T));
+		else
+			RasterKernels::gather(row, &data[(size_t) py * src_width], columns.data(), width);
+		last_py = py;
 	}
 
 	outputraster_guard->global_attributes = this->global_attributes;
@@ -564,49 +558,18 @@ std::unique_ptr<GenericRaster> Raster2D<T>::flip(bool flipx, bool flipy) {
 
 	for (uint32_t y=0;y<height;y++) {
 		uint32_t py = flipy ? height-y-1 : y;
-		for (uint32_t x=0;x<width;x++) {
-			uint32_t px = flipx ? width-x-1 : x;
-			r->set(x, y, get(px, py));
-		}
+		const T *src = &data[(size_t) py * width];
+		T *dest = &r->data[(size_t) y * width];
+		if (flipx)
+			RasterKernels::reverse(dest, src, width);
+		else
+			memcpy(dest, src, width * sizeof(T));
 	}
 
 	flipped_raster->global_attributes = this->global_attributes;
 	return flipped_raster;
 }
 
-
-/*
- * This class is a performance optimization to reproject between two rasters of the same CRS.
- *
- * The basic formula is this:
- * source_x = source->WorldToPixelX( dest->PixelToWorldX( dest_x ) );
- *
- * But that involves several mathematical operations we can precalculate.
- */
-class GridSpatioTemporalResultProjecter {
-public:
-	GridSpatioTemporalResultProjecter(const GridSpatioTemporalResult &source, const GridSpatioTemporalResult &dest) {
-		if (source.stref.crsId != dest.stref.crsId)
-			throw ArgumentException("Cannot do simple projections between rasters of a different crsId");
-		// source_x = WorldToPixelX( PixelToWorldX( dest_x ) );
-		// source_x = WorldToPixelY( dest.stref.x1 + (dest_x+0.5) * dest.pixel_scale_x )
-		// source_x = floor( ( (dest.stref.x1 + (dest_x+0.5) * dest.pixel_scale_x) - source.stref.x1) / source.pixel_scale_x )
-		// source_x = floor( ( (dest.stref.x1 + (dest_x+0.5) * dest.pixel_scale_x) - source.stref.x1) / source.pixel_scale_x )
-		// source_x = floor( dest_x * dest.pixel_scale_x/source.pixel_scale_x + (dest.stref.x1 + 0.5*dest.pixel_scale_x - source.stref.x1) / source.pixel_scale_x )
-		factor_x = dest.pixel_scale_x/source.pixel_scale_x;
-		add_x = (dest.stref.x1 + 0.5*dest.pixel_scale_x - source.stref.x1) / source.pixel_scale_x;
-
-		factor_y = dest.pixel_scale_y/source.pixel_scale_y;
-		add_y = (dest.stref.y1 + 0.5*dest.pixel_scale_y - source.stref.y1) / source.pixel_scale_y;
-	}
-	int64_t getX(int px) { return floor(px * factor_x + add_x); }
-	int64_t getY(int py) { return floor(py * factor_y + add_y); }
-private:
-	double factor_x, factor_y;
-	double add_x, add_y;
-};
-
-
 template<typename T>
 std::unique_ptr<GenericRaster> Raster2D<T>::fitToQueryRectangle(const QueryRectangle &qrect) {
 	setRepresentation(GenericRaster::Representation::CPU);
@@ -618,14 +581,33 @@ std::unique_ptr<GenericRaster> Raster2D<T>::fitToQueryRectangle(const QueryRecta
 	Raster2D<T> *r = (Raster2D<T> *) out.get();
 
 	GridSpatioTemporalResultProjecter p(*this, *out);
+
+	// Source columns are the same for every row. Columns outside of this raster are
+	// gathered from column 0 and cleared afterwards, like getSafe() would.
+	std::vector<uint32_t> columns(r->width);
+	std::vector<uint32_t> outside;
+	for (uint32_t x=0;x<r->width;x++) {
+		//auto px = this->WorldToPixelX( r->PixelToWorldX(x) );
+		auto px = p.getX(x);
+		if (px < 0 || px >= (int64_t) width) {
+			columns[x] = 0;
+			outside.push_back(x);
+		}
+		else
+			columns[x] = (uint32_t) px;
+	}
+
 	for (uint32_t y=0;y<r->height;y++) {
 		//auto py = this->WorldToPixelY( r->PixelToWorldY(y) );
 		auto py = p.getY(y);
-		for (uint32_t x=0;x<r->width;x++) {
-			//auto px = this->WorldToPixelX( r->PixelToWorldX(x) );
-			auto px = p.getX(x);
-			r->set(x, y, getSafe(px, py));
+		T *row = &r->data[(size_t) y * r->width];
+		if (py < 0 || py >= (int64_t) height) {
+			RasterKernels::fill(row, r->width, (T) 0);
+			continue;
 		}
+		RasterKernels::gather(row, &data[(size_t) py * width], columns.data(), r->width);
+		for (auto x : outside)
+			row[x] = 0;
 	}
 
 	out->global_attributes = this->global_attributes;
@@ -0,0 +1,425 @@
+#include "datatypes/raster/raster_kernels.h"
+#include "util/exceptions.h"
+
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RASTER_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+
+namespace RasterKernels {
+
+static InstructionSet detectInstructionSet() {
+#ifdef RASTER_KERNELS_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return InstructionSet::AVX2;
+	if (__builtin_cpu_supports("ssse3"))
+		return InstructionSet::SSSE3;
+#endif
+	return InstructionSet::SCALAR;
+}
+
+static std::atomic<InstructionSet> &currentInstructionSet() {
+	static std::atomic<InstructionSet> current(detectInstructionSet());
+	return current;
+}
+
+InstructionSet getInstructionSet() {
+	return currentInstructionSet().load(std::memory_order_relaxed);
+}
+
+bool isSupported(InstructionSet set) {
+	return (int) set <= (int) detectInstructionSet();
+}
+
+void setInstructionSet(InstructionSet set) {
+	if (!isSupported(set))
+		throw ArgumentException("RasterKernels: instruction set not supported by this CPU");
+	currentInstructionSet().store(set);
+}
+
+
+/*
+ * Scalar reference implementations
+ */
+template<typename T>
+static void fill_scalar(T *dst, size_t count, T value) {
+	for (size_t i = 0; i < count; i++)
+		dst[i] = value;
+}
+
+template<typename T>
+static void reverse_scalar(T *dst, const T *src, size_t count) {
+	for (size_t i = 0; i < count; i++)
+		dst[i] = src[count-1-i];
+}
+
+template<typename T>
+static void gather_scalar(T *dst, const T *src, const uint32_t *indices, size_t count) {
+	for (size_t i = 0; i < count; i++)
+		dst[i] = src[indices[i]];
+}
+
+static void accumulateSum_scalar(double *sums, double *counts, const double *values, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		bool valid = values[i] == values[i];
+		sums[i] += valid ? values[i] : 0.0;
+		counts[i] += valid ? 1.0 : 0.0;
+	}
+}
+
+// written like MINPD/MAXPD, which return the second operand if the first one is NaN
+static void accumulateMin_scalar(double *mins, double *counts, const double *values, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		mins[i] = values[i] < mins[i] ? values[i] : mins[i];
+		counts[i] += values[i] == values[i] ? 1.0 : 0.0;
+	}
+}
+
+static void accumulateMax_scalar(double *maxs, double *counts, const double *values, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		maxs[i] = values[i] > maxs[i] ? values[i] : maxs[i];
+		counts[i] += values[i] == values[i] ? 1.0 : 0.0;
+	}
+}
+
+static void accumulateMoments_scalar(double *means, double *m2s, double *counts, const double *values, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		if (values[i] != values[i])
+			continue;
+		double n = counts[i] + 1.0;
+		double delta = values[i] - means[i];
+		double mean = means[i] + delta / n;
+		m2s[i] = m2s[i] + delta * (values[i] - mean);
+		means[i] = mean;
+		counts[i] = n;
+	}
+}
+
+
+#ifdef RASTER_KERNELS_X86
+/*
+ * Builds the byte shuffle reversing the order of the elements of type T inside 16 bytes
+ */
+template<typename T>
+static void reverseMask(uint8_t *mask) {
+	const size_t n = 16 / sizeof(T);
+	for (size_t j = 0; j < 16; j++)
+		mask[j] = (uint8_t) ((n - 1 - j / sizeof(T)) * sizeof(T) + j % sizeof(T));
+}
+
+/*
+ * SSSE3
+ */
+template<typename T>
+__attribute__((target("ssse3")))
+static void fill_ssse3(T *dst, size_t count, T value) {
+	const size_t step = 16 / sizeof(T);
+	alignas(16) T pattern[step];
+	for (size_t j = 0; j < step; j++)
+		pattern[j] = value;
+	__m128i v = _mm_load_si128((const __m128i *) pattern);
+
+	size_t i = 0;
+	for (; i + step <= count; i += step)
+		_mm_storeu_si128((__m128i *) (dst + i), v);
+	fill_scalar(dst + i, count - i, value);
+}
+
+template<typename T>
+__attribute__((target("ssse3")))
+static void reverse_ssse3(T *dst, const T *src, size_t count) {
+	const size_t step = 16 / sizeof(T);
+	alignas(16) uint8_t mask_bytes[16];
+	reverseMask<T>(mask_bytes);
+	__m128i mask = _mm_load_si128((const __m128i *) mask_bytes);
+
+	size_t i = 0;
+	for (; i + step <= count; i += step) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (src + count - i - step));
+		_mm_storeu_si128((__m128i *) (dst + i), _mm_shuffle_epi8(v, mask));
+	}
+	for (; i < count; i++)
+		dst[i] = src[count-1-i];
+}
+
+__attribute__((target("ssse3")))
+static void accumulateSum_ssse3(double *sums, double *counts, const double *values, size_t count) {
+	const __m128d one = _mm_set1_pd(1.0);
+	size_t i = 0;
+	for (; i + 2 <= count; i += 2) {
+		__m128d v = _mm_loadu_pd(values + i);
+		__m128d valid = _mm_cmpord_pd(v, v);
+		_mm_storeu_pd(sums + i, _mm_add_pd(_mm_loadu_pd(sums + i), _mm_and_pd(valid, v)));
+		_mm_storeu_pd(counts + i, _mm_add_pd(_mm_loadu_pd(counts + i), _mm_and_pd(valid, one)));
+	}
+	accumulateSum_scalar(sums + i, counts + i, values + i, count - i);
+}
+
+__attribute__((target("ssse3")))
+static void accumulateMin_ssse3(double *mins, double *counts, const double *values, size_t count) {
+	const __m128d one = _mm_set1_pd(1.0);
+	size_t i = 0;
+	for (; i + 2 <= count; i += 2) {
+		__m128d v = _mm_loadu_pd(values + i);
+		_mm_storeu_pd(mins + i, _mm_min_pd(v, _mm_loadu_pd(mins + i)));
+		_mm_storeu_pd(counts + i, _mm_add_pd(_mm_loadu_pd(counts + i), _mm_and_pd(_mm_cmpord_pd(v, v), one)));
+	}
+	accumulateMin_scalar(mins + i, counts + i, values + i, count - i);
+}
+
+__attribute__((target("ssse3")))
+static void accumulateMax_ssse3(double *maxs, double *counts, const double *values, size_t count) {
+	const __m128d one = _mm_set1_pd(1.0);
+	size_t i = 0;
+	for (; i + 2 <= count; i += 2) {
+		__m128d v = _mm_loadu_pd(values + i);
+		_mm_storeu_pd(maxs + i, _mm_max_pd(v, _mm_loadu_pd(maxs + i)));
+		_mm_storeu_pd(counts + i, _mm_add_pd(_mm_loadu_pd(counts + i), _mm_and_pd(_mm_cmpord_pd(v, v), one)));
+	}
+	accumulateMax_scalar(maxs + i, counts + i, values + i, count - i);
+}
+
+__attribute__((target("ssse3")))
+static void accumulateMoments_ssse3(double *means, double *m2s, double *counts, const double *values, size_t count) {
+	const __m128d one = _mm_set1_pd(1.0);
+	size_t i = 0;
+	for (; i + 2 <= count; i += 2) {
+		__m128d v = _mm_loadu_pd(values + i);
+		__m128d valid = _mm_cmpord_pd(v, v);
+		__m128d mean = _mm_loadu_pd(means + i), m2 = _mm_loadu_pd(m2s + i), n = _mm_loadu_pd(counts + i);
+		__m128d n_new = _mm_add_pd(n, one);
+		__m128d delta = _mm_sub_pd(v, mean);
+		__m128d mean_new = _mm_add_pd(mean, _mm_div_pd(delta, n_new));
+		__m128d m2_new = _mm_add_pd(m2, _mm_mul_pd(delta, _mm_sub_pd(v, mean_new)));
+		// there is no blend before SSE4.1
+		_mm_storeu_pd(means + i, _mm_or_pd(_mm_and_pd(valid, mean_new), _mm_andnot_pd(valid, mean)));
+		_mm_storeu_pd(m2s + i, _mm_or_pd(_mm_and_pd(valid, m2_new), _mm_andnot_pd(valid, m2)));
+		_mm_storeu_pd(counts + i, _mm_add_pd(n, _mm_and_pd(valid, one)));
+	}
+	accumulateMoments_scalar(means + i, m2s + i, counts + i, values + i, count - i);
+}
+
+/*
+ * AVX2
+ */
+template<typename T>
+__attribute__((target("avx2")))
+static void fill_avx2(T *dst, size_t count, T value) {
+	const size_t step = 32 / sizeof(T);
+	alignas(32) T pattern[step];
+	for (size_t j = 0; j < step; j++)
+		pattern[j] = value;
+	__m256i v = _mm256_load_si256((const __m256i *) pattern);
+
+	size_t i = 0;
+	for (; i + 4*step <= count; i += 4*step) {
+		_mm256_storeu_si256((__m256i *) (dst + i), v);
+		_mm256_storeu_si256((__m256i *) (dst + i + step), v);
+		_mm256_storeu_si256((__m256i *) (dst + i + 2*step), v);
+		_mm256_storeu_si256((__m256i *) (dst + i + 3*step), v);
+	}
+	for (; i + step <= count; i += step)
+		_mm256_storeu_si256((__m256i *) (dst + i), v);
+	fill_scalar(dst + i, count - i, value);
+}
+
+template<typename T>
+__attribute__((target("avx2")))
+static void reverse_avx2(T *dst, const T *src, size_t count) {
+	const size_t step = 32 / sizeof(T);
+	alignas(32) uint8_t mask_bytes[32];
+	reverseMask<T>(mask_bytes);
+	reverseMask<T>(mask_bytes + 16);
+	__m256i mask = _mm256_load_si256((const __m256i *) mask_bytes);
+
+	size_t i = 0;
+	for (; i + step <= count; i += step) {
+		__m256i v = _mm256_loadu_si256((const __m256i *) (src + count - i - step));
+		// reverse within both 128 bit lanes, then swap the lanes
+		v = _mm256_shuffle_epi8(v, mask);
+		v = _mm256_permute2x128_si256(v, v, 1);
+		_mm256_storeu_si256((__m256i *) (dst + i), v);
+	}
+	for (; i < count; i++)
+		dst[i] = src[count-1-i];
+}
+
+template<typename T>
+__attribute__((target("avx2")))
+static void gather_avx2(T *dst, const T *src, const uint32_t *indices, size_t count) {
+	size_t i = 0;
+	if (sizeof(T) == 4) {
+		for (; i + 8 <= count; i += 8) {
+			__m256i idx = _mm256_loadu_si256((const __m256i *) (indices + i));
+			__m256i v = _mm256_i32gather_epi32((const int *) src, idx, 4);
+			_mm256_storeu_si256((__m256i *) (dst + i), v);
+		}
+	}
+	else if (sizeof(T) == 8) {
+		for (; i + 4 <= count; i += 4) {
+			__m128i idx = _mm_loadu_si128((const __m128i *) (indices + i));
+			__m256i v = _mm256_i32gather_epi64((const long long *) src, idx, 8);
+			_mm256_storeu_si256((__m256i *) (dst + i), v);
+		}
+	}
+	// there are no gathers for 8 and 16 bit elements
+	gather_scalar(dst + i, src, indices + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void accumulateSum_avx2(double *sums, double *counts, const double *values, size_t count) {
+	const __m256d one = _mm256_set1_pd(1.0);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m256d v = _mm256_loadu_pd(values + i);
+		__m256d valid = _mm256_cmp_pd(v, v, _CMP_ORD_Q);
+		_mm256_storeu_pd(sums + i, _mm256_add_pd(_mm256_loadu_pd(sums + i), _mm256_and_pd(valid, v)));
+		_mm256_storeu_pd(counts + i, _mm256_add_pd(_mm256_loadu_pd(counts + i), _mm256_and_pd(valid, one)));
+	}
+	accumulateSum_scalar(sums + i, counts + i, values + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void accumulateMin_avx2(double *mins, double *counts, const double *values, size_t count) {
+	const __m256d one = _mm256_set1_pd(1.0);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m256d v = _mm256_loadu_pd(values + i);
+		_mm256_storeu_pd(mins + i, _mm256_min_pd(v, _mm256_loadu_pd(mins + i)));
+		_mm256_storeu_pd(counts + i, _mm256_add_pd(_mm256_loadu_pd(counts + i), _mm256_and_pd(_mm256_cmp_pd(v, v, _CMP_ORD_Q), one)));
+	}
+	accumulateMin_scalar(mins + i, counts + i, values + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void accumulateMax_avx2(double *maxs, double *counts, const double *values, size_t count) {
+	const __m256d one = _mm256_set1_pd(1.0);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m256d v = _mm256_loadu_pd(values + i);
+		_mm256_storeu_pd(maxs + i, _mm256_max_pd(v, _mm256_loadu_pd(maxs + i)));
+		_mm256_storeu_pd(counts + i, _mm256_add_pd(_mm256_loadu_pd(counts + i), _mm256_and_pd(_mm256_cmp_pd(v, v, _CMP_ORD_Q), one)));
+	}
+	accumulateMax_scalar(maxs + i, counts + i, values + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void accumulateMoments_avx2(double *means, double *m2s, double *counts, const double *values, size_t count) {
+	const __m256d one = _mm256_set1_pd(1.0);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m256d v = _mm256_loadu_pd(values + i);
+		__m256d valid = _mm256_cmp_pd(v, v, _CMP_ORD_Q);
+		__m256d mean = _mm256_loadu_pd(means + i), m2 = _mm256_loadu_pd(m2s + i), n = _mm256_loadu_pd(counts + i);
+		__m256d n_new = _mm256_add_pd(n, one);
+		__m256d delta = _mm256_sub_pd(v, mean);
+		__m256d mean_new = _mm256_add_pd(mean, _mm256_div_pd(delta, n_new));
+		__m256d m2_new = _mm256_add_pd(m2, _mm256_mul_pd(delta, _mm256_sub_pd(v, mean_new)));
+		_mm256_storeu_pd(means + i, _mm256_blendv_pd(mean, mean_new, valid));
+		_mm256_storeu_pd(m2s + i, _mm256_blendv_pd(m2, m2_new, valid));
+		_mm256_storeu_pd(counts + i, _mm256_blendv_pd(n, n_new, valid));
+	}
+	accumulateMoments_scalar(means + i, m2s + i, counts + i, values + i, count - i);
+}
+#endif
+
+
+/*
+ * Dispatch
+ */
+template<typename T>
+void fill(T *dst, size_t count, T value) {
+#ifdef RASTER_KERNELS_X86
+	switch (getInstructionSet()) {
+		case InstructionSet::AVX2:
+			return fill_avx2(dst, count, value);
+		case InstructionSet::SSSE3:
+			return fill_ssse3(dst, count, value);
+		default:
+			break;
+	}
+#endif
+	fill_scalar(dst, count, value);
+}
+
+template<typename T>
+void reverse(T *dst, const T *src, size_t count) {
+#ifdef RASTER_KERNELS_X86
+	switch (getInstructionSet()) {
+		case InstructionSet::AVX2:
+			return reverse_avx2(dst, src, count);
+		case InstructionSet::SSSE3:
+			return reverse_ssse3(dst, src, count);
+		default:
+			break;
+	}
+#endif
+	reverse_scalar(dst, src, count);
+}
+
+template<typename T>
+void gather(T *dst, const T *src, const uint32_t *indices, size_t count) {
+#ifdef RASTER_KERNELS_X86
+	if (getInstructionSet() == InstructionSet::AVX2)
+		return gather_avx2(dst, src, indices, count);
+#endif
+	gather_scalar(dst, src, indices, count);
+}
+
+
+/*
+ * Accumulators work on doubles, for which SSE2 suffices; they share the SSSE3 level
+ */
+#ifdef RASTER_KERNELS_X86
+#define RASTER_KERNELS_DISPATCH(name, ...) \
+	switch (getInstructionSet()) { \
+		case InstructionSet::AVX2: \
+			return name##_avx2(__VA_ARGS__); \
+		case InstructionSet::SSSE3: \
+			return name##_ssse3(__VA_ARGS__); \
+		default: \
+			break; \
+	}
+#else
+#define RASTER_KERNELS_DISPATCH(name, ...)
+#endif
+
+void accumulateSum(double *sums, double *counts, const double *values, size_t count) {
+	RASTER_KERNELS_DISPATCH(accumulateSum, sums, counts, values, count)
+	accumulateSum_scalar(sums, counts, values, count);
+}
+
+void accumulateMin(double *mins, double *counts, const double *values, size_t count) {
+	RASTER_KERNELS_DISPATCH(accumulateMin, mins, counts, values, count)
+	accumulateMin_scalar(mins, counts, values, count);
+}
+
+void accumulateMax(double *maxs, double *counts, const double *values, size_t count) {
+	RASTER_KERNELS_DISPATCH(accumulateMax, maxs, counts, values, count)
+	accumulateMax_scalar(maxs, counts, values, count);
+}
+
+void accumulateMoments(double *means, double *m2s, double *counts, const double *values, size_t count) {
+	RASTER_KERNELS_DISPATCH(accumulateMoments, means, m2s, counts, values, count)
+	accumulateMoments_scalar(means, m2s, counts, values, count);
+}
+
+
+#define RASTER_KERNELS_INSTANTIATE(T) \
+	template void fill<T>(T *, size_t, T); \
+	template void reverse<T>(T *, const T *, size_t); \
+	template void gather<T>(T *, const T *, const uint32_t *, size_t);
+
+RASTER_KERNELS_INSTANTIATE(uint8_t)
+RASTER_KERNELS_INSTANTIATE(uint16_t)
+RASTER_KERNELS_INSTANTIATE(int16_t)
+RASTER_KERNELS_INSTANTIATE(uint32_t)
+RASTER_KERNELS_INSTANTIATE(int32_t)
+RASTER_KERNELS_INSTANTIATE(float)
+RASTER_KERNELS_INSTANTIATE(double)
+
+}
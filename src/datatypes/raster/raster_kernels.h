@@ -0,0 +1,81 @@
+#ifndef RASTER_RASTER_KERNELS_H
+#define RASTER_RASTER_KERNELS_H 1
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Vectorized building blocks for the pixel loops of Raster2D.
+ *
+ * Every kernel has a scalar implementation and, on x86, SSSE3 and AVX2 implementations
+ * that are selected at runtime depending on the capabilities of the CPU. All
+ * implementations produce bit-identical results.
+ */
+namespace RasterKernels {
+	enum class InstructionSet {
+		SCALAR,
+		SSSE3,
+		AVX2
+	};
+
+	/**
+	 * @return the instruction set currently used by the kernels
+	 */
+	InstructionSet getInstructionSet();
+
+	/**
+	 * Overrides the instruction set used by the kernels, for testing and benchmarking
+	 * @param set an instruction set supported by this CPU
+	 */
+	void setInstructionSet(InstructionSet set);
+
+	/**
+	 * @return whether the given instruction set is supported by this CPU
+	 */
+	bool isSupported(InstructionSet set);
+
+	/**
+	 * dst[i] = value for all i in [0, count)
+	 */
+	template<typename T>
+	void fill(T *dst, size_t count, T value);
+
+	/**
+	 * dst[i] = src[count-1-i] for all i in [0, count). The ranges must not overlap.
+	 */
+	template<typename T>
+	void reverse(T *dst, const T *src, size_t count);
+
+	/**
+	 * dst[i] = src[indices[i]] for all i in [0, count)
+	 */
+	template<typename T>
+	void gather(T *dst, const T *src, const uint32_t *indices, size_t count);
+
+	/*
+	 * Per-pixel accumulators for aggregating a series of rasters. NaN values are missing
+	 * and leave the accumulators unchanged, otherwise counts[i] is incremented.
+	 */
+
+	/**
+	 * sums[i] += values[i]
+	 */
+	void accumulateSum(double *sums, double *counts, const double *values, size_t count);
+
+	/**
+	 * mins[i] = min(mins[i], values[i])
+	 */
+	void accumulateMin(double *mins, double *counts, const double *values, size_t count);
+
+	/**
+	 * maxs[i] = max(maxs[i], values[i])
+	 */
+	void accumulateMax(double *maxs, double *counts, const double *values, size_t count);
+
+	/**
+	 * Updates the mean and the sum of squared differences from the mean (Welford's algorithm)
+	 */
+	void accumulateMoments(double *means, double *m2s, double *counts, const double *values, size_t count);
+}
+
+#endif
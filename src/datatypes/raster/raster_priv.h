@@ -2,6 +2,9 @@
 #define RASTER_RASTER_PRIV_H 1
 
 #include "datatypes/raster.h"
+#include "util/exceptions.h"
+
+#include <cmath>
 
 /**
  * Base class for n dimensional rasters
@@ -121,6 +124,12 @@ class Raster2D : public Raster<T, 2> {
          */
         virtual void toGDAL(const char *filename, const char *driver, bool flipx = false, bool flipy = false);
 
+        /**
+         * Write an uncompressed GeoTIFF to a stream, row by row
+         * @param header the header created by createGeoTIFFHeader() with the same flips, if it is already known
+         */
+        virtual void toGeoTIFF(std::ostream &output, bool flipx = false, bool flipy = false, const std::string *header = nullptr);
+
         /**
          * Clears all pixels and sets a value
          */
@@ -224,6 +233,51 @@ class Raster2D : public Raster<T, 2> {
 };
 
 
+/**
+ * This class is a performance optimization to reproject between two rasters of the same CRS.
+ *
+ * The basic formula is this:
+ * source_x = source->WorldToPixelX( dest->PixelToWorldX( dest_x ) );
+ *
+ * But that involves several mathematical operations we can precalculate.
+ */
+class GridSpatioTemporalResultProjecter {
+    public:
+        GridSpatioTemporalResultProjecter(const GridSpatioTemporalResult &source, const GridSpatioTemporalResult &dest) {
+            if (source.stref.crsId != dest.stref.crsId)
+                throw ArgumentException("Cannot do simple projections between rasters of a different crsId");
+            // source_x = WorldToPixelX( PixelToWorldX( dest_x ) );
+            // source_x = WorldToPixelY( dest.stref.x1 + (dest_x+0.5) * dest.pixel_scale_x )
+            // source_x = floor( ( (dest.stref.x1 + (dest_x+0.5) * dest.pixel_scale_x) - source.stref.x1) / source.pixel_scale_x )
+            // source_x = floor( ( (dest.stref.x1 + (dest_x+0.5) * dest.pixel_scale_x) - source.stref.x1) / source.pixel_scale_x )
+            // source_x = floor( dest_x * dest.pixel_scale_x/source.pixel_scale_x + (dest.stref.x1 + 0.5*dest.pixel_scale_x - source.stref.x1) / source.pixel_scale_x )
+            factor_x = dest.pixel_scale_x/source.pixel_scale_x;
+            add_x = (dest.stref.x1 + 0.5*dest.pixel_scale_x - source.stref.x1) / source.pixel_scale_x;
+
+            factor_y = dest.pixel_scale_y/source.pixel_scale_y;
+            add_y = (dest.stref.y1 + 0.5*dest.pixel_scale_y - source.stref.y1) / source.pixel_scale_y;
+        }
+        int64_t getX(int px) const { return floor(px * factor_x + add_x); }
+        int64_t getY(int py) const { return floor(py * factor_y + add_y); }
+    private:
+        double factor_x, factor_y;
+        double add_x, add_y;
+};
+
+/**
+ * Creates the header of an uncompressed single band GeoTIFF of the grid, see writeGeoTIFFHeader().
+ * Throws an ExporterException if the grid cannot be written as such a GeoTIFF.
+ */
+std::string createGeoTIFFHeader(const GridSpatioTemporalResult &grid, const DataDescription &dd, bool flipx = false, bool flipy = false);
+
+/**
+ * Writes the header of an uncompressed single band GeoTIFF of the grid. It must be followed by
+ * width*height pixels of the given datatype in row-major order, in native byte order.
+ * Only EPSG and unreferenced coordinate reference systems are supported.
+ */
+void writeGeoTIFFHeader(std::ostream &output, const GridSpatioTemporalResult &grid, const DataDescription &dd, bool flipx = false, bool flipy = false);
+
+
 #define RASTER_PRIV_INSTANTIATE_ALL template class Raster2D<uint8_t>;template class Raster2D<uint16_t>;template class Raster2D<int16_t>;template class Raster2D<uint32_t>;template class Raster2D<int32_t>;template class Raster2D<float>;template class Raster2D<double>;
 
 
@@ -0,0 +1,200 @@
+#include "datatypes/raster/tiled_raster.h"
+#include "datatypes/raster/typejuggling.h"
+#include "operators/queryrectangle.h"
+#include "util/bufferpool.h"
+#include "util/threadpool.h"
+#include "util/exceptions.h"
+
+#include <cstring>
+
+
+template<typename T>
+TiledRaster2D<T>::TiledRaster2D(const DataDescription &dd, const SpatioTemporalReference &stref, uint32_t width, uint32_t height,
+		const TileProducer &producer, uint32_t tile_size)
+	: GridSpatioTemporalResult(stref, width, height), dd(dd), tile_size(tile_size),
+	  tiles_x(tile_size > 0 ? (width + tile_size - 1) / tile_size : 0),
+	  tiles_y(tile_size > 0 ? (height + tile_size - 1) / tile_size : 0),
+	  producer(producer), tiles((size_t) tiles_x * tiles_y) {
+	if (tile_size == 0)
+		throw ArgumentException("TiledRaster2D: tile size must be positive");
+}
+
+template<typename T>
+TiledRaster2D<T>::~TiledRaster2D() {
+	for (auto &t : tiles)
+		BufferPool::release(t.data, tileBytes());
+}
+
+template<typename T>
+std::shared_ptr<TiledRaster2D<T>> TiledRaster2D<T>::fromRaster(std::unique_ptr<GenericRaster> raster, uint32_t tile_size) {
+	if (raster->dd.datatype != RasterTypeInfo<T>::type)
+		throw ArgumentException("TiledRaster2D: raster has a different datatype");
+	raster->setRepresentation(GenericRaster::Representation::CPU);
+
+	std::shared_ptr<GenericRaster> source(std::move(raster));
+	auto r = (Raster2D<T> *) source.get();
+	return std::make_shared<TiledRaster2D<T>>(r->dd, r->stref, r->width, r->height,
+		[source, r](uint32_t x, uint32_t y, uint32_t width, uint32_t height, T *buffer) {
+			const T *data = (const T *) r->getData();
+			for (uint32_t row = 0; row < height; row++)
+				memcpy(&buffer[(size_t) row * width], &data[(size_t) (y + row) * r->width + x], width * sizeof(T));
+		}, tile_size);
+}
+
+template<typename T>
+const T *TiledRaster2D<T>::getTile(uint32_t tx, uint32_t ty) {
+	if (tx >= tiles_x || ty >= tiles_y)
+		throw ArgumentException("TiledRaster2D: tile out of bounds");
+	auto &t = tile(tx, ty);
+	std::lock_guard<std::mutex> guard(t.mutex);
+	if (t.data == nullptr) {
+		T *data = (T *) BufferPool::allocate(tileBytes());
+		try {
+			producer(tx * tile_size, ty * tile_size, getTileWidth(tx), getTileHeight(ty), data);
+		}
+		catch (...) {
+			BufferPool::release(data, tileBytes());
+			throw;
+		}
+		t.data = data;
+	}
+	return t.data;
+}
+
+template<typename T>
+void TiledRaster2D<T>::releaseTile(uint32_t tx, uint32_t ty) {
+	auto &t = tile(tx, ty);
+	std::lock_guard<std::mutex> guard(t.mutex);
+	BufferPool::release(t.data, tileBytes());
+	t.data = nullptr;
+}
+
+template<typename T>
+void TiledRaster2D<T>::read(uint32_t x, uint32_t y, uint32_t width, uint32_t height, T *dest, size_t stride) {
+	if (x + width > this->width || y + height > this->height)
+		throw ArgumentException("TiledRaster2D: read outside of the raster");
+	if (width == 0 || height == 0)
+		return;
+
+	for (uint32_t ty = y / tile_size; ty <= (y + height - 1) / tile_size; ty++) {
+		for (uint32_t tx = x / tile_size; tx <= (x + width - 1) / tile_size; tx++) {
+			const T *data = getTile(tx, ty);
+			uint32_t tile_w = getTileWidth(tx);
+			// the intersection of the tile and the requested region, in raster coordinates
+			uint32_t x1 = std::max(x, tx * tile_size), x2 = std::min(x + width, tx * tile_size + tile_w);
+			uint32_t y1 = std::max(y, ty * tile_size), y2 = std::min(y + height, ty * tile_size + getTileHeight(ty));
+			for (uint32_t row = y1; row < y2; row++)
+				memcpy(&dest[(size_t) (row - y) * stride + (x1 - x)],
+					&data[(size_t) (row - ty * tile_size) * tile_w + (x1 - tx * tile_size)],
+					(x2 - x1) * sizeof(T));
+		}
+	}
+}
+
+template<typename T>
+T TiledRaster2D<T>::getSafe(int64_t x, int64_t y, T def) {
+	if (x < 0 || y < 0 || x >= width || y >= height)
+		return def;
+	uint32_t tx = x / tile_size, ty = y / tile_size;
+	return getTile(tx, ty)[(size_t) (y - ty * tile_size) * getTileWidth(tx) + (x - tx * tile_size)];
+}
+
+template<typename T>
+std::shared_ptr<TiledRaster2D<T>> TiledRaster2D<T>::cut(uint32_t x1, uint32_t y1, uint32_t width, uint32_t height) {
+	if (x1 + width > this->width || y1 + height > this->height)
+		throw ArgumentException("TiledRaster2D: cut() not inside the raster");
+
+	double world_x1 = PixelToWorldX(x1) - pixel_scale_x * 0.5;
+	double world_y1 = PixelToWorldY(y1) - pixel_scale_y * 0.5;
+	SpatioTemporalReference newstref(
+		SpatialReference(stref.crsId, world_x1, world_y1, world_x1 + pixel_scale_x * width, world_y1 + pixel_scale_y * height),
+		TemporalReference(stref)
+	);
+
+	auto source = this->shared_from_this();
+	return std::make_shared<TiledRaster2D<T>>(dd, newstref, width, height,
+		[source, x1, y1](uint32_t x, uint32_t y, uint32_t width, uint32_t height, T *buffer) {
+			source->read(x1 + x, y1 + y, width, height, buffer, width);
+		}, tile_size);
+}
+
+template<typename T>
+std::shared_ptr<TiledRaster2D<T>> TiledRaster2D<T>::fitToQueryRectangle(const QueryRectangle &qrect) {
+	// adjust sref and resolution, but keep the tref.
+	QueryRectangle target(qrect, stref, qrect);
+	GridSpatioTemporalResult target_grid(SpatioTemporalReference(target), target.xres, target.yres);
+	GridSpatioTemporalResultProjecter p(*this, target_grid);
+
+	auto source = this->shared_from_this();
+	return std::make_shared<TiledRaster2D<T>>(dd, target_grid.stref, target.xres, target.yres,
+		[source, p](uint32_t x, uint32_t y, uint32_t width, uint32_t height, T *buffer) {
+			// source columns are the same for every row; pixels outside of the source are 0, like Raster2D::getSafe()
+			std::vector<int64_t> columns(width);
+			int64_t min_column = source->width, max_column = -1;
+			for (uint32_t col = 0; col < width; col++) {
+				columns[col] = p.getX(x + col);
+				if (columns[col] >= 0 && columns[col] < source->width) {
+					min_column = std::min(min_column, columns[col]);
+					max_column = std::max(max_column, columns[col]);
+				}
+			}
+
+			std::vector<T> source_row(max_column >= min_column ? max_column - min_column + 1 : 0);
+			for (uint32_t row = 0; row < height; row++) {
+				auto py = p.getY(y + row);
+				T *out = &buffer[(size_t) row * width];
+				if (py < 0 || py >= source->height || source_row.empty()) {
+					memset(out, 0, width * sizeof(T));
+					continue;
+				}
+				source->read(min_column, py, source_row.size(), 1, source_row.data(), source_row.size());
+				for (uint32_t col = 0; col < width; col++) {
+					auto px = columns[col];
+					out[col] = (px >= min_column && px <= max_column) ? source_row[px - min_column] : 0;
+				}
+			}
+		}, tile_size);
+}
+
+template<typename T>
+std::unique_ptr<GenericRaster> TiledRaster2D<T>::materialize(bool release_tiles) {
+	auto raster_guard = GenericRaster::create(dd, stref, width, height, 0, GenericRaster::Representation::CPU);
+	raster_guard->global_attributes = global_attributes;
+	T *data = (T *) raster_guard->getDataForWriting();
+
+	ThreadPool::getDefault().parallelFor((size_t) tiles_x * tiles_y, [&](size_t i) {
+		uint32_t tx = i % tiles_x, ty = i / tiles_x;
+		read(tx * tile_size, ty * tile_size, getTileWidth(tx), getTileHeight(ty),
+			&data[(size_t) ty * tile_size * width + tx * tile_size], width);
+		if (release_tiles)
+			releaseTile(tx, ty);
+	});
+
+	return raster_guard;
+}
+template<typename T>
+void TiledRaster2D<T>::toGeoTIFF(std::ostream &output) {
+	writeGeoTIFFHeader(output, *this, dd);
+
+	std::vector<T> rows((size_t) width * tile_size);
+	for (uint32_t ty = 0; ty < tiles_y; ty++) {
+		ThreadPool::getDefault().parallelFor(tiles_x, [&](size_t tx) {
+			getTile(tx, ty);
+		});
+		read(0, ty * tile_size, width, getTileHeight(ty), rows.data(), width);
+		for (uint32_t tx = 0; tx < tiles_x; tx++)
+			releaseTile(tx, ty);
+
+		output.write((const char *) rows.data(), (size_t) width * getTileHeight(ty) * sizeof(T));
+		output.flush();
+	}
+}
+
+
+template class TiledRaster2D<uint8_t>;
+template class TiledRaster2D<uint16_t>;
+template class TiledRaster2D<int16_t>;
+template class TiledRaster2D<uint32_t>;
+template class TiledRaster2D<int32_t>;
+template class TiledRaster2D<float>;
+template class TiledRaster2D<double>;
@@ -0,0 +1,112 @@
+#ifndef RASTER_TILED_RASTER_H
+#define RASTER_TILED_RASTER_H 1
+
+#include "datatypes/raster/raster_priv.h"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * A 2D raster stored as square tiles that are produced lazily, when they are first accessed.
+ *
+ * Producers may be expensive (e.g. an operator computing its result) or cheap (a window into
+ * another raster), so cut() and fitToQueryRectangle() return views that do not copy any pixels
+ * until their tiles are requested. Tiles can be released after use, which bounds the memory
+ * needed to process large rasters block by block.
+ *
+ * Tiles may be requested concurrently, every tile is produced at most once until released.
+ */
+template<typename T>
+class TiledRaster2D : public GridSpatioTemporalResult, public std::enable_shared_from_this<TiledRaster2D<T>> {
+	public:
+		static const uint32_t DEFAULT_TILE_SIZE = 256;
+
+		/**
+		 * Fills a tile. The buffer holds width*height pixels in row-major order,
+		 * (x, y) is the position of the tile's top left pixel in the raster.
+		 */
+		typedef std::function<void(uint32_t x, uint32_t y, uint32_t width, uint32_t height, T *buffer)> TileProducer;
+
+		TiledRaster2D(const DataDescription &dd, const SpatioTemporalReference &stref, uint32_t width, uint32_t height,
+				const TileProducer &producer, uint32_t tile_size = DEFAULT_TILE_SIZE);
+		virtual ~TiledRaster2D();
+
+		TiledRaster2D(const TiledRaster2D &) = delete;
+		TiledRaster2D &operator=(const TiledRaster2D &) = delete;
+
+		/**
+		 * Wraps a contiguous raster. Tiles are copied from it on demand.
+		 */
+		static std::shared_ptr<TiledRaster2D<T>> fromRaster(std::unique_ptr<GenericRaster> raster, uint32_t tile_size = DEFAULT_TILE_SIZE);
+
+		uint32_t getTileSize() const { return tile_size; }
+		uint32_t getTilesX() const { return tiles_x; }
+		uint32_t getTilesY() const { return tiles_y; }
+		uint32_t getTileWidth(uint32_t tx) const { return std::min(tile_size, width - tx * tile_size); }
+		uint32_t getTileHeight(uint32_t ty) const { return std::min(tile_size, height - ty * tile_size); }
+
+		/**
+		 * Returns the pixels of the given tile, producing them if necessary.
+		 * The pointer stays valid until the tile is released.
+		 */
+		const T *getTile(uint32_t tx, uint32_t ty);
+
+		/**
+		 * Frees the pixels of the given tile. They will be produced again on the next access.
+		 */
+		void releaseTile(uint32_t tx, uint32_t ty);
+
+		/**
+		 * Copies a rectangular region into the given buffer
+		 * @param stride the number of pixels between the starts of two rows of dest
+		 */
+		void read(uint32_t x, uint32_t y, uint32_t width, uint32_t height, T *dest, size_t stride);
+
+		/**
+		 * Retrieves a pixel value, returning def if the position is out of bounds
+		 */
+		T getSafe(int64_t x, int64_t y, T def = 0);
+
+		/**
+		 * Returns a view of the given region. No pixels are copied until its tiles are accessed.
+		 */
+		std::shared_ptr<TiledRaster2D<T>> cut(uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+		/**
+		 * Returns a view with the spatial extent and resolution of the query rectangle,
+		 * with the same semantics as Raster2D::fitToQueryRectangle().
+		 */
+		std::shared_ptr<TiledRaster2D<T>> fitToQueryRectangle(const QueryRectangle &qrect);
+
+		/**
+		 * Produces all tiles, in parallel, and copies them into a contiguous raster
+		 * @param release_tiles whether to release every tile once it has been copied
+		 */
+		std::unique_ptr<GenericRaster> materialize(bool release_tiles = true);
+
+		/**
+		 * Writes an uncompressed GeoTIFF to a stream, one row of tiles at a time. The tiles of a row
+		 * are produced in parallel and released once written, so only one row of tiles is kept in memory.
+		 */
+		void toGeoTIFF(std::ostream &output);
+
+		const DataDescription dd;
+
+	private:
+		struct Tile {
+			std::mutex mutex;
+			T *data = nullptr;
+		};
+
+		Tile &tile(uint32_t tx, uint32_t ty) { return tiles[(size_t) ty * tiles_x + tx]; }
+		size_t tileBytes() const { return (size_t) tile_size * tile_size * sizeof(T); }
+
+		const uint32_t tile_size;
+		const uint32_t tiles_x, tiles_y;
+		const TileProducer producer;
+		std::vector<Tile> tiles;
+};
+
+#endif
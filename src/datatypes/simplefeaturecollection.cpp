@@ -67,7 +67,21 @@ void SimpleFeatureCollection::validate() const {
 /*
  * Export
  */
+void SimpleFeatureCollection::flushToStream(std::ostringstream &buffer, std::ostream &output, bool force) {
+	if (!force && (size_t) buffer.tellp() < STREAM_CHUNK_SIZE)
+		return;
+	output << buffer.str();
+	buffer.str("");
+	output.flush();
+}
+
 std::string SimpleFeatureCollection::toGeoJSON(bool displayMetadata) const {
+	std::ostringstream json;
+	toGeoJSON(json, displayMetadata);
+	return json.str();
+}
+
+void SimpleFeatureCollection::toGeoJSON(std::ostream &output, bool displayMetadata) const {
 	std::ostringstream json;
 	json << std::fixed; // std::setprecision(4);
 
@@ -75,8 +89,9 @@ std::string SimpleFeatureCollection::toGeoJSON(bool displayMetadata) const {
 
 	auto value_keys = feature_attributes.getNumericKeys();
 	auto string_keys = feature_attributes.getTextualKeys();
-	bool isSimpleCollection = isSimple();
 	for (size_t feature = 0; feature < getFeatureCount(); ++feature) {
+		if (feature > 0)
+			json << ",";
 		json << "{\"type\":\"Feature\",\"geometry\":";
 		featureToGeoJSONGeometry(feature, json);
 
@@ -108,15 +123,13 @@ std::string SimpleFeatureCollection::toGeoJSON(bool displayMetadata) const {
 			json.seekp(((long) json.tellp()) - 1); // delete last ,
 			json << "}";
 		}
-		json << "},";
+		json << "}";
 
+		flushToStream(json, output);
 	}
 
-	if(getFeatureCount() > 0)
-		json.seekp(((long) json.tellp()) - 1); // delete last ,
 	json << "]}";
-
-	return json.str();
+	flushToStream(json, output, true);
 }
 
 
@@ -138,6 +151,12 @@ std::string SimpleFeatureCollection::toWKT() const {
 }
 
 std::string SimpleFeatureCollection::toCSV() const {
+	std::ostringstream csv;
+	toCSV(csv);
+	return csv.str();
+}
+
+void SimpleFeatureCollection::toCSV(std::ostream &output) const {
 	//TODO: include global metadata
 	std::ostringstream csv;
 	csv << std::fixed; // std::setprecision(4);
@@ -145,8 +164,6 @@ std::string SimpleFeatureCollection::toCSV() const {
 	auto string_keys = feature_attributes.getTextualKeys();
 	auto value_keys = feature_attributes.getNumericKeys();
 
-	bool isSimpleCollection = isSimple();
-
 	//header
 	csv << "wkt";
 	if (hasTime())
@@ -157,7 +174,7 @@ std::string SimpleFeatureCollection::toCSV() const {
 	for(auto &key : value_keys) {
 		csv << ",\"" << key << "\"";
 	}
-	csv << std::endl;
+	csv << "\n";
 
 	for (size_t featureIndex = 0; featureIndex < getFeatureCount(); ++featureIndex) {
 		csv << "\"";
@@ -175,10 +192,12 @@ std::string SimpleFeatureCollection::toCSV() const {
 		for(auto &key : value_keys) {
 			csv << "," << feature_attributes.numeric(key).get(featureIndex);
 		}
-		csv << std::endl;
+		csv << "\n";
+
+		flushToStream(csv, output);
 	}
 
-	return csv.str();
+	flushToStream(csv, output, true);
 }
 
 std::string SimpleFeatureCollection::featureToWKT(size_t featureIndex) const{
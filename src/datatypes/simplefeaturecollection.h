@@ -99,11 +99,24 @@ public:
 	 */
 	std::string toGeoJSON(bool displayMetadata = false) const;
 
+	/**
+	 * Write the GeoJSON representation of the collection to a stream, in chunks, while it is serialized
+	 * @param output the stream to write to
+	 * @param displayMetadata if true, include attributes
+	 */
+	void toGeoJSON(std::ostream &output, bool displayMetadata = false) const;
+
 	/**
 	 * Get a CSV representation of this collection
 	 * @return a CSV representation of this collection
 	 */
-	virtual std::string toCSV() const;
+	std::string toCSV() const;
+
+	/**
+	 * Write the CSV representation of the collection to a stream, in chunks, while it is serialized
+	 * @param output the stream to write to
+	 */
+	virtual void toCSV(std::ostream &output) const;
 
 	/**
 	 * Get a WKT representation of this collection
@@ -165,6 +178,13 @@ protected:
 	//calculate the MBR of the coordinates in range from start to stop (exclusive)
 	SpatialReference calculateMBR(size_t coordinateIndexStart, size_t coordinateIndexStop) const;
 
+	/**
+	 * Moves the serialized content of buffer to output once it exceeds STREAM_CHUNK_SIZE bytes, or always if force is set.
+	 * Serializers write to a buffer because featureToWKT() and featureToGeoJSONGeometry() need a seekable stream.
+	 */
+	static void flushToStream(std::ostringstream &buffer, std::ostream &output, bool force = false);
+	static const size_t STREAM_CHUNK_SIZE = 1 << 16;
+
 	size_t calculate_kept_count(const std::vector<bool> &keep) const;
 	size_t calculate_kept_count(const std::vector<char> &keep) const;
 
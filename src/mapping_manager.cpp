@@ -70,6 +70,7 @@ static void usage() {
 		printf("%s enumeratesources [verbose]\n", program_name);
 		printf("%s userdb ...\n", program_name);
 		printf("%s importgdaldataset <dataset_name> <dataset_filename_with_placeholder> <dataset_file_path> <time_format> <time_start> <time_unit> <interval_value> [--unit <measurement> <unit> <interpolation>] [--citation|--c <provenance_citation>] [--license|--l <provenance_license>] [--uri|--u <provenence_uri>]\n", program_name);
+		printf("%s buildgdaloverviews <dataset_name> [<resampling>]\n", program_name);
 		exit(5);
 }
 
@@ -777,6 +778,24 @@ static int import_gdal_dataset(int argc, char *argv[]){
 	return 1;
 }
 
+// Builds overviews for the files of a gdal dataset, which the GDALSource reads queries with low resolutions from
+static int build_gdal_overviews(int argc, char *argv[]) {
+	if (argc < 3 || argc > 4) {
+		usage();
+	}
+	std::string resampling = argc == 4 ? argv[3] : "NEAREST";
+
+	try {
+		size_t built = GDALDatasetImporter::buildOverviews(argv[2], resampling);
+		printf("built overviews for %lu files\n", built);
+		return 0;
+	}
+	catch (const std::exception &e) {
+		printf("ERROR: %s\n", e.what());
+		return 5;
+	}
+}
+
 int main(int argc, char *argv[]) {
 
 	program_name = argv[0];
@@ -861,6 +880,9 @@ int main(int argc, char *argv[]) {
 	else if(strcmp(command, "importgdaldataset") == 0){
 		import_gdal_dataset(argc, argv);
 	}
+	else if(strcmp(command, "buildgdaloverviews") == 0){
+		returncode = build_gdal_overviews(argc, argv);
+	}
 	else {
 		usage();
 	}
@@ -4,6 +4,8 @@
 #include "util/binarystream.h"
 #include "util/sizeutil.h"
 #include "util/log.h"
+#include "util/threadpool.h"
+#include "util/configuration.h"
 
 #include "operators/operator.h"
 #include "cache/manager.h"
@@ -90,7 +92,7 @@ void GenericOperator::validateQRect(const QueryRectangle &rect, GenericOperator:
 		throw OperatorException("Cannot query with TIMETYPE_UNREFERENCED");
 }
 
-void GenericOperator::validateResult(const QueryRectangle &rect, SpatioTemporalResult *result) {
+void GenericOperator::validateResult(const QueryRectangle &rect, const SpatioTemporalResult *result) {
 	if (result->stref.crsId == CrsId::unreferenced())
 		throw OperatorException(concat("Operator ", type, " returned result with EPSG_UNREFERENCED"));
 	if (result->stref.timetype == TIMETYPE_UNREFERENCED)
@@ -143,26 +145,93 @@ static void d_profile(int depth, const std::string &type, const char *result, Qu
 	Log::info(msg.str());
 }
 
+/*
+ * Queries the cache. After a miss, waits for a concurrent computation of the same or a covering query
+ * if the cache coordinates them, until the caller's query is cancelled. Throws a NoSuchElementException
+ * if the caller has to compute the result, which it completes the ticket with after putting it into the cache.
+ */
+template<typename T>
+static std::unique_ptr<T> queryCache(CacheWrapper<T> &cache, GenericOperator &op, const QueryRectangle &rect, const QueryTools &tools, typename SingleFlight<T>::Ticket &ticket) {
+	try {
+		return cache.query( op, rect, tools.profiler );
+	} catch ( NoSuchElementException &nse ) {
+		auto single_flight = cache.get_single_flight();
+		if ( single_flight == nullptr )
+			throw;
+		auto result = single_flight->join( op.getSemanticId(), rect, [&]() { return cache.query( op, rect, tools.profiler ); }, ticket,
+				[&tools]() { tools.checkCancelled(); } );
+		if ( result == nullptr )
+			throw;
+		return result;
+	}
+}
+
+template<typename T>
+static std::shared_ptr<const T> queryCacheShared(CacheWrapper<T> &cache, GenericOperator &op, const QueryRectangle &rect, const QueryTools &tools, typename SingleFlight<T>::Ticket &ticket) {
+	try {
+		return cache.query_shared( op, rect, tools.profiler );
+	} catch ( NoSuchElementException &nse ) {
+		auto single_flight = cache.get_single_flight();
+		if ( single_flight == nullptr )
+			throw;
+		std::shared_ptr<const T> result = single_flight->join( op.getSemanticId(), rect, [&]() { return cache.query( op, rect, tools.profiler ); }, ticket,
+				[&tools]() { tools.checkCancelled(); } );
+		if ( result == nullptr )
+			throw;
+		return result;
+	}
+}
+
+/*
+ * Puts a computed result into the cache and completes the ticket with it. The result is shared
+ * with the cache and only copied if the cache keeps it, because the caller may modify it.
+ */
+template<typename T>
+static bool putCache(CacheWrapper<T> &cache, const std::string &semantic_id, std::unique_ptr<T> &result, const QueryRectangle &rect, const QueryProfiler &profiler, typename SingleFlight<T>::Ticket &ticket) {
+	auto shared = share_result(std::move(result));
+	bool cached = cache.put_shared( semantic_id, shared, rect, profiler );
+	ticket.complete(*shared);
+	result = take_result(std::move(shared));
+	return cached;
+}
+
+/*
+ * Cuts a shared feature collection to the query rectangle, copying it only if some features have to be removed
+ */
+template<typename T>
+static std::shared_ptr<const T> filterShared(std::shared_ptr<const T> result, const QueryRectangle &rect) {
+	if (rect.t1 > result->stref.t1 || rect.t2 < result->stref.t2
+			|| rect.x1 > result->stref.x1 || rect.x2 < result->stref.x2
+			|| rect.y1 > result->stref.y1 || rect.y2 < result->stref.y2) {
+		return result->filterBySpatioTemporalReferenceIntersection(rect);
+	}
+	return result;
+}
+
 std::unique_ptr<GenericRaster> GenericOperator::getCachedRaster(const QueryRectangle &rect, const QueryTools &tools, RasterQM query_mode) {
 	QueryProfiler &parent_profiler = tools.profiler;
 	QueryProfilerSimpleGuard parent_guard(parent_profiler);
+	tools.checkCancelled();
 
 	validateQRect(rect, ResolutionRequirement::REQUIRED);
 	auto &cache = CacheManager::get_instance().get_raster_cache();
 	std::unique_ptr<GenericRaster> result;
+	SingleFlight<GenericRaster>::Ticket ticket;
 
 	try {
-		result = cache.query( *this, rect, parent_profiler );
+		result = queryCache( cache, *this, rect, tools, ticket );
 	} catch ( NoSuchElementException &nse ) {
 		QueryProfilerStoppingGuard stop_guard(parent_profiler);
 		QueryProfiler exec_profiler;
 		{
 			QueryProfilerRunningGuard guard(parent_profiler, exec_profiler);
 			TIME_EXEC("Operator.getRaster");
-			result = getRaster(rect,QueryTools(exec_profiler, tools.session));
+			result = getRaster(rect,QueryTools(exec_profiler, tools));
+			// shared rasters must not change their representation anymore, see copy_result()
+			result->setRepresentation(GenericRaster::Representation::CPU);
 		}
 		d_profile(depth, type, "raster", exec_profiler);
-		if ( cache.put(semantic_id,result,rect,exec_profiler) ) {
+		if ( putCache( cache, semantic_id, result, rect, exec_profiler, ticket ) ) {
 			parent_profiler.cached(exec_profiler);
 		}
 	}
@@ -176,12 +245,14 @@ std::unique_ptr<GenericRaster> GenericOperator::getCachedRaster(const QueryRecta
 std::unique_ptr<PointCollection> GenericOperator::getCachedPointCollection(const QueryRectangle &rect, const QueryTools &tools, FeatureCollectionQM query_mode) {
 	QueryProfiler &parent_profiler = tools.profiler;
 	QueryProfilerSimpleGuard parent_guard(parent_profiler);
+	tools.checkCancelled();
 
 	validateQRect(rect, ResolutionRequirement::FORBIDDEN);
 	auto &cache = CacheManager::get_instance().get_point_cache();
 	std::unique_ptr<PointCollection> result;
+	SingleFlight<PointCollection>::Ticket ticket;
 	try {
-		result = cache.query( *this, rect, parent_profiler );
+		result = queryCache( cache, *this, rect, tools, ticket );
 		if (rect.t1 > result->stref.t1 || rect.t2 < result->stref.t2
 				|| rect.x1 > result->stref.x1 || rect.x2 < result->stref.x2
 				|| rect.y1 > result->stref.y1 || rect.y2 < result->stref.y2) {
@@ -193,10 +264,10 @@ std::unique_ptr<PointCollection> GenericOperator::getCachedPointCollection(const
 		{
 			QueryProfilerRunningGuard guard(parent_profiler, exec_profiler);
 			TIME_EXEC("Operator.getPointCollection");
-			result = getPointCollection(rect,QueryTools(exec_profiler, tools.session));
+			result = getPointCollection(rect,QueryTools(exec_profiler, tools));
 		}
 		d_profile(depth, type, "points", exec_profiler);
-		if ( cache.put(semantic_id,result,rect,exec_profiler) )
+		if ( putCache( cache, semantic_id, result, rect, exec_profiler, ticket ) )
 			parent_profiler.cached(exec_profiler);
 	}
 	// validate the SimpleFeature data structure
@@ -211,12 +282,14 @@ std::unique_ptr<PointCollection> GenericOperator::getCachedPointCollection(const
 std::unique_ptr<LineCollection> GenericOperator::getCachedLineCollection(const QueryRectangle &rect, const QueryTools &tools, FeatureCollectionQM query_mode) {
 	QueryProfiler &parent_profiler = tools.profiler;
 	QueryProfilerSimpleGuard parent_guard(parent_profiler);
+	tools.checkCancelled();
 
 	validateQRect(rect, ResolutionRequirement::FORBIDDEN);
 	auto &cache = CacheManager::get_instance().get_line_cache();
 	std::unique_ptr<LineCollection> result;
+	SingleFlight<LineCollection>::Ticket ticket;
 	try {
-		result = cache.query( *this, rect, parent_profiler );
+		result = queryCache( cache, *this, rect, tools, ticket );
 		if (rect.t1 > result->stref.t1 || rect.t2 < result->stref.t2
 				|| rect.x1 > result->stref.x1 || rect.x2 < result->stref.x2
 				|| rect.y1 > result->stref.y1 || rect.y2 < result->stref.y2) {
@@ -228,11 +301,11 @@ std::unique_ptr<LineCollection> GenericOperator::getCachedLineCollection(const Q
 		{
 			QueryProfilerRunningGuard guard(parent_profiler, exec_profiler);
 			TIME_EXEC("Operator.getLineCollection");
-			result = getLineCollection(rect,QueryTools(exec_profiler, tools.session));
+			result = getLineCollection(rect,QueryTools(exec_profiler, tools));
 		}
 		d_profile(depth, type, "lines", exec_profiler);
-		if ( cache.put(semantic_id,result,rect,exec_profiler) )
-				parent_profiler.cached(exec_profiler);
+		if ( putCache( cache, semantic_id, result, rect, exec_profiler, ticket ) )
+			parent_profiler.cached(exec_profiler);
 	}
 	// validate the SimpleFeature data structure
 	result->validate();
@@ -246,12 +319,14 @@ std::unique_ptr<LineCollection> GenericOperator::getCachedLineCollection(const Q
 std::unique_ptr<PolygonCollection> GenericOperator::getCachedPolygonCollection(const QueryRectangle &rect, const QueryTools &tools, FeatureCollectionQM query_mode) {
 	QueryProfiler &parent_profiler = tools.profiler;
 	QueryProfilerSimpleGuard parent_guard(parent_profiler);
+	tools.checkCancelled();
 
 	validateQRect(rect, ResolutionRequirement::FORBIDDEN);
 	auto &cache = CacheManager::get_instance().get_polygon_cache();
 	std::unique_ptr<PolygonCollection> result;
+	SingleFlight<PolygonCollection>::Ticket ticket;
 	try {
-		result = cache.query( *this, rect, parent_profiler );
+		result = queryCache( cache, *this, rect, tools, ticket );
 		if (rect.t1 > result->stref.t1 || rect.t2 < result->stref.t2
 				|| rect.x1 > result->stref.x1 || rect.x2 < result->stref.x2
 				|| rect.y1 > result->stref.y1 || rect.y2 < result->stref.y2) {
@@ -263,10 +338,10 @@ std::unique_ptr<PolygonCollection> GenericOperator::getCachedPolygonCollection(c
 		{
 			QueryProfilerRunningGuard guard(parent_profiler, exec_profiler);
 			TIME_EXEC("Operator.getPolygonCollection");
-			result = getPolygonCollection(rect,QueryTools(exec_profiler, tools.session));
+			result = getPolygonCollection(rect,QueryTools(exec_profiler, tools));
 		}
 		d_profile(depth, type, "polygon", exec_profiler);
-		if ( cache.put(semantic_id,result,rect,exec_profiler) )
+		if ( putCache( cache, semantic_id, result, rect, exec_profiler, ticket ) )
 			parent_profiler.cached(exec_profiler);
 	}
 	// validate the SimpleFeature data structure
@@ -281,25 +356,165 @@ std::unique_ptr<PolygonCollection> GenericOperator::getCachedPolygonCollection(c
 std::unique_ptr<GenericPlot> GenericOperator::getCachedPlot(const QueryRectangle &rect, const QueryTools &tools) {
 	QueryProfiler &parent_profiler = tools.profiler;
 	QueryProfilerSimpleGuard parent_guard(parent_profiler);
+	tools.checkCancelled();
 
 	//	TODO: do we want plots to allow resolutions?
 	validateQRect(rect, ResolutionRequirement::OPTIONAL);
 	auto &cache = CacheManager::get_instance().get_plot_cache();
 	std::unique_ptr<GenericPlot> result;
+	SingleFlight<GenericPlot>::Ticket ticket;
 	try {
-		result = cache.query( *this, rect, parent_profiler );
+		result = queryCache( cache, *this, rect, tools, ticket );
 	} catch ( NoSuchElementException &nse ) {
 		QueryProfilerStoppingGuard stop_guard(parent_profiler);
 		QueryProfiler exec_profiler;
 		{
 			QueryProfilerRunningGuard guard(parent_profiler, exec_profiler);
 			TIME_EXEC("Operator.getPlot");
-			result = getPlot(rect,QueryTools(exec_profiler, tools.session));
+			result = getPlot(rect,QueryTools(exec_profiler, tools));
 		}
 		d_profile(depth, type, "plot", exec_profiler);
-		if ( cache.put(semantic_id,result,rect,exec_profiler) )
+		if ( putCache( cache, semantic_id, result, rect, exec_profiler, ticket ) )
+			parent_profiler.cached(exec_profiler);
+	}
+	return result;
+}
+
+std::shared_ptr<const GenericRaster> GenericOperator::getCachedRasterShared(const QueryRectangle &rect, const QueryTools &tools, RasterQM query_mode) {
+	QueryProfiler &parent_profiler = tools.profiler;
+	QueryProfilerSimpleGuard parent_guard(parent_profiler);
+	tools.checkCancelled();
+
+	validateQRect(rect, ResolutionRequirement::REQUIRED);
+	auto &cache = CacheManager::get_instance().get_raster_cache();
+	std::shared_ptr<const GenericRaster> result;
+	SingleFlight<GenericRaster>::Ticket ticket;
+
+	try {
+		result = queryCacheShared( cache, *this, rect, tools, ticket );
+	} catch ( NoSuchElementException &nse ) {
+		QueryProfilerStoppingGuard stop_guard(parent_profiler);
+		QueryProfiler exec_profiler;
+		std::unique_ptr<GenericRaster> computed;
+		{
+			QueryProfilerRunningGuard guard(parent_profiler, exec_profiler);
+			TIME_EXEC("Operator.getRaster");
+			computed = getRaster(rect,QueryTools(exec_profiler, tools));
+			// shared rasters must not change their representation anymore, see copy_result()
+			computed->setRepresentation(GenericRaster::Representation::CPU);
+		}
+		d_profile(depth, type, "raster", exec_profiler);
+		result = std::move(computed);
+		if ( cache.put_shared(semantic_id,result,rect,exec_profiler) ) {
+			parent_profiler.cached(exec_profiler);
+		}
+		ticket.complete(*result);
+	}
+	validateResult(rect, result.get());
+
+	// the raster is in the CPU representation, so this only reads it
+	if (query_mode == RasterQM::EXACT)
+		result = const_cast<GenericRaster&>(*result).fitToQueryRectangle(rect);
+	return result;
+}
+
+std::shared_ptr<const PointCollection> GenericOperator::getCachedPointCollectionShared(const QueryRectangle &rect, const QueryTools &tools, FeatureCollectionQM query_mode) {
+	QueryProfiler &parent_profiler = tools.profiler;
+	QueryProfilerSimpleGuard parent_guard(parent_profiler);
+	tools.checkCancelled();
+
+	validateQRect(rect, ResolutionRequirement::FORBIDDEN);
+	auto &cache = CacheManager::get_instance().get_point_cache();
+	std::shared_ptr<const PointCollection> result;
+	SingleFlight<PointCollection>::Ticket ticket;
+	try {
+		result = filterShared( queryCacheShared( cache, *this, rect, tools, ticket ), rect );
+	} catch ( NoSuchElementException &nse ) {
+		QueryProfilerStoppingGuard stop_guard(parent_profiler);
+		QueryProfiler exec_profiler;
+		{
+			QueryProfilerRunningGuard guard(parent_profiler, exec_profiler);
+			TIME_EXEC("Operator.getPointCollection");
+			result = getPointCollection(rect,QueryTools(exec_profiler, tools));
+		}
+		d_profile(depth, type, "points", exec_profiler);
+		if ( cache.put_shared(semantic_id,result,rect,exec_profiler) )
+			parent_profiler.cached(exec_profiler);
+		ticket.complete(*result);
+	}
+	// validate the SimpleFeature data structure
+	result->validate();
+	// validate the invariants of the operator graph
+	validateResult(rect, result.get());
+
+	if (query_mode == FeatureCollectionQM::SINGLE_ELEMENT_FEATURES && !result->isSimple())
+		throw OperatorException("Operator did not return Features consisting only of single points");
+	return result;
+}
+std::shared_ptr<const LineCollection> GenericOperator::getCachedLineCollectionShared(const QueryRectangle &rect, const QueryTools &tools, FeatureCollectionQM query_mode) {
+	QueryProfiler &parent_profiler = tools.profiler;
+	QueryProfilerSimpleGuard parent_guard(parent_profiler);
+	tools.checkCancelled();
+
+	validateQRect(rect, ResolutionRequirement::FORBIDDEN);
+	auto &cache = CacheManager::get_instance().get_line_cache();
+	std::shared_ptr<const LineCollection> result;
+	SingleFlight<LineCollection>::Ticket ticket;
+	try {
+		result = filterShared( queryCacheShared( cache, *this, rect, tools, ticket ), rect );
+	} catch ( NoSuchElementException &nse ) {
+		QueryProfilerStoppingGuard stop_guard(parent_profiler);
+		QueryProfiler exec_profiler;
+		{
+			QueryProfilerRunningGuard guard(parent_profiler, exec_profiler);
+			TIME_EXEC("Operator.getLineCollection");
+			result = getLineCollection(rect,QueryTools(exec_profiler, tools));
+		}
+		d_profile(depth, type, "lines", exec_profiler);
+		if ( cache.put_shared(semantic_id,result,rect,exec_profiler) )
+			parent_profiler.cached(exec_profiler);
+		ticket.complete(*result);
+	}
+	// validate the SimpleFeature data structure
+	result->validate();
+	// validate the invariants of the operator graph
+	validateResult(rect, result.get());
+
+	if (query_mode == FeatureCollectionQM::SINGLE_ELEMENT_FEATURES && !result->isSimple())
+		throw OperatorException("Operator did not return Features consisting only of single lines");
+	return result;
+}
+std::shared_ptr<const PolygonCollection> GenericOperator::getCachedPolygonCollectionShared(const QueryRectangle &rect, const QueryTools &tools, FeatureCollectionQM query_mode) {
+	QueryProfiler &parent_profiler = tools.profiler;
+	QueryProfilerSimpleGuard parent_guard(parent_profiler);
+	tools.checkCancelled();
+
+	validateQRect(rect, ResolutionRequirement::FORBIDDEN);
+	auto &cache = CacheManager::get_instance().get_polygon_cache();
+	std::shared_ptr<const PolygonCollection> result;
+	SingleFlight<PolygonCollection>::Ticket ticket;
+	try {
+		result = filterShared( queryCacheShared( cache, *this, rect, tools, ticket ), rect );
+	} catch ( NoSuchElementException &nse ) {
+		QueryProfilerStoppingGuard stop_guard(parent_profiler);
+		QueryProfiler exec_profiler;
+		{
+			QueryProfilerRunningGuard guard(parent_profiler, exec_profiler);
+			TIME_EXEC("Operator.getPolygonCollection");
+			result = getPolygonCollection(rect,QueryTools(exec_profiler, tools));
+		}
+		d_profile(depth, type, "polygon", exec_profiler);
+		if ( cache.put_shared(semantic_id,result,rect,exec_profiler) )
 			parent_profiler.cached(exec_profiler);
+		ticket.complete(*result);
 	}
+	// validate the SimpleFeature data structure
+	result->validate();
+	// validate the invariants of the operator graph
+	validateResult(rect, result.get());
+
+	if (query_mode == FeatureCollectionQM::SINGLE_ELEMENT_FEATURES && !result->isSimple())
+		throw OperatorException("Operator did not return Features consisting only of single polygons");
 	return result;
 }
 
@@ -320,14 +535,16 @@ std::unique_ptr<ProvenanceCollection> GenericOperator::getFullProvenance() {
 std::unique_ptr<ProvenanceCollection> GenericOperator::getCachedFullProvenance(const QueryRectangle &rect, const QueryTools &tools) {
 	QueryProfiler &parent_profiler = tools.profiler;
 	QueryProfilerSimpleGuard parent_guard(parent_profiler);
+	tools.checkCancelled();
 
 	// TODO: think about the semantics of provenance!
 	QueryRectangle fullRect(SpatialReference::extent(rect.crsId), TemporalReference(rect.timetype), QueryResolution::none());
 
 	auto &cache = CacheManager::get_instance().get_provenance_cache();
 	std::unique_ptr<ProvenanceCollection> result;
+	SingleFlight<ProvenanceCollection>::Ticket ticket;
 	try {
-		result = cache.query( *this, fullRect, parent_profiler );
+		result = queryCache( cache, *this, fullRect, tools, ticket );
 	} catch ( NoSuchElementException &nse ) {
 		QueryProfilerStoppingGuard stop_guard(parent_profiler);
 		QueryProfiler exec_profiler;
@@ -337,7 +554,7 @@ std::unique_ptr<ProvenanceCollection> GenericOperator::getCachedFullProvenance(c
 			result = getFullProvenance();
 		}
 		d_profile(depth, type, "provenance", exec_profiler);
-		if ( cache.put(semantic_id,result, fullRect, exec_profiler) )
+		if ( putCache( cache, semantic_id, result, fullRect, exec_profiler, ticket ) )
 			parent_profiler.cached(exec_profiler);
 	}
 	return result;
@@ -477,3 +694,24 @@ std::unique_ptr<GenericOperator> GenericOperator::fromJSON(const std::string &js
 
 	return GenericOperator::fromJSON(root, depth);
 }
+
+void GenericOperator::getFromSourcesConcurrently(const QueryTools &tools, const std::vector<SourceRequest> &requests) {
+	static const bool parallel = Configuration::get<bool>("operators.parallelsources", true);
+	if (!parallel || requests.size() < 2) {
+		for (auto &request : requests)
+			request(tools);
+		return;
+	}
+
+	// CPU time is measured per thread, so every request gets a profiler running on its own thread
+	std::vector<QueryProfiler> profilers(requests.size());
+	{
+		QueryProfilerStoppingGuard guard(tools.profiler);
+		ThreadPool::getDefault().parallelFor(requests.size(), [&](size_t i) {
+			QueryProfilerSimpleGuard running(profilers[i]);
+			requests[i](QueryTools(profilers[i], tools));
+		});
+	}
+	for (auto &profiler : profilers)
+		tools.profiler.merge(profiler);
+}
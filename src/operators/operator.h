@@ -10,6 +10,8 @@
 #include <string>
 #include <sstream>
 #include <memory>
+#include <vector>
+#include <functional>
 
 namespace Json {
 	class Value;
@@ -73,6 +75,16 @@ class GenericOperator {
 		std::unique_ptr<PolygonCollection> getCachedPolygonCollection(const QueryRectangle &rect, const QueryTools &tools, FeatureCollectionQM query_mode = FeatureCollectionQM::ANY_FEATURE);
 		std::unique_ptr<GenericPlot> getCachedPlot(const QueryRectangle &rect, const QueryTools &tools);
 
+		/*
+		 * These return immutable results, which may be shared with the cache instead of being copied.
+		 * Callers that need to modify the result have to copy it with copy_result() first.
+		 * The node server and the puzzling of remainders only read their results.
+		 */
+		std::shared_ptr<const GenericRaster> getCachedRasterShared(const QueryRectangle &rect, const QueryTools &tools, RasterQM query_mode = RasterQM::LOOSE);
+		std::shared_ptr<const PointCollection> getCachedPointCollectionShared(const QueryRectangle &rect, const QueryTools &tools, FeatureCollectionQM query_mode = FeatureCollectionQM::ANY_FEATURE);
+		std::shared_ptr<const LineCollection> getCachedLineCollectionShared(const QueryRectangle &rect, const QueryTools &tools, FeatureCollectionQM query_mode = FeatureCollectionQM::ANY_FEATURE);
+		std::shared_ptr<const PolygonCollection> getCachedPolygonCollectionShared(const QueryRectangle &rect, const QueryTools &tools, FeatureCollectionQM query_mode = FeatureCollectionQM::ANY_FEATURE);
+
 		std::unique_ptr<ProvenanceCollection> getFullProvenance();
 		std::unique_ptr<ProvenanceCollection> getCachedFullProvenance(const QueryRectangle &rect, const QueryTools &tools);
 
@@ -102,6 +114,16 @@ class GenericOperator {
 		std::unique_ptr<PolygonCollection> getPolygonCollectionFromSource(int idx, const QueryRectangle &rect, const QueryTools &tools, FeatureCollectionQM query_mode = FeatureCollectionQM::ANY_FEATURE);
 		// there is no getPlotFromSource, because plots are by definition the final step of a chain
 
+		/**
+		 * Executes independent requests for source results concurrently on the shared thread pool.
+		 * Each request calls the get*FromSource() methods with the QueryTools it receives; these carry
+		 * a profiler of their own, which is merged into tools.profiler once all requests have finished.
+		 * The first exception thrown by a request is rethrown after all of them have finished.
+		 * If operators.parallelsources is disabled, the requests are executed sequentially.
+		 */
+		typedef std::function<void(const QueryTools &tools)> SourceRequest;
+		void getFromSourcesConcurrently(const QueryTools &tools, const std::vector<SourceRequest> &requests);
+
 	private:
 		enum class ResolutionRequirement {
 			REQUIRED,
@@ -109,7 +131,7 @@ class GenericOperator {
 			OPTIONAL
 		};
 		void validateQRect(const QueryRectangle &rect, ResolutionRequirement res = ResolutionRequirement::OPTIONAL);
-		void validateResult(const QueryRectangle &rect, SpatioTemporalResult *result);
+		void validateResult(const QueryRectangle &rect, const SpatioTemporalResult *result);
 		void getRecursiveProvenance(ProvenanceCollection &pc);
 
 		int sourcecounts[MAX_INPUT_TYPES];
@@ -208,8 +208,16 @@ RasterValueExtractionOperator::getPointCollection(const QueryRectangle &rect, co
         TemporalReference tref = TemporalReference::unreferenced();
         QueryRectangle rect2(rect, rect,
                              QueryResolution::pixels(x_resolution, y_resolution));
+        std::vector<std::unique_ptr<GenericRaster>> raster_results(rasters);
+        std::vector<SourceRequest> requests;
         for (int r = 0; r < rasters; r++) {
-            auto raster = getRasterFromSource(r, rect2, tools);
+            requests.push_back([&, r](const QueryTools &tools) {
+                raster_results[r] = getRasterFromSource(r, rect2, tools);
+            });
+        }
+        getFromSourcesConcurrently(tools, requests);
+        for (int r = 0; r < rasters; r++) {
+            auto raster = std::move(raster_results[r]);
             Profiler::Profiler p("RASTER_VALUE_TO_POINTS_OPERATOR");
             enhance(*points, *raster, names.at(r), tools.profiler);
             if (r == 0)
@@ -236,11 +244,21 @@ auto RasterValueExtractionOperator::getPolygonCollection(const QueryRectangle &r
             QueryResolution::pixels(this->x_resolution, this->y_resolution)
     };
 
+    // load all rasters concurrently
+    std::vector<std::unique_ptr<GenericRaster>> rasters(this->names.size());
+    std::vector<SourceRequest> requests;
+    for (int raster_source_id = 0; raster_source_id < this->names.size(); ++raster_source_id) {
+        requests.push_back([&, raster_source_id](const QueryTools &tools) {
+            rasters[raster_source_id] = getRasterFromSource(raster_source_id, raster_rect, tools, RasterQM::EXACT);
+        });
+    }
+    getFromSourcesConcurrently(tools, requests);
+
     // loop through rasters
     for (int raster_source_id = 0; raster_source_id < this->names.size(); ++raster_source_id) {
         const std::string &name_prefix = this->names[raster_source_id];
 
-        const auto &raster = getRasterFromSource(raster_source_id, raster_rect, tools, RasterQM::EXACT);
+        const auto &raster = rasters[raster_source_id];
 
         for (const std::string &suffix : {"mean", "stdev", "min", "max"}) {
             polygon_collection->feature_attributes.addNumericAttribute(
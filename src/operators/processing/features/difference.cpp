@@ -57,8 +57,11 @@ static double point_distance(const Coordinate &p1, const Coordinate &p2) {
 }
 //TODO: migrate to new multi semantics
 std::unique_ptr<PointCollection> DifferenceOperator::getPointCollection(const QueryRectangle &rect, const QueryTools &tools) {
-	auto pointsMinuend = getPointCollectionFromSource(0, rect, tools);
-	auto pointsSubtrahend = getPointCollectionFromSource(1, rect, tools);
+	std::unique_ptr<PointCollection> pointsMinuend, pointsSubtrahend;
+	getFromSourcesConcurrently(tools, {
+		[&](const QueryTools &tools) { pointsMinuend = getPointCollectionFromSource(0, rect, tools); },
+		[&](const QueryTools &tools) { pointsSubtrahend = getPointCollectionFromSource(1, rect, tools); }
+	});
 
 	//fprintf(stderr, "Minuend: %lu, Subtrahend: %lu\n", pointsMinuend->collection.size(), pointsSubtrahend->collection.size());
 
@@ -44,8 +44,12 @@ REGISTER_OPERATOR(PointInPolygonFilterOperator, "point_in_polygon_filter");
 #ifndef MAPPING_OPERATOR_STUBS
 
 std::unique_ptr<PointCollection> PointInPolygonFilterOperator::getPointCollection(const QueryRectangle &rect, const QueryTools &tools) {
-	auto points = getPointCollectionFromSource(0, rect, tools, FeatureCollectionQM::SINGLE_ELEMENT_FEATURES);
-	auto multiPolygons = getPolygonCollectionFromSource(0, rect, tools, FeatureCollectionQM::ANY_FEATURE);
+	std::unique_ptr<PointCollection> points;
+	std::unique_ptr<PolygonCollection> multiPolygons;
+	getFromSourcesConcurrently(tools, {
+		[&](const QueryTools &tools) { points = getPointCollectionFromSource(0, rect, tools, FeatureCollectionQM::SINGLE_ELEMENT_FEATURES); },
+		[&](const QueryTools &tools) { multiPolygons = getPolygonCollectionFromSource(0, rect, tools, FeatureCollectionQM::ANY_FEATURE); }
+	});
 
 	if(!points->hasTime() && !multiPolygons->hasTime()) {
 		//filter only based on geometry
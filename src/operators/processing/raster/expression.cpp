@@ -1,8 +1,10 @@
 #include "datatypes/raster.h"
 #include "datatypes/raster/typejuggling.h"
 #include "raster/opencl.h"
+#include "raster/expression.h"
 #include "operators/operator.h"
 #include "util/formula.h"
+#include "util/configuration.h"
 
 
 #include <limits>
@@ -75,26 +77,24 @@ void ExpressionOperator::writeSemanticParameters(std::ostringstream& stream) {
 
 #ifndef MAPPING_OPERATOR_STUBS
 
-#ifdef MAPPING_NO_OPENCL
-std::unique_ptr<GenericRaster> ExpressionOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
-	throw OperatorException("ExpressionOperator: cannot be executed without OpenCL support");
-}
-#else
 std::unique_ptr<GenericRaster> ExpressionOperator::getRaster(const QueryRectangle &rect, const QueryTools &tools) {
 	int rastercount = getRasterSourceCount();
 	if (rastercount < 1 || rastercount > 26)
 		throw OperatorException("ExpressionOperator: need between 1 and 26 input rasters");
 
-	RasterOpenCL::init();
+#ifndef MAPPING_NO_OPENCL
+	static const bool use_opencl = Configuration::get<std::string>("operators.expression.engine", "opencl") != "cpu";
+	if (use_opencl)
+		RasterOpenCL::init();
+#endif
 
 	std::vector<std::unique_ptr<GenericRaster> > in_rasters;
 	in_rasters.reserve(rastercount);
 
-	// Load all sources and migrate to opencl
+	// Load all sources
 	in_rasters.push_back(getRasterFromSource(0, rect, tools, RasterQM::LOOSE));
 	// The first raster determines the data type and sizes
 	GenericRaster *raster_in = in_rasters[0].get();
-	raster_in->setRepresentation(GenericRaster::OPENCL);
 
 	// figure out the largest time interval common to all input rasters
 	TemporalReference tref(raster_in->stref);
@@ -104,51 +104,24 @@ std::unique_ptr<GenericRaster> ExpressionOperator::getRaster(const QueryRectangl
 		(TemporalReference &) rect, // we need to calculate the temporal intersection on our own, so always query with the same interval.
 		QueryResolution::pixels(raster_in->width,raster_in->height)
 	);
+	// the other rasters only depend on the first one, so they are loaded concurrently
+	in_rasters.resize(rastercount);
+	std::vector<SourceRequest> requests;
 	for (int i=1;i<rastercount;i++) {
-		in_rasters.push_back(getRasterFromSource(i, exact_rect, tools, RasterQM::EXACT));
-		in_rasters[i]->setRepresentation(GenericRaster::OPENCL);
-		tref.intersect(in_rasters[i]->stref);
+		requests.push_back([&, i](const QueryTools &tools) {
+			in_rasters[i] = getRasterFromSource(i, exact_rect, tools, RasterQM::EXACT);
+		});
 	}
+	getFromSourcesConcurrently(tools, requests);
 
-	/*
-	 * See if the formula is valid and safe
-	 */
-
-	Formula f(expression);
-	f.addCLFunctions();
+	std::vector<GenericRaster *> rasters;
 	for (int i=0;i<rastercount;i++) {
-		char code = 'A' + (char) i;
-		f.addVariable(std::string(1, code));
+		if (in_rasters[i]->width != raster_in->width || in_rasters[i]->height != raster_in->height)
+			throw OperatorException("ExpressionOperator: not all input rasters have the same dimensions");
+		if (i > 0)
+			tref.intersect(in_rasters[i]->stref);
+		rasters.push_back(in_rasters[i].get());
 	}
-	auto safe_expression = f.parse();
-
-	/*
-	 * Let's assemble our code
-	 */
-	std::stringstream ss_sourcecode;
-	ss_sourcecode << "__kernel void expressionkernel(";
-	for (int i=0;i<rastercount;i++) {
-		ss_sourcecode << "__global const IN_TYPE" << i << " *in_data" << i << ", __global const RasterInfo *in_info" << i << ",";
-	}
-	ss_sourcecode << "__global OUT_TYPE0 *out_data, __global const RasterInfo *out_info) {"
-		"int gid = get_global_id(0) + get_global_id(1) * in_info0->size[0];"
-		"if (gid >= in_info0->size[0]*in_info0->size[1]*in_info0->size[2])"
-		"	return;";
-	for (int i=0;i<rastercount;i++) {
-		char code = 'A' + (char) i;
-		ss_sourcecode <<
-			"IN_TYPE"<<i<<" "<<code<<" = in_data"<<i<<"[gid];"
-			"if (ISNODATA"<<i<<"("<<code<<", in_info"<<i<<")) {"
-			"	out_data[gid] = out_info->no_data;"
-			"	return;"
-			"}";
-	}
-	ss_sourcecode <<
-		"OUT_TYPE0 result = " << safe_expression << ";"
-		"out_data[gid] = result;"
-		"}";
-
-	std::string sourcecode(ss_sourcecode.str());
 
 	/*
 	 * Figure out data type, min and max, and create our output raster
@@ -162,25 +135,16 @@ std::unique_ptr<GenericRaster> ExpressionOperator::getRaster(const QueryRectangl
 		out_dd.addNoData();
 
 	SpatioTemporalReference out_stref(raster_in->stref, tref);
-	auto raster_out = GenericRaster::create(out_dd, out_stref, raster_in->width, raster_in->height, 0, GenericRaster::Representation::OPENCL);
 
-	/*
-	 * Run the kernel
-	 */
-	RasterOpenCL::CLProgram prog;
-	prog.setProfiler(tools.profiler);
-	for (int i=0;i<rastercount;i++) {
-		if (i > 0) {
-			if (in_rasters[i]->width != raster_in->width || in_rasters[i]->height != raster_in->height)
-				throw OperatorException("ExpressionOperator: not all input rasters have the same dimensions");
-		}
-		prog.addInRaster(in_rasters[i].get());
+	try {
+#ifndef MAPPING_NO_OPENCL
+		if (use_opencl)
+			return RasterExpression::evaluateOpenCL(expression, rasters, out_dd, out_stref, &tools.profiler);
+#endif
+		return RasterExpression::evaluateCPU(expression, rasters, out_dd, out_stref);
+	}
+	catch (const Formula::parse_error &e) {
+		throw OperatorException(concat("ExpressionOperator: invalid expression: ", e.what()));
 	}
-	prog.addOutRaster(raster_out.get());
-	prog.compile(sourcecode, "expressionkernel");
-	prog.run();
-
-	return raster_out;
 }
 #endif
-#endif
@@ -1,5 +1,6 @@
 #include "datatypes/raster.h"
 #include "datatypes/raster/typejuggling.h"
+#include "datatypes/raster/tiled_raster.h"
 #include "raster/opencl.h"
 #include "operators/operator.h"
 
@@ -68,35 +69,46 @@ struct matrixkernel{
 	static std::unique_ptr<GenericRaster> execute(Raster2D<T> *raster_src, int matrix_size, int *matrix) {
 		raster_src->setRepresentation(GenericRaster::Representation::CPU);
 
-		auto raster_dest_guard = GenericRaster::create(raster_src->dd, *raster_src, GenericRaster::Representation::CPU);
-		Raster2D<T> *raster_dest = (Raster2D<T> *) raster_dest_guard.get();
-
-		auto max = raster_src->dd.unit.getMin();
-		auto min = raster_src->dd.unit.getMax();
+		auto min = raster_src->dd.unit.getMin();
+		auto max = raster_src->dd.unit.getMax();
 
 		int matrix_offset = matrix_size / 2;
 		int width = raster_src->width;
 		int height = raster_src->height;
 
-		// TODO: Rand getrennt verarbeiten, in der mitte ist kein cap nötig
-		for (int y=0;y<height;y++) {
-			for (int x=0;x<width;x++) {
-				typename RasterTypeInfo<T>::accumulator_type value = 0;
-				for (int ky=0;ky<matrix_size;ky++) {
-					for (int kx=0;kx<matrix_size;kx++) {
-						int source_x = cap(x+kx-matrix_offset, 0, width-1);
-						int source_y = cap(y+ky-matrix_offset, 0, height-1);
-
-						value += matrix[ky*matrix_size+kx] * raster_src->get(source_x, source_y);
+		// The result is computed block by block. A block only reads a small neighbourhood
+		// of the source, which stays in the cache while the block is processed.
+		auto raster_dest = std::make_shared<TiledRaster2D<T>>(raster_src->dd, raster_src->stref, width, height,
+			[=](uint32_t x0, uint32_t y0, uint32_t block_width, uint32_t block_height, T *block) {
+				for (int y=y0;y<(int) (y0+block_height);y++) {
+					bool inner_y = y >= matrix_offset && y < height - matrix_offset;
+					T *out = &block[(size_t) (y-y0) * block_width];
+					for (int x=x0;x<(int) (x0+block_width);x++) {
+						typename RasterTypeInfo<T>::accumulator_type value = 0;
+						if (inner_y && x >= matrix_offset && x < width - matrix_offset) {
+							// no capping necessary away from the borders
+							for (int ky=0;ky<matrix_size;ky++)
+								for (int kx=0;kx<matrix_size;kx++)
+									value += matrix[ky*matrix_size+kx] * raster_src->get(x+kx-matrix_offset, y+ky-matrix_offset);
+						}
+						else {
+							for (int ky=0;ky<matrix_size;ky++) {
+								for (int kx=0;kx<matrix_size;kx++) {
+									int source_x = cap(x+kx-matrix_offset, 0, width-1);
+									int source_y = cap(y+ky-matrix_offset, 0, height-1);
+
+									value += matrix[ky*matrix_size+kx] * raster_src->get(source_x, source_y);
+								}
+							}
+						}
+						if (value > max) value = max;
+						if (value < min) value = min;
+						out[x-x0] = value;
 					}
 				}
-				if (value > max) value = max;
-				if (value < min) value = min;
-				raster_dest->set(x, y, value);
-			}
-		}
+			});
 
-		return raster_dest_guard;
+		return raster_dest->materialize();
 	}
 };
 
@@ -108,8 +108,11 @@ auto RgbaCompositeOperator::getRaster(const QueryRectangle &rect,
             QueryResolution::pixels(raster_r->width, raster_r->height)
     );
 
-    std::unique_ptr<GenericRaster> raster_g = getRasterFromSource(1, exact_rect, tools, RasterQM::EXACT);
-    std::unique_ptr<GenericRaster> raster_b = getRasterFromSource(2, exact_rect, tools, RasterQM::EXACT);
+    std::unique_ptr<GenericRaster> raster_g, raster_b;
+    getFromSourcesConcurrently(tools, {
+            [&](const QueryTools &tools) { raster_g = getRasterFromSource(1, exact_rect, tools, RasterQM::EXACT); },
+            [&](const QueryTools &tools) { raster_b = getRasterFromSource(2, exact_rect, tools, RasterQM::EXACT); }
+    });
 
     RasterOpenCL::init(); // it is necessary to init it already here, otherwise the following statements would crash
 
@@ -1,34 +1,49 @@
 #include "datatypes/raster.h"
-#include "datatypes/raster/typejuggling.h"
-#include "raster/opencl.h"
+#include "raster/temporal_aggregation.h"
 #include "operators/operator.h"
-#include "util/formula.h"
 #include "util/enumconverter.h"
 
-#include <limits>
+#include <functional>
 #include <memory>
 #include <sstream>
 #include <json/json.h>
-#include <iostream>
 
-enum class AggregationType {
-	MIN, MAX, AVG
-};
+const std::vector<std::pair<TemporalAggregator::Type, std::string> > AggregationTypeMap {
+		std::make_pair(TemporalAggregator::Type::COUNT, "count"),
+		std::make_pair(TemporalAggregator::Type::SUM, "sum"),
+		std::make_pair(TemporalAggregator::Type::MIN, "min"),
+		std::make_pair(TemporalAggregator::Type::MAX, "max"),
+		std::make_pair(TemporalAggregator::Type::AVG, "avg"),
+		std::make_pair(TemporalAggregator::Type::STDDEV, "stddev"),
+		std::make_pair(TemporalAggregator::Type::MEDIAN, "median"),
+		std::make_pair(TemporalAggregator::Type::PERCENTILE, "percentile") };
+
+static EnumConverter<TemporalAggregator::Type> AggregationTypeConverter(
+		AggregationTypeMap);
 
-const std::vector<std::pair<AggregationType, std::string> > AggregationTypeMap {
-		std::make_pair(AggregationType::MIN, "min"), std::make_pair(
-				AggregationType::MAX, "max"), std::make_pair(
-				AggregationType::AVG, "avg") };
+const std::vector<std::pair<TemporalAggregator::NoData, std::string> > NoDataMap {
+		std::make_pair(TemporalAggregator::NoData::FIRST_AS_VALUE, "first_as_value"),
+		std::make_pair(TemporalAggregator::NoData::PROPAGATE, "propagate"),
+		std::make_pair(TemporalAggregator::NoData::IGNORE, "ignore") };
 
-static EnumConverter<AggregationType> AggregationTypeConverter(
-		AggregationTypeMap);
+static EnumConverter<TemporalAggregator::NoData> NoDataConverter(
+		NoDataMap, "first_as_value");
 
 /**
  * Operator that aggregates a given input raster over a given time interval
  *
+ * The time slices are aggregated one at a time (see raster/temporal_aggregation.h),
+ * while the next slice is already requested from the source.
+ *
  * Parameters:
  * - duration: the length of the time interval in seconds as double
- * - aggregation: "min", "max", "avg"
+ * - aggregation: "count", "sum", "min", "max", "avg", "stddev", "median" or "percentile"
+ * - percentile: the percentile between 0 and 100, required for "percentile"
+ * - no_data: the handling of no data values (see TemporalAggregator::NoData)
+ *   - "first_as_value": no data values of the first raster are aggregated like values,
+ *     no data in a later raster makes the pixel no data (default)
+ *   - "propagate": a pixel is no data once it is no data in any raster
+ *   - "ignore": no data values are skipped
  */
 class TemporalAggregationOperator: public GenericOperator {
 public:
@@ -37,7 +52,6 @@ public:
 	virtual ~TemporalAggregationOperator();
 
 #ifndef MAPPING_OPERATOR_STUBS
-	std::unique_ptr<Raster2D<double>> createAccumulator(GenericRaster &raster);
 	virtual std::unique_ptr<GenericRaster> getRaster(const QueryRectangle &rect,
 			const QueryTools &tools);
 #endif
@@ -45,10 +59,22 @@ protected:
 	void writeSemanticParameters(std::ostringstream& stream);
 private:
 	double duration;
-	AggregationType aggregationType;
+	TemporalAggregator::Type aggregationType;
+	double percentile;
+	TemporalAggregator::NoData noData;
+
+#ifndef MAPPING_OPERATOR_STUBS
+	/*
+	 * Aggregates the given raster and the following ones. next receives the previous raster and the
+	 * query rectangle of it, sets the query rectangle of the next raster and returns false if there is none.
+	 */
+	typedef std::function<bool(const GenericRaster &previous, QueryRectangle &rect)> NextRectangle;
+	std::unique_ptr<GenericRaster> aggregate(std::unique_ptr<GenericRaster> input, const QueryRectangle &rect,
+			const NextRectangle &next, const QueryTools &tools);
 
 	std::unique_ptr<GenericRaster>
 	sampleAggregation(std::unique_ptr<GenericRaster> unique_ptr, const QueryRectangle &rectangle, const QueryTools &tools);
+#endif
 };
 
 TemporalAggregationOperator::TemporalAggregationOperator(int sourcecounts[],
@@ -67,6 +93,20 @@ TemporalAggregationOperator::TemporalAggregationOperator(int sourcecounts[],
 	}
 	aggregationType = AggregationTypeConverter.from_string(
 			params.get("aggregation", "").asString());
+
+	percentile = 50;
+	if (aggregationType == TemporalAggregator::Type::PERCENTILE) {
+		if (!params.isMember("percentile")) {
+			throw OperatorException(
+					"TemporalAggregationOperator: Parameter percentile is missing");
+		}
+		percentile = params.get("percentile", 50).asDouble();
+		if (!(percentile >= 0 && percentile <= 100)) {
+			throw OperatorException(
+					"TemporalAggregationOperator: Parameter percentile must be between 0 and 100");
+		}
+	}
+	noData = NoDataConverter.from_json(params, "no_data");
 }
 
 TemporalAggregationOperator::~TemporalAggregationOperator() {
@@ -78,105 +118,17 @@ void TemporalAggregationOperator::writeSemanticParameters(
 	Json::Value json(Json::objectValue);
 	json["duration"] = duration;
 	json["aggregation"] = AggregationTypeConverter.to_string(aggregationType);
+	// only written if set, so the semantic ids of existing queries stay the same
+	if (aggregationType == TemporalAggregator::Type::PERCENTILE)
+		json["percentile"] = percentile;
+	if (noData != TemporalAggregator::NoData::FIRST_AS_VALUE)
+		json["no_data"] = NoDataConverter.to_string(noData);
 
 	stream << json;
 }
 
 #ifndef MAPPING_OPERATOR_STUBS
 
-template<typename T>
-struct Accumulate {
-	static void execute(Raster2D<T> *raster, Raster2D<double> *accumulator, AggregationType aggregationType) {
-		raster->setRepresentation(GenericRaster::Representation::CPU);
-		// accumulate
-		for (int x = 0; x < raster->width; ++x) {
-			for (int y = 0; y < raster->height; ++y) {
-				T rasterValue = raster->get(x, y);
-				double accValue = accumulator->get(x, y);
-				double newValue;
-
-				if (raster->dd.is_no_data(rasterValue) || std::isnan(accValue)) {
-					newValue = NAN;
-				} else {
-
-					switch (aggregationType) {
-					case AggregationType::MIN:
-						newValue = std::min(static_cast<double>(rasterValue), accValue);
-						break;
-					case AggregationType::MAX:
-						newValue = std::max(static_cast<double>(rasterValue), accValue);
-						break;
-					case AggregationType::AVG:
-						newValue = static_cast<double>(rasterValue) + accValue;
-						break;
-					}
-				}
-				accumulator->set(x, y, newValue);
-			}
-		}
-
-	}
-};
-
-template<typename T>
-struct Output {
-	static std::unique_ptr<GenericRaster> execute(Raster2D<T> *raster, Raster2D<double> *accumulator,
-			AggregationType aggregationType, size_t n) {
-		auto output = std::make_unique<Raster2D<T>>(raster->dd, accumulator->stref,
-											   accumulator->width, accumulator->height);
-
-		for (int x = 0; x < raster->width; ++x) {
-			for (int y = 0; y < raster->height; ++y) {
-				double accValue = accumulator->get(x, y);
-				T outputValue;
-
-				if (std::isnan(accValue)) {
-					if (!raster->dd.has_no_data) {
-						throw OperatorException(
-								"Temporal_Aggregation: No data value in data without no data value");
-					} else {
-						outputValue = raster->dd.no_data;
-					}
-				} else {
-					switch (aggregationType) {
-					case AggregationType::MIN:
-						outputValue = static_cast<T>(accValue);
-						break;
-					case AggregationType::MAX:
-						outputValue = static_cast<T>(accValue);
-						break;
-					case AggregationType::AVG:
-						// TODO: solve for non-equi length time validities
-						outputValue = static_cast<T>(accValue / n);
-						break;
-					}
-				}
-				output->set(x, y, outputValue);
-			}
-		}
-
-		return std::unique_ptr<GenericRaster>(output.release());
-	}
-};
-
-std::unique_ptr<Raster2D<double>> TemporalAggregationOperator::createAccumulator(
-		GenericRaster &raster) {
-	DataDescription accumulatorDD = raster.dd;
-	accumulatorDD.datatype = GDT_Float64;
-
-	auto accumulator = std::make_unique<Raster2D<double>>(accumulatorDD,
-			raster.stref, raster.width, raster.height);
-
-	// initialize accumulator
-	for (int x = 0; x < accumulator->width; ++x) {
-		for (int y = 0; y < accumulator->height; ++y) {
-			accumulator->set(x, y, raster.getAsDouble(x, y));
-		}
-	}
-
-	return accumulator;
-}
-
 std::unique_ptr<GenericRaster> TemporalAggregationOperator::getRaster(
 		const QueryRectangle &rect, const QueryTools &tools) {
 	// TODO: compute using OpenCL
@@ -189,28 +141,13 @@ std::unique_ptr<GenericRaster> TemporalAggregationOperator::getRaster(
 		return sampleAggregation(std::move(input), rect, tools);
 	}
 
-	auto accumulator = createAccumulator(*input);
-
-	size_t n = 1;
-	QueryRectangle nextRect = rect;
-	nextRect.t1 = input->stref.t2;
-	nextRect.t2 = nextRect.t1 + nextRect.epsilon();
-
 	// TODO: what to do with rasters that are partially contained in timespan?
-    // TODO: gaps in rasters temporal validity
-	while (nextRect.t1 < rect.t1 + duration) {
-		std::unique_ptr<GenericRaster> rasterFromSource = getRasterFromSource(0, nextRect, tools,
-					RasterQM::EXACT);
-
-		// accumulate
-		callUnaryOperatorFunc<Accumulate>(rasterFromSource.get(), accumulator.get(), aggregationType);
-
-		nextRect.t1 = rasterFromSource->stref.t2;
+	// TODO: gaps in rasters temporal validity
+	return aggregate(std::move(input), rect, [&](const GenericRaster &previous, QueryRectangle &nextRect) {
+		nextRect.t1 = previous.stref.t2;
 		nextRect.t2 = nextRect.t1 + nextRect.epsilon();
-		n += 1;
-	}
-
-	return callUnaryOperatorFunc<Output>(input.get(), accumulator.get(), aggregationType, n);
+		return nextRect.t1 < rect.t1 + duration;
+	}, tools);
 }
 
 std::unique_ptr<GenericRaster>
@@ -218,25 +155,37 @@ TemporalAggregationOperator::sampleAggregation(std::unique_ptr<GenericRaster> in
 	const size_t n = 3; // TODO: introduce (optional) parameter
 	double timeDelta = (rect.t2 - rect.t1) / n;
 
-	auto accumulator = createAccumulator(*input);
-
-	QueryRectangle nextRect = rect;
-	nextRect.t1 = input->stref.t1 + timeDelta;
-	nextRect.t2 = nextRect.t1 + nextRect.epsilon();
-
-	for (size_t i = 0; i < n; ++i) {
-		std::unique_ptr<GenericRaster> rasterFromSource = getRasterFromSource(0, nextRect, tools,
-																			  RasterQM::EXACT);
+	size_t samples = 0;
+	return aggregate(std::move(input), rect, [&](const GenericRaster &previous, QueryRectangle &nextRect) {
+		nextRect.t1 = previous.stref.t1 + timeDelta;
+		nextRect.t2 = nextRect.t1 + nextRect.epsilon();
+		return samples++ < n;
+	}, tools);
+}
 
-		// accumulate
-		callUnaryOperatorFunc<Accumulate>(rasterFromSource.get(), accumulator.get(), aggregationType);
+std::unique_ptr<GenericRaster> TemporalAggregationOperator::aggregate(std::unique_ptr<GenericRaster> input,
+		const QueryRectangle &rect, const NextRectangle &next, const QueryTools &tools) {
+	TemporalAggregator aggregator(aggregationType, percentile / 100, noData);
+	auto stref = input->stref;
 
-		nextRect.t1 = rasterFromSource->stref.t1 + timeDelta;
-		nextRect.t2 = nextRect.t1 + nextRect.epsilon();
+	// the next raster is requested while the current one is aggregated
+	std::unique_ptr<GenericRaster> current = std::move(input);
+	QueryRectangle nextRect = rect;
+	while (current != nullptr) {
+		std::unique_ptr<GenericRaster> following;
+		std::vector<SourceRequest> requests {
+			[&](const QueryTools &) { aggregator.add(*current); }
+		};
+		if (next(*current, nextRect)) {
+			requests.push_back([&](const QueryTools &tools) {
+				following = getRasterFromSource(0, nextRect, tools, RasterQM::EXACT);
+			});
+		}
+		getFromSourcesConcurrently(tools, requests);
+		current = std::move(following);
 	}
 
-	return callUnaryOperatorFunc<Output>(input.get(), accumulator.get(), aggregationType, n);
+	return aggregator.getResult(stref);
 }
 
 #endif
-
@@ -107,6 +107,15 @@ QueryProfiler & QueryProfiler::operator+=(const QueryProfiler &other) {
 	return operator +=((ProfilingData&)other);
 }
 
+void QueryProfiler::merge(const QueryProfiler &other) {
+	if (other.t_start != std::numeric_limits<double>::infinity())
+		throw OperatorException("QueryProfiler: tried merging a timer that had not been stopped");
+	self_cpu += other.self_cpu;
+	self_gpu += other.self_gpu;
+	self_io += other.self_io;
+	operator +=((ProfilingData&)other);
+}
+
 void QueryProfiler::cached(const ProfilingData &data) {
 	uncached_cpu -= data.uncached_cpu;
 	uncached_gpu -= data.uncached_gpu;
@@ -42,6 +42,11 @@ class QueryProfiler : public ProfilingData {
 
 		QueryProfiler & operator+=( const ProfilingData &other );
 		QueryProfiler & operator+=( const QueryProfiler &other );
+		/**
+		 * Adds all costs of a profiler that measured part of this profiler's own work, e.g. on another thread.
+		 * Unlike operator+=, the self costs are added as well.
+		 */
+		void merge( const QueryProfiler &other );
 		void addTotalCosts( const ProfilingData &profile );
 		void cached( const ProfilingData &profile );
 
@@ -3,6 +3,9 @@
 
 #include "userdb/userdb.h"
 #include "operators/queryprofiler.h"
+#include "util/exceptions.h"
+
+#include <atomic>
 
 /*
  * This class contains references to a few useful things during query execution.
@@ -12,9 +15,25 @@ class QueryTools {
 	public:
         explicit QueryTools(QueryProfiler &profiler) : profiler(profiler) {};
 		QueryTools(QueryProfiler &profiler, std::shared_ptr<UserDB::Session> session) : profiler(profiler), session(std::move(session)) {};
+		QueryTools(QueryProfiler &profiler, std::shared_ptr<UserDB::Session> session, std::shared_ptr<const std::atomic<bool>> cancelled)
+			: profiler(profiler), session(std::move(session)), cancelled(std::move(cancelled)) {};
+		/**
+		 * Tools for a sub-query with its own profiler
+		 */
+		QueryTools(QueryProfiler &profiler, const QueryTools &parent) : profiler(profiler), session(parent.session), cancelled(parent.cancelled) {};
+
+		/**
+		 * Throws a QueryCancelledException if the query was cancelled. Operators are not interrupted,
+		 * so this is checked whenever an operator is about to be executed.
+		 */
+		void checkCancelled() const {
+			if (cancelled && *cancelled)
+				throw QueryCancelledException("The query was cancelled", MappingExceptionType::TRANSIENT);
+		}
 
 		QueryProfiler &profiler;
 		std::shared_ptr<UserDB::Session> session;
+		std::shared_ptr<const std::atomic<bool>> cancelled;
 };
 
 
@@ -1,6 +1,8 @@
 #include "operators/operator.h"
 #include "util/exceptions.h"
 #include "util/csv_source_util.h"
+#include "util/csv_sidecar.h"
+#include "util/configuration.h"
 #include "util/uriloader.h"
 
 #include <string>
@@ -57,6 +59,10 @@ enum class FileType {
  *   - license
  *   - uri
  *
+ * Point queries on local xy files are answered from a spatially indexed sidecar (see CSVSidecar)
+ * if one exists for the current version of the file. It is built on the first query if
+ * csv_source.sidecar is enabled. Otherwise, local files are memory-mapped and parsed in parallel
+ * chunks unless csv_source.mmap is disabled.
  */
 class CSVSourceOperator : public GenericOperator {
 	public:
@@ -153,6 +159,23 @@ void CSVSourceOperator::getProvenance(ProvenanceCollection &pc) {
 }
 
 std::unique_ptr<PointCollection> CSVSourceOperator::getPointCollection(const QueryRectangle &rect, const QueryTools &tools) {
+	if (filename.find("file://") == 0) {
+		std::string path = filename.substr(7);
+		auto sidecar = Configuration::get<bool>("csv_source.sidecar", false)
+			? CSVSidecar::openOrBuild(path, *csvSourceUtil) : CSVSidecar::open(path, *csvSourceUtil);
+		if (sidecar) {
+			size_t bytes_read = 0;
+			auto points = sidecar->getPointCollection(rect, bytes_read);
+			tools.profiler.addIOCost(bytes_read);
+			return points;
+		}
+		if (Configuration::get<bool>("csv_source.mmap", true)) {
+			filesize = getFilesize(path.c_str());
+			tools.profiler.addIOCost(filesize);
+			return csvSourceUtil->getPointCollectionFromFile(path, rect);
+		}
+	}
+
 	filesize = getFilesize(filename.c_str());
 	tools.profiler.addIOCost(filesize);
 
@@ -6,6 +6,7 @@
 #include "util/gdal.h"
 #include "util/gdal_source_datasets.h"
 #include "util/gdal_dataset_importer.h"
+#include "util/gdal_dataset_cache.h"
 #include "util/configuration.h"
 #include "util/log.h"
 
@@ -54,7 +55,8 @@ class RasterGDALSourceOperator : public GenericOperator {
 													double clip_x1, double clip_y1,
 													double clip_x2, double clip_y2,
 													const QueryRectangle &qrect,
-                                                    const GDALTimesnap::GDALDataLoadingInfo &loadingInfo);
+                                                    const GDALTimesnap::GDALDataLoadingInfo &loadingInfo,
+                                                    QueryProfiler &profiler);
 };
 
 
@@ -120,22 +122,48 @@ std::unique_ptr<GenericRaster> RasterGDALSourceOperator::getRaster(const QueryRe
     }
 
 	GDALTimesnap::GDALDataLoadingInfo loadingInfo = GDALTimesnap::getDataLoadingInfo(datasetJson, channel, rect);
-	auto raster = loadDataset(loadingInfo, rect.crsId, true, rect, tools);
-	//flip here so the tiff result will not be flipped
-	return raster->flip(false, true);
+	// the raster is loaded in our orientation, so the tiff result will not be flipped
+	return loadDataset(loadingInfo, rect.crsId, true, rect, tools);
 }
 
 bool overlaps (double a_start, double a_end, double b_start, double b_end) {
 	return a_end >= a_start && b_end >= b_start && a_end >= b_start && a_start <= b_end;
 }
 
+/*
+ * Selects the band to read from when downsampling by the given factors: the overview with the lowest
+ * resolution that is not coarser than requested, or the band itself. Like GDAL, overviews slightly coarser
+ * than requested are accepted (gdal_source.overviewthreshold).
+ */
+static GDALRasterBand *selectOverview(GDALRasterBand *band, double downsampling_x, double downsampling_y) {
+	static const double threshold = Configuration::get<double>("gdal_source.overviewthreshold", 1.2);
+	double requested = std::min(downsampling_x, downsampling_y) * threshold;
+
+	GDALRasterBand *best = band;
+	double best_factor = 1.0;
+	int count = band->GetOverviewCount();
+	for (int i = 0; i < count; i++) {
+		GDALRasterBand *overview = band->GetOverview(i);
+		if (overview == nullptr || overview->GetXSize() <= 0 || overview->GetYSize() <= 0)
+			continue;
+		double factor = std::min(static_cast<double>(band->GetXSize()) / overview->GetXSize(),
+								 static_cast<double>(band->GetYSize()) / overview->GetYSize());
+		if (factor > best_factor && factor <= requested) {
+			best = overview;
+			best_factor = factor;
+		}
+	}
+	return best;
+}
+
 // loads the raster and read the wanted raster data section into a GenericRaster
 std::unique_ptr<GenericRaster> RasterGDALSourceOperator::loadRaster(GDALDataset *dataset, double origin_x,
 																	double origin_y, double scale_x, double scale_y,
 																	CrsId crsId, bool clip, double clip_x1,
 																	double clip_y1, double clip_x2, double clip_y2,
 																	const QueryRectangle& qrect,
-																	const GDALTimesnap::GDALDataLoadingInfo &loadingInfo) {
+																	const GDALTimesnap::GDALDataLoadingInfo &loadingInfo,
+																	QueryProfiler &profiler) {
 	// get raster metadata
     GDALRasterBand  *poBand;
 	int             nBlockXSize, nBlockYSize;
@@ -222,33 +250,15 @@ std::unique_ptr<GenericRaster> RasterGDALSourceOperator::loadRaster(GDALDataset
         double query_scale_factor_y = std::abs(scale_y / query_scale_y);
 
 
-        std::unique_ptr<GenericRaster> raster;
-        SpatioTemporalReference stref_gdal(
-                SpatialReference(qrect.crsId, gdal_x1, gdal_y1, gdal_x2, gdal_y2, flipx, flipy),
-                loadingInfo.tref
-        );
-
         DataDescription dd(type, loadingInfo.unit, hasnodata, nodata);
 
-        // read the actual data
 		auto gdal_raster_width = static_cast<int> (std::ceil(gdal_pixel_width * query_scale_factor_x));
 		auto gdal_raster_height = static_cast<int> (std::ceil(gdal_pixel_height * query_scale_factor_y));
-        raster = GenericRaster::create(dd, stref_gdal, static_cast<uint32_t>(gdal_raster_width),
-                                            static_cast<uint32_t>(gdal_raster_height));
-        void *buffer = raster->getDataForWriting();
-
-        auto res = poBand->RasterIO(GF_Read,
-                                    gdal_pixel_x1, gdal_pixel_y1, gdal_pixel_width,
-                                    gdal_pixel_height,  // rectangle in the source raster
-                                    buffer, raster->width,
-                                    raster->height,  // position and size of the destination buffer
-                                    type, 0, 0, nullptr);
-
-        if (res != CE_None) {
-            GDALClose(dataset);
-            throw OperatorException("GDAL Source: RasterIO failed");
-        }
 
+        // the data is read directly into the raster that is returned, at the following position and size
+        std::unique_ptr<GenericRaster> raster;
+        int dest_x = 0, dest_y = 0;
+        int dest_width = gdal_raster_width, dest_height = gdal_raster_height;
 
         // check if requested query rectangle exceed the data returned from GDAL
         if (pixel_width > gdal_pixel_width || pixel_height > gdal_pixel_height) {
@@ -258,23 +268,77 @@ std::unique_ptr<GenericRaster> RasterGDALSourceOperator::loadRaster(GDALDataset
                     loadingInfo.tref
             );
 
-            auto raster2 = GenericRaster::create(dd, stref, qrect.xres, qrect.yres);
+            raster = GenericRaster::create(dd, stref, qrect.xres, qrect.yres);
             if(hasnodata && nodata != 0) {
-                raster2->clear(nodata);
+                raster->clear(nodata);
             }
 
-            if (raster) {
-                int gdal_pixel_offset_x = gdal_pixel_x1 - pixel_x1;
-                int gdal_pixel_offset_y = gdal_pixel_y1 - pixel_y1;
-				auto blit_offset_x = static_cast<int>(gdal_pixel_offset_x * query_scale_factor_x);
-				auto blit_offset_y = static_cast<int>(gdal_pixel_offset_y * query_scale_factor_y);
-                raster2->blit(raster.get(), blit_offset_x, blit_offset_y);
-            }
-
-            return raster2;
+            int gdal_pixel_offset_x = gdal_pixel_x1 - pixel_x1;
+            int gdal_pixel_offset_y = gdal_pixel_y1 - pixel_y1;
+            dest_x = static_cast<int>(gdal_pixel_offset_x * query_scale_factor_x);
+            dest_y = static_cast<int>(gdal_pixel_offset_y * query_scale_factor_y);
+            // the part of the data exceeding the raster is cut off
+            dest_width = std::min(dest_width, static_cast<int>(raster->width) - dest_x);
+            dest_height = std::min(dest_height, static_cast<int>(raster->height) - dest_y);
+            if (dest_width <= 0 || dest_height <= 0)
+                return raster;
         } else {
-			return raster;
-		}
+            SpatioTemporalReference stref_gdal(
+                    SpatialReference(qrect.crsId, gdal_x1, gdal_y1, gdal_x2, gdal_y2, flipx, flipy),
+                    loadingInfo.tref
+            );
+            raster = GenericRaster::create(dd, stref_gdal, static_cast<uint32_t>(gdal_raster_width),
+                                           static_cast<uint32_t>(gdal_raster_height));
+        }
+
+        // When the data is cut off, the source window shrinks accordingly, so that the remaining
+        // pixels are sampled at the same positions as without cutting. GDAL accepts fractional windows for that.
+        double source_width = static_cast<double>(gdal_pixel_width) * dest_width / gdal_raster_width;
+        double source_height = static_cast<double>(gdal_pixel_height) * dest_height / gdal_raster_height;
+
+        // read from an overview if the query's resolution is low enough, the window shrinks accordingly
+        GDALRasterBand *readBand = selectOverview(poBand, source_width / dest_width, source_height / dest_height);
+        double level_scale_x = static_cast<double>(readBand->GetXSize()) / nXSize;
+        double level_scale_y = static_cast<double>(readBand->GetYSize()) / nYSize;
+        double level_x = gdal_pixel_x1 * level_scale_x, level_y = gdal_pixel_y1 * level_scale_y;
+        double level_width = source_width * level_scale_x, level_height = source_height * level_scale_y;
+
+        int read_x = std::min(readBand->GetXSize() - 1, static_cast<int>(std::floor(level_x)));
+        int read_y = std::min(readBand->GetYSize() - 1, static_cast<int>(std::floor(level_y)));
+        int read_width = std::min(readBand->GetXSize() - read_x, std::max(1, static_cast<int>(std::ceil(level_width))));
+        int read_height = std::min(readBand->GetYSize() - read_y, std::max(1, static_cast<int>(std::ceil(level_height))));
+
+        // When the window is not aligned to the pixels of the level, e.g. because data beyond the raster's
+        // edge was cut off, GDAL accepts the fractional window. That keeps the remaining pixels sampled at
+        // the same positions as without cutting.
+        GDALRasterIOExtraArg extra_arg;
+        INIT_RASTERIO_EXTRA_ARG(extra_arg);
+        if (level_x != read_x || level_y != read_y || level_width != read_width || level_height != read_height) {
+            extra_arg.bFloatingPointWindowValidity = TRUE;
+            extra_arg.dfXOff = level_x;
+            extra_arg.dfYOff = level_y;
+            extra_arg.dfXSize = level_width;
+            extra_arg.dfYSize = level_height;
+        }
+
+        // GDAL's rows start at the top, ours at the bottom. Writing the rows backwards from the last
+        // destination row flips the data while reading, without another copy.
+        auto pixel_space = static_cast<GSpacing>(raster->getDataSize() / raster->getPixelCount());
+        auto line_space = static_cast<GSpacing>(raster->width) * pixel_space;
+        char *buffer = static_cast<char *>(raster->getDataForWriting())
+                + (raster->height - 1 - dest_y) * line_space + dest_x * pixel_space;
+
+        auto res = readBand->RasterIO(GF_Read,
+                                      read_x, read_y, read_width, read_height,  // rectangle in the source raster
+                                      buffer, dest_width, dest_height,  // position and size of the destination buffer
+                                      type, pixel_space, -line_space, &extra_arg);
+
+        if (res != CE_None)
+            throw OperatorException("GDAL Source: RasterIO failed");
+
+        profiler.addIOCost(static_cast<size_t>(read_width) * read_height * GDALGetDataTypeSizeBytes(type));
+
+        return raster;
 
     } else {
         // return empty raster
@@ -292,7 +356,7 @@ std::unique_ptr<GenericRaster> RasterGDALSourceOperator::loadRaster(GDALDataset
         return raster;
     }
 
-	//GDALRasterBand is not to be freed, is owned by GDALDataset that will be closed later
+	//GDALRasterBand is not to be freed, is owned by GDALDataset that will be returned to the GDALDatasetCache later
 }
 
 void injectParameters(std::string &file, const QueryRectangle &qrect, const QueryTools &tools) {
@@ -332,14 +396,14 @@ void injectParameters(std::string &file, const QueryRectangle &qrect, const Quer
 std::unique_ptr<GenericRaster> RasterGDALSourceOperator::loadDataset(const GDALTimesnap::GDALDataLoadingInfo &loadingInfo,
                                                                      CrsId crsId, bool clip, const QueryRectangle &qrect,
                                                                      const QueryTools &tools) {
-	GDAL::init();
 	std::string fileName = loadingInfo.fileName;
     injectParameters(fileName, qrect, tools);
     Log::debug(concat("loadDataset: using filename: ", fileName.c_str()));
 
-	auto dataset = (GDALDataset *) GDALOpen(fileName.c_str(), GA_ReadOnly);
+	// the handle is returned to the cache when the lease goes out of scope
+	auto dataset = GDALDatasetCache::open(fileName);
 
-	if (dataset == nullptr)
+	if (!dataset)
 		throw OperatorException(concat("GDAL Source: Could not open dataset ", loadingInfo.fileName));
 
 	if (crsId != loadingInfo.crsId) {
@@ -349,22 +413,21 @@ std::unique_ptr<GenericRaster> RasterGDALSourceOperator::loadDataset(const GDALT
 	//read GeoTransform to get origin and scale
 	double adfGeoTransform[6];
 	if( dataset->GetGeoTransform( adfGeoTransform ) != CE_None ) {
-		GDALClose(dataset);
 		throw OperatorException("GDAL Source: No GeoTransform information in raster");
 	}
 
 	int rastercount = dataset->GetRasterCount();
 	if (loadingInfo.channel < 1 || loadingInfo.channel > rastercount) {
-		GDALClose(dataset);
 		throw OperatorException("GDAL Source: rasterid not found");
 	}
 
-	auto raster = loadRaster(dataset, adfGeoTransform[0], adfGeoTransform[3], adfGeoTransform[1],
-                             adfGeoTransform[5], crsId, clip, qrect.x1, qrect.y1, qrect.x2, qrect.y2, qrect, loadingInfo);
-
-	GDALClose(dataset);
-
-	return raster;
+	try {
+		return loadRaster(dataset.get(), adfGeoTransform[0], adfGeoTransform[3], adfGeoTransform[1],
+                          adfGeoTransform[5], crsId, clip, qrect.x1, qrect.y1, qrect.x2, qrect.y2, qrect, loadingInfo,
+                          tools.profiler);
+	} catch (const OperatorException &) {
+		// don't hand a dataset that failed to read to the next query
+		dataset.discard();
+		throw;
+	}
 }
-
-
@@ -4,20 +4,28 @@ using namespace pv;
 
 BoundingBox::BoundingBox(Coordinate center, Dimension halfDimension, double epsilonDistance) : center(center), halfDimension(halfDimension), EPSILON_DISTANCE(epsilonDistance) {}
 
+bool BoundingBox::intersects(Circle& circle) const {
+	return intersects(circle.getX(), circle.getY(), circle.getRadius());
+}
+
+bool BoundingBox::contains(Circle& circle) const {
+	return contains(circle.getX(), circle.getY(), circle.getRadius());
+}
+
 /**
  * http://stackoverflow.com/questions/401847/circle-rectangle-collision-detection-intersection
  */
-bool BoundingBox::intersects(Circle& circle) const {
+bool BoundingBox::intersects(double x, double y, double radius) const {
 	auto circleDistance = std::make_pair(
-			fabs(circle.getX() - center.getX()),
-			fabs(circle.getY() - center.getY()));
+			fabs(x - center.getX()),
+			fabs(y - center.getY()));
 
 	if (circleDistance.first
-			> (halfDimension.getWidth() + circle.getRadius() + EPSILON_DISTANCE)) {
+			> (halfDimension.getWidth() + radius + EPSILON_DISTANCE)) {
 		return false;
 	}
 	if (circleDistance.second
-			> (halfDimension.getHeight() + circle.getRadius() + EPSILON_DISTANCE)) {
+			> (halfDimension.getHeight() + radius + EPSILON_DISTANCE)) {
 		return false;
 	}
 
@@ -32,12 +40,12 @@ bool BoundingBox::intersects(Circle& circle) const {
 			circleDistance.first - halfDimension.getWidth(), 2)
 			+ pow(circleDistance.second - halfDimension.getHeight(), 2);
 
-	return (cornerDistance_sq <= pow(circle.getRadius(), 2));
+	return (cornerDistance_sq <= pow(radius, 2));
 }
 
-bool BoundingBox::contains(Circle& circle) const {
-	return ( fabs(circle.getX() - center.getX()) <= (halfDimension.getWidth() - circle.getRadius() - EPSILON_DISTANCE) )
-		&& (fabs(circle.getY() - center.getY()) <= (halfDimension.getHeight() - circle.getRadius() - EPSILON_DISTANCE));
+bool BoundingBox::contains(double x, double y, double radius) const {
+	return ( fabs(x - center.getX()) <= (halfDimension.getWidth() - radius - EPSILON_DISTANCE) )
+		&& (fabs(y - center.getY()) <= (halfDimension.getHeight() - radius - EPSILON_DISTANCE));
 }
 
 Coordinate BoundingBox::getCenter() const {
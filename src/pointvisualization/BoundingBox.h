@@ -39,6 +39,15 @@ namespace pv {
 			 */
 			bool contains(Circle& circle) const;
 
+			/**
+			 * Calculate the intersection between the bounding box and a circle given by its center and radius.
+			 */
+			bool intersects(double x, double y, double radius) const;
+			/**
+			 * Calculate the containment between the bounding box and a circle given by its center and radius.
+			 */
+			bool contains(double x, double y, double radius) const;
+
 			/**
 			 * @return center
 			 */
@@ -0,0 +1,388 @@
+#include <cmath>
+#include <algorithm>
+#include "FlatCircleClustering.h"
+
+using namespace pv;
+
+const uint32_t FlatCircleClustering::NONE;
+const size_t FlatCircleClustering::MAXIMUM_TEXTS;
+
+FlatCircleClustering::FlatCircleClustering(const BoundingBox &boundingBox, double x_min, double y_min,
+										   double circleMinRadius, double epsilonDistance,
+										   size_t numericAttributes, size_t textAttributes, size_t nodeCapacity)
+		: circleMinRadius(circleMinRadius), epsilonDistance(epsilonDistance),
+		  numericAttributes(numericAttributes), textAttributes(textAttributes), nodeCapacity(nodeCapacity),
+		  average(numericAttributes), averageOfSquared(numericAttributes),
+		  textCount(textAttributes), textKeys(textAttributes), textX(textAttributes), textY(textAttributes) {
+	// same grid as Grid
+	this->cell_width = (2 * circleMinRadius + epsilonDistance) / std::sqrt(2.0);
+
+	double map_width = boundingBox.getHalfDimension().getWidth() * 2;
+	this->number_of_horitontal_buckets = static_cast<uint16_t >(std::ceil(map_width / cell_width));
+
+	this->offset_x = std::floor(x_min / this->cell_width) * this->cell_width;
+	this->offset_y = std::floor(y_min / this->cell_width) * this->cell_width;
+
+	nodes.emplace_back(boundingBox);
+
+	// circle 0 holds the point that is merged into a grid cell
+	std::vector<double> zeros(numericAttributes, 0);
+	std::vector<uint32_t> noTexts(textAttributes, 0);
+	addCircle(0, 0, zeros.data(), noTexts.data());
+}
+
+uint32_t FlatCircleClustering::getTextKey(const std::string &text) {
+	auto result = textDictionary.emplace(text, static_cast<uint32_t>(texts.size()));
+	if (result.second) {
+		texts.push_back(&result.first->first);
+	}
+	return result.first->second;
+}
+
+void FlatCircleClustering::insert(double x, double y, const double *numericValues, const uint32_t *textKeys) {
+	uint32_t grid_x = static_cast<uint32_t >((x - this->offset_x) / this->cell_width);
+	uint32_t grid_y = static_cast<uint32_t >((y - this->offset_y) / this->cell_width);
+	uint32_t grid_pos = grid_y * number_of_horitontal_buckets + grid_x;
+
+	// the position is truncated to the key type, as in Grid
+	auto iterator = this->cells.find(static_cast<uint16_t>(grid_pos));
+	if (iterator != this->cells.end()) {
+		setPoint(0, x, y, numericValues, textKeys);
+		merge(iterator->second, 0);
+	} else {
+		this->cells.insert(iterator, {static_cast<uint16_t>(grid_pos), addCircle(x, y, numericValues, textKeys)});
+	}
+}
+
+void FlatCircleClustering::cluster() {
+	// insert the cells in the order of Grid::insert_into(): by bucket, and by descending position within a bucket
+	std::vector<std::pair<uint16_t, uint32_t>> bucket_circles;
+	for (size_t bucket_i = 0; bucket_i < this->cells.bucket_count(); ++bucket_i) {
+		bucket_circles.assign(this->cells.begin(bucket_i), this->cells.end(bucket_i));
+		std::sort(bucket_circles.begin(), bucket_circles.end(), [](const std::pair<uint16_t, uint32_t> &a, const std::pair<uint16_t, uint32_t> &b) {
+			return a.first > b.first;
+		});
+		for (auto &bucket_circle : bucket_circles) {
+			insertIntoTree(bucket_circle.second);
+		}
+	}
+
+	// collect the circles in the order of CircleClusteringQuadTree::getCircles()
+	result.clear();
+	std::vector<uint32_t> queue{0};
+	for (size_t i = 0; i < queue.size(); ++i) {
+		const Node &node = nodes[queue[i]];
+		for (uint32_t circle = node.firstCircle; circle != NONE; circle = next[circle]) {
+			result.push_back(circle);
+		}
+		if (node.firstChild != NONE) {
+			for (uint32_t child = 0; child < 4; ++child) {
+				queue.push_back(node.firstChild + child);
+			}
+		}
+	}
+}
+
+size_t FlatCircleClustering::getCircleCount() const {
+	return result.size();
+}
+
+double FlatCircleClustering::getX(size_t circle) const {
+	return x[result[circle]];
+}
+
+double FlatCircleClustering::getY(size_t circle) const {
+	return y[result[circle]];
+}
+
+double FlatCircleClustering::getRadius(size_t circle) const {
+	return radius[result[circle]];
+}
+
+unsigned int FlatCircleClustering::getNumberOfPoints(size_t circle) const {
+	return numberOfPoints[result[circle]];
+}
+
+double FlatCircleClustering::getAverage(size_t circle, size_t attribute) const {
+	return average[attribute][result[circle]];
+}
+
+double FlatCircleClustering::getVariance(size_t circle, size_t attribute) const {
+	return averageOfSquared[attribute][result[circle]] - pow(average[attribute][result[circle]], 2);
+}
+
+std::vector<std::string> FlatCircleClustering::getTexts(size_t circle, size_t attribute) const {
+	std::vector<std::string> circleTexts;
+	size_t offset = result[circle] * MAXIMUM_TEXTS;
+	for (size_t i = 0; i < textCount[attribute][result[circle]]; ++i) {
+		circleTexts.push_back(*texts[textKeys[attribute][offset + i]]);
+	}
+	return circleTexts;
+}
+
+uint32_t FlatCircleClustering::addCircle(double x, double y, const double *numericValues, const uint32_t *textKeys) {
+	uint32_t circle = static_cast<uint32_t>(this->x.size());
+	this->x.push_back(0);
+	this->y.push_back(0);
+	radius.push_back(0);
+	numberOfPoints.push_back(0);
+	previous.push_back(NONE);
+	next.push_back(NONE);
+	for (size_t attribute = 0; attribute < numericAttributes; ++attribute) {
+		average[attribute].push_back(0);
+		averageOfSquared[attribute].push_back(0);
+	}
+	for (size_t attribute = 0; attribute < textAttributes; ++attribute) {
+		textCount[attribute].push_back(0);
+		this->textKeys[attribute].resize(this->textKeys[attribute].size() + MAXIMUM_TEXTS);
+		textX[attribute].resize(textX[attribute].size() + MAXIMUM_TEXTS);
+		textY[attribute].resize(textY[attribute].size() + MAXIMUM_TEXTS);
+	}
+	setPoint(circle, x, y, numericValues, textKeys);
+	return circle;
+}
+
+void FlatCircleClustering::setPoint(uint32_t circle, double x, double y, const double *numericValues, const uint32_t *textKeys) {
+	this->x[circle] = x;
+	this->y[circle] = y;
+	numberOfPoints[circle] = 1;
+	radius[circle] = circleMinRadius + log(1);
+	for (size_t attribute = 0; attribute < numericAttributes; ++attribute) {
+		average[attribute][circle] = numericValues[attribute];
+		averageOfSquared[attribute][circle] = pow(numericValues[attribute], 2);
+	}
+	for (size_t attribute = 0; attribute < textAttributes; ++attribute) {
+		textCount[attribute][circle] = 1;
+		this->textKeys[attribute][circle * MAXIMUM_TEXTS] = textKeys[attribute];
+		textX[attribute][circle * MAXIMUM_TEXTS] = x;
+		textY[attribute][circle * MAXIMUM_TEXTS] = y;
+	}
+}
+
+/*
+ * Same as Circle::merge(), but stores the result in circle
+ */
+void FlatCircleClustering::merge(uint32_t circle, uint32_t other) {
+	unsigned int thisWeight = numberOfPoints[circle];
+	unsigned int otherWeight = numberOfPoints[other];
+	unsigned int newWeight = thisWeight + otherWeight;
+
+	for (size_t attribute = 0; attribute < numericAttributes; ++attribute) {
+		average[attribute][circle] =
+			((average[attribute][circle] * thisWeight) + (average[attribute][other] * otherWeight)) / (thisWeight+otherWeight);
+		averageOfSquared[attribute][circle] =
+			((averageOfSquared[attribute][circle] * thisWeight) + (averageOfSquared[attribute][other] * otherWeight)) / (thisWeight+otherWeight);
+	}
+
+	// texts are merged around the former center
+	for (size_t attribute = 0; attribute < textAttributes; ++attribute) {
+		mergeTexts(circle, other, attribute);
+	}
+
+	x[circle] = (x[circle] * thisWeight + x[other] * otherWeight) / newWeight;
+	y[circle] = (y[circle] * thisWeight + y[other] * otherWeight) / newWeight;
+	numberOfPoints[circle] = newWeight;
+	radius[circle] = circleMinRadius + log(static_cast<int>(newWeight));
+}
+
+/*
+ * Same as Circle::TextAttribute::merge(), but stores the result in circle
+ */
+void FlatCircleClustering::mergeTexts(uint32_t circle, uint32_t other, size_t attribute) {
+	const Coordinate center(x[circle], y[circle]);
+	uint32_t *newKeys = &textKeys[attribute][circle * MAXIMUM_TEXTS];
+	double *newX = &textX[attribute][circle * MAXIMUM_TEXTS];
+	double *newY = &textY[attribute][circle * MAXIMUM_TEXTS];
+	const uint32_t *otherKeys = &textKeys[attribute][other * MAXIMUM_TEXTS];
+	const double *otherX = &textX[attribute][other * MAXIMUM_TEXTS];
+	const double *otherY = &textY[attribute][other * MAXIMUM_TEXTS];
+	size_t size = textCount[attribute][circle];
+
+	double squaredDistances[MAXIMUM_TEXTS];
+	size_t largestSquaredDistanceIndex = 0;
+	for (size_t i = 0; i < size; ++i) {
+		squaredDistances[i] = Coordinate(newX[i], newY[i]).squaredEuclideanDistance(center);
+		if (squaredDistances[i] > squaredDistances[largestSquaredDistanceIndex]) {
+			largestSquaredDistanceIndex = i;
+		}
+	}
+
+	for (size_t otherIndex = 0; otherIndex < textCount[attribute][other]; ++otherIndex) {
+		const Coordinate otherCoordinate(otherX[otherIndex], otherY[otherIndex]);
+
+		// duplicate?
+		bool duplicate = false;
+		for (size_t i = 0; i < size; ++i) {
+			if (otherKeys[otherIndex] == newKeys[i]) {
+				double otherSquaredDistance = otherCoordinate.squaredEuclideanDistance(center);
+				if (otherSquaredDistance < squaredDistances[i]) {
+					newX[i] = otherCoordinate.getX();
+					newY[i] = otherCoordinate.getY();
+					squaredDistances[i] = otherSquaredDistance;
+				}
+				duplicate = true;
+				break;
+			}
+		}
+		if (duplicate) {
+			continue;
+		}
+
+		double squaredDistance = otherCoordinate.squaredEuclideanDistance(center);
+		if (size < MAXIMUM_TEXTS) {
+			newKeys[size] = otherKeys[otherIndex];
+			newX[size] = otherCoordinate.getX();
+			newY[size] = otherCoordinate.getY();
+			squaredDistances[size] = squaredDistance;
+			++size;
+		} else if (squaredDistance < squaredDistances[largestSquaredDistanceIndex]) {
+			newKeys[largestSquaredDistanceIndex] = otherKeys[otherIndex];
+			newX[largestSquaredDistanceIndex] = otherCoordinate.getX();
+			newY[largestSquaredDistanceIndex] = otherCoordinate.getY();
+			squaredDistances[largestSquaredDistanceIndex] = squaredDistance;
+
+			for (size_t i = 0; i < size; ++i) {
+				if (squaredDistances[i] > squaredDistances[largestSquaredDistanceIndex]) {
+					largestSquaredDistanceIndex = i;
+				}
+			}
+		}
+	}
+
+	textCount[attribute][circle] = static_cast<uint32_t>(size);
+}
+
+bool FlatCircleClustering::intersects(uint32_t circle, uint32_t other) const {
+	return sqrt(pow(x[circle] - x[other], 2) + pow(y[circle] - y[other], 2)) < (radius[circle] + radius[other] + epsilonDistance);
+}
+
+/*
+ * Same as CircleClusteringQuadTree::insert()
+ */
+void FlatCircleClustering::insertIntoTree(uint32_t circle) {
+	while (true) {
+		uint32_t node;
+		uint32_t intersectingCircle = find(0, circle, node);
+
+		if (intersectingCircle == NONE) {
+			insertDirect(node, circle);
+			return;
+		}
+
+		// MERGE
+		unlink(node, intersectingCircle);
+		merge(intersectingCircle, circle);
+		circle = intersectingCircle;
+	}
+}
+
+/*
+ * Same as QuadTreeNode::find()
+ * @return the intersecting circle, and its node in freeNode, or NONE and the node to insert the circle into
+ */
+uint32_t FlatCircleClustering::find(uint32_t node, uint32_t circle, uint32_t &freeNode) const {
+	for (uint32_t nodeCircle = nodes[node].firstCircle; nodeCircle != NONE; nodeCircle = next[nodeCircle]) {
+		if (intersects(circle, nodeCircle)) {
+			freeNode = node;
+			return nodeCircle;
+		}
+	}
+
+	if (nodes[node].firstChild != NONE) {
+		for (uint32_t child = nodes[node].firstChild; child < nodes[node].firstChild + 4; ++child) {
+			if (nodes[child].boundingBox.intersects(x[circle], y[circle], radius[circle])) {
+				uint32_t intersectingCircle = find(child, circle, freeNode);
+				if (intersectingCircle != NONE) {
+					return intersectingCircle;
+				} else if (nodes[child].boundingBox.contains(x[circle], y[circle], radius[circle])) {
+					return NONE; // child is responsible for circle
+				}
+			}
+		}
+	}
+
+	freeNode = node;
+	return NONE;
+}
+
+void FlatCircleClustering::insertDirect(uint32_t node, uint32_t circle) {
+	if (nodes[node].firstChild != NONE || nodes[node].circleCount < nodeCapacity) {
+		append(node, circle);
+		return;
+	}
+
+	split(node);
+	for (uint32_t child = nodes[node].firstChild; child < nodes[node].firstChild + 4; ++child) {
+		if (insertIfInBounds(child, circle)) {
+			return;
+		}
+	}
+	append(node, circle);
+}
+
+bool FlatCircleClustering::insertIfInBounds(uint32_t node, uint32_t circle) {
+	if (nodes[node].boundingBox.contains(x[circle], y[circle], radius[circle])) {
+		insertDirect(node, circle);
+		return true;
+	} else {
+		return false;
+	}
+}
+
+void FlatCircleClustering::split(uint32_t node) {
+	const BoundingBox boundingBox = nodes[node].boundingBox;
+	Dimension newDimension = boundingBox.getHalfDimension().halve();
+	const double centerX = boundingBox.getCenter().getX();
+	const double centerY = boundingBox.getCenter().getY();
+
+	uint32_t firstChild = static_cast<uint32_t>(nodes.size());
+	nodes.emplace_back(BoundingBox(Coordinate(centerX - newDimension.getWidth(), centerY - newDimension.getHeight()), newDimension, boundingBox.getEpsilonDistance()));
+	nodes.emplace_back(BoundingBox(Coordinate(centerX + newDimension.getWidth(), centerY - newDimension.getHeight()), newDimension, boundingBox.getEpsilonDistance()));
+	nodes.emplace_back(BoundingBox(Coordinate(centerX - newDimension.getWidth(), centerY + newDimension.getHeight()), newDimension, boundingBox.getEpsilonDistance()));
+	nodes.emplace_back(BoundingBox(Coordinate(centerX + newDimension.getWidth(), centerY + newDimension.getHeight()), newDimension, boundingBox.getEpsilonDistance()));
+	nodes[node].firstChild = firstChild;
+
+	// move the circles that fit into a child
+	uint32_t circle = nodes[node].firstCircle;
+	while (circle != NONE) {
+		uint32_t following = next[circle];
+		for (uint32_t child = firstChild; child < firstChild + 4; ++child) {
+			if (nodes[child].boundingBox.contains(x[circle], y[circle], radius[circle])) {
+				unlink(node, circle);
+				insertDirect(child, circle);
+				break;
+			}
+		}
+		circle = following;
+	}
+}
+
+void FlatCircleClustering::append(uint32_t node, uint32_t circle) {
+	Node &n = nodes[node];
+	previous[circle] = n.lastCircle;
+	next[circle] = NONE;
+	if (n.lastCircle != NONE) {
+		next[n.lastCircle] = circle;
+	} else {
+		n.firstCircle = circle;
+	}
+	n.lastCircle = circle;
+	++n.circleCount;
+}
+
+void FlatCircleClustering::unlink(uint32_t node, uint32_t circle) {
+	Node &n = nodes[node];
+	if (previous[circle] != NONE) {
+		next[previous[circle]] = next[circle];
+	} else {
+		n.firstCircle = next[circle];
+	}
+	if (next[circle] != NONE) {
+		previous[next[circle]] = previous[circle];
+	} else {
+		n.lastCircle = previous[circle];
+	}
+	previous[circle] = NONE;
+	next[circle] = NONE;
+	--n.circleCount;
+}
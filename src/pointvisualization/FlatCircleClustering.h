@@ -0,0 +1,139 @@
+#ifndef POINTVISUALIZATION_FLATCIRCLECLUSTERING_H_
+#define POINTVISUALIZATION_FLATCIRCLECLUSTERING_H_
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+
+#include "BoundingBox.h"
+
+namespace pv {
+
+	/**
+	 * Clusters points into non-overlapping circles like Grid followed by CircleClusteringQuadTree, with the same results.
+	 *
+	 * Circles live in arrays indexed by circle number, one array per property and attribute, and are merged in place.
+	 * Quad tree nodes live in an array as well and refer to their children and circles by index.
+	 * Text values are stored as keys of a dictionary. Points only occupy a circle if they are the first of their
+	 * grid cell, so the memory does not grow with the number of points.
+	 */
+	class FlatCircleClustering {
+		public:
+			/**
+			 * Construct the clustering (cf. Grid, CircleClusteringQuadTree).
+			 * @param boundingBox
+			 * @param x_min
+			 * @param y_min
+			 * @param circleMinRadius
+			 * @param epsilonDistance
+			 * @param numericAttributes number of numeric attributes of each point
+			 * @param textAttributes number of text attributes of each point
+			 * @param nodeCapacity capacity of the quad tree nodes
+			 */
+			FlatCircleClustering(const BoundingBox &boundingBox, double x_min, double y_min,
+								 double circleMinRadius, double epsilonDistance,
+								 size_t numericAttributes, size_t textAttributes, size_t nodeCapacity = 1);
+
+			/**
+			 * @return the key of a text value, for passing it to insert()
+			 */
+			uint32_t getTextKey(const std::string &text);
+
+			/**
+			 * Inserts a point, merging it with the circle of its grid cell.
+			 * @param x
+			 * @param y
+			 * @param numericValues one value per numeric attribute
+			 * @param textKeys one key per text attribute
+			 */
+			void insert(double x, double y, const double *numericValues, const uint32_t *textKeys);
+
+			/**
+			 * Clusters the circles of the grid cells. Call after all points are inserted.
+			 */
+			void cluster();
+
+			/**
+			 * @return number of circles after cluster()
+			 */
+			size_t getCircleCount() const;
+
+			/*
+			 * Properties of the circles after cluster(), in the order of CircleClusteringQuadTree::getCircles()
+			 */
+			double getX(size_t circle) const;
+			double getY(size_t circle) const;
+			double getRadius(size_t circle) const;
+			unsigned int getNumberOfPoints(size_t circle) const;
+			double getAverage(size_t circle, size_t attribute) const;
+			double getVariance(size_t circle, size_t attribute) const;
+			std::vector<std::string> getTexts(size_t circle, size_t attribute) const;
+
+		private:
+			static const uint32_t NONE = UINT32_MAX;
+			static const size_t MAXIMUM_TEXTS = 5; // cf. Circle::TextAttribute::maximumTextArrayLength
+
+			struct Node {
+				Node(const BoundingBox &boundingBox) : boundingBox(boundingBox), firstChild(NONE), firstCircle(NONE), lastCircle(NONE), circleCount(0) {}
+				BoundingBox boundingBox;
+				uint32_t firstChild; // the four children are stored consecutively
+				uint32_t firstCircle;
+				uint32_t lastCircle;
+				size_t circleCount;
+			};
+
+			uint32_t addCircle(double x, double y, const double *numericValues, const uint32_t *textKeys);
+			void setPoint(uint32_t circle, double x, double y, const double *numericValues, const uint32_t *textKeys);
+			void merge(uint32_t circle, uint32_t other);
+			void mergeTexts(uint32_t circle, uint32_t other, size_t attribute);
+			bool intersects(uint32_t circle, uint32_t other) const;
+
+			void insertIntoTree(uint32_t circle);
+			uint32_t find(uint32_t node, uint32_t circle, uint32_t &freeNode) const;
+			void insertDirect(uint32_t node, uint32_t circle);
+			bool insertIfInBounds(uint32_t node, uint32_t circle);
+			void split(uint32_t node);
+			void append(uint32_t node, uint32_t circle);
+			void unlink(uint32_t node, uint32_t circle);
+
+			const double circleMinRadius;
+			const double epsilonDistance;
+			const size_t numericAttributes;
+			const size_t textAttributes;
+			const size_t nodeCapacity;
+
+			// grid
+			double offset_x;
+			double offset_y;
+			double cell_width;
+			uint16_t number_of_horitontal_buckets;
+			std::unordered_map<uint16_t, uint32_t> cells;
+
+			// circles
+			std::vector<double> x;
+			std::vector<double> y;
+			std::vector<double> radius;
+			std::vector<unsigned int> numberOfPoints;
+			std::vector<uint32_t> previous;
+			std::vector<uint32_t> next;
+			std::vector<std::vector<double>> average;
+			std::vector<std::vector<double>> averageOfSquared;
+			// MAXIMUM_TEXTS entries per circle, of which textCount are used
+			std::vector<std::vector<uint32_t>> textCount;
+			std::vector<std::vector<uint32_t>> textKeys;
+			std::vector<std::vector<double>> textX;
+			std::vector<std::vector<double>> textY;
+
+			// text dictionary
+			std::unordered_map<std::string, uint32_t> textDictionary;
+			std::vector<const std::string *> texts;
+
+			// tree
+			std::vector<Node> nodes;
+			std::vector<uint32_t> result;
+	};
+
+}
+
+#endif /* POINTVISUALIZATION_FLATCIRCLECLUSTERING_H_ */
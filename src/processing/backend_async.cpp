@@ -0,0 +1,194 @@
+
+#include "util/configuration.h"
+#include "util/concat.h"
+#include "processing/backend_local.h"
+
+#include <atomic>
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*
+ * Executes queries on a fixed number of worker threads, so callers may wait for, poll or cancel them.
+ *
+ * Interactive queries are executed before bulk queries. Bulk queries may only occupy
+ * bulk_workers of the workers, the others remain available for interactive ones.
+ * Cancelled queries finish with an error without being executed or, if already running, before their next operator.
+ *
+ * Parameters:
+ * - workers: the number of worker threads, 0 means one per hardware thread
+ * - bulk_workers: the maximum number of workers executing bulk queries at the same time
+ */
+class AsyncQueryProcessor : public LocalQueryProcessor {
+	public:
+		AsyncQueryProcessor(const ConfigurationTable& params);
+		virtual ~AsyncQueryProcessor();
+		virtual std::unique_ptr<QueryProcessor::QueryResult> process(const Query &q, std::shared_ptr<UserDB::Session> session, bool includeProvenance);
+		virtual std::unique_ptr<QueryProcessor::QueryProgress> processAsync(const Query &q, std::shared_ptr<UserDB::Session> session, bool includeProvenance);
+
+		/**
+		 * The state of a query, shared by the queue and its QueryProgress
+		 */
+		class Task {
+			public:
+				Task(const Query &query, std::shared_ptr<UserDB::Session> session, bool includeProvenance, const std::string &id)
+					: query(query), session(std::move(session)), includeProvenance(includeProvenance), id(id),
+					  cancelled(std::make_shared<std::atomic<bool>>(false)), finished(false) {}
+
+				void finish(std::unique_ptr<QueryProcessor::QueryResult> result);
+
+				const Query query;
+				const std::shared_ptr<UserDB::Session> session;
+				const bool includeProvenance;
+				const std::string id;
+				std::shared_ptr<std::atomic<bool>> cancelled;
+
+				std::mutex mutex;
+				std::condition_variable cv;
+				bool finished;
+				std::unique_ptr<QueryProcessor::QueryResult> result;
+		};
+
+	private:
+		void work();
+		std::shared_ptr<Task> next();
+
+		std::vector<std::thread> workers;
+		std::deque<std::shared_ptr<Task>> interactive_queue;
+		std::deque<std::shared_ptr<Task>> bulk_queue;
+		size_t bulk_workers;
+		size_t running_bulk;
+		size_t next_id;
+		bool stopped;
+		std::mutex mutex;
+		std::condition_variable cv;
+};
+REGISTER_QUERYPROCESSOR_BACKEND(AsyncQueryProcessor, "async");
+
+
+class AsyncQueryProgress : public QueryProcessor::QueryProgress {
+	public:
+		AsyncQueryProgress(std::shared_ptr<AsyncQueryProcessor::Task> task) : task(std::move(task)) {};
+		virtual ~AsyncQueryProgress() {
+			// nobody is interested in the result anymore
+			if (!isFinished())
+				cancel();
+		};
+		virtual bool isFinished() {
+			std::lock_guard<std::mutex> lock(task->mutex);
+			return task->finished;
+		};
+		virtual void wait() {
+			std::unique_lock<std::mutex> lock(task->mutex);
+			task->cv.wait(lock, [this]() { return task->finished; });
+		};
+		virtual std::unique_ptr<QueryProcessor::QueryResult> getResult() {
+			wait();
+			return std::move(task->result);
+		};
+		virtual std::string getID() { return task->id; };
+		virtual void cancel() { *task->cancelled = true; };
+	private:
+		std::shared_ptr<AsyncQueryProcessor::Task> task;
+};
+
+
+void AsyncQueryProcessor::Task::finish(std::unique_ptr<QueryProcessor::QueryResult> result) {
+	std::lock_guard<std::mutex> lock(mutex);
+	this->result = std::move(result);
+	finished = true;
+	cv.notify_all();
+}
+
+
+AsyncQueryProcessor::AsyncQueryProcessor(const ConfigurationTable& params)
+	: LocalQueryProcessor(params), running_bulk(0), next_id(0), stopped(false) {
+	ConfigurationTable table(params);
+	auto threads = (size_t) table.get<int64_t>("workers", 0);
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	bulk_workers = (size_t) table.get<int64_t>("bulk_workers", 1);
+	// keep a worker for interactive queries
+	if (threads > 1)
+		bulk_workers = std::min(bulk_workers, threads - 1);
+	bulk_workers = std::max(bulk_workers, (size_t) 1);
+
+	for (size_t i = 0; i < threads; i++)
+		workers.emplace_back(&AsyncQueryProcessor::work, this);
+}
+
+AsyncQueryProcessor::~AsyncQueryProcessor() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopped = true;
+		for (auto queue : {&interactive_queue, &bulk_queue})
+			for (auto &task : *queue)
+				*task->cancelled = true;
+	}
+	cv.notify_all();
+	for (auto &worker : workers)
+		worker.join();
+}
+
+
+std::unique_ptr<QueryProcessor::QueryResult> AsyncQueryProcessor::process(const Query &q, std::shared_ptr<UserDB::Session> session, bool includeProvenance) {
+	return processAsync(q, session, includeProvenance)->getResult();
+}
+
+std::unique_ptr<QueryProcessor::QueryProgress> AsyncQueryProcessor::processAsync(const Query &q, std::shared_ptr<UserDB::Session> session, bool includeProvenance) {
+	std::shared_ptr<Task> task;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		task = std::make_shared<Task>(q, session, includeProvenance, concat("async-", next_id++));
+		if (q.priority == Query::Priority::BULK)
+			bulk_queue.push_back(task);
+		else
+			interactive_queue.push_back(task);
+	}
+	cv.notify_one();
+	return std::make_unique<AsyncQueryProgress>(task);
+}
+
+
+/*
+ * Returns the next task to execute, or nullptr when the processor is destroyed and all tasks are done.
+ */
+std::shared_ptr<AsyncQueryProcessor::Task> AsyncQueryProcessor::next() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		if (!interactive_queue.empty()) {
+			auto task = interactive_queue.front();
+			interactive_queue.pop_front();
+			return task;
+		}
+		if (!bulk_queue.empty() && (running_bulk < bulk_workers || stopped)) {
+			auto task = bulk_queue.front();
+			bulk_queue.pop_front();
+			running_bulk++;
+			return task;
+		}
+		if (stopped && bulk_queue.empty())
+			return nullptr;
+		cv.wait(lock);
+	}
+}
+
+void AsyncQueryProcessor::work() {
+	while (auto task = next()) {
+		QueryProfiler profiler;
+		QueryTools tools(profiler, task->session, task->cancelled);
+		task->finish(execute(task->query, tools, task->includeProvenance));
+
+		if (task->query.priority == Query::Priority::BULK) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				running_bulk--;
+			}
+			// another worker may be waiting for a bulk slot
+			cv.notify_all();
+		}
+	}
+}
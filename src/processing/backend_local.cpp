@@ -1,14 +1,7 @@
 
 #include "util/configuration.h"
-#include "processing/queryprocessor_backend.h"
+#include "processing/backend_local.h"
 
-class LocalQueryProcessor : public QueryProcessor::QueryProcessorBackend {
-	public:
-		LocalQueryProcessor(const ConfigurationTable& params);
-		virtual ~LocalQueryProcessor();
-		virtual std::unique_ptr<QueryProcessor::QueryResult> process(const Query &q, std::shared_ptr<UserDB::Session> session, bool includeProvenance);
-		virtual std::unique_ptr<QueryProcessor::QueryProgress> processAsync(const Query &q, std::shared_ptr<UserDB::Session> session, bool includeProvenance);
-};
 REGISTER_QUERYPROCESSOR_BACKEND(LocalQueryProcessor, "local");
 
 LocalQueryProcessor::LocalQueryProcessor(const ConfigurationTable& params) {
@@ -21,12 +14,15 @@ LocalQueryProcessor::~LocalQueryProcessor() {
 
 
 std::unique_ptr<QueryProcessor::QueryResult> LocalQueryProcessor::process(const Query &q, std::shared_ptr<UserDB::Session> session, bool includeProvenance) {
+	QueryProfiler profiler;
+	return execute(q, QueryTools(profiler, session), includeProvenance);
+}
+
+std::unique_ptr<QueryProcessor::QueryResult> LocalQueryProcessor::execute(const Query &q, const QueryTools &tools, bool includeProvenance) {
 	try {
+		tools.checkCancelled();
 		auto op = GenericOperator::fromJSON(q.operatorgraph);
 
-		QueryProfiler profiler;
-		QueryTools tools(profiler, session);
-
 		std::unique_ptr<ProvenanceCollection> provenance;
 		if(includeProvenance) {
 			provenance.reset(op->getCachedFullProvenance(q.rectangle, tools).release());
@@ -64,6 +60,7 @@ class LocalQueryProgress : public QueryProcessor::QueryProgress {
 		virtual void wait() { };
 		virtual std::unique_ptr<QueryProcessor::QueryResult> getResult() { return std::move(result); };
 		virtual std::string getID() { return ""; };
+		virtual void cancel() { };
 		std::unique_ptr<QueryProcessor::QueryResult> result;
 };
 
@@ -0,0 +1,23 @@
+#ifndef PROCESSING_BACKEND_LOCAL_H
+#define PROCESSING_BACKEND_LOCAL_H
+
+#include "processing/queryprocessor_backend.h"
+
+/**
+ * Executes queries on the calling thread.
+ */
+class LocalQueryProcessor : public QueryProcessor::QueryProcessorBackend {
+	public:
+		LocalQueryProcessor(const ConfigurationTable& params);
+		virtual ~LocalQueryProcessor();
+		virtual std::unique_ptr<QueryProcessor::QueryResult> process(const Query &q, std::shared_ptr<UserDB::Session> session, bool includeProvenance);
+		virtual std::unique_ptr<QueryProcessor::QueryProgress> processAsync(const Query &q, std::shared_ptr<UserDB::Session> session, bool includeProvenance);
+
+	protected:
+		/**
+		 * Executes the query with the given tools. Errors are returned as error results.
+		 */
+		std::unique_ptr<QueryProcessor::QueryResult> execute(const Query &q, const QueryTools &tools, bool includeProvenance);
+};
+
+#endif
@@ -14,12 +14,20 @@ class Query {
 			PLOT,
 			ERROR
 		};
-		Query(const std::string &operatorgraph, ResultType result, const QueryRectangle &rectangle);
+		/**
+		 * Backends may execute interactive queries (e.g. map tiles) before bulk queries (e.g. exports)
+		 */
+		enum class Priority {
+			INTERACTIVE,
+			BULK
+		};
+		Query(const std::string &operatorgraph, ResultType result, const QueryRectangle &rectangle, Priority priority = Priority::INTERACTIVE);
 		~Query();
 
 		std::string operatorgraph;
 		ResultType result;
 		QueryRectangle rectangle;
+		Priority priority;
 };
 
 #endif
@@ -4,14 +4,18 @@
 #include "processing/queryprocessor_backend.h"
 #include "util/configuration.h"
 
+#include <mutex>
+
 
 std::unique_ptr<QueryProcessor> QueryProcessor::default_instance;
 
 QueryProcessor &QueryProcessor::getDefaultProcessor() {
-	if (default_instance == nullptr) {
+	// the FCGI threads share the default processor
+	static std::once_flag initialized;
+	std::call_once(initialized, []() {
 		auto name = Configuration::get<std::string>("processing.backend", "local");
 		default_instance = create(name, Configuration::getSubTable("processing." + name));
-	}
+	});
 	return *default_instance;
 }
 
@@ -22,6 +22,7 @@ class SimpleFeatureCollection;
  *
  * - it can either execute the graph locally or connect to a processing service for distributed processing
  * - it can execute the graph asynchronously in a separate thread, or non-blocking for distributed processing
+ * - it can prioritize interactive queries over bulk queries and cancel queries
  * - it can set up a process-wide or even distributed cache
  *
  * All of these things can be controlled using the global configuration.
@@ -61,10 +62,15 @@ class QueryProcessor {
 
 		class QueryProgress {
 			public:
+				virtual ~QueryProgress() = default;
 				virtual bool isFinished() = 0;
 				virtual void wait() = 0;
 				virtual std::unique_ptr<QueryResult> getResult() = 0;
 				virtual std::string getID() = 0;
+				/**
+				 * Requests the query to be cancelled. Its result is an error unless it finished before.
+				 */
+				virtual void cancel() = 0;
 		};
 
 		/**
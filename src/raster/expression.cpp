@@ -0,0 +1,204 @@
+#include "raster/expression.h"
+#include "raster/opencl.h"
+#include "datatypes/raster/typejuggling.h"
+#include "util/formula.h"
+#include "util/threadpool.h"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <cmath>
+
+
+static void checkInputs(const std::vector<GenericRaster *> &in_rasters) {
+	if (in_rasters.empty() || in_rasters.size() > 26)
+		throw ArgumentException("RasterExpression: need between 1 and 26 input rasters");
+	for (auto raster : in_rasters) {
+		if (raster->width != in_rasters[0]->width || raster->height != in_rasters[0]->height)
+			throw ArgumentException("RasterExpression: not all input rasters have the same dimensions");
+	}
+}
+
+
+/*
+ * CPU
+ */
+// Converts pixels to doubles and marks the ones that are no-data
+typedef void (*BatchLoader)(const void *data, const DataDescription &dd, size_t offset, size_t count, double *values, uint8_t *no_data);
+// Converts results to pixels, writing no-data where marked
+typedef void (*BatchStorer)(void *data, const DataDescription &dd, size_t offset, size_t count, const double *values, const uint8_t *no_data, bool integer_values);
+
+// the same test as the ISNODATA macros of the OpenCL kernels
+template<typename T> static inline bool isNoData(T value, T no_data) { return value == no_data; }
+template<> inline bool isNoData(float value, float no_data) { return std::isnan(value) || value == no_data; }
+template<> inline bool isNoData(double value, double no_data) { return std::isnan(value) || value == no_data; }
+
+template<typename T>
+static void loadBatch(const void *data, const DataDescription &dd, size_t offset, size_t count, double *values, uint8_t *no_data) {
+	const T *src = (const T *) data + offset;
+	for (size_t i = 0; i < count; i++)
+		values[i] = src[i];
+	if (dd.has_no_data) {
+		T no_data_value = (T) dd.no_data;
+		for (size_t i = 0; i < count; i++)
+			no_data[i] |= isNoData(src[i], no_data_value);
+	}
+}
+
+/*
+ * Integers wrap around like the integer conversions in C, e.g. when packing colors with bit operations.
+ * Floating point values are truncated, but saturated instead of overflowing. Infinity and NaN become no-data.
+ */
+template<typename T>
+static inline T toPixel(double value, bool integer_value, T no_data_value) {
+	if (!std::numeric_limits<T>::is_integer)
+		return (T) value;
+	if (!std::isfinite(value))
+		return no_data_value;
+	if (integer_value && std::fabs(value) < 9.2e18)
+		return (T) (int64_t) value;
+	return (T) std::min(std::max(value, (double) std::numeric_limits<T>::lowest()), (double) std::numeric_limits<T>::max());
+}
+
+template<typename T>
+static void storeBatch(void *data, const DataDescription &dd, size_t offset, size_t count, const double *values, const uint8_t *no_data, bool integer_values) {
+	T *dst = (T *) data + offset;
+	T no_data_value = (T) dd.no_data;
+	for (size_t i = 0; i < count; i++)
+		dst[i] = no_data[i] ? no_data_value : toPixel<T>(values[i], integer_values, no_data_value);
+}
+
+template<typename T>
+struct getBatchLoader {
+	static BatchLoader execute(Raster2D<T> *) { return &loadBatch<T>; }
+};
+
+template<typename T>
+struct getBatchStorer {
+	static BatchStorer execute(Raster2D<T> *) { return &storeBatch<T>; }
+};
+
+std::unique_ptr<GenericRaster> RasterExpression::evaluateCPU(const std::string &expression, const std::vector<GenericRaster *> &in_rasters,
+		const DataDescription &out_dd, const SpatioTemporalReference &out_stref) {
+	checkInputs(in_rasters);
+	size_t rastercount = in_rasters.size();
+
+	Formula f(expression);
+	f.addCLFunctions();
+	for (size_t i=0;i<rastercount;i++) {
+		char code = 'A' + (char) i;
+		auto datatype = in_rasters[i]->dd.datatype;
+		bool is_float = datatype == GDT_Float32 || datatype == GDT_Float64;
+		f.addVariable(std::string(1, code), "", is_float ? Formula::Type::FLOAT : Formula::Type::INTEGER);
+	}
+	auto program = f.compile();
+	bool integer_result = program.getResultType() == Formula::Type::INTEGER;
+
+	std::vector<BatchLoader> loaders;
+	std::vector<const void *> inputs;
+	for (auto raster : in_rasters) {
+		raster->setRepresentation(GenericRaster::Representation::CPU);
+		loaders.push_back(callUnaryOperatorFunc<getBatchLoader>(raster));
+		inputs.push_back(raster->getData());
+	}
+
+	auto width = in_rasters[0]->width, height = in_rasters[0]->height;
+	auto raster_out = GenericRaster::create(out_dd, out_stref, width, height, 0, GenericRaster::Representation::CPU);
+	auto storer = callUnaryOperatorFunc<getBatchStorer>(raster_out.get());
+	void *output = raster_out->getDataForWriting();
+
+	const size_t BATCH_SIZE = FormulaProgram::BATCH_SIZE;
+	const size_t CHUNK_SIZE = BATCH_SIZE * 64;
+	size_t pixels = (size_t) width * height;
+	size_t chunks = (pixels + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	ThreadPool::getDefault().parallelFor(chunks, [&](size_t chunk) {
+		std::vector<double> values(rastercount * BATCH_SIZE), results(BATCH_SIZE), scratch;
+		std::vector<uint8_t> no_data(BATCH_SIZE);
+		std::vector<const double *> variables;
+		for (size_t i=0;i<rastercount;i++)
+			variables.push_back(&values[i * BATCH_SIZE]);
+
+		size_t end = std::min(pixels, (chunk + 1) * CHUNK_SIZE);
+		for (size_t offset = chunk * CHUNK_SIZE; offset < end; offset += BATCH_SIZE) {
+			size_t count = std::min(BATCH_SIZE, end - offset);
+			std::fill(no_data.begin(), no_data.begin() + count, 0);
+			for (size_t i=0;i<rastercount;i++)
+				loaders[i](inputs[i], in_rasters[i]->dd, offset, count, &values[i * BATCH_SIZE], no_data.data());
+			program.evaluate(variables.data(), results.data(), count, scratch);
+			storer(output, out_dd, offset, count, results.data(), no_data.data(), integer_result);
+		}
+	});
+
+	return raster_out;
+}
+
+
+/*
+ * OpenCL
+ */
+#ifndef MAPPING_NO_OPENCL
+std::unique_ptr<GenericRaster> RasterExpression::evaluateOpenCL(const std::string &expression, const std::vector<GenericRaster *> &in_rasters,
+		const DataDescription &out_dd, const SpatioTemporalReference &out_stref, QueryProfiler *profiler) {
+	checkInputs(in_rasters);
+	size_t rastercount = in_rasters.size();
+
+	RasterOpenCL::init();
+
+	/*
+	 * See if the formula is valid and safe
+	 */
+	Formula f(expression);
+	f.addCLFunctions();
+	for (size_t i=0;i<rastercount;i++) {
+		char code = 'A' + (char) i;
+		f.addVariable(std::string(1, code));
+	}
+	auto safe_expression = f.parse();
+
+	/*
+	 * Let's assemble our code
+	 */
+	std::stringstream ss_sourcecode;
+	ss_sourcecode << "__kernel void expressionkernel(";
+	for (size_t i=0;i<rastercount;i++) {
+		ss_sourcecode << "__global const IN_TYPE" << i << " *in_data" << i << ", __global const RasterInfo *in_info" << i << ",";
+	}
+	ss_sourcecode << "__global OUT_TYPE0 *out_data, __global const RasterInfo *out_info) {"
+		"int gid = get_global_id(0) + get_global_id(1) * in_info0->size[0];"
+		"if (gid >= in_info0->size[0]*in_info0->size[1]*in_info0->size[2])"
+		"	return;";
+	for (size_t i=0;i<rastercount;i++) {
+		char code = 'A' + (char) i;
+		ss_sourcecode <<
+			"IN_TYPE"<<i<<" "<<code<<" = in_data"<<i<<"[gid];"
+			"if (ISNODATA"<<i<<"("<<code<<", in_info"<<i<<")) {"
+			"	out_data[gid] = out_info->no_data;"
+			"	return;"
+			"}";
+	}
+	ss_sourcecode <<
+		"OUT_TYPE0 result = " << safe_expression << ";"
+		"out_data[gid] = result;"
+		"}";
+
+	std::string sourcecode(ss_sourcecode.str());
+
+	auto raster_out = GenericRaster::create(out_dd, out_stref, in_rasters[0]->width, in_rasters[0]->height, 0, GenericRaster::Representation::OPENCL);
+
+	/*
+	 * Run the kernel
+	 */
+	RasterOpenCL::CLProgram prog;
+	if (profiler)
+		prog.setProfiler(*profiler);
+	for (auto raster : in_rasters) {
+		raster->setRepresentation(GenericRaster::OPENCL);
+		prog.addInRaster(raster);
+	}
+	prog.addOutRaster(raster_out.get());
+	prog.compile(sourcecode, "expressionkernel");
+	prog.run();
+
+	return raster_out;
+}
+#endif
@@ -0,0 +1,34 @@
+#ifndef RASTER_EXPRESSION_H
+#define RASTER_EXPRESSION_H
+
+#include "datatypes/raster.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class QueryProfiler;
+
+/**
+ * Evaluates a formula (see util/formula.h) for every pixel of a set of rasters with equal dimensions.
+ *
+ * The rasters are referenced by A, B, ... in the formula. If any of them is no-data in a pixel,
+ * the result is no-data, too.
+ */
+namespace RasterExpression {
+	/**
+	 * Evaluates the formula on the CPU. The pixels are processed in batches, distributed on the thread pool.
+	 */
+	std::unique_ptr<GenericRaster> evaluateCPU(const std::string &expression, const std::vector<GenericRaster *> &in_rasters,
+			const DataDescription &out_dd, const SpatioTemporalReference &out_stref);
+
+#ifndef MAPPING_NO_OPENCL
+	/**
+	 * Evaluates the formula in an OpenCL kernel
+	 */
+	std::unique_ptr<GenericRaster> evaluateOpenCL(const std::string &expression, const std::vector<GenericRaster *> &in_rasters,
+			const DataDescription &out_dd, const SpatioTemporalReference &out_stref, QueryProfiler *profiler = nullptr);
+#endif
+}
+
+#endif
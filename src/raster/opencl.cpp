@@ -9,10 +9,13 @@
 #include "operators/operator.h" // For QueryProfiler
 #include "util/configuration.h"
 #include "util/log.h"
+#include "util/binary_cache.h"
+#include "util/concat.h"
 
 #include <sstream>
 #include <mutex>
 #include <atomic>
+#include <future>
 #include <unordered_map>
 
 namespace RasterOpenCL {
@@ -241,23 +244,93 @@ const std::string &getRasterInfoStructSource() {
 
 /*
  * ProgramCache
+ *
+ * Programs are compiled at most once per process. Different programs may be compiled concurrently,
+ * concurrent requests for the same program wait for its compilation.
+ * Additionally, the binaries can be stored in the directory configured as global.opencl.binarycache,
+ * keyed by the hash of the source and the identity of the platform, device and driver. Other processes
+ * load them instead of compiling the source again. The binaries are executed as they are, so the
+ * directory must only be writable by the user running mapping (see BinaryCache).
  */
-
-// For the first implementation, only one program may be compiled at a time, and
-// there's no replacement strategy; the cache just keeps on filling.
 static std::mutex program_cache_mutex;
-static std::unordered_map<std::string, cl::Program> program_cache;
+static std::unordered_map<std::string, std::shared_future<cl::Program>> program_cache;
 
 void freeProgramCache() {
 	std::lock_guard<std::mutex> guard(program_cache_mutex);
 	program_cache.clear();
 }
 
-cl::Program compileSource(const std::string &sourcecode) {
-	std::lock_guard<std::mutex> guard(program_cache_mutex);
+static BinaryCache getBinaryCache() {
+	return BinaryCache(Configuration::get<std::string>("global.opencl.binarycache", ""));
+}
+
+// everything a compiled binary depends on
+static std::vector<std::string> getBinaryCacheKey(const std::string &sourcecode) {
+	return {
+		platform.getInfo<CL_PLATFORM_NAME>(),
+		platform.getInfo<CL_PLATFORM_VERSION>(),
+		device.getInfo<CL_DEVICE_NAME>(),
+		device.getInfo<CL_DEVICE_VERSION>(),
+		device.getInfo<CL_DRIVER_VERSION>(),
+		sourcecode
+	};
+}
+
+static cl::Program loadBinary(const BinaryCache &cache, const std::vector<std::string> &key) {
+	std::vector<char> binary;
+	if (!cache.load(key, binary))
+		return cl::Program();
+
+	try {
+		cl::Program::Binaries binaries(1, std::make_pair(binary.data(), binary.size()));
+		cl::Program program(context, std::vector<cl::Device>(1, device), binaries);
+		program.build(std::vector<cl::Device>(1, device), "");
+		return program;
+	}
+	catch (const cl::Error &e) {
+		// e.g. a corrupted file, the source is compiled and the file replaced
+		Log::warn(concat("Could not load cl::Program from ", cache.getFilename(key), ": ", e.err(), ": ", e.what()));
+		return cl::Program();
+	}
+}
+
+static void storeBinary(const BinaryCache &cache, const std::vector<std::string> &key, const cl::Program &program) {
+	try {
+		auto devices = program.getInfo<CL_PROGRAM_DEVICES>();
+		auto sizes = program.getInfo<CL_PROGRAM_BINARY_SIZES>();
+		size_t idx = 0;
+		while (idx < devices.size() && devices[idx]() != device())
+			idx++;
+		if (idx >= devices.size() || sizes[idx] == 0)
+			return;
+
+		// cl.hpp cannot fetch the binaries into buffers of the right size, so we use the C API
+		std::vector<std::vector<unsigned char>> binaries(devices.size());
+		std::vector<unsigned char *> pointers(devices.size());
+		for (size_t i = 0; i < devices.size(); i++) {
+			binaries[i].resize(sizes[i]);
+			pointers[i] = binaries[i].data();
+		}
+		cl_int err = clGetProgramInfo(program(), CL_PROGRAM_BINARIES, pointers.size() * sizeof(unsigned char *), pointers.data(), nullptr);
+		if (err != CL_SUCCESS)
+			throw cl::Error(err, "clGetProgramInfo");
+
+		cache.store(key, (const char *) binaries[idx].data(), binaries[idx].size());
+	}
+	catch (const std::exception &e) {
+		// the cache is an optimization, the program can be used anyways
+		Log::warn(concat("Could not store cl::Program in ", cache.getFilename(key), ": ", e.what()));
+	}
+}
 
-	if (program_cache.count(sourcecode) == 1) {
-		return program_cache.at(sourcecode);
+static cl::Program buildSource(const std::string &sourcecode) {
+	auto cache = getBinaryCache();
+	std::vector<std::string> key;
+	if (cache.isTrusted()) {
+		key = getBinaryCacheKey(sourcecode);
+		cl::Program program = loadBinary(cache, key);
+		if (program() != nullptr)
+			return program;
 	}
 
 	cl::Program program;
@@ -272,10 +345,41 @@ cl::Program compileSource(const std::string &sourcecode) {
 		throw OpenCLException(ss.str(), MappingExceptionType::CONFIDENTIAL);
 	}
 
-	program_cache[sourcecode] = program;
+	if (!key.empty())
+		storeBinary(cache, key, program);
 	return program;
 }
 
+cl::Program compileSource(const std::string &sourcecode) {
+	std::promise<cl::Program> promise;
+	std::shared_future<cl::Program> future;
+	{
+		std::lock_guard<std::mutex> guard(program_cache_mutex);
+		auto it = program_cache.find(sourcecode);
+		if (it != program_cache.end())
+			future = it->second;
+		else
+			program_cache.emplace(sourcecode, promise.get_future().share());
+	}
+
+	// another thread is compiling or has compiled this program
+	if (future.valid())
+		return future.get();
+
+	try {
+		cl::Program program = buildSource(sourcecode);
+		promise.set_value(program);
+		return program;
+	}
+	catch (...) {
+		// let waiting threads fail as well, but let the next request try again
+		promise.set_exception(std::current_exception());
+		std::lock_guard<std::mutex> guard(program_cache_mutex);
+		program_cache.erase(sourcecode);
+		throw;
+	}
+}
+
 
 /*
  * CLProgram
@@ -0,0 +1,288 @@
+#include "raster/temporal_aggregation.h"
+#include "datatypes/raster/raster_priv.h"
+#include "datatypes/raster/raster_kernels.h"
+#include "datatypes/raster/typejuggling.h"
+#include "util/exceptions.h"
+#include "util/threadpool.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <cmath>
+
+
+/*
+ * Conversion of rows between the rasters and the accumulators
+ */
+// Converts pixels to doubles, NaN for no-data
+typedef void (*RowLoader)(const void *data, const DataDescription &dd, size_t offset, size_t count, double *values);
+// Converts results to pixels, writing no-data for NaN
+typedef void (*RowStorer)(void *data, const DataDescription &dd, size_t offset, size_t count, const double *values);
+
+template<typename T>
+static void loadRow(const void *data, const DataDescription &dd, size_t offset, size_t count, double *values) {
+	const T *src = (const T *) data + offset;
+	if (!dd.has_no_data) {
+		for (size_t i = 0; i < count; i++)
+			values[i] = src[i];
+		return;
+	}
+	// NaN is converted to NaN, so this also covers a no_data value of NaN
+	const T no_data = (T) dd.no_data;
+	const double nan = std::numeric_limits<double>::quiet_NaN();
+	for (size_t i = 0; i < count; i++)
+		values[i] = src[i] == no_data ? nan : (double) src[i];
+}
+
+template<typename T>
+static void storeRow(void *data, const DataDescription &dd, size_t offset, size_t count, const double *values) {
+	T *dst = (T *) data + offset;
+	if (!dd.has_no_data && std::numeric_limits<T>::is_integer) {
+		for (size_t i = 0; i < count; i++) {
+			if (std::isnan(values[i]))
+				throw OperatorException("TemporalAggregator: no-data in a result without a no-data value");
+		}
+	}
+	const T no_data = dd.has_no_data ? (T) dd.no_data : std::numeric_limits<T>::quiet_NaN();
+	for (size_t i = 0; i < count; i++)
+		dst[i] = std::isnan(values[i]) ? no_data : (T) values[i];
+}
+
+template<typename T>
+struct getRowLoader {
+	static RowLoader execute(Raster2D<T> *) { return &loadRow<T>; }
+};
+
+template<typename T>
+struct getRowStorer {
+	static RowStorer execute(Raster2D<T> *) { return &storeRow<T>; }
+};
+
+/*
+ * Executes fn(offset, row) for the offset of the first pixel of every row, in bands of rows
+ * distributed on the thread pool. row is a buffer for the values of one row.
+ */
+static void forAllRows(uint32_t width, uint32_t height, const std::function<void(size_t, double *)> &fn) {
+	const size_t BAND_PIXELS = 64 * 1024;
+	size_t band_rows = std::max<size_t>(1, BAND_PIXELS / std::max<uint32_t>(1, width));
+	size_t bands = (height + band_rows - 1) / band_rows;
+	ThreadPool::getDefault().parallelFor(bands, [&](size_t band) {
+		std::vector<double> row(width);
+		size_t end = std::min<size_t>(height, (band + 1) * band_rows);
+		for (size_t y = band * band_rows; y < end; y++)
+			fn(y * width, row.data());
+	});
+}
+
+
+/*
+ * P² quantile estimation: five markers track the minimum, the quantile, the maximum and the
+ * quantiles halfway between. Their heights are adjusted with a piecewise-parabolic
+ * interpolation whenever a marker's position is off from its desired position by one.
+ * A sketch consists of the marker heights followed by their (0-based) positions.
+ */
+static const size_t SKETCH_SIZE = 10;
+
+static double parabolic(const float *q, const float *n, size_t i, double s) {
+	return q[i] + s / (n[i+1] - n[i-1]) * (
+			(n[i] - n[i-1] + s) * (q[i+1] - q[i]) / (n[i+1] - n[i]) +
+			(n[i+1] - n[i] - s) * (q[i] - q[i-1]) / (n[i] - n[i-1]));
+}
+
+static double linear(const float *q, const float *n, size_t i, int s) {
+	return q[i] + s * (q[i+s] - q[i]) / (n[i+s] - n[i]);
+}
+
+// adds a value to a sketch which already holds count values
+static void addToSketch(float *sketch, double value, size_t count, double quantile) {
+	float *q = sketch, *n = sketch + 5;
+	float v = (float) value;
+
+	// the first five values are kept sorted
+	if (count < 5) {
+		size_t i = count;
+		for (; i > 0 && q[i-1] > v; i--)
+			q[i] = q[i-1];
+		q[i] = v;
+		if (count == 4) {
+			for (size_t j = 0; j < 5; j++)
+				n[j] = j;
+		}
+		return;
+	}
+
+	// find the cell of the value, extending the extremes
+	size_t k;
+	if (v < q[0]) {
+		q[0] = v;
+		k = 0;
+	}
+	else if (v >= q[4]) {
+		q[4] = v;
+		k = 3;
+	}
+	else {
+		k = 0;
+		while (v >= q[k+1])
+			k++;
+	}
+	for (size_t i = k+1; i < 5; i++)
+		n[i] += 1;
+
+	double last = count;
+	const double desired[5] = {0, last * quantile / 2, last * quantile, last * (1 + quantile) / 2, last};
+	for (size_t i = 1; i <= 3; i++) {
+		double d = desired[i] - n[i];
+		if ((d >= 1 && n[i+1] - n[i] > 1) || (d <= -1 && n[i-1] - n[i] < -1)) {
+			int s = d > 0 ? 1 : -1;
+			double height = parabolic(q, n, i, s);
+			if (!(q[i-1] < height && height < q[i+1]))
+				height = linear(q, n, i, s);
+			q[i] = (float) height;
+			n[i] += s;
+		}
+	}
+}
+
+static double estimateFromSketch(const float *sketch, size_t count, double quantile) {
+	if (count > 5)
+		return sketch[2];
+	// the sorted values themselves
+	return sketch[(size_t) std::round(quantile * (count - 1))];
+}
+
+
+TemporalAggregator::TemporalAggregator(Type type, double quantile, NoData no_data)
+	: type(type), quantile(quantile), no_data(no_data), rasters(0), width(0), height(0) {
+	if (type == Type::MEDIAN)
+		this->quantile = 0.5;
+	if (!(this->quantile >= 0 && this->quantile <= 1))
+		throw ArgumentException("TemporalAggregator: quantile must be between 0 and 1");
+}
+
+void TemporalAggregator::add(GenericRaster &raster) {
+	if (rasters == 0) {
+		dd = std::make_unique<DataDescription>(raster.dd);
+		width = raster.width;
+		height = raster.height;
+
+		size_t pixels = (size_t) width * height;
+		counts.assign(pixels, 0);
+		switch (type) {
+			case Type::MIN:
+				values.assign(pixels, std::numeric_limits<double>::infinity());
+				break;
+			case Type::MAX:
+				values.assign(pixels, -std::numeric_limits<double>::infinity());
+				break;
+			case Type::STDDEV:
+				values.assign(pixels, 0);
+				m2s.assign(pixels, 0);
+				break;
+			case Type::MEDIAN:
+			case Type::PERCENTILE:
+				sketches.assign(pixels * SKETCH_SIZE, 0);
+				break;
+			default:
+				values.assign(pixels, 0);
+				break;
+		}
+	}
+	else if (raster.width != width || raster.height != height)
+		throw ArgumentException("TemporalAggregator: all rasters must have the same dimensions");
+
+	// loading the first raster as if it had no no-data value aggregates its no-data values as values
+	DataDescription load_dd = raster.dd;
+	if (rasters == 0 && no_data == NoData::FIRST_AS_VALUE && type != Type::COUNT)
+		load_dd.has_no_data = false;
+
+	raster.setRepresentation(GenericRaster::Representation::CPU);
+	auto loader = callUnaryOperatorFunc<getRowLoader>(&raster);
+	const void *data = raster.getData();
+	forAllRows(width, height, [&](size_t offset, double *row) {
+		loader(data, load_dd, offset, width, row);
+		accumulate(row, offset, width);
+	});
+	rasters++;
+}
+
+void TemporalAggregator::accumulate(const double *row, size_t offset, size_t count) {
+	double *c = &counts[offset];
+	switch (type) {
+		case Type::COUNT:
+		case Type::SUM:
+		case Type::AVG:
+			RasterKernels::accumulateSum(&values[offset], c, row, count);
+			break;
+		case Type::MIN:
+			RasterKernels::accumulateMin(&values[offset], c, row, count);
+			break;
+		case Type::MAX:
+			RasterKernels::accumulateMax(&values[offset], c, row, count);
+			break;
+		case Type::STDDEV:
+			RasterKernels::accumulateMoments(&values[offset], &m2s[offset], c, row, count);
+			break;
+		case Type::MEDIAN:
+		case Type::PERCENTILE:
+			for (size_t i = 0; i < count; i++) {
+				if (std::isnan(row[i]))
+					continue;
+				addToSketch(&sketches[(offset + i) * SKETCH_SIZE], row[i], (size_t) c[i], quantile);
+				c[i] += 1;
+			}
+			break;
+	}
+}
+
+void TemporalAggregator::aggregate(double *results, size_t offset, size_t count) const {
+	const double nan = std::numeric_limits<double>::quiet_NaN();
+	for (size_t i = 0; i < count; i++) {
+		size_t pixel = offset + i;
+		double n = counts[pixel];
+		if (type == Type::COUNT) {
+			results[i] = n;
+			continue;
+		}
+		if (n == 0 || (no_data != NoData::IGNORE && n < rasters)) {
+			results[i] = nan;
+			continue;
+		}
+		switch (type) {
+			case Type::AVG:
+				// TODO: solve for non-equi length time validities
+				results[i] = values[pixel] / n;
+				break;
+			case Type::STDDEV:
+				results[i] = std::sqrt(m2s[pixel] / n);
+				break;
+			case Type::MEDIAN:
+			case Type::PERCENTILE:
+				results[i] = estimateFromSketch(&sketches[pixel * SKETCH_SIZE], (size_t) n, quantile);
+				break;
+			default:
+				results[i] = values[pixel];
+				break;
+		}
+	}
+}
+
+std::unique_ptr<GenericRaster> TemporalAggregator::getResult(const SpatioTemporalReference &stref) {
+	if (rasters == 0)
+		throw ArgumentException("TemporalAggregator: no rasters were added");
+
+	DataDescription out_dd = *dd;
+	if (type == Type::COUNT)
+		out_dd = DataDescription(GDT_UInt32, Unit::unknown());
+	else if (type == Type::SUM || type == Type::STDDEV)
+		out_dd = DataDescription(GDT_Float32, Unit::unknown(), true, std::numeric_limits<double>::quiet_NaN());
+
+	auto result = GenericRaster::create(out_dd, stref, width, height, 0, GenericRaster::Representation::CPU);
+	auto storer = callUnaryOperatorFunc<getRowStorer>(result.get());
+	void *data = result->getDataForWriting();
+	forAllRows(width, height, [&](size_t offset, double *row) {
+		aggregate(row, offset, width);
+		storer(data, out_dd, offset, width, row);
+	});
+	return result;
+}
@@ -0,0 +1,87 @@
+#ifndef RASTER_TEMPORAL_AGGREGATION_H
+#define RASTER_TEMPORAL_AGGREGATION_H
+
+#include "datatypes/raster.h"
+
+#include <memory>
+#include <vector>
+
+/**
+ * Aggregates a series of rasters with equal dimensions pixel-wise, one raster at a time,
+ * so only the accumulators have to be kept in memory.
+ *
+ * The accumulators are stored row-major like the rasters. Each added raster is processed
+ * in bands of rows distributed on the thread pool, using the vectorized accumulators of
+ * RasterKernels. Median and percentiles are estimated with a P² sketch of five markers
+ * per pixel (Jain & Chlamtac, 1985); they are exact for up to five values.
+ *
+ * Count, sum and standard deviation are returned as new rasters of type UInt32 resp. Float32,
+ * the other aggregations keep the data description of the first raster.
+ */
+class TemporalAggregator {
+	public:
+		enum class Type {
+			COUNT, SUM, MIN, MAX, AVG, STDDEV, MEDIAN, PERCENTILE
+		};
+
+		/**
+		 * The handling of no-data values. COUNT always counts the valid values.
+		 */
+		enum class NoData {
+			// no-data values of the first raster are aggregated like values, a no-data value in
+			// a later raster makes the pixel no-data. This is how the aggregation always worked.
+			FIRST_AS_VALUE,
+			// a pixel is no-data once it was no-data in any raster
+			PROPAGATE,
+			// no-data values are skipped
+			IGNORE
+		};
+
+		/**
+		 * @param type the aggregation
+		 * @param quantile the quantile estimated by PERCENTILE, in [0, 1]
+		 * @param no_data the handling of no-data values
+		 */
+		TemporalAggregator(Type type, double quantile = 0.5, NoData no_data = NoData::FIRST_AS_VALUE);
+
+		/**
+		 * Adds the next raster of the series
+		 */
+		void add(GenericRaster &raster);
+
+		/**
+		 * @param stref the reference of the result
+		 * @return the aggregate of all rasters added so far
+		 */
+		std::unique_ptr<GenericRaster> getResult(const SpatioTemporalReference &stref);
+
+		/**
+		 * @return the number of rasters added so far
+		 */
+		size_t getRasterCount() const { return rasters; }
+
+	private:
+		// adds the values of the pixels [offset, offset+count), NaN for no-data
+		void accumulate(const double *values, size_t offset, size_t count);
+		// computes the results of the pixels [offset, offset+count), NaN for no-data
+		void aggregate(double *results, size_t offset, size_t count) const;
+
+		Type type;
+		double quantile;
+		NoData no_data;
+
+		size_t rasters;
+		std::unique_ptr<DataDescription> dd;
+		uint32_t width, height;
+
+		// the number of valid values of each pixel
+		std::vector<double> counts;
+		// the sum, minimum, maximum or mean, depending on the type
+		std::vector<double> values;
+		// the sum of squared differences from the mean for STDDEV
+		std::vector<double> m2s;
+		// the heights and positions of the P² markers of each pixel for MEDIAN and PERCENTILE
+		std::vector<float> sketches;
+};
+
+#endif
@@ -65,6 +65,12 @@ class RasterDBBackend {
 		virtual bool hasTile(rasterid_t rasterid, uint32_t width, uint32_t height, uint32_t depth, int offx, int offy, int offz, int zoom) = 0;
 		virtual std::unique_ptr<ByteBuffer> readTile(const TileDescription &tiledesc) = 0;
 
+		/*
+		 * Whether readTile() may be called from several threads at once. If not,
+		 * RasterDB serializes all calls.
+		 */
+		virtual bool supportsConcurrentReads() { return false; }
+
 		bool isOpen() { return is_opened; }
 		bool isWriteable() { return is_writeable; }
 	protected:
@@ -7,6 +7,8 @@
 #include <sys/types.h> // the next three are for posix open()
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <sys/mman.h> // mmap()
+#include <unistd.h>
 
 #include <string>
 
@@ -36,12 +38,17 @@ class LocalRasterDBBackend : public RasterDBBackend {
 		virtual const std::vector<TileDescription> enumerateTiles(int channelid, rasterid_t rasterid, int x1, int y1, int x2, int y2, int zoom = 0);
 		virtual bool hasTile(rasterid_t rasterid, uint32_t width, uint32_t height, uint32_t depth, int offx, int offy, int offz, int zoom);
 		virtual std::unique_ptr<ByteBuffer> readTile(const TileDescription &tiledesc);
+		virtual bool supportsConcurrentReads();
 
 	private:
 		void init();
 		void cleanup();
+		void mapDataFile();
 
 		int lockedfile;
+		bool use_mmap;
+		const char *mapped_data;
+		size_t mapped_size;
 		std::string location;
 		std::string sourcename;
 		std::string filename_json;
@@ -52,7 +59,8 @@ class LocalRasterDBBackend : public RasterDBBackend {
 };
 
 
-LocalRasterDBBackend::LocalRasterDBBackend(const std::string &location, const ConfigurationTable& params) : lockedfile(-1), location(location) {
+LocalRasterDBBackend::LocalRasterDBBackend(const std::string &location, const ConfigurationTable& params)
+	: lockedfile(-1), use_mmap(ConfigurationTable(params).get<bool>("mmap", true)), mapped_data(nullptr), mapped_size(0), location(location) {
 }
 
 LocalRasterDBBackend::~LocalRasterDBBackend() {
@@ -182,10 +190,43 @@ void LocalRasterDBBackend::open(const std::string &_sourcename, bool writeable)
 		db.exec("CREATE UNIQUE INDEX IF NOT EXISTS idx_rik ON attributes (rasterid, isstring, key)");
 	}
 
+	/*
+	 * Step #3: map the data file. Writeable sources append to it, so they keep using read().
+	 */
+	if (use_mmap && !writeable)
+		mapDataFile();
+
 	is_opened = true;
 }
 
+void LocalRasterDBBackend::mapDataFile() {
+	int f = ::open(filename_data.c_str(), O_RDONLY | O_CLOEXEC);
+	if (f < 0)
+		return; // no tiles yet
+
+	struct stat st;
+	if (fstat(f, &st) != 0 || st.st_size <= 0) {
+		close(f);
+		return;
+	}
+
+	// The shared lock on the .json file guarantees that no writer appends while we are open
+	void *addr = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_SHARED, f, 0);
+	close(f);
+	if (addr == MAP_FAILED) {
+		fprintf(stderr, "Unable to mmap() %s, falling back to read()\n", filename_data.c_str());
+		return;
+	}
+	mapped_data = (const char *) addr;
+	mapped_size = (size_t) st.st_size;
+}
+
 void LocalRasterDBBackend::cleanup() {
+	if (mapped_data) {
+		munmap((void *) mapped_data, mapped_size);
+		mapped_data = nullptr;
+		mapped_size = 0;
+	}
 	if (lockedfile != -1) {
 		close(lockedfile); // also removes the lock acquired by flock()
 		lockedfile = -1;
@@ -467,6 +508,18 @@ std::unique_ptr<ByteBuffer> LocalRasterDBBackend::readTile(const TileDescription
 	if (!this->is_opened)
 		throw ArgumentException("Cannot call readTile() before open() on a RasterDBBackend");
 
+	// Tiles are handed out as views into the mapping, which lives as long as this backend
+	if (mapped_data && tiledesc.offset + tiledesc.size <= mapped_size) {
+		const char *tile = mapped_data + tiledesc.offset;
+
+		// Ask the kernel to fault in the tile's pages ahead of decoding
+		const uintptr_t pagesize = (uintptr_t) sysconf(_SC_PAGESIZE);
+		uintptr_t start = (uintptr_t) tile & ~(pagesize - 1);
+		madvise((void *) start, (uintptr_t) tile + tiledesc.size - start, MADV_WILLNEED);
+
+		return ByteBuffer::view(tile, tiledesc.size);
+	}
+
 #define USE_POSIX_IO true
 #if USE_POSIX_IO
 	int f = ::open(filename_data.c_str(), O_RDONLY | O_CLOEXEC); // | O_NOATIME
@@ -504,5 +557,10 @@ std::unique_ptr<ByteBuffer> LocalRasterDBBackend::readTile(const TileDescription
 	return buffer;
 }
 
+bool LocalRasterDBBackend::supportsConcurrentReads() {
+	// readTile() either returns a view into the read-only mapping or opens its own file descriptor
+	return true;
+}
+
 
 REGISTER_RASTERDB_BACKEND(LocalRasterDBBackend, "local");
@@ -4,6 +4,8 @@
 
 #include <memory>
 #include <unordered_map>
+#include <string>
+#include <stdexcept>
 
 /**
  * Converter Registration
@@ -37,8 +39,28 @@ std::unique_ptr<GenericRaster> RasterConverter::direct_decode(ByteBuffer &buffer
 
 std::unique_ptr<RasterConverter> RasterConverter::getConverter(const std::string &method) {
 	auto map = getRegisteredConstructorsMap();
-	if (map->count(method) != 1)
+	auto pos = method.find(':');
+	auto name = method.substr(0, pos);
+	if (map->count(name) != 1)
 		throw ConverterException(concat("Unknown compression method ", method));
-	auto constructor = map->at(method);
-	return constructor();
+	auto constructor = map->at(name);
+	auto converter = constructor();
+	if (pos != std::string::npos) {
+		int level;
+		try {
+			size_t parsed = 0;
+			level = std::stoi(method.substr(pos+1), &parsed);
+			if (parsed != method.size() - pos - 1)
+				throw std::invalid_argument("trailing characters");
+		}
+		catch (const std::exception &) {
+			throw ConverterException(concat("Invalid compression level in method ", method));
+		}
+		converter->setLevel(level);
+	}
+	return converter;
+}
+
+void RasterConverter::setLevel(int) {
+	throw ConverterException("This compression method does not support compression levels");
 }
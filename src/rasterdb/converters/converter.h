@@ -6,13 +6,25 @@
 
 class ByteBuffer {
 	public:
-		ByteBuffer(char *data, size_t size) : data(data), size(size) {};
-		ByteBuffer(size_t size) : data(nullptr), size(size) { data = new char[size]; }
-		~ByteBuffer() { delete [] data; data = nullptr; size = 0; };
+		ByteBuffer(char *data, size_t size) : data(data), size(size), owns_data(true) {};
+		ByteBuffer(size_t size) : data(nullptr), size(size), owns_data(true) { data = new char[size]; }
+		~ByteBuffer() { if (owns_data) delete [] data; data = nullptr; size = 0; };
+
+		/*
+		 * Creates a buffer referencing memory owned by someone else, e.g. a memory mapped file.
+		 * The memory must outlive the buffer and must not be written to.
+		 */
+		static std::unique_ptr<ByteBuffer> view(const char *data, size_t size) {
+			auto buffer = std::make_unique<ByteBuffer>(const_cast<char *>(data), size);
+			buffer->owns_data = false;
+			return buffer;
+		}
+
 		char *data;
 		size_t size;
 	private:
 		void operator=(ByteBuffer &);
+		bool owns_data;
 };
 
 
@@ -26,8 +38,14 @@ class RasterConverter {
 		static std::unique_ptr<ByteBuffer> direct_encode(GenericRaster *raster, const std::string &method);
 		static std::unique_ptr<GenericRaster> direct_decode(ByteBuffer &buffer, const DataDescription &datadescription, const SpatioTemporalReference &stref, uint32_t width, uint32_t height, uint32_t depth, const std::string &method);
 
+		/*
+		 * Returns the converter for the given method. Methods supporting compression levels
+		 * accept them as a suffix, e.g. "ZSTD:19". The level only affects encoding.
+		 */
 		static std::unique_ptr<RasterConverter> getConverter(const std::string &method);
 
+		virtual void setLevel(int level);
+
 		virtual std::unique_ptr<ByteBuffer> encode(GenericRaster *raster) = 0;
 		virtual std::unique_ptr<GenericRaster> decode(ByteBuffer &buffer, const DataDescription &datadescription, const SpatioTemporalReference &stref, uint32_t width, uint32_t height, uint32_t depth) = 0;
 };
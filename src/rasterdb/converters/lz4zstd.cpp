@@ -0,0 +1,220 @@
+#include "rasterdb/converters/converter.h"
+#include "util/exceptions.h"
+#include "util/concat.h"
+
+#include <memory>
+#include <cstring>
+#include <type_traits>
+#include <lz4.h>
+#include <lz4hc.h>
+#include <zstd.h>
+
+#ifndef LZ4HC_CLEVEL_MAX // not defined by older releases
+#define LZ4HC_CLEVEL_MAX 12
+#endif
+
+
+/*
+ * Horizontal delta predictor: every pixel except the first of each row is replaced by the
+ * difference to its left neighbour. Smooth integer rasters turn into long runs of small
+ * values, which compress considerably better. The arithmetic wraps, so the filter is lossless.
+ */
+template<typename T>
+static void deltaEncode(char *data, size_t size, uint32_t width) {
+	typedef typename std::make_unsigned<T>::type U;
+	U *values = (U *) data;
+	size_t rows = size / (sizeof(U) * width);
+	for (size_t r = 0; r < rows; r++) {
+		U *row = values + r * width;
+		for (uint32_t x = width - 1; x > 0; x--)
+			row[x] = (U) (row[x] - row[x-1]);
+	}
+}
+
+template<typename T>
+static void deltaDecode(char *data, size_t size, uint32_t width) {
+	typedef typename std::make_unsigned<T>::type U;
+	U *values = (U *) data;
+	size_t rows = size / (sizeof(U) * width);
+	for (size_t r = 0; r < rows; r++) {
+		U *row = values + r * width;
+		for (uint32_t x = 1; x < width; x++)
+			row[x] = (U) (row[x] + row[x-1]);
+	}
+}
+
+/*
+ * Applies the predictor (or its inverse) to the given data. Floating point rasters are left
+ * untouched, their differences are not any more compressible than the values themselves.
+ * @return whether the data has been modified
+ */
+static bool applyDelta(GDALDataType datatype, char *data, size_t size, uint32_t width, bool inverse) {
+	if (width < 2)
+		return false;
+	switch (datatype) {
+		case GDT_Byte:
+			inverse ? deltaDecode<uint8_t>(data, size, width) : deltaEncode<uint8_t>(data, size, width);
+			return true;
+		case GDT_Int16:
+		case GDT_UInt16:
+			inverse ? deltaDecode<uint16_t>(data, size, width) : deltaEncode<uint16_t>(data, size, width);
+			return true;
+		case GDT_Int32:
+		case GDT_UInt32:
+			inverse ? deltaDecode<uint32_t>(data, size, width) : deltaEncode<uint32_t>(data, size, width);
+			return true;
+		default:
+			return false;
+	}
+}
+
+
+/**
+ * BlockConverter: common base of the block codecs below, handles the optional predictor
+ */
+class BlockConverter : public RasterConverter {
+	public:
+		BlockConverter(bool delta) : delta(delta) {};
+		virtual std::unique_ptr<ByteBuffer> encode(GenericRaster *raster);
+		virtual std::unique_ptr<GenericRaster> decode(ByteBuffer &buffer, const DataDescription &datadescription, const SpatioTemporalReference &stref, uint32_t width, uint32_t height, uint32_t depth);
+	protected:
+		virtual size_t bound(size_t raw_size) = 0;
+		// returns the compressed size
+		virtual size_t compress(const char *src, size_t src_size, char *dst, size_t dst_capacity) = 0;
+		// must fill dst completely or throw
+		virtual void decompress(const char *src, size_t src_size, char *dst, size_t dst_size) = 0;
+	private:
+		bool delta;
+};
+
+std::unique_ptr<ByteBuffer> BlockConverter::encode(GenericRaster *raster) {
+	size_t raw_size = raster->getDataSize();
+	const char *src = (const char *) raster->getData();
+
+	std::unique_ptr<char []> filtered;
+	if (delta) {
+		filtered.reset(new char[raw_size]);
+		memcpy(filtered.get(), src, raw_size);
+		if (applyDelta(raster->dd.datatype, filtered.get(), raw_size, raster->width, false))
+			src = filtered.get();
+	}
+
+	size_t capacity = bound(raw_size);
+	std::unique_ptr<char []> compressed(new char[capacity]);
+	size_t compressed_size = compress(src, raw_size, compressed.get(), capacity);
+
+	return std::make_unique<ByteBuffer>(compressed.release(), compressed_size);
+}
+
+std::unique_ptr<GenericRaster> BlockConverter::decode(ByteBuffer &buffer, const DataDescription &datadescription, const SpatioTemporalReference &stref, uint32_t width, uint32_t height, uint32_t depth) {
+	auto raster = GenericRaster::create(datadescription, stref, width, height, depth);
+
+	char *data = (char *) raster->getDataForWriting();
+	size_t size = raster->getDataSize();
+	decompress(buffer.data, buffer.size, data, size);
+
+	if (delta)
+		applyDelta(datadescription.datatype, data, size, width, true);
+
+	return raster;
+}
+
+
+/**
+ * Lz4Converter: LZ4 block format. Level 0 is the default fast mode, negative levels trade ratio
+ * for speed, positive levels select the slower LZ4HC encoder. Decoding speed does not depend on the level.
+ */
+class Lz4Converter : public BlockConverter {
+	public:
+		Lz4Converter(bool delta = false) : BlockConverter(delta), level(0) {};
+		virtual void setLevel(int level);
+	protected:
+		virtual size_t bound(size_t raw_size);
+		virtual size_t compress(const char *src, size_t src_size, char *dst, size_t dst_capacity);
+		virtual void decompress(const char *src, size_t src_size, char *dst, size_t dst_size);
+	private:
+		int level;
+};
+REGISTER_RASTERCONVERTER(Lz4Converter, "LZ4");
+
+class Lz4DeltaConverter : public Lz4Converter {
+	public:
+		Lz4DeltaConverter() : Lz4Converter(true) {};
+};
+REGISTER_RASTERCONVERTER(Lz4DeltaConverter, "LZ4_DELTA");
+
+void Lz4Converter::setLevel(int level) {
+	if (level > LZ4HC_CLEVEL_MAX)
+		throw ConverterException(concat("LZ4 compression level must not exceed ", LZ4HC_CLEVEL_MAX));
+	this->level = level;
+}
+
+size_t Lz4Converter::bound(size_t raw_size) {
+	if (raw_size > LZ4_MAX_INPUT_SIZE)
+		throw ConverterException("Raster too large for LZ4 compression");
+	return LZ4_compressBound((int) raw_size);
+}
+
+size_t Lz4Converter::compress(const char *src, size_t src_size, char *dst, size_t dst_capacity) {
+	int res;
+	if (level > 0)
+		res = LZ4_compress_HC(src, dst, (int) src_size, (int) dst_capacity, level);
+	else
+		res = LZ4_compress_fast(src, dst, (int) src_size, (int) dst_capacity, 1 - level);
+	if (res <= 0)
+		throw ConverterException("Error on LZ4 compress");
+	return res;
+}
+
+void Lz4Converter::decompress(const char *src, size_t src_size, char *dst, size_t dst_size) {
+	int res = LZ4_decompress_safe(src, dst, (int) src_size, (int) dst_size);
+	if (res < 0 || (size_t) res != dst_size)
+		throw SourceException("Error on LZ4 decompress");
+}
+
+
+/**
+ * ZstdConverter: Zstandard frame format. The default level is 3, higher levels compress better at
+ * the expense of encoding speed only.
+ */
+class ZstdConverter : public BlockConverter {
+	public:
+		ZstdConverter(bool delta = false) : BlockConverter(delta), level(3) {};
+		virtual void setLevel(int level);
+	protected:
+		virtual size_t bound(size_t raw_size);
+		virtual size_t compress(const char *src, size_t src_size, char *dst, size_t dst_capacity);
+		virtual void decompress(const char *src, size_t src_size, char *dst, size_t dst_size);
+	private:
+		int level;
+};
+REGISTER_RASTERCONVERTER(ZstdConverter, "ZSTD");
+
+class ZstdDeltaConverter : public ZstdConverter {
+	public:
+		ZstdDeltaConverter() : ZstdConverter(true) {};
+};
+REGISTER_RASTERCONVERTER(ZstdDeltaConverter, "ZSTD_DELTA");
+
+void ZstdConverter::setLevel(int level) {
+	if (level < 1 || level > ZSTD_maxCLevel())
+		throw ConverterException(concat("ZSTD compression level must be between 1 and ", ZSTD_maxCLevel()));
+	this->level = level;
+}
+
+size_t ZstdConverter::bound(size_t raw_size) {
+	return ZSTD_compressBound(raw_size);
+}
+
+size_t ZstdConverter::compress(const char *src, size_t src_size, char *dst, size_t dst_capacity) {
+	size_t res = ZSTD_compress(dst, dst_capacity, src, src_size, level);
+	if (ZSTD_isError(res))
+		throw ConverterException(concat("Error on ZSTD compress: ", ZSTD_getErrorName(res)));
+	return res;
+}
+
+void ZstdConverter::decompress(const char *src, size_t src_size, char *dst, size_t dst_size) {
+	size_t res = ZSTD_decompress(dst, dst_size, src, src_size);
+	if (ZSTD_isError(res) || res != dst_size)
+		throw SourceException("Error on ZSTD decompress");
+}
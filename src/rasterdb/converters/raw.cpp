@@ -46,6 +46,9 @@ std::unique_ptr<ByteBuffer> RawConverter::encode(GenericRaster *raster) {
 
 std::unique_ptr<GenericRaster> RawConverter::decode(ByteBuffer &buffer, const DataDescription &datadescription, const SpatioTemporalReference &stref, uint32_t width, uint32_t height, uint32_t depth) {
 	auto raster = GenericRaster::create(datadescription, stref, width, height, depth);
+	if (buffer.size != raster->getDataSize())
+		throw SourceException("Raw tile does not match the size of the raster");
+	// If the buffer is a view into a mapped data file, this is the only copy the tile's pixels go through
 	memcpy(raster->getDataForWriting(), buffer.data, buffer.size);
 	return raster;
 }
@@ -6,6 +6,7 @@
 #include "converters/converter.h"
 #include "util/sqlite.h"
 #include "util/configuration.h"
+#include "util/threadpool.h"
 #include "operators/operator.h"
 
 
@@ -160,7 +161,7 @@ std::unique_ptr<RasterDBBackend> instantiate_backend() {
 
 
 RasterDB::RasterDB(const char *sourcename, bool writeable)
-	: writeable(writeable), crs(nullptr), channelcount(0), channels(nullptr) {
+	: writeable(writeable), parallel_load(Configuration::get<bool>("rasterdb.parallelload", true)), crs(nullptr), channelcount(0), channels(nullptr) {
 	try {
 		backend = instantiate_backend();
 		backend->open(sourcename, writeable);
@@ -444,6 +445,9 @@ std::unique_ptr<GenericRaster> RasterDB::load(int channelid, const TemporalRefer
 	if (t.timetype != TIMETYPE_UNIX)
 		throw SourceException("RasterDB::load() with timetype != UNIX");
 
+	// The lock only protects the metadata lookups, tiles are read and decoded without holding it
+	std::unique_lock<std::mutex> lock(mutex);
+
 	auto rasterdescription = backend->getClosestRaster(channelid, t.t1, t.t2);
 	auto rasterid = rasterdescription.rasterid;
 	auto loaded_zoom = backend->getBestZoom(rasterid, zoom);
@@ -492,25 +496,57 @@ std::unique_ptr<GenericRaster> RasterDB::load(int channelid, const TemporalRefer
 
 	// Load all overlapping parts and blit them onto the empty raster
 	auto tiles = backend->enumerateTiles(channelid, rasterid, x1, y1, x2, y2, loaded_zoom);
+	const bool concurrent_reads = backend->supportsConcurrentReads();
+	lock.unlock();
 
 	// If no tiles were found, that's ok. return a raster filled with nodata.
 	//if (tiles.size() <= 0)
 	//	throw SourceException("RasterDB::load(): No matching tiles found in DB");
 
-	for (auto &tile : tiles) {
-		auto tile_buffer = backend->readTile(tile);
-
-		auto tile_raster = RasterConverter::direct_decode(*tile_buffer, channels[channelid]->dd, SpatioTemporalReference::unreferenced(), tile.width, tile.height, tile.depth, tile.compression);
-		if (io_cost)
+	if (io_cost) {
+		for (auto &tile : tiles)
 			*io_cost += tile.size;
+	}
+
+	// Read, decode and downscale each tile. Tiles are independent of each other, so this may happen concurrently.
+	const DataDescription &tile_dd = channels[channelid]->dd;
+	std::vector<std::unique_ptr<GenericRaster>> tile_rasters(tiles.size());
+	auto load_tile = [&](size_t i) {
+		auto &tile = tiles[i];
+		std::unique_ptr<ByteBuffer> tile_buffer;
+		if (concurrent_reads)
+			tile_buffer = backend->readTile(tile);
+		else {
+			std::lock_guard<std::mutex> guard(mutex);
+			tile_buffer = backend->readTile(tile);
+		}
+
+		auto tile_raster = RasterConverter::direct_decode(*tile_buffer, tile_dd, SpatioTemporalReference::unreferenced(), tile.width, tile.height, tile.depth, tile.compression);
+		tile_buffer.reset();
 
 		if (loaded_zoom != returned_zoom) {
 			auto new_width = tile_raster->width >> (returned_zoom - loaded_zoom);
 			auto new_height = tile_raster->height >> (returned_zoom - loaded_zoom);
 			if (new_width <= 0 || new_height <= 0)
-				continue;
+				return;
 			tile_raster = tile_raster->scale(new_width, new_height);
 		}
+		tile_rasters[i] = std::move(tile_raster);
+	};
+
+	if (parallel_load && tiles.size() > 1)
+		ThreadPool::getDefault().parallelFor(tiles.size(), load_tile);
+	else {
+		for (size_t i = 0; i < tiles.size(); i++)
+			load_tile(i);
+	}
+
+	// Blit in the order returned by the backend, so overlapping tiles behave as before
+	for (size_t i = 0; i < tiles.size(); i++) {
+		auto &tile = tiles[i];
+		auto &tile_raster = tile_rasters[i];
+		if (!tile_raster)
+			continue;
 
 		int64_t blit_dest_x = ((int64_t) tile.x1-x1) >> returned_zoom;
 		int64_t blit_dest_y = ((int64_t) tile.y1-y1) >> returned_zoom;
@@ -524,6 +560,7 @@ std::unique_ptr<GenericRaster> RasterDB::load(int channelid, const TemporalRefer
 		}
 		else
 			result->blit(tile_raster.get(), blit_dest_x, blit_dest_y, blit_dest_z);
+		tile_raster.reset();
 	}
 
 	if (flipx || flipy) {
@@ -554,8 +591,6 @@ std::unique_ptr<GenericRaster> RasterDB::query(const QueryRectangle &rect, Query
 	if (crs->crsId != rect.crsId)
 		throw OperatorException(concat("SourceOperator: wrong crsId requested. Source is ", crs->crsId.to_string(), ", requested ", rect.crsId.to_string()));
 
-	std::lock_guard<std::mutex> guard(mutex);
-
 	// Get all pixel coordinates that need to be returned. The endpoints of the QueryRectangle are inclusive.
 	// floor() returns the index of the pixel containing our boundary points.
 	int px1 = std::floor(crs->WorldToPixelX(rect.x1));
@@ -114,6 +114,7 @@ class RasterDB {
 		void cleanup();
 
 		bool writeable;
+		bool parallel_load;
 		std::unique_ptr<RasterDBBackend> backend;
 		GDALCRS *crs;
 		int channelcount;
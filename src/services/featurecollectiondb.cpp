@@ -125,7 +125,7 @@ void FeatureCollectionDBService::run() {
 
 		std::string type = params.get("type", "");
 
-		Query query(queryString, featureTypeConverter.from_string(type), rect);
+		Query query(queryString, featureTypeConverter.from_string(type), rect, Query::Priority::BULK);
 		auto result = processQuery(query, session);
 
 		FeatureCollectionDB::DataSetMetaData metaData;
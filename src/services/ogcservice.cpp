@@ -147,7 +147,7 @@ void OGCService::outputSimpleFeatureCollectionGeoJSON(SimpleFeatureCollection *c
 	response.sendDebugHeader();
 	response.sendContentType("application/json");
 	response.finishHeaders();
-	response << collection->toGeoJSON(displayMetadata);
+	collection->toGeoJSON(response, displayMetadata);
 }
 
 void OGCService::outputSimpleFeatureCollectionCSV(SimpleFeatureCollection *collection) {
@@ -155,7 +155,7 @@ void OGCService::outputSimpleFeatureCollectionCSV(SimpleFeatureCollection *colle
 	response.sendContentType("text/csv");
 	response.sendHeader("Content-Disposition", "attachment; filename=\"export.csv\"");
 	response.finishHeaders();
-	response << collection->toCSV();
+	collection->toCSV(response);
 }
 
 void OGCService::outputSimpleFeatureCollectionARFF(SimpleFeatureCollection* collection){
@@ -131,38 +131,57 @@ void WCSService::run() {
 			QueryResolution::pixels(sizeX, sizeY)
 		);
 
-		Query query(params.get("coverageid"), Query::ResultType::RASTER, query_rect);
+		// coverages are downloads rather than map views
+		Query query(params.get("coverageid"), Query::ResultType::RASTER, query_rect, Query::Priority::BULK);
 		auto result = processQuery(query, session);
 		auto result_raster = result->getRaster(GenericOperator::RasterQM::EXACT);
 
 		// TODO: check permissions
 
 		auto format = params.get("format", "image/tiff");
-		fprintf(stderr,format.c_str());
 		bool exportMode = false;
 		if(format.find(EXPORT_MIME_PREFIX) == 0) {
 			exportMode = true;
 			format = format.substr(strlen(EXPORT_MIME_PREFIX));
 		}
 
-		GByte* outDataBuffer;
-		vsi_l_offset length;
-		std::string gdalFileName;
-		if(format == "image/tiff") {
-			//setup the output parameters
-			std::string gdalDriver = "GTiff";
-			std::string gdalPrefix = "/vsimem/";
-			gdalFileName = "test.tif";
-			std::string gdalOutFileName = gdalPrefix+gdalFileName;
+		if(format != "image/tiff")
+			throw ArgumentException("WCSService: unknown format");
+		std::string gdalFileName = "test.tif";
+
+		// Stream an uncompressed GeoTIFF while it is written, instead of compressing the whole file in memory first.
+		// The response has no Content-Length, so the web server sends it with chunked transfer encoding.
+		// Exports are zipped in memory and other CRS are only known to GDAL, so these take the regular path.
+		// The GeoTIFF header is validated before the HTTP headers are sent, rasters it cannot describe
+		// take the regular path, too, instead of failing after the response has started.
+		bool streaming = !exportMode && query_crsId.authority == "EPSG" && Configuration::get<bool>("wcs.streaming", false);
+		std::string header;
+		if(streaming) {
+			try {
+				header = createGeoTIFFHeader(*result_raster, result_raster->dd);
+			} catch (const ExporterException &) {
+				streaming = false;
+			}
+		}
+		if(streaming) {
+			response.sendContentType("image/tiff");
+			response.sendHeader("Content-Disposition", concat("attachment; filename=\"",gdalFileName,"\""));
+			response.finishHeaders();
+			result_raster->toGeoTIFF(response, false, false, &header);
+			return;
+		}
 
-			//write the raster into a GDAL file
-			result_raster->toGDAL(gdalOutFileName.c_str(), gdalDriver.c_str());
+		//setup the output parameters
+		std::string gdalDriver = "GTiff";
+		std::string gdalPrefix = "/vsimem/";
+		std::string gdalOutFileName = gdalPrefix+gdalFileName;
 
-			//get the bytearray (buffer) and its size
+		//write the raster into a GDAL file
+		result_raster->toGDAL(gdalOutFileName.c_str(), gdalDriver.c_str());
 
-			outDataBuffer = VSIGetMemFileBuffer(gdalOutFileName.c_str(), &length, true);
-		} else
-			throw ArgumentException("WCSService: unknown format");
+		//get the bytearray (buffer) and its size
+		vsi_l_offset length;
+		GByte* outDataBuffer = VSIGetMemFileBuffer(gdalOutFileName.c_str(), &length, true);
 
 		if(exportMode) {
 			exportZip(params.get("coverageid"), reinterpret_cast<char*>(outDataBuffer), static_cast<size_t>(length), format, result->getProvenance());
@@ -3,7 +3,7 @@
 #include "datatypes/linecollection.h"
 #include "datatypes/polygoncollection.h"
 #include "processing/queryprocessor.h"
-#include "pointvisualization/CircleClusteringQuadTree.h"
+#include "pointvisualization/FlatCircleClustering.h"
 #include "util/timeparser.h"
 #include "util/enumconverter.h"
 
@@ -14,7 +14,6 @@
 #include <json/json.h>
 #include <utility>
 #include <vector>
-#include <pointvisualization/Grid.h>
 
 enum class WFSServiceType {
 	GetCapabilities, GetFeature
@@ -165,20 +164,20 @@ void WFSService::getFeature() {
 		format = format.substr(strlen(EXPORT_MIME_PREFIX));
 	}
 
-	std::string output;
-	if (format == "application/json")
-		output = features->toGeoJSON(true);
-	else if (format == "csv")
-		output = features->toCSV();
-	else
+	if (format != "application/json" && format != "csv")
 		throw ArgumentException("WFSService: unknown output format");
 
 	if(exportMode) {
+		std::string output = format == "application/json" ? features->toGeoJSON(true) : features->toCSV();
 		exportZip(operatorgraph, output.c_str(), output.length(), format, result->getProvenance());
 	} else {
+		// features are written as they are serialized, the web server sends them with chunked transfer encoding
 		response.sendContentType(format + "; charset=utf-8");
 		response.finishHeaders();
-		response << output;
+		if (format == "application/json")
+			features->toGeoJSON(response, true);
+		else
+			features->toCSV(response);
 	}
 	// VSPs
 	// O
@@ -254,55 +253,44 @@ std::unique_ptr<PointCollection> WFSService::clusterPoints(const PointCollection
             common_attributes.getEpsilonDistance()
     );
 
-	// initialize empty grid and tree
-	pv::Grid grid(bounding_box, x1, y1, common_attributes);
-    std::size_t node_capacity = 1;
-    pv::CircleClusteringQuadTree clustering_tree{bounding_box, node_capacity};
-
-    // add coordinate by coordinate
+    // initialize the clustering, which works like a pv::Grid followed by a pv::CircleClusteringQuadTree
     std::vector<std::string> text_keys = points.feature_attributes.getTextualKeys();
     std::vector<std::string> numeric_keys = points.feature_attributes.getNumericKeys();
-    for (const auto& point: points) {
-        Coordinate mapping_coordinate = points.coordinates.at(static_cast<std::size_t>(point));
-        pv::Coordinate coordinate{mapping_coordinate.x / resolution, mapping_coordinate.y / resolution};
-
-        // add text attributes
-        std::map<std::string, pv::Circle::TextAttribute> text_attributes;
-        for (const auto& key : text_keys) {
-            text_attributes.insert(
-                std::make_pair(
-                    key,
-                    pv::Circle::TextAttribute{
-                        points.feature_attributes.textual(key).get(point),
-                        coordinate,
-                        common_attributes
-                    }
-                )
-            );
+    std::size_t node_capacity = 1;
+    pv::FlatCircleClustering clustering{
+            bounding_box, x1, y1,
+            common_attributes.getCircleMinRadius(), common_attributes.getEpsilonDistance(),
+            numeric_keys.size(), text_keys.size(), node_capacity
+    };
+
+    // look up the attribute values attribute by attribute
+    std::size_t feature_count = points.getFeatureCount();
+    std::vector<uint32_t> text_values(feature_count * text_keys.size());
+    for (std::size_t i = 0; i < text_keys.size(); ++i) {
+        const auto &values = points.feature_attributes.textual(text_keys[i]);
+        for (std::size_t point = 0; point < feature_count; ++point) {
+            text_values[point * text_keys.size() + i] = clustering.getTextKey(values.get(point));
         }
-
-        // add numeric attributes
-        std::map<std::string, pv::Circle::NumericAttribute> numeric_attributes;
-        for (const auto& key : numeric_keys) {
-            numeric_attributes.insert(
-                std::make_pair(
-                    key,
-                    pv::Circle::NumericAttribute{points.feature_attributes.numeric(key).get(point)}
-                )
-            );
+    }
+    std::vector<double> numeric_values(feature_count * numeric_keys.size());
+    for (std::size_t i = 0; i < numeric_keys.size(); ++i) {
+        const auto &values = points.feature_attributes.numeric(numeric_keys[i]);
+        for (std::size_t point = 0; point < feature_count; ++point) {
+            numeric_values[point * numeric_keys.size() + i] = values.get(point);
         }
+    }
 
-        grid.insert(
-            std::make_shared<pv::Circle>(
-                coordinate,
-                common_attributes,
-                text_attributes,
-                numeric_attributes
-            )
+    // add coordinate by coordinate
+    for (const auto& point: points) {
+        std::size_t index = static_cast<std::size_t>(point);
+        Coordinate mapping_coordinate = points.coordinates.at(index);
+        clustering.insert(
+            mapping_coordinate.x / resolution, mapping_coordinate.y / resolution,
+            numeric_values.data() + index * numeric_keys.size(), text_values.data() + index * text_keys.size()
         );
     }
 
-    grid.insert_into(clustering_tree);
+    clustering.cluster();
 
 	// PROPERTYNAME
 	// O
@@ -312,13 +300,13 @@ std::unique_ptr<PointCollection> WFSService::clusterPoints(const PointCollection
 	// TYPENAMES=ns1:F1,ns1:F1&ALIASES=C,D&FILTER=<Filter>…for C,D…</Filter>
 
     // output circles
-	auto circles = clustering_tree.getCircles();
+	std::size_t circle_count = clustering.getCircleCount();
 
     // initialize map specific data
 	auto &attr_radius = clusteredPoints->feature_attributes.addNumericAttribute("___radius", Unit::unknown());
 	auto &attr_number = clusteredPoints->feature_attributes.addNumericAttribute("___numberOfPoints", Unit::unknown());
-	attr_radius.reserve(circles.size());
-	attr_number.reserve(circles.size());
+	attr_radius.reserve(circle_count);
+	attr_number.reserve(circle_count);
 
     // initialize textual attributes
     for (const auto& key: text_keys) {
@@ -330,33 +318,33 @@ std::unique_ptr<PointCollection> WFSService::clusterPoints(const PointCollection
         clusteredPoints->feature_attributes.addTextualAttribute(key, points.feature_attributes.numeric(key).unit);
     }
 
-	for (const auto& circle : circles) {
+	for (std::size_t circle = 0; circle < circle_count; ++circle) {
         // add feature to point collection
 		size_t idx = clusteredPoints->addSinglePointFeature(
-            Coordinate(circle->getX() * resolution, circle->getY() * resolution)
+            Coordinate(clustering.getX(circle) * resolution, clustering.getY(circle) * resolution)
         );
 
         // set circle map specific data
-		attr_radius.set(idx, circle->getRadius());
-		attr_number.set(idx, circle->getNumberOfPoints());
+		attr_radius.set(idx, clustering.getRadius(circle));
+		attr_number.set(idx, clustering.getNumberOfPoints(circle));
 
         // add textual attributes
-        for (const auto& text_attribute_entry : circle->getTextAttributes()) {
-            std::vector<std::string> texts = text_attribute_entry.second.getTexts();
+        for (std::size_t i = 0; i < text_keys.size(); ++i) {
+            std::vector<std::string> texts = clustering.getTexts(circle, i);
             std::string texts_concat;
-            for (const auto &text : text_attribute_entry.second.getTexts()) {
+            for (const auto &text : texts) {
                 texts_concat += text + ", ";
             }
-            clusteredPoints->feature_attributes.textual(text_attribute_entry.first).set(
+            clusteredPoints->feature_attributes.textual(text_keys[i]).set(
                 idx,
                 texts.size() >= 5 ? texts_concat + "…" : texts_concat.substr(0, texts_concat.size() - 2)
             );
         }
 
         // add numeric attributes as text attributes for output
-        for (const auto& numeric_attribute_entry : circle->getNumericAttributes()) {
-            double average = numeric_attribute_entry.second.getAverage();
-            double variance = numeric_attribute_entry.second.getVariance();
+        for (std::size_t i = 0; i < numeric_keys.size(); ++i) {
+            double average = clustering.getAverage(circle, i);
+            double variance = clustering.getVariance(circle, i);
 
             std::stringstream output_stream;
 
@@ -368,7 +356,7 @@ std::unique_ptr<PointCollection> WFSService::clusterPoints(const PointCollection
                 }
             }
 
-            clusteredPoints->feature_attributes.textual(numeric_attribute_entry.first).set(idx, output_stream.str());
+            clusteredPoints->feature_attributes.textual(numeric_keys[i]).set(idx, output_stream.str());
         }
 	}
 
@@ -0,0 +1,93 @@
+#include "util/binary_cache.h"
+#include "util/sha1.h"
+#include "util/log.h"
+#include "util/concat.h"
+
+#include <fstream>
+#include <iterator>
+#include <boost/filesystem.hpp>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+BinaryCache::BinaryCache(const std::string &directory) : directory(directory) {
+}
+
+std::string BinaryCache::getFilename(const std::vector<std::string> &key) const {
+	if (directory == "")
+		return "";
+
+	// every part is prefixed with its length, so different keys never hash the same bytes
+	SHA1 sha1;
+	for (auto &part : key) {
+		sha1.addBytes(concat(part.size(), ":"));
+		sha1.addBytes(part);
+	}
+	return (boost::filesystem::path(directory) / (sha1.digest().asHex() + ".bin")).string();
+}
+
+// whether the file is owned by the current user and not writable by others
+static bool isPrivate(const std::string &path, const struct stat &st) {
+	if (st.st_uid != geteuid() || (st.st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+		Log::warn(concat("BinaryCache: ignoring ", path, ", it is not owned by the current user or writable by others"));
+		return false;
+	}
+	return true;
+}
+
+bool BinaryCache::isTrusted() const {
+	if (directory == "")
+		return false;
+	if (!boost::filesystem::path(directory).is_absolute()) {
+		Log::warn(concat("BinaryCache: ignoring ", directory, ", it is not an absolute path"));
+		return false;
+	}
+	struct stat st;
+	if (stat(directory.c_str(), &st) != 0)
+		return true; // created by store()
+	return isPrivate(directory, st);
+}
+
+bool BinaryCache::load(const std::vector<std::string> &key, std::vector<char> &binary) const {
+	if (!isTrusted())
+		return false;
+	auto filename = getFilename(key);
+	struct stat st;
+	if (stat(filename.c_str(), &st) != 0 || !isPrivate(filename, st))
+		return false;
+
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+		return false;
+	binary.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return !binary.empty();
+}
+
+bool BinaryCache::store(const std::vector<std::string> &key, const char *data, size_t size) const {
+	if (!isTrusted())
+		return false;
+	auto filename = getFilename(key);
+	try {
+		auto path = boost::filesystem::path(filename);
+		if (boost::filesystem::create_directories(path.parent_path()))
+			boost::filesystem::permissions(path.parent_path(), boost::filesystem::owner_all);
+
+		// Write to a temporary file first, so other processes never read an incomplete binary
+		auto tmp = path;
+		tmp += boost::filesystem::unique_path(".%%%%-%%%%-%%%%.tmp");
+		{
+			std::ofstream file(tmp.string(), std::ios::binary);
+			file.write(data, size);
+			if (!file)
+				throw std::runtime_error("could not write file");
+		}
+		boost::filesystem::permissions(tmp, boost::filesystem::owner_read | boost::filesystem::owner_write);
+		boost::filesystem::rename(tmp, path);
+		return true;
+	}
+	catch (const std::exception &e) {
+		// the cache is an optimization, callers work without it
+		Log::warn(concat("BinaryCache: could not store ", filename, ": ", e.what()));
+		return false;
+	}
+}
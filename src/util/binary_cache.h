@@ -0,0 +1,51 @@
+#ifndef UTIL_BINARY_CACHE_H
+#define UTIL_BINARY_CACHE_H
+
+#include <string>
+#include <vector>
+
+/**
+ * A directory of binary files shared between processes, e.g. compiled OpenCL programs.
+ *
+ * Entries are keyed by the SHA1 of a list of strings, which must contain everything the
+ * binary depends on. Files are written to a temporary file first and then renamed, so
+ * readers never see incomplete entries.
+ *
+ * The files are used as they are, so the directory must be trusted: it is only used if it
+ * is an absolute path, owned by the current user and not writable by anybody else. Otherwise,
+ * or if the directory is empty, the cache is disabled and stores nothing.
+ */
+class BinaryCache {
+	public:
+		/**
+		 * @param directory the directory, created on the first store. Empty to disable the cache.
+		 */
+		explicit BinaryCache(const std::string &directory);
+
+		/**
+		 * @return the filename of the entry with the given key, empty if the cache is disabled
+		 */
+		std::string getFilename(const std::vector<std::string> &key) const;
+
+		/**
+		 * Reads an entry
+		 * @return whether the entry exists and was read into binary
+		 */
+		bool load(const std::vector<std::string> &key, std::vector<char> &binary) const;
+
+		/**
+		 * Writes an entry, replacing an existing one
+		 * @return whether the entry was written
+		 */
+		bool store(const std::vector<std::string> &key, const char *data, size_t size) const;
+
+		/**
+		 * @return whether the directory may be used, logs a warning if not
+		 */
+		bool isTrusted() const;
+
+	private:
+		std::string directory;
+};
+
+#endif
@@ -205,15 +205,20 @@ void BinaryStream::write(BinaryWriteBuffer &buffer) {
 		writeNB(buffer);
 }
 
-void BinaryStream::writeNB(BinaryWriteBuffer &buffer) {
+void BinaryStream::writeNB(BinaryWriteBuffer &buffer, bool *would_block) {
+	if (would_block)
+		*would_block = false;
 	buffer.prepareForWriting();
 	if (!buffer.isWriting())
 		throw ArgumentException("cannot writeNB() a BinaryWriteBuffer when not prepared for writing");
 
 	auto written = writev(write_fd, (const iovec *) &buffer.areas.at(buffer.areas_sent), buffer.areas.size()-buffer.areas_sent);
 	if (written < 0) {
-		if (!is_blocking && (errno == EAGAIN || errno == EWOULDBLOCK))
+		if (!is_blocking && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			if (would_block)
+				*would_block = true;
 			return;
+		}
 		throw NetworkException(concat("BinaryStream: writev() failed: ", strerror(errno)));
 	}
 	if (written == 0) {
@@ -237,7 +242,9 @@ bool BinaryStream::read(BinaryReadBuffer &buffer, bool allow_eof) {
 	return false;
 }
 
-bool BinaryStream::readNB(BinaryReadBuffer &buffer, bool allow_eof) {
+bool BinaryStream::readNB(BinaryReadBuffer &buffer, bool allow_eof, bool *would_block) {
+	if (would_block)
+		*would_block = false;
 	if (buffer.isRead())
 		throw ArgumentException("cannot read() a BinaryReadBuffer that's already fully read");
 
@@ -245,8 +252,11 @@ bool BinaryStream::readNB(BinaryReadBuffer &buffer, bool allow_eof) {
 
 	auto bytes_read = ::read(read_fd, buffer.buffer.data()+buffer.size_read, buffer.size_total-buffer.size_read);
 	if (bytes_read == -1) {
-		if (errno == EAGAIN || errno == EWOULDBLOCK)
+		if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			if (would_block)
+				*would_block = true;
 			return false;
+		}
 		throw NetworkException(concat("BinaryStream: unexpected error while reading a BinaryReadBuffer: ", strerror(errno)));
 	}
 	if (bytes_read == 0) {
@@ -85,8 +85,9 @@ class BinaryStream {
 		void write(BinaryWriteBuffer &buffer);
 		/*
 		 * Write the contents of a BinaryWriteBuffer to the stream (non-blocking)
+		 * @param would_block if given, set to whether the stream could not accept any more data
 		 */
-		void writeNB(BinaryWriteBuffer &buffer);
+		void writeNB(BinaryWriteBuffer &buffer, bool *would_block = nullptr);
 		/*
 		 * Fill a BinaryReadBuffer with contents from the stream (blocking)
 		 * @return true if eof was encountered and allow_eof = true, otherwise false
@@ -94,9 +95,10 @@ class BinaryStream {
 		bool read(BinaryReadBuffer &buffer, bool allow_eof = false);
 		/*
 		 * Fill a BinaryReadBuffer with contents from the stream (non-blocking)
+		 * @param would_block if given, set to whether the stream had no more data available
 		 * @return true if eof was encountered and allow_eof = true, otherwise false
 		 */
-		bool readNB(BinaryReadBuffer &buffer, bool allow_eof = false);
+		bool readNB(BinaryReadBuffer &buffer, bool allow_eof = false, bool *would_block = nullptr);
 
 		/*
 		 * Returns the file descriptor used for reading.
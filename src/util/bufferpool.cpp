@@ -0,0 +1,227 @@
+#include "util/bufferpool.h"
+#include "util/configuration.h"
+
+#include <array>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cstring>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+/*
+ * Size classes: 1, 2, 3 and 4 pages, then four classes per power of two up to 256 MiB.
+ * Larger buffers are not pooled.
+ */
+static const size_t NUM_CLASSES = 60;
+static const size_t SMALL_CLASSES = 4;
+
+static size_t pagesOf(size_t size) {
+	return (size + BufferPool::ALIGNMENT - 1) / BufferPool::ALIGNMENT;
+}
+
+/*
+ * @return the size class of a buffer with the given number of pages, or -1 if it is not pooled
+ */
+static int sizeClass(size_t pages, size_t &class_pages) {
+	if (pages <= SMALL_CLASSES) {
+		class_pages = pages;
+		return (int) pages - 1;
+	}
+	int exponent = 63 - __builtin_clzll(pages - 1); // 2^exponent < pages <= 2^(exponent+1)
+	size_t step = (size_t) 1 << (exponent - 2);
+	class_pages = (pages + step - 1) / step * step;
+	size_t index = 4 * (exponent - 1) + class_pages / step - 5;
+	if (index >= NUM_CLASSES)
+		return -1;
+	return (int) index;
+}
+
+static size_t classBytes(size_t index) {
+	if (index < SMALL_CLASSES)
+		return (index + 1) * BufferPool::ALIGNMENT;
+	size_t exponent = index / 4 + 1;
+	size_t step = (size_t) 1 << (exponent - 2);
+	return (index % 4 + 5) * step * BufferPool::ALIGNMENT;
+}
+
+
+namespace {
+
+typedef std::array<std::vector<void *>, NUM_CLASSES> FreeLists;
+
+struct SharedPool {
+	SharedPool()
+		: enabled(Configuration::get<bool>("rasterpool.enabled", true)),
+		  capacity(Configuration::get<size_t>("rasterpool.capacity", (size_t) 512 << 20)),
+		  thread_cache(Configuration::get<size_t>("rasterpool.threadcache", (size_t) 32 << 20)),
+		  bytes_shared(0), hits(0), misses(0), releases(0), bytes_retained(0) {}
+
+	const bool enabled;
+	const size_t capacity;
+	const size_t thread_cache;
+
+	std::mutex mutex;
+	FreeLists lists;
+	size_t bytes_shared;
+
+	std::atomic<uint64_t> hits;
+	std::atomic<uint64_t> misses;
+	std::atomic<uint64_t> releases;
+	std::atomic<size_t> bytes_retained;
+
+	void *take(int index, size_t class_bytes) {
+		std::lock_guard<std::mutex> guard(mutex);
+		auto &list = lists[index];
+		if (list.empty())
+			return nullptr;
+		void *buffer = list.back();
+		list.pop_back();
+		bytes_shared -= class_bytes;
+		return buffer;
+	}
+
+	void put(void *buffer, int index, size_t class_bytes) {
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			if (bytes_shared + class_bytes <= capacity) {
+				lists[index].push_back(buffer);
+				bytes_shared += class_bytes;
+				bytes_retained += class_bytes;
+				return;
+			}
+		}
+		releases++;
+		free(buffer);
+	}
+
+	void trim() {
+		FreeLists freed;
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			std::swap(freed, lists);
+			bytes_shared = 0;
+		}
+		freeAll(freed);
+	}
+
+	void freeAll(FreeLists &freed) {
+		for (size_t index = 0; index < NUM_CLASSES; index++) {
+			for (void *buffer : freed[index]) {
+				free(buffer);
+				bytes_retained -= classBytes(index);
+				releases++;
+			}
+			freed[index].clear();
+		}
+	}
+};
+
+// Never destroyed, so threads exiting late can still return their buffers
+static SharedPool &getSharedPool() {
+	static SharedPool *pool = new SharedPool();
+	return *pool;
+}
+
+struct ThreadCache {
+	ThreadCache() : bytes(0) {}
+	~ThreadCache() {
+		auto &shared = getSharedPool();
+		for (size_t index = 0; index < NUM_CLASSES; index++)
+			for (void *buffer : lists[index]) {
+				shared.bytes_retained -= classBytes(index);
+				shared.put(buffer, index, classBytes(index));
+			}
+	}
+
+	FreeLists lists;
+	size_t bytes;
+};
+
+static thread_local ThreadCache thread_cache;
+
+}
+
+
+void *BufferPool::allocate(size_t size) {
+	auto &shared = getSharedPool();
+	size_t pages = pagesOf(size);
+	size_t class_pages = pages;
+	int index = shared.enabled ? sizeClass(pages, class_pages) : -1;
+	size_t class_bytes = class_pages * ALIGNMENT;
+
+	void *buffer = nullptr;
+	if (index >= 0) {
+		auto &list = thread_cache.lists[index];
+		if (!list.empty()) {
+			buffer = list.back();
+			list.pop_back();
+			thread_cache.bytes -= class_bytes;
+		}
+		else
+			buffer = shared.take(index, class_bytes);
+	}
+
+	if (buffer != nullptr) {
+		shared.hits++;
+		shared.bytes_retained -= class_bytes;
+	}
+	else {
+		shared.misses++;
+		buffer = aligned_alloc(ALIGNMENT, class_bytes);
+		if (buffer == nullptr) {
+			// give the memory kept for reuse back and try again
+			trim();
+			buffer = aligned_alloc(ALIGNMENT, class_bytes);
+			if (buffer == nullptr)
+				throw std::bad_alloc();
+		}
+	}
+
+	memset(buffer, 0, pages * ALIGNMENT);
+	return buffer;
+}
+
+void BufferPool::release(void *buffer, size_t size) {
+	if (buffer == nullptr)
+		return;
+	auto &shared = getSharedPool();
+	size_t class_pages = pagesOf(size);
+	int index = shared.enabled ? sizeClass(class_pages, class_pages) : -1;
+	if (index < 0) {
+		shared.releases++;
+		free(buffer);
+		return;
+	}
+	size_t class_bytes = class_pages * ALIGNMENT;
+	if (thread_cache.bytes + class_bytes <= shared.thread_cache) {
+		thread_cache.lists[index].push_back(buffer);
+		thread_cache.bytes += class_bytes;
+		shared.bytes_retained += class_bytes;
+	}
+	else
+		shared.put(buffer, index, class_bytes);
+}
+
+void BufferPool::trim() {
+	auto &shared = getSharedPool();
+	shared.freeAll(thread_cache.lists);
+	thread_cache.bytes = 0;
+	shared.trim();
+#ifdef __GLIBC__
+	malloc_trim(0);
+#endif
+}
+
+BufferPool::Statistics BufferPool::getStatistics() {
+	auto &shared = getSharedPool();
+	Statistics stats;
+	stats.hits = shared.hits;
+	stats.misses = shared.misses;
+	stats.releases = shared.releases;
+	stats.bytes_retained = shared.bytes_retained;
+	return stats;
+}
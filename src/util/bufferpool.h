@@ -0,0 +1,47 @@
+#ifndef UTIL_BUFFERPOOL_H_
+#define UTIL_BUFFERPOOL_H_
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Pool for large, page aligned buffers such as the pixel data of rasters.
+ *
+ * Buffers are grouped into size classes (four per power of two) and kept for reuse
+ * instead of being returned to the allocator. Every thread keeps a small cache of its
+ * own, backed by a shared pool. Both are capped, buffers exceeding the caps are freed.
+ *
+ * Configured by the keys rasterpool.enabled, rasterpool.capacity and rasterpool.threadcache.
+ */
+class BufferPool {
+	public:
+		struct Statistics {
+			uint64_t hits; // allocations served from the pool
+			uint64_t misses; // allocations served by the system allocator
+			uint64_t releases; // buffers returned to the system allocator
+			size_t bytes_retained; // bytes currently kept for reuse
+		};
+
+		static const size_t ALIGNMENT = 4096;
+
+		/**
+		 * Returns a zero-initialized buffer of at least the given size, aligned to ALIGNMENT
+		 */
+		static void *allocate(size_t size);
+
+		/**
+		 * Returns a buffer obtained by allocate() to the pool
+		 * @param buffer the buffer
+		 * @param size the size passed to allocate()
+		 */
+		static void release(void *buffer, size_t size);
+
+		/**
+		 * Frees all buffers kept by the shared pool and by the calling thread
+		 */
+		static void trim();
+
+		static Statistics getStatistics();
+};
+
+#endif
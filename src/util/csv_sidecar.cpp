@@ -0,0 +1,482 @@
+#include "util/csv_sidecar.h"
+#include "util/csv_source_util.h"
+#include "util/exceptions.h"
+#include "util/log.h"
+
+#include <json/json.h>
+
+#include <algorithm>
+#include <numeric>
+#include <fstream>
+#include <thread>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+/*
+ * File layout, all sections aligned to 8 bytes:
+ *   Header
+ *   the parameters of the CSVSourceUtil as json
+ *   numeric_count + textual_count column names, each preceded by its length as uint64_t
+ *   Block[block_count]
+ *   uint64_t rows[feature_count]: the row of each feature in the csv file
+ *   double x[feature_count], y[feature_count]
+ *   double t1[feature_count], t2[feature_count] if has_time
+ *   double values[feature_count] for every numeric column
+ *   uint64_t offsets[feature_count+1] and the characters for every textual column
+ */
+static const char MAGIC[8] = {'M', 'C', 'S', 'V', 'I', 'D', 'X', '1'};
+
+namespace {
+
+struct Header {
+	char magic[8];
+	int64_t csv_mtime_sec;
+	int64_t csv_mtime_nsec;
+	int64_t csv_size;
+	uint64_t feature_count;
+	uint64_t block_count;
+	uint32_t numeric_count;
+	uint32_t textual_count;
+	uint32_t has_time;
+	int32_t timetype;
+	uint64_t parameters_length;
+};
+
+// returns false if the csv file does not exist
+bool statCSV(const std::string &csv_filename, Header &header) {
+	struct stat st;
+	if (stat(csv_filename.c_str(), &st) != 0)
+		return false;
+	header.csv_mtime_sec = st.st_mtim.tv_sec;
+	header.csv_mtime_nsec = st.st_mtim.tv_nsec;
+	header.csv_size = st.st_size;
+	return true;
+}
+
+std::string getParameterString(CSVSourceUtil &util) {
+	Json::FastWriter writer;
+	return writer.write(util.getParameters());
+}
+
+class SidecarWriter {
+	public:
+		explicit SidecarWriter(std::ofstream &out) : out(out), written(0) {}
+
+		template<typename T>
+		void write(const T *data, size_t count) {
+			out.write((const char *) data, sizeof(T) * count);
+			written += sizeof(T) * count;
+		}
+		void pad() {
+			static const char zeros[8] = {0};
+			if (written % 8 != 0)
+				write(zeros, 8 - written % 8);
+		}
+	private:
+		std::ofstream &out;
+		size_t written;
+};
+
+// Walks through the mapped file, checking that every section lies within it
+class SidecarReader {
+	public:
+		SidecarReader(const char *data, size_t size) : data(data), size(size), position(0) {}
+
+		template<typename T>
+		const T *read(size_t count) {
+			if (count > (size - position) / sizeof(T))
+				throw MustNotHappenException("CSVSidecar: file is truncated");
+			auto result = (const T *) (data + position);
+			position += sizeof(T) * count;
+			return result;
+		}
+		void pad() {
+			position = std::min(size, (position + 7) / 8 * 8);
+		}
+	private:
+		const char *data;
+		size_t size;
+		size_t position;
+};
+
+// The builds of the sidecars of one csv file, which all write the same file
+struct BuildState {
+	std::mutex mutex;
+	// the csv files a build failed for, by the parameter string
+	std::unordered_map<std::string, Header> failures;
+};
+
+std::mutex build_states_mutex;
+std::unordered_map<std::string, std::shared_ptr<BuildState>> build_states;
+
+}
+
+struct CSVSidecar::Block {
+	uint64_t start;
+	uint64_t end;
+	double x1, y1, x2, y2; // bounds of the finite coordinates, NaN never intersects a query
+	double t1, t2; // minimum start and maximum end time
+};
+
+
+std::string CSVSidecar::getFilename(const std::string &csv_filename) {
+	return csv_filename + ".index";
+}
+
+bool CSVSidecar::build(const std::string &csv_filename, CSVSourceUtil &util) {
+	if (util.geometry_specification != GeometrySpecification::XY)
+		return false;
+
+	Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	if (!statCSV(csv_filename, header))
+		return false;
+
+	/*
+	 * Parse all features, the same way CSVSourceUtil::getPointCollection does
+	 */
+	timetype_t timetype = util.time1Parser ? util.time1Parser->getTimeType() : TIMETYPE_UNIX;
+	QueryRectangle everything(SpatialReference::unreferenced(), TemporalReference(timetype), QueryResolution::none());
+	PointCollection points(everything);
+	try {
+		std::ifstream data(csv_filename);
+		if (!data.is_open())
+			return false;
+		util.readAnyCollection(&points, data, everything, [&](const std::string &x_str, const std::string &y_str) -> bool {
+			if (x_str == "" || y_str == "")
+				return false;
+			points.addSinglePointFeature(Coordinate(std::stod(x_str), std::stod(y_str)));
+			return true;
+		});
+	}
+	catch (const std::exception &e) {
+		Log::warn("CSVSidecar: not building a sidecar for %s: %s", csv_filename.c_str(), e.what());
+		return false;
+	}
+
+	size_t count = points.getFeatureCount();
+	bool has_time = points.hasTime();
+
+	/*
+	 * Sort the features into a grid with about BLOCK_SIZE features per cell, and by time within a cell
+	 */
+	double x1 = INFINITY, y1 = INFINITY, x2 = -INFINITY, y2 = -INFINITY;
+	for (auto &c : points.coordinates) {
+		if (std::isfinite(c.x)) {
+			x1 = std::min(x1, c.x);
+			x2 = std::max(x2, c.x);
+		}
+		if (std::isfinite(c.y)) {
+			y1 = std::min(y1, c.y);
+			y2 = std::max(y2, c.y);
+		}
+	}
+	size_t grid = std::max((size_t) 1, std::min((size_t) 1024, (size_t) std::ceil(std::sqrt((double) count / BLOCK_SIZE))));
+	auto cellOf = [&](size_t feature) -> size_t {
+		auto &c = points.coordinates[feature];
+		auto index = [&](double value, double min, double max) -> size_t {
+			if (!(value > min) || !(max > min))
+				return 0;
+			return std::min(grid - 1, (size_t) ((value - min) / (max - min) * grid));
+		};
+		return index(c.y, y1, y2) * grid + index(c.x, x1, x2);
+	};
+	std::vector<size_t> cells(count);
+	for (size_t i = 0; i < count; i++)
+		cells[i] = cellOf(i);
+
+	std::vector<uint64_t> order(count);
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&](uint64_t a, uint64_t b) {
+		if (cells[a] != cells[b])
+			return cells[a] < cells[b];
+		if (has_time && points.time[a].t1 != points.time[b].t1)
+			return points.time[a].t1 < points.time[b].t1;
+		return a < b;
+	});
+
+	std::vector<Block> blocks;
+	for (size_t start = 0; start < count; ) {
+		size_t end = start + 1;
+		while (end < count && end - start < BLOCK_SIZE && cells[order[end]] == cells[order[start]])
+			end++;
+		Block block{start, end, INFINITY, INFINITY, -INFINITY, -INFINITY, -INFINITY, INFINITY};
+		if (has_time) {
+			block.t1 = INFINITY;
+			block.t2 = -INFINITY;
+		}
+		for (size_t i = start; i < end; i++) {
+			auto &c = points.coordinates[order[i]];
+			block.x1 = std::min(block.x1, c.x);
+			block.y1 = std::min(block.y1, c.y);
+			block.x2 = std::max(block.x2, c.x);
+			block.y2 = std::max(block.y2, c.y);
+			if (has_time) {
+				block.t1 = std::min(block.t1, points.time[order[i]].t1);
+				block.t2 = std::max(block.t2, points.time[order[i]].t2);
+			}
+		}
+		blocks.push_back(block);
+		start = end;
+	}
+
+	/*
+	 * Write the columns to a temporary file, which replaces the sidecar when it is complete
+	 */
+	std::string parameters = getParameterString(util);
+	header.feature_count = count;
+	header.block_count = blocks.size();
+	header.numeric_count = util.columns_numeric.size();
+	header.textual_count = util.columns_textual.size();
+	header.has_time = has_time;
+	header.timetype = timetype;
+	header.parameters_length = parameters.size();
+
+	std::string filename = getFilename(csv_filename);
+	std::string temporary = concat(filename, ".", getpid(), ".", std::hash<std::thread::id>()(std::this_thread::get_id()));
+	{
+		std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+		if (!out.is_open()) {
+			Log::warn("CSVSidecar: could not write %s", temporary.c_str());
+			return false;
+		}
+		SidecarWriter writer(out);
+		writer.write(&header, 1);
+		writer.write(parameters.data(), parameters.size());
+		writer.pad();
+		for (auto names : {&util.columns_numeric, &util.columns_textual}) {
+			for (auto &name : *names) {
+				uint64_t length = name.size();
+				writer.write(&length, 1);
+				writer.write(name.data(), name.size());
+			}
+		}
+		writer.pad();
+		writer.write(blocks.data(), blocks.size());
+		writer.write(order.data(), count);
+
+		std::vector<double> column(count);
+		auto writeColumn = [&](const std::function<double(size_t)> &get) {
+			for (size_t i = 0; i < count; i++)
+				column[i] = get(order[i]);
+			writer.write(column.data(), count);
+		};
+		writeColumn([&](size_t feature) { return points.coordinates[feature].x; });
+		writeColumn([&](size_t feature) { return points.coordinates[feature].y; });
+		if (has_time) {
+			writeColumn([&](size_t feature) { return points.time[feature].t1; });
+			writeColumn([&](size_t feature) { return points.time[feature].t2; });
+		}
+		for (auto &name : util.columns_numeric) {
+			auto &values = points.feature_attributes.numeric(name);
+			writeColumn([&](size_t feature) { return values.get(feature); });
+		}
+		for (auto &name : util.columns_textual) {
+			auto &values = points.feature_attributes.textual(name);
+			std::vector<uint64_t> offsets(count + 1, 0);
+			for (size_t i = 0; i < count; i++)
+				offsets[i + 1] = offsets[i] + values.get(order[i]).size();
+			writer.write(offsets.data(), offsets.size());
+			for (size_t i = 0; i < count; i++) {
+				auto &value = values.get(order[i]);
+				writer.write(value.data(), value.size());
+			}
+			writer.pad();
+		}
+
+		out.close();
+		if (!out) {
+			unlink(temporary.c_str());
+			Log::warn("CSVSidecar: could not write %s", temporary.c_str());
+			return false;
+		}
+	}
+	if (rename(temporary.c_str(), filename.c_str()) != 0) {
+		unlink(temporary.c_str());
+		return false;
+	}
+	return true;
+}
+
+std::unique_ptr<CSVSidecar> CSVSidecar::open(const std::string &csv_filename, CSVSourceUtil &util) {
+	if (util.geometry_specification != GeometrySpecification::XY)
+		return nullptr;
+
+	Header current;
+	if (!statCSV(csv_filename, current))
+		return nullptr;
+
+	std::string filename = getFilename(csv_filename);
+	int f = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+	if (f < 0)
+		return nullptr;
+	struct stat st;
+	if (fstat(f, &st) != 0 || (size_t) st.st_size < sizeof(Header)) {
+		close(f);
+		return nullptr;
+	}
+	void *addr = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_SHARED, f, 0);
+	close(f);
+	if (addr == MAP_FAILED)
+		return nullptr;
+
+	std::unique_ptr<CSVSidecar> sidecar(new CSVSidecar());
+	sidecar->mapped = (const char *) addr;
+	sidecar->mapped_size = (size_t) st.st_size;
+
+	try {
+		SidecarReader reader(sidecar->mapped, sidecar->mapped_size);
+		auto header = reader.read<Header>(1);
+		if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0)
+			return nullptr;
+		// outdated
+		if (header->csv_mtime_sec != current.csv_mtime_sec || header->csv_mtime_nsec != current.csv_mtime_nsec
+				|| header->csv_size != current.csv_size)
+			return nullptr;
+		// built with other parameters
+		auto parameters = reader.read<char>(header->parameters_length);
+		if (std::string(parameters, header->parameters_length) != getParameterString(util))
+			return nullptr;
+		reader.pad();
+
+		for (uint32_t i = 0; i < header->numeric_count + header->textual_count; i++) {
+			uint64_t length = *reader.read<uint64_t>(1);
+			std::string name(reader.read<char>(length), length);
+			(i < header->numeric_count ? sidecar->numeric_names : sidecar->textual_names).push_back(name);
+		}
+		reader.pad();
+
+		size_t count = header->feature_count;
+		sidecar->feature_count = count;
+		sidecar->block_count = header->block_count;
+		sidecar->has_time = header->has_time != 0;
+		sidecar->timetype = (timetype_t) header->timetype;
+		sidecar->blocks = reader.read<Block>(header->block_count);
+		sidecar->rows = reader.read<uint64_t>(count);
+		sidecar->x = reader.read<double>(count);
+		sidecar->y = reader.read<double>(count);
+		if (sidecar->has_time) {
+			sidecar->t1 = reader.read<double>(count);
+			sidecar->t2 = reader.read<double>(count);
+		}
+		for (uint32_t i = 0; i < header->numeric_count; i++)
+			sidecar->numeric.push_back(reader.read<double>(count));
+		for (uint32_t i = 0; i < header->textual_count; i++) {
+			auto offsets = reader.read<uint64_t>(count + 1);
+			sidecar->textual_offsets.push_back(offsets);
+			sidecar->textual_chars.push_back(reader.read<char>(offsets[count]));
+			reader.pad();
+		}
+	}
+	catch (const MustNotHappenException &e) {
+		Log::warn("CSVSidecar: ignoring %s: %s", filename.c_str(), e.what());
+		return nullptr;
+	}
+	return sidecar;
+}
+
+CSVSidecar::~CSVSidecar() {
+	if (mapped)
+		munmap((void *) mapped, mapped_size);
+}
+
+std::unique_ptr<PointCollection> CSVSidecar::getPointCollection(const QueryRectangle &rect, size_t &bytes_read) const {
+	if (has_time && timetype != rect.timetype)
+		throw OperatorException("CSVPointSource: Invalid time specification for given query rectangle");
+
+	/*
+	 * Find the features in the blocks intersecting the query, using the same tests as
+	 * SimpleFeatureCollection::filterBySpatioTemporalReferenceIntersectionInPlace()
+	 */
+	size_t feature_bytes = sizeof(uint64_t) + 2 * sizeof(double) + (has_time ? 2 * sizeof(double) : 0)
+		+ numeric.size() * sizeof(double) + textual_offsets.size() * sizeof(uint64_t);
+	std::vector<uint64_t> matches;
+	for (size_t b = 0; b < block_count; b++) {
+		auto &block = blocks[b];
+		if (block.x1 > rect.x2 || block.x2 < rect.x1 || block.y1 > rect.y2 || block.y2 < rect.y1)
+			continue;
+		if (has_time && !rect.intersects(block.t1, block.t2))
+			continue;
+		bytes_read += (block.end - block.start) * feature_bytes;
+		for (size_t i = block.start; i < block.end; i++) {
+			if (x[i] >= rect.x1 && x[i] <= rect.x2 && y[i] >= rect.y1 && y[i] <= rect.y2
+					&& (!has_time || rect.intersects(t1[i], t2[i])))
+				matches.push_back(i);
+		}
+	}
+	std::sort(matches.begin(), matches.end(), [&](uint64_t a, uint64_t b) { return rows[a] < rows[b]; });
+
+	auto points = std::make_unique<PointCollection>(rect);
+	points->coordinates.reserve(matches.size());
+	points->start_feature.reserve(matches.size());
+	for (auto i : matches)
+		points->addSinglePointFeature(Coordinate(x[i], y[i]));
+	if (has_time) {
+		points->time.reserve(matches.size());
+		for (auto i : matches)
+			points->time.push_back(TimeInterval(t1[i], t2[i]));
+	}
+	for (size_t k = 0; k < numeric.size(); k++) {
+		auto &values = points->feature_attributes.addNumericAttribute(numeric_names[k], Unit::unknown());
+		values.reserve(matches.size());
+		for (size_t j = 0; j < matches.size(); j++)
+			values.set(j, numeric[k][matches[j]]);
+	}
+	for (size_t k = 0; k < textual_offsets.size(); k++) {
+		auto &values = points->feature_attributes.addTextualAttribute(textual_names[k], Unit::unknown());
+		values.reserve(matches.size());
+		for (size_t j = 0; j < matches.size(); j++) {
+			auto i = matches[j];
+			auto begin = textual_offsets[k][i], end = textual_offsets[k][i + 1];
+			bytes_read += end - begin;
+			values.set(j, std::string(textual_chars[k] + begin, end - begin));
+		}
+	}
+
+	return points;
+}
+
+std::unique_ptr<CSVSidecar> CSVSidecar::openOrBuild(const std::string &csv_filename, CSVSourceUtil &util) {
+	auto sidecar = open(csv_filename, util);
+	if (sidecar || util.geometry_specification != GeometrySpecification::XY)
+		return sidecar;
+
+	std::shared_ptr<BuildState> state;
+	{
+		std::lock_guard<std::mutex> guard(build_states_mutex);
+		auto &entry = build_states[csv_filename];
+		if (!entry)
+			entry = std::make_shared<BuildState>();
+		state = entry;
+	}
+
+	std::lock_guard<std::mutex> guard(state->mutex);
+	Header current;
+	if (!statCSV(csv_filename, current))
+		return nullptr;
+	std::string parameters = getParameterString(util);
+	auto failure = state->failures.find(parameters);
+	if (failure != state->failures.end() && failure->second.csv_mtime_sec == current.csv_mtime_sec
+			&& failure->second.csv_mtime_nsec == current.csv_mtime_nsec && failure->second.csv_size == current.csv_size)
+		return nullptr;
+
+	// another thread may have built it while we were waiting
+	sidecar = open(csv_filename, util);
+	if (!sidecar && build(csv_filename, util))
+		sidecar = open(csv_filename, util);
+
+	if (sidecar)
+		state->failures.erase(parameters);
+	else
+		state->failures[parameters] = current;
+	return sidecar;
+}
@@ -0,0 +1,90 @@
+#ifndef UTIL_CSV_SIDECAR_H
+#define UTIL_CSV_SIDECAR_H
+
+#include "datatypes/pointcollection.h"
+#include "operators/queryrectangle.h"
+
+#include <memory>
+#include <string>
+#include <cstdint>
+
+class CSVSourceUtil;
+
+/**
+ * A binary sidecar of a csv file with points, stored next to it as <filename>.index.
+ *
+ * It contains the features as parsed by a CSVSourceUtil, stored column by column. The features are
+ * sorted into the cells of a grid over their coordinates and, within a cell, by their start time.
+ * They are grouped into blocks of up to BLOCK_SIZE features, for which the bounds in space and time
+ * are stored. A query only touches the blocks intersecting its rectangle; the file is memory-mapped,
+ * so the other blocks are never read.
+ *
+ * A sidecar is only valid for the parameters it was built with and as long as the csv file's
+ * modification time and size do not change. Only xy geometries are supported.
+ */
+class CSVSidecar {
+	public:
+		static const size_t BLOCK_SIZE = 1024;
+
+		~CSVSidecar();
+		CSVSidecar(const CSVSidecar &) = delete;
+		CSVSidecar &operator=(const CSVSidecar &) = delete;
+
+		static std::string getFilename(const std::string &csv_filename);
+
+		/**
+		 * Parses the csv file and writes its sidecar
+		 * @return false if the parameters are not supported or the file could not be parsed or written
+		 */
+		static bool build(const std::string &csv_filename, CSVSourceUtil &util);
+
+		/**
+		 * Opens the sidecar of a csv file
+		 * @return the sidecar, or nullptr if there is none that matches the file and the parameters
+		 */
+		static std::unique_ptr<CSVSidecar> open(const std::string &csv_filename, CSVSourceUtil &util);
+
+		/**
+		 * Opens the sidecar of a csv file, building it first if there is none.
+		 *
+		 * Only one thread builds the sidecar of a file at a time, the others wait and open its result.
+		 * A failed build is remembered and not tried again until the csv file changes.
+		 * @return the sidecar, or nullptr if it could not be built
+		 */
+		static std::unique_ptr<CSVSidecar> openOrBuild(const std::string &csv_filename, CSVSourceUtil &util);
+
+		/**
+		 * Returns the features intersecting the query rectangle, in the order of the csv file
+		 * @param bytes_read is increased by the size of the blocks that were read
+		 */
+		std::unique_ptr<PointCollection> getPointCollection(const QueryRectangle &rect, size_t &bytes_read) const;
+
+		size_t getFeatureCount() const { return feature_count; }
+
+	private:
+		struct Block;
+
+		CSVSidecar() = default;
+
+		const char *mapped = nullptr;
+		size_t mapped_size = 0;
+
+		size_t feature_count = 0;
+		size_t block_count = 0;
+		bool has_time = false;
+		timetype_t timetype = TIMETYPE_UNIX;
+		std::vector<std::string> numeric_names;
+		std::vector<std::string> textual_names;
+
+		const Block *blocks = nullptr;
+		const uint64_t *rows = nullptr;
+		const double *x = nullptr;
+		const double *y = nullptr;
+		const double *t1 = nullptr;
+		const double *t2 = nullptr;
+		std::vector<const double *> numeric;
+		std::vector<const uint64_t *> textual_offsets;
+		std::vector<const char *> textual_chars;
+};
+
+#endif
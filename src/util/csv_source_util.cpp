@@ -3,6 +3,8 @@
 
 #include "util/exceptions.h"
 #include "util/csvparser.h"
+#include "util/mapped_csvparser.h"
+#include "util/threadpool.h"
 #include "util/timeparser.h"
 #include "datatypes/simplefeaturecollections/wkbutil.h"
 #include "operators/queryrectangle.h"
@@ -16,6 +18,7 @@
 #include <json/json.h>
 #include <sys/stat.h>
 #include <memory>
+#include <atomic>
 
 CSVSourceUtil::CSVSourceUtil(GeometrySpecification geometry_specification,
 		TimeSpecification time_specification, double time_duration,
@@ -141,195 +144,239 @@ Json::Value CSVSourceUtil::getParameters() {
 
 
 
-void CSVSourceUtil::readAnyCollection(SimpleFeatureCollection *collection, std::istream &data, const QueryRectangle &rect,
-		std::function<bool(const std::string &,const std::string &)> addFeature) {
+namespace {
 
-	//header
-	CSVParser parser(data, field_separator);
-	auto headers = parser.readHeaders();
+const size_t no_pos = std::numeric_limits<size_t>::max();
 
-	// Try to match up all headers
-	size_t no_pos = std::numeric_limits<size_t>::max();
-	size_t pos_x = no_pos, pos_y = no_pos, pos_time1 = no_pos, pos_time2 = no_pos;
+// The positions of the configured columns in the file
+struct ColumnPositions {
+	size_t x = no_pos, y = no_pos, time1 = no_pos, time2 = no_pos;
+	std::vector<size_t> numeric;
+	std::vector<size_t> textual;
+};
 
-	std::vector<size_t> pos_numeric(columns_numeric.size(), no_pos);
-	std::vector<size_t> pos_textual(columns_textual.size(), no_pos);
+/*
+ * Try to match up all headers
+ */
+ColumnPositions findColumns(const CSVSourceUtil &util, const std::vector<std::string> &headers, const QueryRectangle &rect) {
+	ColumnPositions pos;
+	pos.numeric.assign(util.columns_numeric.size(), no_pos);
+	pos.textual.assign(util.columns_textual.size(), no_pos);
 
 	for (size_t i=0; i < headers.size(); i++) {
 		const std::string &header = headers[i];
 		//fprintf(stderr, "column %d: '%s' -> '%s'\n", (int) i, headers[i].c_str(), lc.c_str());
-		if (header == column_x)
-			pos_x = i;
-		else if (header == column_y)
-			pos_y = i;
-		else if (header == column_time1)
-			pos_time1 = i;
-		else if (header == column_time2)
-			pos_time2 = i;
+		if (header == util.column_x)
+			pos.x = i;
+		else if (header == util.column_y)
+			pos.y = i;
+		else if (header == util.column_time1)
+			pos.time1 = i;
+		else if (header == util.column_time2)
+			pos.time2 = i;
 		else {
 			bool found=false;
-			for (size_t k=0;k<columns_numeric.size();k++) {
-				if (header == columns_numeric[k]) {
+			for (size_t k=0;k<util.columns_numeric.size();k++) {
+				if (header == util.columns_numeric[k]) {
 					found = true;
-					pos_numeric[k] = i;
+					pos.numeric[k] = i;
 					break;
 				}
 			}
 			if (found)
 				continue;
-			for (size_t k=0;k<columns_textual.size();k++) {
-				if (header == columns_textual[k]) {
-					pos_textual[k] = i;
+			for (size_t k=0;k<util.columns_textual.size();k++) {
+				if (header == util.columns_textual[k]) {
+					pos.textual[k] = i;
 					break;
 				}
 			}
 		}
 	}
 
-	if (default_x == "" && (pos_x == no_pos || (geometry_specification == GeometrySpecification::XY && pos_y == no_pos)))
+	if (util.default_x == "" && (pos.x == no_pos || (util.geometry_specification == GeometrySpecification::XY && pos.y == no_pos)))
 		throw OperatorException("CSVPointSource: the given columns containing the geometry could not be found.");
 
-	if((time1Parser != nullptr && pos_time1 == no_pos) || (time2Parser != nullptr && pos_time2 == no_pos))
+	if((util.time1Parser != nullptr && pos.time1 == no_pos) || (util.time2Parser != nullptr && pos.time2 == no_pos))
 		throw OperatorException("CSVPointSource: the given column containing time information could not be found.");
 
-	if((time1Parser != nullptr && time1Parser->getTimeType() != rect.timetype) || (time2Parser != nullptr && time2Parser->getTimeType() != rect.timetype))
+	if((util.time1Parser != nullptr && util.time1Parser->getTimeType() != rect.timetype) || (util.time2Parser != nullptr && util.time2Parser->getTimeType() != rect.timetype))
 		throw OperatorException("CSVPointSource: Invalid time specification for given query rectangle");
 
-	for (size_t k=0;k<columns_numeric.size();k++) {
-		if (pos_numeric[k] == no_pos)
-			throw OperatorException(concat("CSVPointSource: numeric column \"", columns_numeric[k], "\" not found."));
-		collection->feature_attributes.addNumericAttribute(columns_numeric[k], Unit::unknown()); // TODO: units
+	for (size_t k=0;k<util.columns_numeric.size();k++) {
+		if (pos.numeric[k] == no_pos)
+			throw OperatorException(concat("CSVPointSource: numeric column \"", util.columns_numeric[k], "\" not found."));
 	}
 
-	for (size_t k=0;k<columns_textual.size();k++) {
-		if (pos_textual[k] == no_pos)
-			throw OperatorException(concat("CSVPointSource: textual column \"", columns_textual[k], "\" not found."));
-		collection->feature_attributes.addTextualAttribute(columns_textual[k], Unit::unknown()); // TODO: units
+	for (size_t k=0;k<util.columns_textual.size();k++) {
+		if (pos.textual[k] == no_pos)
+			throw OperatorException(concat("CSVPointSource: textual column \"", util.columns_textual[k], "\" not found."));
 	}
 
+	return pos;
+}
 
-	const std::string empty_string = "";
+void addAttributes(const CSVSourceUtil &util, SimpleFeatureCollection *collection) {
+	for (auto &name : util.columns_numeric)
+		collection->feature_attributes.addNumericAttribute(name, Unit::unknown()); // TODO: units
+	for (auto &name : util.columns_textual)
+		collection->feature_attributes.addTextualAttribute(name, Unit::unknown()); // TODO: units
+}
 
-	size_t current_idx = 0;
-	while (true) {
-		auto tuple = parser.readTuple();
-		if (tuple.size() == 0)
-			break;
+// Tuples are either read by CSVParser or by MappedCSVParser
+const std::string &fieldToString(const std::string &field) {
+	return field;
+}
 
-		// Step 1: extract the geometry
-		// Note: faulty geometries lead to an error; empty geometries are simply skipped
-		const std::string &x_str = (pos_x == no_pos ? default_x : tuple[pos_x]);
-		const std::string &y_str = (pos_y == no_pos ? default_y : tuple[pos_y]);
+std::string fieldToString(const MappedCSVParser::Field &field) {
+	return field.toString();
+}
 
-		bool added = false;
-		try {
-			added = addFeature(x_str, y_str);
-		}
-		catch (const std::exception &e) {
-			switch(errorHandling) {
-				case ErrorHandling::ABORT:
-					std::throw_with_nested(OperatorException(concat("Geometry in CSV could not be parsed: '", x_str, "', '", y_str, "' "), MappingExceptionType::SAME_AS_NESTED));
-				case ErrorHandling::SKIP:
-					continue;
-				case ErrorHandling::KEEP:
-					//TODO: ???? Insert 0-Feature?
-					continue;
-			}
+double fieldToDouble(const std::string &field) {
+	return std::stod(field.c_str());
+}
 
+double fieldToDouble(const MappedCSVParser::Field &field) {
+	return field.toDouble();
+}
+
+/*
+ * Adds the feature of a single tuple to the collection at index current_idx
+ * @return false if the tuple was skipped
+ */
+template<typename Field, typename AddFeature>
+bool addTuple(const CSVSourceUtil &util, SimpleFeatureCollection *collection, const std::vector<Field> &tuple,
+		const Field &x_str, const Field &y_str, const ColumnPositions &pos, const QueryRectangle &rect,
+		AddFeature &addFeature, size_t current_idx) {
+
+	// Step 1: extract the geometry
+	// Note: faulty geometries lead to an error; empty geometries are simply skipped
+	bool added = false;
+	try {
+		added = addFeature(x_str, y_str);
+	}
+	catch (const std::exception &e) {
+		switch(util.errorHandling) {
+			case ErrorHandling::ABORT:
+				std::throw_with_nested(OperatorException(concat("Geometry in CSV could not be parsed: '", fieldToString(x_str), "', '", fieldToString(y_str), "' "), MappingExceptionType::SAME_AS_NESTED));
+			case ErrorHandling::SKIP:
+				return false;
+			case ErrorHandling::KEEP:
+				//TODO: ???? Insert 0-Feature?
+				return false;
 		}
-		if (!added)
-			continue;
-
-		// Step 2: extract the time information
-		if (time_specification != TimeSpecification::NONE) {
-			double t1, t2;
-			bool error = false;
-			if (time_specification == TimeSpecification::START) {
-				try {
-					t1 = time1Parser->parse(tuple[pos_time1]);
-					if(time_duration >= 0.0)
-						t2 = t1+time_duration;
-					else
-						t2 = rect.end_of_time();
-				} catch (const TimeParseException& e){
-					t1 = rect.beginning_of_time();
+
+	}
+	if (!added)
+		return false;
+
+	// Step 2: extract the time information
+	if (util.time_specification != TimeSpecification::NONE) {
+		double t1, t2;
+		bool error = false;
+		if (util.time_specification == TimeSpecification::START) {
+			try {
+				t1 = util.time1Parser->parse(fieldToString(tuple[pos.time1]));
+				if(util.time_duration >= 0.0)
+					t2 = t1+util.time_duration;
+				else
 					t2 = rect.end_of_time();
-					error = true;
-				}
+			} catch (const TimeParseException& e){
+				t1 = rect.beginning_of_time();
+				t2 = rect.end_of_time();
+				error = true;
 			}
-			else if (time_specification == TimeSpecification::START_END) {
-				try {
-					t1 = time1Parser->parse(tuple[pos_time1]);
-				} catch (const TimeParseException& e){
-					t1 = rect.beginning_of_time();
-					error = true;
-				}
-				try {
-					t2 = time2Parser->parse(tuple[pos_time2]);
-				} catch (const TimeParseException& e){
-					t2 = rect.end_of_time();
-					error = true;
-				}
-			}
-			else if (time_specification == TimeSpecification::START_DURATION) {
-				try {
-					t1 = time1Parser->parse(tuple[pos_time1]);
-					t2 = t1 + time2Parser->parse(tuple[pos_time2]);
-				} catch (const TimeParseException& e){
-					t1 = rect.beginning_of_time();
-					t2 = rect.end_of_time();
-					error = true;
-				}
+		}
+		else if (util.time_specification == TimeSpecification::START_END) {
+			try {
+				t1 = util.time1Parser->parse(fieldToString(tuple[pos.time1]));
+			} catch (const TimeParseException& e){
+				t1 = rect.beginning_of_time();
+				error = true;
 			}
-
-			if(error) {
-				switch(errorHandling) {
-					case ErrorHandling::ABORT:
-						throw OperatorException("CSVSource: could not parse time");
-					case ErrorHandling::SKIP:
-						collection->removeLastFeature();
-						continue;
-					case ErrorHandling::KEEP:
-						break;
-				}
+			try {
+				t2 = util.time2Parser->parse(fieldToString(tuple[pos.time2]));
+			} catch (const TimeParseException& e){
+				t2 = rect.end_of_time();
+				error = true;
 			}
-			collection->time.push_back(TimeInterval(t1, t2));
 		}
-
-
-
-		// Step 3: extract the attributes
-		for (size_t k=0;k<columns_numeric.size();k++) {
-			double value;
+		else if (util.time_specification == TimeSpecification::START_DURATION) {
 			try {
-				value = std::stod(tuple[pos_numeric[k]].c_str());
-				collection->feature_attributes.numeric(columns_numeric[k]).set(current_idx, value);
-			} catch (const std::exception& e) {
-				switch(errorHandling) {
-					case ErrorHandling::ABORT:
-						throw OperatorException(concat("CSVSource: error parsing double value from string '", tuple[pos_numeric[k]], "' on feature #", current_idx));
-					case ErrorHandling::SKIP:
-						collection->removeLastFeature();
-						added = false;
-						break;
-					case ErrorHandling::KEEP:
-						value = NAN;
-						collection->feature_attributes.numeric(columns_numeric[k]).set(current_idx, value);
-				}
-			}
-			if (!added) {
-				break;
+				t1 = util.time1Parser->parse(fieldToString(tuple[pos.time1]));
+				t2 = t1 + util.time2Parser->parse(fieldToString(tuple[pos.time2]));
+			} catch (const TimeParseException& e){
+				t1 = rect.beginning_of_time();
+				t2 = rect.end_of_time();
+				error = true;
 			}
 		}
-		if (!added) {
-			continue;
+
+		if(error) {
+			switch(util.errorHandling) {
+				case ErrorHandling::ABORT:
+					throw OperatorException("CSVSource: could not parse time");
+				case ErrorHandling::SKIP:
+					collection->removeLastFeature();
+					return false;
+				case ErrorHandling::KEEP:
+					break;
+			}
 		}
-		for (size_t k=0;k<columns_textual.size();k++) {
-			collection->feature_attributes.textual(columns_textual[k]).set(current_idx, tuple[pos_textual[k]]);
+		collection->time.push_back(TimeInterval(t1, t2));
+	}
+
+	// Step 3: extract the attributes
+	for (size_t k=0;k<util.columns_numeric.size();k++) {
+		double value;
+		try {
+			value = fieldToDouble(tuple[pos.numeric[k]]);
+			collection->feature_attributes.numeric(util.columns_numeric[k]).set(current_idx, value);
+		} catch (const std::exception& e) {
+			switch(util.errorHandling) {
+				case ErrorHandling::ABORT:
+					throw OperatorException(concat("CSVSource: error parsing double value from string '", fieldToString(tuple[pos.numeric[k]]), "' on feature #", current_idx));
+				case ErrorHandling::SKIP:
+					collection->removeLastFeature();
+					return false;
+				case ErrorHandling::KEEP:
+					value = NAN;
+					collection->feature_attributes.numeric(util.columns_numeric[k]).set(current_idx, value);
+			}
 		}
+	}
+	for (size_t k=0;k<util.columns_textual.size();k++) {
+		collection->feature_attributes.textual(util.columns_textual[k]).set(current_idx, fieldToString(tuple[pos.textual[k]]));
+	}
+
+	return true;
+}
+
+}
+
+
+void CSVSourceUtil::readAnyCollection(SimpleFeatureCollection *collection, std::istream &data, const QueryRectangle &rect,
+		std::function<bool(const std::string &,const std::string &)> addFeature) {
+
+	//header
+	CSVParser parser(data, field_separator);
+	auto headers = parser.readHeaders();
+
+	auto pos = findColumns(*this, headers, rect);
+	addAttributes(*this, collection);
+
+	size_t current_idx = 0;
+	while (true) {
+		auto tuple = parser.readTuple();
+		if (tuple.size() == 0)
+			break;
+
+		const std::string &x_str = (pos.x == no_pos ? default_x : tuple[pos.x]);
+		const std::string &y_str = (pos.y == no_pos ? default_y : tuple[pos.y]);
 
 		// Step 4: increase the current idx, since our feature is finished
-		current_idx++;
+		if (addTuple(*this, collection, tuple, x_str, y_str, pos, rect, addFeature, current_idx))
+			current_idx++;
 	}
 }
 
@@ -365,6 +412,113 @@ std::unique_ptr<PointCollection> CSVSourceUtil::getPointCollection(std::istream
 	return collection;
 }
 
+std::unique_ptr<PointCollection> CSVSourceUtil::getPointCollectionFromFile(const std::string &filename, const QueryRectangle &rect) {
+	auto readSequentially = [&]() {
+		std::ifstream data(filename);
+		if (!data.is_open())
+			throw OperatorException("URILoader: could not open file");
+		return getPointCollection(data, rect);
+	};
+
+	if (geometry_specification != GeometrySpecification::XY)
+		return readSequentially();
+
+	std::unique_ptr<MappedCSVParser> parser;
+	try {
+		parser = std::make_unique<MappedCSVParser>(filename, field_separator);
+	}
+	catch (const std::exception &e) {
+		return readSequentially();
+	}
+
+	auto pos = findColumns(*this, parser->getHeaders(), rect);
+	if (pos.x == no_pos || pos.y == no_pos)
+		return readSequentially();
+
+	/*
+	 * Every chunk is parsed into a collection of its own, which is filtered right away
+	 */
+	size_t chunk_count = parser->getChunkCount();
+	std::vector<std::unique_ptr<PointCollection>> chunks(chunk_count);
+	std::atomic<bool> failed(false);
+	ThreadPool::getDefault().parallelFor(chunk_count, [&](size_t chunk) {
+		if (failed)
+			return;
+		auto collection = std::make_unique<PointCollection>(rect);
+		addAttributes(*this, collection.get());
+		auto add_xy = [&](const MappedCSVParser::Field &x_str, const MappedCSVParser::Field &y_str) -> bool {
+			// Workaround for safecast data: ignore entries without coordinates
+			if (x_str.empty() || y_str.empty())
+				return false;
+
+			double x, y;
+			x = x_str.toDouble();
+			y = y_str.toDouble();
+
+			collection->addSinglePointFeature(Coordinate(x, y));
+			return true;
+		};
+
+		size_t current_idx = 0;
+		try {
+			parser->parseChunk(chunk, [&](const std::vector<MappedCSVParser::Field> &tuple) {
+				if (addTuple(*this, collection.get(), tuple, tuple[pos.x], tuple[pos.y], pos, rect, add_xy, current_idx))
+					current_idx++;
+			});
+		}
+		catch (const std::exception &e) {
+			failed = true;
+			return;
+		}
+		collection->filterBySpatioTemporalReferenceIntersectionInPlace(rect);
+		chunks[chunk] = std::move(collection);
+	});
+
+	// The sequential parser reports the error, counting the features of the whole file
+	if (failed)
+		return readSequentially();
+
+	auto collection = std::make_unique<PointCollection>(rect);
+	addAttributes(*this, collection.get());
+	size_t feature_count = 0;
+	for (auto &chunk : chunks)
+		feature_count += chunk->getFeatureCount();
+	collection->coordinates.reserve(feature_count);
+	collection->start_feature.reserve(feature_count + 1);
+	if (time_specification != TimeSpecification::NONE)
+		collection->time.reserve(feature_count);
+	for (auto &name : columns_numeric)
+		collection->feature_attributes.numeric(name).reserve(feature_count);
+	for (auto &name : columns_textual)
+		collection->feature_attributes.textual(name).reserve(feature_count);
+
+	for (auto &chunk : chunks) {
+		size_t feature_offset = collection->getFeatureCount();
+		size_t coordinate_offset = collection->coordinates.size();
+		collection->coordinates.insert(collection->coordinates.end(), chunk->coordinates.begin(), chunk->coordinates.end());
+		for (size_t i = 1; i < chunk->start_feature.size(); i++)
+			collection->start_feature.push_back(coordinate_offset + chunk->start_feature[i]);
+		collection->time.insert(collection->time.end(), chunk->time.begin(), chunk->time.end());
+
+		size_t count = chunk->getFeatureCount();
+		for (auto &name : columns_numeric) {
+			auto &source = chunk->feature_attributes.numeric(name);
+			auto &target = collection->feature_attributes.numeric(name);
+			for (size_t i = 0; i < count; i++)
+				target.set(feature_offset + i, source.get(i));
+		}
+		for (auto &name : columns_textual) {
+			auto &source = chunk->feature_attributes.textual(name);
+			auto &target = collection->feature_attributes.textual(name);
+			for (size_t i = 0; i < count; i++)
+				target.set(feature_offset + i, source.get(i));
+		}
+		chunk.reset();
+	}
+
+	return collection;
+}
+
 std::unique_ptr<LineCollection> CSVSourceUtil::getLineCollection(std::istream &data, const QueryRectangle &rect) {
 	auto collection = std::make_unique<LineCollection>(rect);
 	auto add_wkt = [&](const std::string &wkt, const std::string &) -> bool {
@@ -88,6 +88,13 @@ class CSVSourceUtil {
 		std::unique_ptr<LineCollection> getLineCollection(std::istream &data, const QueryRectangle &rect);
 		std::unique_ptr<PolygonCollection> getPolygonCollection(std::istream &data, const QueryRectangle &rect);
 
+		/**
+		 * Reads the points of a local file. Files with xy coordinates are memory-mapped and parsed in
+		 * chunks, which are processed in parallel. Other files, and files with errors, are read with
+		 * getPointCollection(std::istream &, const QueryRectangle &), with the same results.
+		 */
+		std::unique_ptr<PointCollection> getPointCollectionFromFile(const std::string &filename, const QueryRectangle &rect);
+
 		void readAnyCollection(SimpleFeatureCollection *collection, std::istream &data, const QueryRectangle &rect,
 					std::function<bool(const std::string &,const std::string &)> addFeature);
 
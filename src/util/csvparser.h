@@ -1,3 +1,5 @@
+#ifndef UTIL_CSVPARSER_H
+#define UTIL_CSVPARSER_H
 
 #include "util/exceptions.h"
 
@@ -29,5 +31,4 @@ class CSVParser {
 		std::istream &in;
 };
 
-
-
+#endif
@@ -75,6 +75,7 @@ _CUSTOM_EXCEPTION_CLASS(TimeParseException);
 _CUSTOM_EXCEPTION_CLASS(PermissionDeniedException);
 _CUSTOM_EXCEPTION_CLASS(NoRasterForGivenTimeException);
 _CUSTOM_EXCEPTION_CLASS(ProcessingException);
+_CUSTOM_EXCEPTION_CLASS(QueryCancelledException, ProcessingException);
 
 // Added Micha
 _CUSTOM_EXCEPTION_CLASS(CacheException);
@@ -1,11 +1,18 @@
 
 #include "util/formula.h"
 
+#include <memory>
+#include <cmath>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+#include <limits>
+
 Formula::Formula(const std::string &formula) : formula(formula) {
 }
 
 void Formula::addFunction(size_t arguments, const std::string &sourcename, const std::string &translatedname) {
-	// TODO: implement
+	functions[sourcename] = Function{arguments, translatedname.empty() ? sourcename : translatedname};
 }
 void Formula::addCLFunctions() {
 	// https://www.khronos.org/registry/cl/sdk/1.0/docs/man/xhtml/mathFunctions.html
@@ -41,8 +48,10 @@ void Formula::addCLFunctions() {
 	addFunction(1, "log10");
 }
 
-void Formula::addVariable(const std::string variable, const std::string &translatedname) {
-	// TODO: implement
+void Formula::addVariable(const std::string variable, const std::string &translatedname, Type type) {
+	auto it = variables.find(variable);
+	size_t index = it != variables.end() ? it->second.index : variables.size();
+	variables[variable] = Variable{index, type};
 }
 
 
@@ -62,3 +71,468 @@ std::string Formula::parse() {
 
 	return formula;
 }
+
+
+/*
+ * Compiling
+ */
+// The implementations of the functions, by their translated name
+static const std::map<std::string, double (*)(double)> cpu_functions1 = {
+	{"sin", [](double x) { return std::sin(x); }},
+	{"asin", [](double x) { return std::asin(x); }},
+	{"cos", [](double x) { return std::cos(x); }},
+	{"acos", [](double x) { return std::acos(x); }},
+	{"tan", [](double x) { return std::tan(x); }},
+	{"atan", [](double x) { return std::atan(x); }},
+	{"ceil", [](double x) { return std::ceil(x); }},
+	{"floor", [](double x) { return std::floor(x); }},
+	{"round", [](double x) { return std::round(x); }},
+	{"trunc", [](double x) { return std::trunc(x); }},
+	{"fabs", [](double x) { return std::fabs(x); }},
+	{"fract", [](double x) { return std::fmin(x - std::floor(x), std::nextafter(1.0, 0.0)); }},
+	{"sqrt", [](double x) { return std::sqrt(x); }},
+	{"exp", [](double x) { return std::exp(x); }},
+	{"exp2", [](double x) { return std::exp2(x); }},
+	{"exp10", [](double x) { return std::pow(10.0, x); }},
+	{"log", [](double x) { return std::log(x); }},
+	{"log2", [](double x) { return std::log2(x); }},
+	{"log10", [](double x) { return std::log10(x); }}
+};
+static const std::map<std::string, double (*)(double, double)> cpu_functions2 = {
+	{"fmod", [](double x, double y) { return std::fmod(x, y); }},
+	{"remainder", [](double x, double y) { return std::remainder(x, y); }},
+	{"pow", [](double x, double y) { return std::pow(x, y); }}
+};
+
+// The scalar semantics of the operators, shared by constant folding and evaluation
+static inline double opNegate(double a) { return -a; }
+static inline double opNot(double a) { return a == 0 ? 1 : 0; }
+static inline double opBitNot(double a) { return (double) ~(int64_t) a; }
+static inline double opAdd(double a, double b) { return a + b; }
+static inline double opSubtract(double a, double b) { return a - b; }
+static inline double opMultiply(double a, double b) { return a * b; }
+static inline double opDivide(double a, double b) { return a / b; }
+static inline double opDivideInteger(double a, double b) { return std::trunc(a / b); }
+static inline double opModulo(double a, double b) { return std::fmod(a, b); }
+static inline double opShiftLeft(double a, double b) { return (double) (int64_t) ((uint64_t) (int64_t) a << ((int64_t) b & 63)); }
+static inline double opShiftRight(double a, double b) { return (double) ((int64_t) a >> ((int64_t) b & 63)); }
+static inline double opBitAnd(double a, double b) { return (double) ((int64_t) a & (int64_t) b); }
+static inline double opBitOr(double a, double b) { return (double) ((int64_t) a | (int64_t) b); }
+static inline double opBitXor(double a, double b) { return (double) ((int64_t) a ^ (int64_t) b); }
+static inline double opLess(double a, double b) { return a < b ? 1 : 0; }
+static inline double opLessEqual(double a, double b) { return a <= b ? 1 : 0; }
+static inline double opGreater(double a, double b) { return a > b ? 1 : 0; }
+static inline double opGreaterEqual(double a, double b) { return a >= b ? 1 : 0; }
+static inline double opEqual(double a, double b) { return a == b ? 1 : 0; }
+static inline double opNotEqual(double a, double b) { return a != b ? 1 : 0; }
+static inline double opAnd(double a, double b) { return (a != 0 && b != 0) ? 1 : 0; }
+static inline double opOr(double a, double b) { return (a != 0 || b != 0) ? 1 : 0; }
+static inline double opSelect(double a, double b, double c) { return a != 0 ? b : c; }
+
+/*
+ * A recursive descent parser with the precedence rules of C, building a syntax tree,
+ * which is then emitted as instructions.
+ */
+class FormulaCompiler {
+	public:
+		FormulaCompiler(const Formula &formula) : formula(formula), source(formula.formula), pos(0), depth(0) {}
+
+		FormulaProgram compile() {
+			auto root = parseExpression();
+			skipWhitespace();
+			if (pos < source.size())
+				fail(concat("unexpected '", source[pos], "'"));
+
+			program.variable_count = formula.variables.size();
+			program.result_type = root->type;
+			emit(*root, 0);
+			return std::move(program);
+		}
+
+	private:
+		typedef FormulaProgram::Op Op;
+		struct Node {
+			Op op;
+			Formula::Type type;
+			double value;
+			double (*function1)(double);
+			double (*function2)(double, double);
+			std::vector<std::unique_ptr<Node>> args;
+		};
+		typedef std::unique_ptr<Node> NodePtr;
+
+		static const size_t MAX_DEPTH = 200;
+
+		const Formula &formula;
+		const std::string &source;
+		size_t pos;
+		size_t depth;
+		FormulaProgram program;
+
+		void fail(const std::string &message) {
+			throw Formula::parse_error(concat("Formula: ", message, " at position ", pos));
+		}
+
+		void skipWhitespace() {
+			while (pos < source.size() && std::isspace((unsigned char) source[pos]))
+				pos++;
+		}
+
+		bool accept(const char *token) {
+			skipWhitespace();
+			size_t len = strlen(token);
+			if (source.compare(pos, len, token) != 0)
+				return false;
+			// do not mistake a part of "<=", "<<", "&&" etc for a shorter token
+			if (len == 1 && pos + 1 < source.size()) {
+				char next = source[pos+1];
+				if ((strchr("<>=!", token[0]) && next == '=') || (strchr("<>&|", token[0]) && next == token[0]))
+					return false;
+			}
+			pos += len;
+			return true;
+		}
+
+		void expect(const char *token) {
+			if (!accept(token))
+				fail(concat("expected '", token, "'"));
+		}
+
+		static Formula::Type promote(const Node &a, const Node &b) {
+			return (a.type == Formula::Type::INTEGER && b.type == Formula::Type::INTEGER) ? Formula::Type::INTEGER : Formula::Type::FLOAT;
+		}
+
+		static bool isBitwise(Op op) {
+			return op == Op::SHIFT_LEFT || op == Op::SHIFT_RIGHT || op == Op::BIT_AND || op == Op::BIT_OR || op == Op::BIT_XOR;
+		}
+
+		static bool isConstant(const Node &n) {
+			return n.op == Op::CONSTANT;
+		}
+
+		static NodePtr makeConstant(double value, Formula::Type type) {
+			NodePtr n(new Node{Op::CONSTANT, type, value, nullptr, nullptr, {}});
+			return n;
+		}
+
+		static NodePtr makeNode(Op op, Formula::Type type, std::vector<NodePtr> &&args) {
+			NodePtr n(new Node{op, type, 0, nullptr, nullptr, std::move(args)});
+			return fold(std::move(n));
+		}
+
+		// Replaces operations on constants by their result
+		static NodePtr fold(NodePtr n) {
+			for (auto &arg : n->args)
+				if (!isConstant(*arg))
+					return n;
+			double a = n->args.size() > 0 ? n->args[0]->value : 0;
+			double b = n->args.size() > 1 ? n->args[1]->value : 0;
+			double c = n->args.size() > 2 ? n->args[2]->value : 0;
+			double result;
+			switch (n->op) {
+				case Op::NEGATE: result = opNegate(a); break;
+				case Op::NOT: result = opNot(a); break;
+				case Op::BIT_NOT: result = opBitNot(a); break;
+				case Op::ADD: result = opAdd(a, b); break;
+				case Op::SUBTRACT: result = opSubtract(a, b); break;
+				case Op::MULTIPLY: result = opMultiply(a, b); break;
+				case Op::DIVIDE: result = opDivide(a, b); break;
+				case Op::DIVIDE_INTEGER: result = opDivideInteger(a, b); break;
+				case Op::MODULO: result = opModulo(a, b); break;
+				case Op::SHIFT_LEFT: result = opShiftLeft(a, b); break;
+				case Op::SHIFT_RIGHT: result = opShiftRight(a, b); break;
+				case Op::BIT_AND: result = opBitAnd(a, b); break;
+				case Op::BIT_OR: result = opBitOr(a, b); break;
+				case Op::BIT_XOR: result = opBitXor(a, b); break;
+				case Op::LESS: result = opLess(a, b); break;
+				case Op::LESS_EQUAL: result = opLessEqual(a, b); break;
+				case Op::GREATER: result = opGreater(a, b); break;
+				case Op::GREATER_EQUAL: result = opGreaterEqual(a, b); break;
+				case Op::EQUAL: result = opEqual(a, b); break;
+				case Op::NOT_EQUAL: result = opNotEqual(a, b); break;
+				case Op::AND: result = opAnd(a, b); break;
+				case Op::OR: result = opOr(a, b); break;
+				case Op::SELECT: result = opSelect(a, b, c); break;
+				case Op::FUNCTION1: result = n->function1(a); break;
+				case Op::FUNCTION2: result = n->function2(a, b); break;
+				default: return n;
+			}
+			return makeConstant(result, n->type);
+		}
+
+		static std::vector<NodePtr> args(NodePtr a, NodePtr b = nullptr, NodePtr c = nullptr) {
+			std::vector<NodePtr> result;
+			result.push_back(std::move(a));
+			if (b)
+				result.push_back(std::move(b));
+			if (c)
+				result.push_back(std::move(c));
+			return result;
+		}
+
+		NodePtr parseExpression() {
+			if (++depth > MAX_DEPTH)
+				fail("too deeply nested");
+			auto condition = parseBinary(0);
+			if (accept("?")) {
+				auto a = parseExpression();
+				expect(":");
+				auto b = parseExpression();
+				auto type = promote(*a, *b);
+				condition = makeNode(Op::SELECT, type, args(std::move(condition), std::move(a), std::move(b)));
+			}
+			depth--;
+			return condition;
+		}
+
+		// binary operators from the lowest to the highest precedence
+		NodePtr parseBinary(int level) {
+			static const std::vector<std::vector<std::pair<const char *, Op>>> levels = {
+				{{"||", Op::OR}},
+				{{"&&", Op::AND}},
+				{{"|", Op::BIT_OR}},
+				{{"^", Op::BIT_XOR}},
+				{{"&", Op::BIT_AND}},
+				{{"==", Op::EQUAL}, {"!=", Op::NOT_EQUAL}},
+				{{"<=", Op::LESS_EQUAL}, {">=", Op::GREATER_EQUAL}, {"<", Op::LESS}, {">", Op::GREATER}},
+				{{"<<", Op::SHIFT_LEFT}, {">>", Op::SHIFT_RIGHT}},
+				{{"+", Op::ADD}, {"-", Op::SUBTRACT}},
+				{{"*", Op::MULTIPLY}, {"/", Op::DIVIDE}, {"%", Op::MODULO}}
+			};
+			if (level == (int) levels.size())
+				return parseUnary();
+
+			auto left = parseBinary(level + 1);
+			while (true) {
+				bool found = false;
+				for (auto &op : levels[level]) {
+					if (!accept(op.first))
+						continue;
+					auto right = parseBinary(level + 1);
+					Formula::Type type = promote(*left, *right);
+					Op code = op.second;
+					if (isBitwise(code) && type != Formula::Type::INTEGER)
+						fail("bitwise operators require integer operands");
+					if (code == Op::DIVIDE && type == Formula::Type::INTEGER)
+						code = Op::DIVIDE_INTEGER;
+					// comparisons and logical operators result in 0 or 1
+					if (code != Op::ADD && code != Op::SUBTRACT && code != Op::MULTIPLY && code != Op::DIVIDE && code != Op::MODULO)
+						type = Formula::Type::INTEGER;
+					left = makeNode(code, type, args(std::move(left), std::move(right)));
+					found = true;
+					break;
+				}
+				if (!found)
+					return left;
+			}
+		}
+
+		NodePtr parseUnary() {
+			if (++depth > MAX_DEPTH)
+				fail("too deeply nested");
+			NodePtr result;
+			if (accept("-")) {
+				auto a = parseUnary();
+				auto type = a->type;
+				result = makeNode(Op::NEGATE, type, args(std::move(a)));
+			}
+			else if (accept("+"))
+				result = parseUnary();
+			else if (accept("!"))
+				result = makeNode(Op::NOT, Formula::Type::INTEGER, args(parseUnary()));
+			else if (accept("~")) {
+				auto a = parseUnary();
+				if (a->type != Formula::Type::INTEGER)
+					fail("bitwise operators require integer operands");
+				result = makeNode(Op::BIT_NOT, Formula::Type::INTEGER, args(std::move(a)));
+			}
+			else
+				result = parsePrimary();
+			depth--;
+			return result;
+		}
+
+		NodePtr parsePrimary() {
+			skipWhitespace();
+			if (pos >= source.size())
+				fail("unexpected end");
+
+			if (accept("(")) {
+				auto result = parseExpression();
+				expect(")");
+				return result;
+			}
+
+			char c = source[pos];
+			if (std::isdigit((unsigned char) c) || c == '.')
+				return parseNumber();
+			if (std::isalpha((unsigned char) c) || c == '_')
+				return parseIdentifier();
+			fail(concat("unexpected '", c, "'"));
+			return nullptr;
+		}
+
+		NodePtr parseNumber() {
+			size_t start = pos;
+			bool is_float = false;
+			while (pos < source.size() && (std::isdigit((unsigned char) source[pos]) || source[pos] == '.')) {
+				is_float |= source[pos] == '.';
+				pos++;
+			}
+			if (pos < source.size() && (source[pos] == 'e' || source[pos] == 'E')) {
+				is_float = true;
+				pos++;
+				if (pos < source.size() && (source[pos] == '+' || source[pos] == '-'))
+					pos++;
+				if (pos >= source.size() || !std::isdigit((unsigned char) source[pos]))
+					fail("invalid number");
+				while (pos < source.size() && std::isdigit((unsigned char) source[pos]))
+					pos++;
+			}
+			std::string number = source.substr(start, pos - start);
+			if (pos < source.size() && (source[pos] == 'f' || source[pos] == 'F') && is_float)
+				pos++;
+			if (pos < source.size() && (std::isalnum((unsigned char) source[pos]) || source[pos] == '_' || source[pos] == '.'))
+				fail("invalid number");
+
+			char *end;
+			double value = strtod(number.c_str(), &end);
+			if (*end != 0 || number == ".")
+				fail("invalid number");
+			return makeConstant(value, is_float ? Formula::Type::FLOAT : Formula::Type::INTEGER);
+		}
+
+		NodePtr parseIdentifier() {
+			size_t start = pos;
+			while (pos < source.size() && (std::isalnum((unsigned char) source[pos]) || source[pos] == '_'))
+				pos++;
+			std::string name = source.substr(start, pos - start);
+
+			if (!accept("(")) {
+				auto it = formula.variables.find(name);
+				if (it == formula.variables.end())
+					fail(concat("unknown variable '", name, "'"));
+				NodePtr n(new Node{Op::VARIABLE, it->second.type, (double) it->second.index, nullptr, nullptr, {}});
+				return n;
+			}
+
+			auto it = formula.functions.find(name);
+			if (it == formula.functions.end())
+				fail(concat("unknown function '", name, "'"));
+			std::vector<NodePtr> arguments;
+			if (!accept(")")) {
+				do {
+					arguments.push_back(parseExpression());
+				} while (accept(","));
+				expect(")");
+			}
+			if (arguments.size() != it->second.arguments)
+				fail(concat("function '", name, "' expects ", it->second.arguments, " arguments"));
+
+			auto &translated = it->second.translatedname;
+			if (arguments.size() == 1 && cpu_functions1.count(translated)) {
+				NodePtr n(new Node{Op::FUNCTION1, Formula::Type::FLOAT, 0, cpu_functions1.at(translated), nullptr, std::move(arguments)});
+				return fold(std::move(n));
+			}
+			if (arguments.size() == 2 && cpu_functions2.count(translated)) {
+				NodePtr n(new Node{Op::FUNCTION2, Formula::Type::FLOAT, 0, nullptr, cpu_functions2.at(translated), std::move(arguments)});
+				return fold(std::move(n));
+			}
+			fail(concat("function '", name, "' is not available on the CPU"));
+			return nullptr;
+		}
+
+		// Emits the instructions computing the node into the given register, using the registers above it for intermediate results
+		void emit(const Node &n, size_t reg) {
+			if (reg + n.args.size() >= std::numeric_limits<uint16_t>::max())
+				fail("too complex");
+			program.registers = std::max(program.registers, reg + 1);
+			for (size_t i = 0; i < n.args.size(); i++)
+				emit(*n.args[i], reg + i);
+			uint16_t r = (uint16_t) reg;
+			program.code.push_back(FormulaProgram::Instruction{n.op, r, r, (uint16_t) (r + 1), (uint16_t) (r + 2), n.value, n.function1, n.function2});
+		}
+};
+
+FormulaProgram Formula::compile() const {
+	return FormulaCompiler(*this).compile();
+}
+
+
+/*
+ * Evaluation
+ */
+const size_t FormulaProgram::BATCH_SIZE;
+
+template<double (*op)(double)>
+static inline void applyUnary(double *dst, const double *a, size_t count) {
+	for (size_t i = 0; i < count; i++)
+		dst[i] = op(a[i]);
+}
+
+template<double (*op)(double, double)>
+static inline void applyBinary(double *dst, const double *a, const double *b, size_t count) {
+	for (size_t i = 0; i < count; i++)
+		dst[i] = op(a[i], b[i]);
+}
+
+void FormulaProgram::evaluate(const double * const *variables, double *result, size_t count) const {
+	std::vector<double> scratch;
+	evaluate(variables, result, count, scratch);
+}
+
+void FormulaProgram::evaluate(const double * const *variables, double *result, size_t count, std::vector<double> &scratch) const {
+	if (code.empty())
+		throw ArgumentException("FormulaProgram: cannot evaluate a program that was not compiled");
+	// two more registers, as unused operands of an instruction may point beyond the last register
+	scratch.resize((registers + 2) * BATCH_SIZE);
+
+	for (size_t start = 0; start < count; start += BATCH_SIZE) {
+		size_t n = std::min(BATCH_SIZE, count - start);
+		for (auto &i : code) {
+			double *dst = &scratch[i.dst * BATCH_SIZE];
+			const double *a = &scratch[i.a * BATCH_SIZE];
+			const double *b = &scratch[i.b * BATCH_SIZE];
+			const double *c = &scratch[i.c * BATCH_SIZE];
+			switch (i.op) {
+				case Op::CONSTANT: std::fill(dst, dst + n, i.value); break;
+				case Op::VARIABLE: memcpy(dst, variables[(size_t) i.value] + start, n * sizeof(double)); break;
+				case Op::NEGATE: applyUnary<opNegate>(dst, a, n); break;
+				case Op::NOT: applyUnary<opNot>(dst, a, n); break;
+				case Op::BIT_NOT: applyUnary<opBitNot>(dst, a, n); break;
+				case Op::ADD: applyBinary<opAdd>(dst, a, b, n); break;
+				case Op::SUBTRACT: applyBinary<opSubtract>(dst, a, b, n); break;
+				case Op::MULTIPLY: applyBinary<opMultiply>(dst, a, b, n); break;
+				case Op::DIVIDE: applyBinary<opDivide>(dst, a, b, n); break;
+				case Op::DIVIDE_INTEGER: applyBinary<opDivideInteger>(dst, a, b, n); break;
+				case Op::MODULO: applyBinary<opModulo>(dst, a, b, n); break;
+				case Op::SHIFT_LEFT: applyBinary<opShiftLeft>(dst, a, b, n); break;
+				case Op::SHIFT_RIGHT: applyBinary<opShiftRight>(dst, a, b, n); break;
+				case Op::BIT_AND: applyBinary<opBitAnd>(dst, a, b, n); break;
+				case Op::BIT_OR: applyBinary<opBitOr>(dst, a, b, n); break;
+				case Op::BIT_XOR: applyBinary<opBitXor>(dst, a, b, n); break;
+				case Op::LESS: applyBinary<opLess>(dst, a, b, n); break;
+				case Op::LESS_EQUAL: applyBinary<opLessEqual>(dst, a, b, n); break;
+				case Op::GREATER: applyBinary<opGreater>(dst, a, b, n); break;
+				case Op::GREATER_EQUAL: applyBinary<opGreaterEqual>(dst, a, b, n); break;
+				case Op::EQUAL: applyBinary<opEqual>(dst, a, b, n); break;
+				case Op::NOT_EQUAL: applyBinary<opNotEqual>(dst, a, b, n); break;
+				case Op::AND: applyBinary<opAnd>(dst, a, b, n); break;
+				case Op::OR: applyBinary<opOr>(dst, a, b, n); break;
+				case Op::SELECT:
+					for (size_t j = 0; j < n; j++)
+						dst[j] = opSelect(a[j], b[j], c[j]);
+					break;
+				case Op::FUNCTION1:
+					for (size_t j = 0; j < n; j++)
+						dst[j] = i.function1(a[j]);
+					break;
+				case Op::FUNCTION2:
+					for (size_t j = 0; j < n; j++)
+						dst[j] = i.function2(a[j], b[j]);
+					break;
+			}
+		}
+		memcpy(result + start, scratch.data(), n * sizeof(double));
+	}
+}
@@ -5,6 +5,10 @@
 
 #include <string>
 #include <vector>
+#include <map>
+#include <cstdint>
+
+class FormulaProgram;
 
 /*
  * This class is meant to model user-inputted formulas.
@@ -12,12 +16,21 @@
  * We may want to concatenate a user-supplied formula into an opencl kernel.
  * Obviously, we must to sanitze it first, making sure it doesn't contain loops, pointer arithmetic etc.
  *
- * So far, this is a stub. It will catch most obvious hacking attempts, but will not catch formulas
- * that are otherwise invalid for proper error reporting.
+ * parse() only catches the most obvious hacking attempts. compile() fully parses the formula
+ * using the registered functions and variables and translates it for evaluation on the CPU.
  */
 
 class Formula {
 	public:
+		/*
+		 * Variables have the semantics of the C types they are stored in: dividing two integers
+		 * truncates the result. The remainder % is computed like fmod(), also for floats.
+		 */
+		enum class Type {
+			INTEGER,
+			FLOAT
+		};
+
 		Formula(const std::string &formula);
 		~Formula() = default;
 		Formula(const Formula &other) = delete;
@@ -25,15 +38,87 @@ class Formula {
 		void addFunction(size_t arguments, const std::string &sourcename, const std::string &translatedname = "");
 		void addCLFunctions();
 
-		void addVariable(const std::string variable, const std::string &translatedname = "");
+		void addVariable(const std::string variable, const std::string &translatedname = "", Type type = Type::FLOAT);
 
 		std::string parse();
 
+		/*
+		 * Parses the formula and translates it into a program for the CPU.
+		 * The program's variables are numbered in the order they were added.
+		 */
+		FormulaProgram compile() const;
+
 		class parse_error : public std::runtime_error {
 			using std::runtime_error::runtime_error;
 		};
 	private:
+		friend class FormulaCompiler;
+		struct Function {
+			size_t arguments;
+			std::string translatedname;
+		};
+		struct Variable {
+			size_t index;
+			Type type;
+		};
 		std::string formula;
+		std::map<std::string, Function> functions;
+		std::map<std::string, Variable> variables;
+};
+
+
+/*
+ * A formula compiled to a sequence of instructions on registers.
+ *
+ * Every instruction processes a whole batch of values at once, which keeps the
+ * interpretation overhead low and lets the compiler vectorize the arithmetic.
+ * All values are held as doubles, which represent every supported integer exactly.
+ * Integer operations are carried out on 64 bit integers.
+ */
+class FormulaProgram {
+	public:
+		static const size_t BATCH_SIZE = 256;
+
+		FormulaProgram() = default;
+
+		/*
+		 * Evaluates the formula for count sets of variables
+		 * @param variables one array of count values for each variable
+		 * @param result an array for count results
+		 * @param scratch memory for the registers, kept by the caller to avoid allocations on repeated calls
+		 */
+		void evaluate(const double * const *variables, double *result, size_t count, std::vector<double> &scratch) const;
+		void evaluate(const double * const *variables, double *result, size_t count) const;
+
+		size_t getVariableCount() const { return variable_count; }
+		// Integer results may exceed the range of the output type and should wrap around like in C
+		Formula::Type getResultType() const { return result_type; }
+		size_t getInstructionCount() const { return code.size(); }
+
+	private:
+		friend class FormulaCompiler;
+
+		enum class Op : uint8_t {
+			CONSTANT, VARIABLE,
+			NEGATE, NOT, BIT_NOT,
+			ADD, SUBTRACT, MULTIPLY, DIVIDE, DIVIDE_INTEGER, MODULO,
+			SHIFT_LEFT, SHIFT_RIGHT, BIT_AND, BIT_OR, BIT_XOR,
+			LESS, LESS_EQUAL, GREATER, GREATER_EQUAL, EQUAL, NOT_EQUAL,
+			AND, OR, SELECT,
+			FUNCTION1, FUNCTION2
+		};
+		struct Instruction {
+			Op op;
+			uint16_t dst, a, b, c;
+			double value; // CONSTANT: the value, VARIABLE: the index
+			double (*function1)(double);
+			double (*function2)(double, double);
+		};
+
+		std::vector<Instruction> code;
+		size_t registers = 0;
+		size_t variable_count = 0;
+		Formula::Type result_type = Formula::Type::FLOAT;
 };
 
 
@@ -0,0 +1,237 @@
+#include "util/gdal_dataset_cache.h"
+#include "util/gdal.h"
+#include "util/configuration.h"
+
+#include <gdal_priv.h>
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+bool GDALDatasetCache::FileStamp::operator==(const FileStamp &other) const {
+	return mtime_sec == other.mtime_sec && mtime_nsec == other.mtime_nsec && size == other.size
+		&& overview_mtime_sec == other.overview_mtime_sec && overview_mtime_nsec == other.overview_mtime_nsec
+		&& overview_size == other.overview_size;
+}
+
+namespace {
+
+typedef GDALDatasetCache::FileStamp FileStamp;
+
+static FileStamp getFileStamp(const std::string &filename) {
+	FileStamp stamp;
+	struct stat st;
+	if (stat(filename.c_str(), &st) == 0) {
+		stamp.mtime_sec = st.st_mtim.tv_sec;
+		stamp.mtime_nsec = st.st_mtim.tv_nsec;
+		stamp.size = st.st_size;
+	}
+	// GDAL picks up overviews built later only when the dataset is opened again
+	if (stat((filename + ".ovr").c_str(), &st) == 0) {
+		stamp.overview_mtime_sec = st.st_mtim.tv_sec;
+		stamp.overview_mtime_nsec = st.st_mtim.tv_nsec;
+		stamp.overview_size = st.st_size;
+	}
+	return stamp;
+}
+
+struct IdleHandle {
+	std::string filename;
+	GDALDataset *dataset;
+	FileStamp stamp;
+};
+
+struct HandleCache {
+	HandleCache()
+		: capacity(Configuration::get<size_t>("gdal_source.datasetcache", 32)),
+		  pid(getpid()), hits(0), misses(0), evictions(0), idle_count(0) {}
+
+	const size_t capacity;
+
+	std::mutex mutex;
+	pid_t pid;
+	// most recently used first
+	std::list<IdleHandle> idle;
+	std::unordered_multimap<std::string, std::list<IdleHandle>::iterator> by_filename;
+
+	std::atomic<uint64_t> hits;
+	std::atomic<uint64_t> misses;
+	std::atomic<uint64_t> evictions;
+	std::atomic<size_t> idle_count;
+
+	/*
+	 * Takes an idle handle of the file with the given stamp. Handles with an outdated stamp are
+	 * moved to stale for closing outside of the lock.
+	 */
+	GDALDataset *take(const std::string &filename, const FileStamp &stamp, std::vector<GDALDataset *> &stale) {
+		std::lock_guard<std::mutex> guard(mutex);
+		forgetAfterFork();
+		GDALDataset *dataset = nullptr;
+		auto range = by_filename.equal_range(filename);
+		for (auto it = range.first; it != range.second; ) {
+			auto handle = it->second;
+			if (handle->stamp == stamp) {
+				if (dataset != nullptr) {
+					++it;
+					continue;
+				}
+				dataset = handle->dataset;
+			}
+			else
+				stale.push_back(handle->dataset);
+			idle.erase(handle);
+			it = by_filename.erase(it);
+		}
+		idle_count = idle.size();
+		return dataset;
+	}
+
+	/*
+	 * Keeps a handle for reuse. The handles exceeding the capacity are moved to evicted.
+	 */
+	void put(const std::string &filename, GDALDataset *dataset, const FileStamp &stamp, std::vector<GDALDataset *> &evicted) {
+		std::lock_guard<std::mutex> guard(mutex);
+		forgetAfterFork();
+		idle.push_front(IdleHandle{filename, dataset, stamp});
+		by_filename.emplace(filename, idle.begin());
+		while (idle.size() > capacity)
+			evicted.push_back(removeOldest());
+		idle_count = idle.size();
+	}
+
+	GDALDataset *removeOldest() {
+		auto handle = std::prev(idle.end());
+		auto range = by_filename.equal_range(handle->filename);
+		for (auto it = range.first; it != range.second; ++it) {
+			if (it->second == handle) {
+				by_filename.erase(it);
+				break;
+			}
+		}
+		auto dataset = handle->dataset;
+		idle.pop_back();
+		return dataset;
+	}
+
+	/*
+	 * A forked child shares the file offsets of the parent's handles, so it must not use them.
+	 * They are dropped without closing, which would not affect the parent but might flush caches.
+	 */
+	void forgetAfterFork() {
+		if (pid == getpid())
+			return;
+		pid = getpid();
+		idle.clear();
+		by_filename.clear();
+	}
+
+	void close(std::vector<GDALDataset *> &datasets) {
+		for (auto dataset : datasets) {
+			GDALClose(dataset);
+			evictions++;
+		}
+		datasets.clear();
+	}
+};
+
+// Never destroyed, so no dataset is closed after GDAL has been shut down
+static HandleCache &getHandleCache() {
+	static HandleCache *cache = new HandleCache();
+	return *cache;
+}
+
+}
+
+
+GDALDatasetCache::Lease::Lease(GDALDataset *dataset, const std::string &filename, const FileStamp &stamp)
+	: dataset(dataset), filename(filename), stamp(stamp) {
+}
+
+GDALDatasetCache::Lease::~Lease() {
+	release();
+}
+
+GDALDatasetCache::Lease::Lease(Lease &&other) noexcept
+	: dataset(other.dataset), filename(std::move(other.filename)), stamp(other.stamp) {
+	other.dataset = nullptr;
+}
+
+GDALDatasetCache::Lease &GDALDatasetCache::Lease::operator=(Lease &&other) noexcept {
+	if (this != &other) {
+		release();
+		dataset = other.dataset;
+		filename = std::move(other.filename);
+		stamp = other.stamp;
+		other.dataset = nullptr;
+	}
+	return *this;
+}
+
+void GDALDatasetCache::Lease::discard() {
+	if (dataset != nullptr) {
+		GDALClose(dataset);
+		dataset = nullptr;
+	}
+}
+
+void GDALDatasetCache::Lease::release() {
+	if (dataset == nullptr)
+		return;
+	auto &cache = getHandleCache();
+	std::vector<GDALDataset *> evicted;
+	if (cache.capacity > 0)
+		cache.put(filename, dataset, stamp, evicted);
+	else
+		evicted.push_back(dataset);
+	dataset = nullptr;
+	cache.close(evicted);
+}
+
+
+GDALDatasetCache::Lease GDALDatasetCache::open(const std::string &filename) {
+	GDAL::init();
+	auto &cache = getHandleCache();
+	auto stamp = getFileStamp(filename);
+
+	std::vector<GDALDataset *> stale;
+	GDALDataset *dataset = cache.capacity > 0 ? cache.take(filename, stamp, stale) : nullptr;
+	cache.close(stale);
+
+	if (dataset != nullptr)
+		cache.hits++;
+	else {
+		cache.misses++;
+		dataset = (GDALDataset *) GDALOpen(filename.c_str(), GA_ReadOnly);
+		if (dataset == nullptr)
+			return Lease();
+	}
+	return Lease(dataset, filename, stamp);
+}
+
+void GDALDatasetCache::clear() {
+	auto &cache = getHandleCache();
+	std::vector<GDALDataset *> closed;
+	{
+		std::lock_guard<std::mutex> guard(cache.mutex);
+		cache.forgetAfterFork();
+		while (!cache.idle.empty())
+			closed.push_back(cache.removeOldest());
+		cache.idle_count = 0;
+	}
+	cache.close(closed);
+}
+
+GDALDatasetCache::Statistics GDALDatasetCache::getStatistics() {
+	auto &cache = getHandleCache();
+	Statistics statistics;
+	statistics.hits = cache.hits;
+	statistics.misses = cache.misses;
+	statistics.evictions = cache.evictions;
+	statistics.idle = cache.idle_count;
+	return statistics;
+}
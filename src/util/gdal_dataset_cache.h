@@ -0,0 +1,91 @@
+#ifndef UTIL_GDAL_DATASET_CACHE_H_
+#define UTIL_GDAL_DATASET_CACHE_H_
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+class GDALDataset;
+
+/**
+ * Cache of opened GDAL datasets, so that consecutive queries on the same file do not have to
+ * open it (and parse its header) again.
+ *
+ * A GDALDataset must not be used by several threads at once. Every lease therefore grants
+ * exclusive use of a handle; concurrent queries on the same file open handles of their own.
+ * When a lease ends, its handle is kept for reuse. The least recently used handles are closed
+ * once more than gdal_source.datasetcache handles are idle.
+ *
+ * Handles of local files are reopened when the modification time or size of the file or of its
+ * external overviews (<filename>.ovr) has changed, e.g. after mapping_manager buildgdaloverviews.
+ */
+class GDALDatasetCache {
+	public:
+		/**
+		 * The state of a local file, a handle is reused only while it does not change
+		 */
+		struct FileStamp {
+			time_t mtime_sec = 0;
+			long mtime_nsec = 0;
+			int64_t size = -1; // -1 if the file could not be stat()ed, e.g. for /vsicurl/ urls
+			// of the external overviews, -1 if there are none
+			time_t overview_mtime_sec = 0;
+			long overview_mtime_nsec = 0;
+			int64_t overview_size = -1;
+
+			bool operator==(const FileStamp &other) const;
+		};
+
+		struct Statistics {
+			uint64_t hits; // leases served by an idle handle
+			uint64_t misses; // leases that had to open the dataset
+			uint64_t evictions; // idle handles closed because of the capacity or a modified file
+			size_t idle; // handles currently kept for reuse
+		};
+
+		/**
+		 * Exclusive use of an opened dataset, returned to the cache on destruction
+		 */
+		class Lease {
+			public:
+				Lease() = default;
+				~Lease();
+				Lease(Lease &&other) noexcept;
+				Lease &operator=(Lease &&other) noexcept;
+				Lease(const Lease &) = delete;
+				Lease &operator=(const Lease &) = delete;
+
+				GDALDataset *get() const { return dataset; }
+				GDALDataset *operator->() const { return dataset; }
+				explicit operator bool() const { return dataset != nullptr; }
+
+				/**
+				 * Closes the dataset instead of returning it to the cache, e.g. after a failed read
+				 */
+				void discard();
+			private:
+				friend class GDALDatasetCache;
+				Lease(GDALDataset *dataset, const std::string &filename, const FileStamp &stamp);
+				void release();
+
+				GDALDataset *dataset = nullptr;
+				std::string filename;
+				FileStamp stamp;
+		};
+
+		/**
+		 * Opens the dataset read-only, reusing an idle handle if possible.
+		 * @return the lease, which is empty if GDAL could not open the file
+		 */
+		static Lease open(const std::string &filename);
+
+		/**
+		 * Closes all idle handles
+		 */
+		static void clear();
+
+		static Statistics getStatistics();
+};
+
+#endif
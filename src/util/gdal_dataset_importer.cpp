@@ -1,8 +1,11 @@
 #include "gdal_dataset_importer.h"
 #include "gdal_timesnap.h"
+#include "gdal_source_datasets.h"
 #include "configuration.h"
+#include "log.h"
 #include <ogr_spatialref.h>
 #include <boost/filesystem.hpp>
+#include <algorithm>
 
 const std::string GDALDatasetImporter::placeholder = "%%%TIME_STRING%%%";
 
@@ -94,6 +97,83 @@ void GDALDatasetImporter::importDataset(std::string dataset_name,
 
 }
 
+// lists the files of a dataset, the placeholder matches any time string
+static std::vector<std::string> listDatasetFiles(const std::string &path, const std::string &file_name, const std::string &placeholder) {
+	namespace bf = boost::filesystem;
+	std::vector<std::string> files;
+	size_t placeholderPos = file_name.find(placeholder);
+	if (placeholderPos == std::string::npos) {
+		files.push_back((bf::path(path) / file_name).string());
+		return files;
+	}
+
+	std::string prefix = file_name.substr(0, placeholderPos);
+	std::string suffix = file_name.substr(placeholderPos + placeholder.length());
+	if (!bf::is_directory(path))
+		throw ImporterException(concat("GDALDatasetImporter: directory ", path, " not found"));
+	for (auto it = bf::directory_iterator(path); it != bf::directory_iterator{}; ++it) {
+		std::string name = it->path().filename().string();
+		if (bf::is_regular_file(it->path()) && name.length() >= prefix.length() + suffix.length()
+				&& name.compare(0, prefix.length(), prefix) == 0
+				&& name.compare(name.length() - suffix.length(), suffix.length(), suffix) == 0)
+			files.push_back(it->path().string());
+	}
+	std::sort(files.begin(), files.end());
+	return files;
+}
+
+size_t GDALDatasetImporter::buildOverviews(const std::string &dataset_name, const std::string &resampling) {
+	Json::Value datasetJson = GDALSourceDataSets::getDataSetDescription(dataset_name);
+
+	// channels may be stored in files of their own
+	std::vector<std::string> files;
+	std::vector<Json::Value> sources{datasetJson};
+	for (auto &channelJson : datasetJson["channels"])
+		if (channelJson.isMember("file_name") || channelJson.isMember("path"))
+			sources.push_back(channelJson);
+	for (auto &source : sources) {
+		std::string path = source.get("path", datasetJson.get("path", "")).asString();
+		std::string file_name = source.get("file_name", datasetJson.get("file_name", "")).asString();
+		if (file_name.empty())
+			continue;
+		for (auto &file : listDatasetFiles(path, file_name, placeholder))
+			if (std::find(files.begin(), files.end(), file) == files.end())
+				files.push_back(file);
+	}
+
+	size_t built = 0;
+	for (auto &file : files) {
+		// parameters injected into the file name at query time can't be resolved here
+		if (file.find("%%%") != std::string::npos) {
+			Log::warn("GDALDatasetImporter: skipping %s, its name depends on the query", file.c_str());
+			continue;
+		}
+
+		// datasets opened read-only get external overviews
+		GDALDataset *dataset = openGDALDataset(file);
+		if (dataset->GetRasterCount() < 1 || dataset->GetRasterBand(1)->GetOverviewCount() > 0) {
+			GDALClose(dataset);
+			continue;
+		}
+
+		std::vector<int> levels;
+		for (int level = 2; std::max(dataset->GetRasterXSize(), dataset->GetRasterYSize()) / level >= 256; level *= 2)
+			levels.push_back(level);
+		if (levels.empty()) {
+			GDALClose(dataset);
+			continue;
+		}
+
+		CPLErr result = dataset->BuildOverviews(resampling.c_str(), static_cast<int>(levels.size()), levels.data(), 0, nullptr, nullptr, nullptr);
+		GDALClose(dataset);
+		if (result != CE_None)
+			throw ImporterException(concat("GDALDatasetImporter: building overviews for ", file, " failed"));
+		built++;
+	}
+
+	return built;
+}
+
 //read crsId, size, scale, origin from actual GDALDatset
 Json::Value GDALDatasetImporter::readCoords(GDALDataset *dataset){
 	Json::Value coordsJson(Json::ValueType::objectValue);
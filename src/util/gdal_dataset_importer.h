@@ -33,6 +33,15 @@ public:
 							  std::string unit,
 							  std::string interpolation);
 
+	/*
+	 * Builds external overviews (.ovr) for every file of an imported dataset that has none yet, so that
+	 * the GDALSource operator can serve queries with low resolutions from them. The levels are halved
+	 * until the raster is smaller than 256 pixels.
+	 * @param resampling the GDAL resampling method, e.g. NEAREST or AVERAGE
+	 * @return the number of files overviews were built for
+	 */
+	static size_t buildOverviews(const std::string &dataset_name, const std::string &resampling);
+
 
 private:
 	static const std::string placeholder;
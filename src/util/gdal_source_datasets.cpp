@@ -1,5 +1,9 @@
 
 #include <fstream>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <sys/stat.h>
 #include <json/reader.h>
 #include <boost/filesystem.hpp>
 
@@ -11,6 +15,33 @@
 const std::string suffix(".json");
 const size_t suffix_length = suffix.length();
 
+namespace {
+
+// a parsed description and the modification time and size of its file when it was read
+struct CachedDescription {
+    time_t mtime_sec;
+    long mtime_nsec;
+    off_t size;
+    Json::Value description;
+};
+
+struct DescriptionCache {
+    DescriptionCache() : enabled(Configuration::get<bool>("gdal_source.descriptioncache", true)), hits(0), misses(0) {}
+
+    const bool enabled;
+    std::mutex mutex;
+    std::unordered_map<std::string, CachedDescription> descriptions;
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+};
+
+DescriptionCache &getDescriptionCache() {
+    static DescriptionCache cache;
+    return cache;
+}
+
+}
+
 std::vector<std::string> GDALSourceDataSets::getDataSetNames() {
     namespace bf = boost::filesystem;
     const bf::path path(Configuration::get<std::string>("gdalsource.datasets.path"));
@@ -43,8 +74,24 @@ Json::Value GDALSourceDataSets::getDataSetDescription(const std::string &dataSet
     boost::filesystem::path file_path(Configuration::get<std::string>("gdalsource.datasets.path"));
     file_path /= (dataSetName + suffix);
 
+    const std::string path = file_path.string();
+
+    auto &cache = getDescriptionCache();
+    struct stat st;
+    bool has_stat = stat(path.c_str(), &st) == 0;
+    if (cache.enabled && has_stat) {
+        std::lock_guard<std::mutex> guard(cache.mutex);
+        auto it = cache.descriptions.find(path);
+        if (it != cache.descriptions.end() && it->second.mtime_sec == st.st_mtim.tv_sec
+                && it->second.mtime_nsec == st.st_mtim.tv_nsec && it->second.size == st.st_size) {
+            cache.hits++;
+            return it->second.description;
+        }
+    }
+    cache.misses++;
+
     //open file then read json object from it
-    std::ifstream file(file_path.string());
+    std::ifstream file(path);
     if (!file.is_open()) {
         throw ArgumentException("GDAlSourceDataSets: Data set with given name not found");
     }
@@ -55,5 +102,19 @@ Json::Value GDALSourceDataSets::getDataSetDescription(const std::string &dataSet
         throw ArgumentException("GDALSourceDataSets: invalid json file");
     }
 
+    // the stamp is from before reading, so a modification while reading causes another read next time
+    if (cache.enabled && has_stat) {
+        std::lock_guard<std::mutex> guard(cache.mutex);
+        cache.descriptions[path] = CachedDescription{st.st_mtim.tv_sec, st.st_mtim.tv_nsec, st.st_size, root};
+    }
+
     return root;
 }
+
+GDALSourceDataSets::DescriptionCacheStatistics GDALSourceDataSets::getDescriptionCacheStatistics() {
+    auto &cache = getDescriptionCache();
+    DescriptionCacheStatistics statistics;
+    statistics.hits = cache.hits;
+    statistics.misses = cache.misses;
+    return statistics;
+}
@@ -5,11 +5,17 @@
 #include "userdb/userdb.h"
 
 #include <vector>
+#include <cstdint>
 #include <json/value.h>
 
 
 class GDALSourceDataSets {
 public:
+    struct DescriptionCacheStatistics {
+        uint64_t hits; // descriptions served from memory
+        uint64_t misses; // descriptions read from disk, because they were new or had been modified
+    };
+
     /**
      * get the available data sets in the gdal source data sets directory
      */
@@ -17,11 +23,14 @@ public:
 
 
     /**
-     * get the data set description of the given data set
+     * get the data set description of the given data set.
+     * Parsed descriptions are kept in memory until their file is modified (see gdal_source.descriptioncache)
      * @param dataSetName
      */
     static Json::Value getDataSetDescription(const std::string &dataSetName);
 
+    static DescriptionCacheStatistics getDescriptionCacheStatistics();
+
 };
 
 
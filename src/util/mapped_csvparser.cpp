@@ -0,0 +1,249 @@
+
+#include "util/mapped_csvparser.h"
+
+#include <cstring>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+
+/*
+ * Converts [+-]digits[.digits][(e|E)[+-]digits] exactly, if the digits fit into the mantissa of a
+ * double and the power of ten is exactly representable, too. A single multiplication or division of
+ * exact values is correctly rounded, so the result equals that of strtod().
+ * Returns false for everything else, which is left to std::stod.
+ */
+static bool parseSimpleDouble(const char *pos, const char *end, double &result) {
+	static const double powers_of_ten[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+	const uint64_t max_mantissa = (uint64_t) 1 << 53;
+
+	bool negative = false;
+	if (pos < end && (*pos == '-' || *pos == '+')) {
+		negative = *pos == '-';
+		pos++;
+	}
+
+	uint64_t mantissa = 0;
+	int exponent = 0;
+	size_t digits = 0;
+	for (; pos < end && *pos >= '0' && *pos <= '9'; pos++, digits++) {
+		mantissa = mantissa * 10 + (*pos - '0');
+		if (mantissa > max_mantissa)
+			return false;
+	}
+	if (pos < end && *pos == '.') {
+		pos++;
+		for (; pos < end && *pos >= '0' && *pos <= '9'; pos++, digits++) {
+			mantissa = mantissa * 10 + (*pos - '0');
+			if (mantissa > max_mantissa)
+				return false;
+			exponent--;
+		}
+	}
+	if (digits == 0)
+		return false;
+
+	if (pos < end && (*pos == 'e' || *pos == 'E')) {
+		pos++;
+		bool negative_exponent = false;
+		if (pos < end && (*pos == '-' || *pos == '+')) {
+			negative_exponent = *pos == '-';
+			pos++;
+		}
+		if (pos == end)
+			return false;
+		int explicit_exponent = 0;
+		for (; pos < end && *pos >= '0' && *pos <= '9'; pos++) {
+			explicit_exponent = explicit_exponent * 10 + (*pos - '0');
+			if (explicit_exponent > 1000)
+				return false;
+		}
+		exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+	}
+	if (pos != end)
+		return false;
+
+	double value = (double) mantissa;
+	if (mantissa != 0) {
+		if (exponent < -22 || exponent > 22)
+			return false;
+		value = exponent < 0 ? value / powers_of_ten[-exponent] : value * powers_of_ten[exponent];
+	}
+	result = negative ? -value : value;
+	return true;
+}
+
+
+std::string MappedCSVParser::Field::toString() const {
+	if (!escaped)
+		return std::string(data, length);
+
+	std::string result;
+	result.reserve(length);
+	for (size_t i = 0; i < length; i++) {
+		result += data[i];
+		// quotes are doubled inside quoted fields
+		if (data[i] == '"')
+			i++;
+	}
+	return result;
+}
+
+double MappedCSVParser::Field::toDouble() const {
+	double result;
+	if (!escaped && parseSimpleDouble(data, data + length, result))
+		return result;
+	return std::stod(toString());
+}
+
+
+MappedCSVParser::MappedCSVParser(const std::string &filename, char field_separator, size_t chunk_size)
+	: field_separator(field_separator), data(nullptr), size(0) {
+	int f = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+	if (f < 0)
+		throw ArgumentException(concat("MappedCSVParser: could not open ", filename));
+	struct stat st;
+	if (fstat(f, &st) != 0) {
+		close(f);
+		throw ArgumentException(concat("MappedCSVParser: could not stat ", filename));
+	}
+	size = (size_t) st.st_size;
+	if (size > 0) {
+		void *addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, f, 0);
+		if (addr == MAP_FAILED) {
+			close(f);
+			throw ArgumentException(concat("MappedCSVParser: could not mmap() ", filename));
+		}
+		data = (const char *) addr;
+		madvise(addr, size, MADV_SEQUENTIAL);
+	}
+	close(f);
+
+	const char *end = data + size;
+	std::vector<Field> fields;
+	const char *start;
+	try {
+		start = parseRecord(data, end, fields);
+	}
+	catch (...) {
+		if (data)
+			munmap((void *) data, size);
+		throw;
+	}
+	for (auto &field : fields)
+		headers.push_back(field.toString());
+
+	/*
+	 * A line break ends a record if an even number of quotes precedes it: every quoted field
+	 * contributes two quotes plus two for each escaped quote, and quotes are not allowed elsewhere.
+	 * Invalid files may be split in the middle of a record, which makes parsing that chunk fail.
+	 */
+	chunks.push_back(start - data);
+	size_t quotes = 0;
+	const char *counted = start;
+	while ((size_t) (end - start) > chunk_size) {
+		const char *pos = start + chunk_size;
+		const char *boundary = nullptr;
+		while (pos < end && boundary == nullptr) {
+			auto line_break = (const char *) memchr(pos, '\n', end - pos);
+			if (line_break == nullptr)
+				break;
+			while (counted < line_break) {
+				auto quote = (const char *) memchr(counted, '"', line_break - counted);
+				if (quote == nullptr) {
+					counted = line_break;
+					break;
+				}
+				quotes++;
+				counted = quote + 1;
+			}
+			if (quotes % 2 == 0)
+				boundary = line_break + 1;
+			pos = line_break + 1;
+		}
+		if (boundary == nullptr)
+			break;
+		start = boundary;
+		chunks.push_back(start - data);
+	}
+	chunks.push_back(size);
+}
+
+MappedCSVParser::~MappedCSVParser() {
+	if (data)
+		munmap((void *) data, size);
+}
+
+
+void MappedCSVParser::parseChunk(size_t chunk, const std::function<void(const std::vector<Field> &)> &callback) const {
+	const char *pos = data + chunks.at(chunk);
+	const char *end = data + chunks.at(chunk + 1);
+
+	std::vector<Field> fields;
+	fields.reserve(headers.size());
+	while (true) {
+		pos = parseRecord(pos, end, fields);
+		if (fields.empty())
+			break;
+		if (fields.size() != headers.size())
+			throw parse_error("CSV invalid: file contains lines with different field counts");
+		callback(fields);
+	}
+}
+
+/*
+ * Parses the record starting at pos into fields and returns the position after it.
+ * fields is empty if there are only line separators left.
+ */
+const char *MappedCSVParser::parseRecord(const char *pos, const char *end, std::vector<Field> &fields) const {
+	fields.clear();
+
+	while (pos < end && (*pos == '\r' || *pos == '\n'))
+		pos++;
+	if (pos == end)
+		return pos;
+
+	while (true) {
+		if (pos < end && *pos == '"') {
+			const char *field_start = ++pos;
+			bool escaped = false;
+			while (true) {
+				auto quote = (const char *) memchr(pos, '"', end - pos);
+				if (quote == nullptr)
+					throw parse_error(concat("CSV invalid: quoted field does not end with a quote at byte ", field_start - data));
+				pos = quote + 1;
+				if (pos < end && *pos == '"') {
+					escaped = true;
+					pos++;
+				}
+				else
+					break;
+			}
+			fields.emplace_back(field_start, pos - 1 - field_start, escaped);
+			if (pos < end && *pos != field_separator && *pos != '\r' && *pos != '\n')
+				throw parse_error(concat("CSV invalid: quoted field was not followed by a separator at byte ", pos - data));
+		}
+		else {
+			const char *field_start = pos;
+			for (; pos < end; pos++) {
+				char c = *pos;
+				if (c == field_separator || c == '\r' || c == '\n')
+					break;
+				if (c == '"')
+					throw parse_error(concat("CSV invalid: Found a quote inside an unquoted field at byte ", pos - data));
+			}
+			fields.emplace_back(field_start, pos - field_start, false);
+		}
+
+		if (pos == end)
+			return pos;
+		if (*pos != field_separator)
+			return pos + 1;
+		pos++;
+	}
+}
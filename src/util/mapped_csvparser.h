@@ -0,0 +1,74 @@
+#ifndef UTIL_MAPPED_CSVPARSER_H
+#define UTIL_MAPPED_CSVPARSER_H
+
+#include "util/csvparser.h"
+
+#include <string>
+#include <vector>
+#include <functional>
+
+/**
+ * A parser for delimiter separated text files that memory-maps the file and hands out the fields
+ * as views into the mapping instead of copying them into strings.
+ *
+ * It follows the quoting rules of CSVParser. The records after the header are split into chunks
+ * at record boundaries, which are found by the parity of the quotes before a line break. The chunks
+ * can be parsed concurrently.
+ */
+class MappedCSVParser {
+	public:
+		using parse_error = CSVParser::parse_error;
+
+		/**
+		 * A field of a record, pointing into the mapped file
+		 */
+		class Field {
+			public:
+				Field(const char *data, size_t length, bool escaped) : data(data), length(length), escaped(escaped) {}
+
+				bool empty() const { return length == 0; }
+				std::string toString() const;
+
+				/**
+				 * Converts the field like std::stod does, including its exceptions.
+				 * Plain decimal numbers are converted without copying the field.
+				 */
+				double toDouble() const;
+
+				const char *data;
+				size_t length;
+				bool escaped; // the field was quoted and contains escaped quotes
+		};
+
+		/**
+		 * Maps the file and reads its header
+		 * @param chunk_size the approximate number of bytes per chunk
+		 */
+		MappedCSVParser(const std::string &filename, char field_separator = ',', size_t chunk_size = 4 << 20);
+		~MappedCSVParser();
+
+		MappedCSVParser(const MappedCSVParser &) = delete;
+		MappedCSVParser &operator=(const MappedCSVParser &) = delete;
+
+		const std::vector<std::string> &getHeaders() const { return headers; }
+		size_t getChunkCount() const { return chunks.size() - 1; }
+		size_t getSize() const { return size; }
+
+		/**
+		 * Calls the callback for every record of the chunk, in the order of the file.
+		 * The fields are only valid during the call.
+		 * Throws a parse_error if a record is invalid or its field count differs from the header's.
+		 */
+		void parseChunk(size_t chunk, const std::function<void(const std::vector<Field> &)> &callback) const;
+
+	private:
+		const char *parseRecord(const char *pos, const char *end, std::vector<Field> &fields) const;
+
+		char field_separator;
+		const char *data;
+		size_t size;
+		std::vector<std::string> headers;
+		std::vector<size_t> chunks; // offsets of the chunk starts, followed by the file size
+};
+
+#endif
@@ -2,6 +2,7 @@
 #include "util/exceptions.h"
 #include "util/server_nonblocking.h"
 #include "util/log.h"
+#include "util/configuration.h"
 
 #include <sys/types.h>
 
@@ -20,13 +21,17 @@
 #include <sys/stat.h>
 // waitpid
 #include <sys/wait.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
 
 
 /*
  * Connection
  */
 NonblockingServer::Connection::Connection(NonblockingServer &server, int fd, int id)
-	: fd(fd), stream(BinaryStream::fromAcceptedSocket(fd,true)), state(State::INITIALIZING), is_closed(false), server(server), id(id) {
+	: fd(fd), stream(BinaryStream::fromAcceptedSocket(fd,true)), state(State::INITIALIZING), is_closed(false),
+	  is_readable(true), is_writable(true), server(server), id(id) {
 	stream.makeNonBlocking();
 	// the client is supposed to send the first data, so we'll start reading.
 	waitForData();
@@ -55,11 +60,18 @@ void NonblockingServer::Connection::waitForData() {
 }
 
 void NonblockingServer::Connection::close() {
-	is_closed = true;
+	bool was_closed = is_closed.exchange(true);
+	if (!was_closed && server.epoll_fd >= 0) {
+		std::lock_guard<std::recursive_mutex> connections_lock(server.connections_mutex);
+		server.closed_connections.push_back(id);
+	}
 	if (state != State::PROCESSING_DATA_ASYNC) {
 		// we must not remove them while another thread may be using the connection.
 		readbuffer.reset(nullptr);
 		writebuffer.reset(nullptr);
+		// a forked child may still hold the fd, so it would stay registered after closing it
+		if (!was_closed)
+			server.unwatch(*this);
 		stream.close();
 	}
 }
@@ -71,9 +83,10 @@ void NonblockingServer::Connection::startWritingData(std::unique_ptr<BinaryWrite
 	readbuffer.reset(nullptr);
 	writebuffer = std::move(new_writebuffer);
 	auto &server = this->server;
+	auto id = this->id;
 	state = State::WRITING_DATA;
 	if (old_state != State::PROCESSING_DATA)
-		server.wake();
+		server.wakeConnection(id);
 }
 
 void NonblockingServer::Connection::enqueueForAsyncProcessing() {
@@ -257,8 +270,21 @@ static int getListeningSocket(const std::string &socket_path, int umode) {
 /*
  * Nonblocking Server
  */
+static NonblockingServer::Backend getDefaultBackend() {
+	auto name = Configuration::get<std::string>("nonblockingserver.backend", "epoll");
+	if (name == "select")
+		return NonblockingServer::Backend::SELECT;
+	if (name != "epoll")
+		throw ArgumentException(concat("NonblockingServer: unknown backend ", name));
+#ifdef __linux__
+	return NonblockingServer::Backend::EPOLL;
+#else
+	return NonblockingServer::Backend::SELECT;
+#endif
+}
+
 NonblockingServer::NonblockingServer()
-	: num_workers(0), allow_forking(false), next_connection_id(1), running(false), wakeup_pipe(BinaryStream::makePipe()) {
+	: backend(getDefaultBackend()), epoll_fd(-1), num_workers(0), allow_forking(false), next_connection_id(1), running(false), wakeup_pipe(BinaryStream::makePipe()) {
 }
 
 NonblockingServer::~NonblockingServer() {
@@ -266,18 +292,19 @@ NonblockingServer::~NonblockingServer() {
 	stopAllWorkers();
 }
 
-void NonblockingServer::readNB(Connection &c) {
+bool NonblockingServer::readNB(Connection &c) {
+	bool would_block = false;
 	try {
-		auto is_eof = c.stream.readNB(*(c.readbuffer), true);
+		auto is_eof = c.stream.readNB(*(c.readbuffer), true, &would_block);
 		if (is_eof) {
 			c.close();
-			return;
+			return false;
 		}
 	}
 	catch (const std::exception &e) {
 		Log::error("%d: Exception during readNB: %s", c.id, e.what());
 		c.close();
-		return;
+		return false;
 	}
 
 	if (c.readbuffer->isRead()) {
@@ -287,14 +314,16 @@ void NonblockingServer::readNB(Connection &c) {
 		catch (const std::exception &e) {
 			Log::error("%d: Exception when processing command: %s", c.id, e.what());
 			c.close();
-			return;
+			return false;
 		}
 	}
+	return !would_block;
 }
 
-void NonblockingServer::writeNB(Connection &c) {
+bool NonblockingServer::writeNB(Connection &c) {
+	bool would_block = false;
 	try {
-		c.stream.writeNB(*(c.writebuffer));
+		c.stream.writeNB(*(c.writebuffer), &would_block);
 		if (c.writebuffer->isFinished()) {
 			Log::debug("%d: response sent", c.id);
 			c.waitForData();
@@ -303,14 +332,17 @@ void NonblockingServer::writeNB(Connection &c) {
 	catch (const std::exception &e) {
 		Log::error("%d: Exception during writeNB: %s", c.id, e.what());
 		c.close();
-		return;
+		return false;
 	}
+	return !would_block;
 }
 
 /*
  * job-queue
  */
 void NonblockingServer::enqueueTask(Connection *connection) {
+	// the worker takes the stream, so the main loop must not get any events for it
+	unwatch(*connection);
 	std::unique_lock<std::mutex> lock(job_queue_mutex);
 	try {
 		job_queue.push(connection);
@@ -352,10 +384,9 @@ NonblockingServer::Connection *NonblockingServer::popTask() {
 
 NonblockingServer::Connection *NonblockingServer::getIdleConnectionById(int id) {
 	std::lock_guard<std::recursive_mutex> connections_lock(connections_mutex);
-	for (auto &c : connections) {
-		if (c->id == id && c->state == Connection::State::IDLE && !c->is_closed)
-			return c.get();
-	}
+	auto it = connections.find(id);
+	if (it != connections.end() && it->second->state == Connection::State::IDLE && !it->second->is_closed)
+		return it->second.get();
 	throw ArgumentException("No idle connection with the given ID found");
 }
 
@@ -373,6 +404,16 @@ void NonblockingServer::allowForking() {
 	allow_forking = true;
 }
 
+void NonblockingServer::setBackend(Backend backend) {
+	if (running)
+		throw MustNotHappenException("NonblockingServer: do not call setBackend() after start()");
+#ifndef __linux__
+	if (backend == Backend::EPOLL)
+		throw ArgumentException("NonblockingServer: epoll is only available on linux");
+#endif
+	this->backend = backend;
+}
+
 void NonblockingServer::listen(int portnr) {
 	if (running)
 		throw MustNotHappenException("NonblockingServer: do not call listen() after start()");
@@ -509,6 +550,16 @@ void NonblockingServer::start() {
 	for (int i=0;i<num_workers;i++)
 		workers.emplace_back(&NonblockingServer::worker_thread, this);
 
+	if (backend == Backend::EPOLL)
+		runEpollLoop();
+	else
+		runSelectLoop();
+
+	stopAllWorkers();
+	reapAllChildProcesses(true);
+}
+
+void NonblockingServer::runSelectLoop() {
 	while (true) {
 		reapAllChildProcesses();
 
@@ -519,7 +570,7 @@ void NonblockingServer::start() {
 		std::unique_lock<std::recursive_mutex> connections_lock(connections_mutex);
 		auto it = connections.begin();
 		while (it != connections.end()) {
-			auto &c = *it;
+			auto &c = it->second;
 			int fd = c->fd;
 			Connection::State state = c->state;
 			if (c->is_closed) {
@@ -569,7 +620,8 @@ void NonblockingServer::start() {
 		}
 
 		connections_lock.lock();
-		for (auto &c : connections) {
+		for (auto &entry : connections) {
+			auto &c = entry.second;
 			Connection::State state = c->state;
 			if (state == Connection::State::WRITING_DATA && writefds.isset(c->fd)) {
 				writeNB(*c);
@@ -597,9 +649,151 @@ void NonblockingServer::start() {
 			}
 		}
 	}
+}
 
-	stopAllWorkers();
-	reapAllChildProcesses(true);
+
+#ifdef __linux__
+// epoll_event.data of the fds that are not connections, which use their id
+static const uint64_t EPOLL_DATA_WAKEUP = (uint64_t) 1 << 32;
+static const uint64_t EPOLL_DATA_LISTENSOCKET = (uint64_t) 1 << 33;
+
+static void addToEpoll(int epoll_fd, int fd, uint32_t events, uint64_t data) {
+	struct epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = events;
+	event.data.u64 = data;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+		throw NetworkException(concat("epoll_ctl() failed: ", strerror(errno)));
+}
+
+void NonblockingServer::runEpollLoop() {
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd < 0)
+		throw NetworkException(concat("epoll_create1() failed: ", strerror(errno)));
+
+	// The wakeup pipe and the listen sockets are level-triggered, so a single read() or accept() per event is enough.
+	addToEpoll(epoll_fd, wakeup_pipe.getReadFD(), EPOLLIN, EPOLL_DATA_WAKEUP);
+	for (auto sock : listensockets_inet)
+		addToEpoll(epoll_fd, sock, EPOLLIN, EPOLL_DATA_LISTENSOCKET | (uint32_t) sock);
+	for (auto sock : listensockets_unix)
+		addToEpoll(epoll_fd, sock, EPOLLIN, EPOLL_DATA_LISTENSOCKET | (uint32_t) sock);
+	{
+		std::lock_guard<std::recursive_mutex> connections_lock(connections_mutex);
+		for (auto &entry : connections)
+			addToEpoll(epoll_fd, entry.second->fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, entry.first);
+	}
+
+	const int MAX_EVENTS = 256;
+	struct epoll_event events[MAX_EVENTS];
+	std::vector<int> woken;
+	while (true) {
+		reapAllChildProcesses();
+
+		auto res = epoll_wait(epoll_fd, events, MAX_EVENTS, 60000);
+		if (res < 0) {
+			if (errno == EINTR) // interrupted by signal
+				continue;
+			close(epoll_fd);
+			epoll_fd = -1;
+			throw NetworkException(concat("epoll_wait() call failed: ", strerror(errno)));
+		}
+
+		if (!running) {
+			Log::info("Stopping Server");
+			break;
+		}
+
+		std::lock_guard<std::recursive_mutex> connections_lock(connections_mutex);
+		for (int i=0;i<res;i++) {
+			auto data = events[i].data.u64;
+			if (data == EPOLL_DATA_WAKEUP) {
+				// we have been woken, now we need to read any outstanding data or the pipe will remain readable
+				char buf[1024];
+				read(wakeup_pipe.getReadFD(), buf, 1024);
+
+				// connections changed by other threads did not get an event, so service them now.
+				{
+					std::lock_guard<std::mutex> woken_lock(woken_connections_mutex);
+					woken.swap(woken_connections);
+				}
+				for (auto id : woken) {
+					auto it = connections.find(id);
+					if (it != connections.end() && !it->second->is_closed)
+						serviceConnection(*it->second);
+				}
+				woken.clear();
+			}
+			else if (data & EPOLL_DATA_LISTENSOCKET) {
+				struct sockaddr_storage remote_addr; // large enough for AF_INET, AF_INET6 and AF_UNIX
+				socklen_t sin_size = sizeof(remote_addr);
+				int new_fd = accept((int) (uint32_t) data, (struct sockaddr *) &remote_addr, &sin_size);
+				addNewConnectionFromAcceptedFD(new_fd);
+			}
+			else {
+				// events of connections that were closed in the meantime are ignored, ids are never reused.
+				auto it = connections.find((int) data);
+				if (it == connections.end() || it->second->is_closed)
+					continue;
+				auto &c = *it->second;
+				auto flags = events[i].events;
+				if (flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+					c.is_readable = true;
+				if (flags & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+					c.is_writable = true;
+				serviceConnection(c);
+			}
+		}
+
+		// Connections in PROCESSING_DATA_ASYNC are kept until the worker thread is done with them
+		for (auto it = closed_connections.begin(); it != closed_connections.end(); ) {
+			auto c = connections.find(*it);
+			if (c != connections.end() && c->second->state == Connection::State::PROCESSING_DATA_ASYNC) {
+				++it;
+				continue;
+			}
+			if (c != connections.end()) {
+				connections.erase(c);
+				Log::info("%d: closing, %lu clients remain", *it, connections.size());
+			}
+			it = closed_connections.erase(it);
+		}
+	}
+
+	close(epoll_fd);
+	epoll_fd = -1;
+}
+#else
+void NonblockingServer::runEpollLoop() {
+	throw MustNotHappenException("NonblockingServer: epoll is only available on linux");
+}
+#endif
+
+void NonblockingServer::serviceConnection(Connection &c) {
+	// With edge-triggered events, we must continue until the fd would block, or we will not be notified again.
+	while (!c.is_closed) {
+		Connection::State state = c.state;
+		if (state == Connection::State::READING_DATA && c.is_readable)
+			c.is_readable = readNB(c);
+		else if (state == Connection::State::WRITING_DATA && c.is_writable)
+			c.is_writable = writeNB(c);
+		else
+			break;
+	}
+}
+
+void NonblockingServer::unwatch(Connection &c) {
+#ifdef __linux__
+	if (epoll_fd >= 0)
+		epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c.fd, nullptr); // errors only mean that the fd was not registered
+#endif
+}
+
+void NonblockingServer::wakeConnection(int id) {
+	if (epoll_fd >= 0) {
+		std::lock_guard<std::mutex> woken_lock(woken_connections_mutex);
+		woken_connections.push_back(id);
+	}
+	wake();
 }
 
 
@@ -616,7 +810,21 @@ void NonblockingServer::addNewConnectionFromAcceptedFD(int fd) {
 	}
 
 	std::unique_lock<std::recursive_mutex> connections_lock(connections_mutex);
-	connections.push_back( createConnection(fd, next_connection_id++) );
+	auto id = next_connection_id++;
+	auto connection = createConnection(fd, id);
+	auto &c = *connection;
+	connections.emplace(id, std::move(connection));
+#ifdef __linux__
+	if (epoll_fd >= 0) {
+		try {
+			addToEpoll(epoll_fd, c.fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, id);
+		}
+		catch (const std::exception &e) {
+			Log::error("%d: %s", id, e.what());
+			c.close();
+		}
+	}
+#endif
 }
 
 
@@ -648,9 +856,15 @@ void NonblockingServer::cleanupAfterFork() {
 
 	// Worker threads don't persist after fork(), so we don't need to clean up any.
 
+	// The epoll instance is shared with the parent, so the connections must not be removed from it.
+	if (epoll_fd >= 0) {
+		close(epoll_fd);
+		epoll_fd = -1;
+	}
+
 	// It closes all fds that aren't required by the client any more.
 	closeAllListenSockets();
 	for (auto &connection : connections) {
-		connection->close();
+		connection.second->close();
 	}
 }
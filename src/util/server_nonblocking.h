@@ -8,6 +8,7 @@
 #include <thread>
 #include <mutex>
 #include <map>
+#include <unordered_map>
 #include <memory>
 #include <atomic>
 #include <condition_variable>
@@ -18,6 +19,11 @@
 /*
  * A server based on non-blocking network IO.
  *
+ * The main loop waits for IO with either select() or, on linux, epoll. The select() loop
+ * rebuilds its fd sets on every iteration, so its cost grows with the number of connections,
+ * even idle ones. The epoll loop registers every connection once, edge-triggered, and only
+ * touches connections the kernel reported as ready or that were woken by another thread.
+ *
  * TODO: allow multiple listen sockets (ipv4, ipv6, af_unix, multiple interfaces, ...)
  */
 class NonblockingServer {
@@ -59,6 +65,9 @@ class NonblockingServer {
 				};
 				std::atomic<State> state;
 				std::atomic<bool> is_closed;
+				// readiness reported by epoll, only used by the main loop. Cleared once a read or write would block.
+				bool is_readable;
+				bool is_writable;
 
 				// The following methods all model state changes. Private methods are called by the Server, protected by the Connection.
 				void startProcessing();
@@ -75,6 +84,11 @@ class NonblockingServer {
 				const int id;
 		};
 
+		enum class Backend {
+			SELECT,
+			EPOLL
+		};
+
 		NonblockingServer();
 		virtual ~NonblockingServer();
 		/*
@@ -95,6 +109,12 @@ class NonblockingServer {
 		 * Set this before calling start();
 		 */
 		void allowForking();
+		/*
+		 * Selects how the main loop waits for IO. Defaults to the configuration value nonblockingserver.backend.
+		 * EPOLL is only available on linux.
+		 * Set this before calling start();
+		 */
+		void setBackend(Backend backend);
 		/*
 		 * After listen() succeeded, start the main loop
 		 */
@@ -113,13 +133,31 @@ class NonblockingServer {
 		 */
 		Connection *getIdleConnectionById(int id);
 		/*
-		 * Wake the server up, interrupting a select() call. Used to notify the server about
+		 * Wake the server up, interrupting a select() or epoll_wait() call. Used to notify the server about
 		 * changes in the connections or about stopping.
 		 */
 		void wake();
 	private:
-		void readNB(Connection &connection);
-		void writeNB(Connection &connection);
+		/*
+		 * Both return false when the stream would block, i.e. no further progress is possible
+		 * until the fd becomes ready again.
+		 */
+		bool readNB(Connection &connection);
+		bool writeNB(Connection &connection);
+
+		// Main loops
+		Backend backend;
+		void runSelectLoop();
+		void runEpollLoop();
+		// Reads and writes as long as the connection is ready and has something to do
+		void serviceConnection(Connection &connection);
+		// Stops watching a connection's fd, before it is closed or handed to a worker thread
+		void unwatch(Connection &connection);
+		// Like wake(), but the epoll loop will also service the given connection
+		void wakeConnection(int id);
+		std::atomic<int> epoll_fd;
+		std::mutex woken_connections_mutex;
+		std::vector<int> woken_connections;
 
 		/*
 		 * A Server must overload this method. All it does is instantiate a new Connection
@@ -154,7 +192,8 @@ class NonblockingServer {
 		// Connections
 		std::recursive_mutex connections_mutex;
 		int next_connection_id;
-		std::vector<std::unique_ptr<Connection>> connections;
+		std::unordered_map<int, std::unique_ptr<Connection>> connections;
+		std::vector<int> closed_connections; // only maintained by the epoll loop
 		void addNewConnectionFromAcceptedFD(int fd);
 
 		// Status
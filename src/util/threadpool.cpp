@@ -0,0 +1,107 @@
+#include "util/threadpool.h"
+#include "util/configuration.h"
+#include "util/exceptions.h"
+
+#include <atomic>
+
+
+ThreadPool::ThreadPool(size_t threads) : stopped(false) {
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	workers.reserve(threads);
+	for (size_t i = 0; i < threads; i++)
+		workers.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		stopped = true;
+	}
+	cv.notify_all();
+	for (auto &w : workers)
+		w.join();
+}
+
+size_t ThreadPool::size() const {
+	return workers.size();
+}
+
+void ThreadPool::push(std::function<void()> &&task) {
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		if (stopped)
+			throw MustNotHappenException("ThreadPool: cannot enqueue tasks on a stopped pool");
+		tasks.push(std::move(task));
+	}
+	cv.notify_one();
+}
+
+void ThreadPool::work() {
+	while (true) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [this] { return stopped || !tasks.empty(); });
+			if (tasks.empty())
+				return;
+			task = std::move(tasks.front());
+			tasks.pop();
+		}
+		task();
+	}
+}
+
+void ThreadPool::parallelFor(size_t n, const std::function<void(size_t)> &fn, size_t max_parallelism) {
+	if (n == 0)
+		return;
+
+	struct State {
+		State(size_t n, const std::function<void(size_t)> &fn) : n(n), fn(fn), next(0), finished(0) {}
+		const size_t n;
+		const std::function<void(size_t)> &fn;
+		std::atomic<size_t> next;
+		size_t finished;
+		std::exception_ptr error;
+		std::mutex mutex;
+		std::condition_variable cv;
+
+		// claims and executes iterations until none are left
+		void run() {
+			size_t i;
+			while ((i = next++) < n) {
+				std::exception_ptr e;
+				try {
+					fn(i);
+				} catch (...) {
+					e = std::current_exception();
+				}
+				std::lock_guard<std::mutex> guard(mutex);
+				if (e && !error)
+					error = e;
+				if (++finished == n)
+					cv.notify_all();
+			}
+		}
+	};
+	auto state = std::make_shared<State>(n, fn);
+
+	size_t helpers = std::min(n - 1, workers.size());
+	if (max_parallelism > 0)
+		helpers = std::min(helpers, max_parallelism - 1);
+	// Helpers that start late simply find no work left. The shared state outlives this call.
+	for (size_t i = 0; i < helpers; i++)
+		push([state]() { state->run(); });
+
+	state->run();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->cv.wait(lock, [&state] { return state->finished == state->n; });
+	if (state->error)
+		std::rethrow_exception(state->error);
+}
+
+ThreadPool &ThreadPool::getDefault() {
+	static ThreadPool pool(std::max(0, Configuration::get<int>("threadpool.size", 0)));
+	return pool;
+}
@@ -0,0 +1,79 @@
+#ifndef UTIL_THREADPOOL_H_
+#define UTIL_THREADPOOL_H_
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+/**
+ * A fixed-size pool of worker threads executing tasks from a shared queue.
+ *
+ * parallelFor() lets the calling thread take part in the work, so it may be
+ * used from within tasks running on the pool without risking a deadlock.
+ */
+class ThreadPool {
+	public:
+		/**
+		 * Creates a pool with the given number of worker threads
+		 * @param threads the number of workers, 0 means one per hardware thread
+		 */
+		explicit ThreadPool(size_t threads);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool &) = delete;
+		ThreadPool &operator=(const ThreadPool &) = delete;
+
+		/**
+		 * Schedules the given function for execution on the pool
+		 * @return a future holding the result of the function
+		 */
+		template<typename F>
+		auto enqueue(F &&f) -> std::future<decltype(f())>;
+
+		/**
+		 * Executes fn(i) for all i in [0, n) on the pool and the calling thread
+		 * and waits for all of them to finish. If any call throws, the first
+		 * exception is rethrown after all started calls have finished.
+		 * @param n the number of iterations
+		 * @param fn the function to execute
+		 * @param max_parallelism the maximum number of threads to use, 0 for no limit
+		 */
+		void parallelFor(size_t n, const std::function<void(size_t)> &fn, size_t max_parallelism = 0);
+
+		/**
+		 * @return the number of worker threads
+		 */
+		size_t size() const;
+
+		/**
+		 * The process-wide pool, sized by the configuration key threadpool.size
+		 */
+		static ThreadPool &getDefault();
+
+	private:
+		void push(std::function<void()> &&task);
+		void work();
+
+		std::vector<std::thread> workers;
+		std::queue<std::function<void()>> tasks;
+		std::mutex mutex;
+		std::condition_variable cv;
+		bool stopped;
+};
+
+
+template<typename F>
+auto ThreadPool::enqueue(F &&f) -> std::future<decltype(f())> {
+	using R = decltype(f());
+	auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+	auto result = task->get_future();
+	push([task]() { (*task)(); });
+	return result;
+}
+
+#endif
@@ -0,0 +1,41 @@
+#include "benchmark.h"
+
+#include <map>
+#include <cstdio>
+
+// The magic of type registration, see REGISTER_BENCHMARK in benchmark.h
+static std::map<std::string, Benchmark::BenchmarkFunction> *getRegisteredBenchmarksMap() {
+	static std::map<std::string, Benchmark::BenchmarkFunction> registered_benchmarks;
+	return &registered_benchmarks;
+}
+
+BenchmarkRegistration::BenchmarkRegistration(const char *name, Benchmark::BenchmarkFunction function) {
+	auto map = getRegisteredBenchmarksMap();
+	(*map)[std::string(name)] = function;
+}
+
+size_t Benchmark::runAll(const std::string &prefix) {
+	size_t count = 0;
+	for (auto &b : *getRegisteredBenchmarksMap()) {
+		if (b.first.compare(0, prefix.size(), prefix) != 0)
+			continue;
+		printf("# %s\n", b.first.c_str());
+		b.second();
+		count++;
+	}
+	return count;
+}
+
+double Benchmark::measure(size_t runs, const std::function<void()> &fn) {
+	// warm up
+	fn();
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < runs; i++)
+		fn();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count() / runs;
+}
+
+void Benchmark::report(const std::string &name, const std::string &variant, double value, const std::string &unit) {
+	printf("%-40s %-30s %14.4f %s\n", name.c_str(), variant.c_str(), value, unit.c_str());
+}
@@ -0,0 +1,43 @@
+#ifndef BENCHMARKS_BENCHMARK_H
+#define BENCHMARKS_BENCHMARK_H
+
+#include <string>
+#include <functional>
+#include <chrono>
+
+/**
+ * Minimal harness for micro-benchmarks. Benchmarks are registered with
+ * REGISTER_BENCHMARK and executed by the mapping_benchmarks binary.
+ */
+class Benchmark {
+	public:
+		typedef void (*BenchmarkFunction)();
+
+		/**
+		 * Runs all benchmarks whose name starts with the given prefix
+		 * @return the number of benchmarks executed
+		 */
+		static size_t runAll(const std::string &prefix);
+
+		/**
+		 * Executes the given function repeatedly and reports the average runtime
+		 * @param runs the number of repetitions
+		 * @param fn the function to measure
+		 * @return the average runtime in milliseconds
+		 */
+		static double measure(size_t runs, const std::function<void()> &fn);
+
+		/**
+		 * Prints a single result line
+		 */
+		static void report(const std::string &name, const std::string &variant, double value, const std::string &unit);
+};
+
+class BenchmarkRegistration {
+	public:
+		BenchmarkRegistration(const char *name, Benchmark::BenchmarkFunction function);
+};
+
+#define REGISTER_BENCHMARK(name) static void benchmark_##name(); static BenchmarkRegistration register_benchmark_##name(#name, benchmark_##name); static void benchmark_##name()
+
+#endif
@@ -0,0 +1,57 @@
+#include "benchmark.h"
+
+#include "cache/priv/cache_index.h"
+
+#include <map>
+#include <random>
+
+/*
+ * Compares candidate lookups through the CubeIndex against a
+ * linear scan over all entries (the former CacheStructure behaviour).
+ * Entries model a tiled cache: tiles of a 2D-grid for several time-steps.
+ */
+REGISTER_BENCHMARK(cache_index) {
+	std::mt19937 gen(1);
+	std::uniform_real_distribution<double> pos(0, 1000);
+
+	for (size_t tiles_per_side : {10, 30, 100, 200}) {
+		const double tile = 1000.0 / tiles_per_side;
+		CubeIndex<uint64_t> index;
+		std::map<uint64_t, Cube3> entries;
+		uint64_t key = 0;
+		for (size_t t = 0; t < 4; t++)
+			for (size_t y = 0; y < tiles_per_side; y++)
+				for (size_t x = 0; x < tiles_per_side; x++) {
+					Cube3 c(x * tile, (x + 1) * tile, y * tile, (y + 1) * tile, t * 10, t * 10 + 10);
+					index.insert(key, c);
+					entries.emplace(key++, c);
+				}
+
+		std::vector<Cube3> queries;
+		for (int i = 0; i < 1000; i++) {
+			double x = pos(gen), y = pos(gen), t = pos(gen) / 25;
+			queries.emplace_back(x, x + tile, y, y + tile, t, t + 1);
+		}
+
+		size_t found_scan = 0, found_index = 0;
+		double scan = Benchmark::measure(5, [&]() {
+			for (auto &q : queries)
+				for (auto &e : entries)
+					if (e.second.intersects(q))
+						found_scan++;
+		});
+		double indexed = Benchmark::measure(5, [&]() {
+			for (auto &q : queries)
+				index.search(q, [&](const uint64_t &) {
+					found_index++;
+					return true;
+				});
+		});
+
+		std::string variant = std::to_string(entries.size()) + " entries";
+		Benchmark::report("cache_index/linear_scan", variant, scan * 1000 / queries.size(), "us/query");
+		Benchmark::report("cache_index/cube_index", variant, indexed * 1000 / queries.size(), "us/query");
+		if (found_scan != found_index)
+			Benchmark::report("cache_index/MISMATCH", variant, found_scan - (double) found_index, "entries");
+	}
+}
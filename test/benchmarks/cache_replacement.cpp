@@ -0,0 +1,285 @@
+#include "benchmark.h"
+
+#include "cache/node/manager/local_replacement.h"
+#include "datatypes/pointcollection.h"
+
+#include <algorithm>
+#include <map>
+#include <random>
+
+namespace {
+
+/*
+ * An operator of a workflow of the cache experiments (src/cache/experiments/exp_workflows.h)
+ * with the size of its results per pixel and the costs of computing a tile from the results
+ * of its sources. Reading a tile from the raster database costs 1.
+ */
+struct Operator {
+	std::string semantic_id;
+	size_t bytes_per_pixel;
+	double costs;
+	std::vector<Operator> sources;
+};
+
+// cache_exp::avg_temp: the Float32 average of the twelve monthly Int16 worldclim temperatures
+Operator averageTemperature() {
+	Operator expression{"avg_temp", 4, 12 * 0.25, {}};
+	for (int month = 1; month <= 12; month++) {
+		auto m = std::to_string(month);
+		expression.sources.push_back(Operator{"timeshift_" + m, 2, 0.1, {Operator{"worldclim_" + m, 2, 1, {}}}});
+	}
+	return expression;
+}
+
+// cache_exp::srtm_ex: the Int16 classification of the Int16 srtm heights
+Operator srtmExpression() {
+	return Operator{"srtm_ex", 2, 0.25, {Operator{"srtm", 2, 1, {}}}};
+}
+
+// the costs of computing the operator's result without any cached results
+double totalCosts(const Operator &op) {
+	double costs = op.costs;
+	for (auto &source : op.sources)
+		costs += totalCosts(source);
+	return costs;
+}
+
+// the size of the results of the operator and all its sources for one tile
+size_t totalSize(const Operator &op, size_t pixels) {
+	size_t size = op.bytes_per_pixel * pixels;
+	for (auto &source : op.sources)
+		size += totalSize(source, pixels);
+	return size;
+}
+
+/*
+ * A query of the relevance experiment (RelevanceExperiment::generate_queries() in
+ * src/cache/experiments/cache_experiments.cpp): one of 4x4 tiles of one of five areas
+ */
+struct Query {
+	uint32_t tile;
+	QueryRectangle rect;
+};
+
+const uint32_t TILE_PIXELS = 256;
+
+std::vector<Query> createQueries(uint32_t seed) {
+	const CrsId latLon = CrsId::from_epsg_code(4326);
+	const std::vector<SpatialReference> areas {
+		SpatialReference(latLon, -112.5,  22.5, -90.0,  45.0), // North America
+		SpatialReference(latLon,    0.0,  45.0,  22.5,  67.5), // Europe
+		SpatialReference(latLon,    0.0,   0.0,  22.5,  22.5), // Africa
+		SpatialReference(latLon,   67.5,  22.5,  90.0,  45.0), // Asia
+		SpatialReference(latLon,  135.0, -45.0, 157.5, -22.5)  // Australia
+	};
+	const TemporalReference tref(TIMETYPE_UNIX, 1275847200); // cache_exp::tref, 2010-06-06T18:00:00Z
+
+	std::mt19937 gen(seed);
+	std::uniform_int_distribution<int> area_distribution(0, areas.size() - 1);
+	std::uniform_int_distribution<int> tile_distribution(0, 15);
+	std::vector<Query> queries;
+	while (queries.size() < 160) {
+		int a = area_distribution(gen), tile = tile_distribution(gen);
+		auto &area = areas[a];
+		double extent = (area.x2 - area.x1) / 4;
+		double x1 = area.x1 + (tile % 4) * extent, y1 = area.y1 + (tile / 4) * extent;
+		queries.push_back(Query{(uint32_t) (a * 16 + tile),
+				QueryRectangle(SpatialReference(latLon, x1, y1, x1 + extent, y1 + extent), tref,
+						QueryResolution::pixels(TILE_PIXELS, TILE_PIXELS))});
+	}
+	return queries;
+}
+
+// the operator's semantic id and the tile
+typedef std::pair<std::string, uint32_t> Key;
+
+struct Result {
+	size_t requests = 0, hits = 0;
+	double costs = 0, saved_costs = 0;
+};
+
+/*
+ * Executes the queries like the operators do: an operator looks up its result in the cache
+ * and, after a miss, requests the results of its sources and puts its own result.
+ * Cache implements lookup(semantic_id, query) and insert(semantic_id, query, size, costs).
+ */
+template<class Cache>
+class Replay {
+public:
+	Replay(Cache &cache, Result &result) : cache(cache), result(result) {}
+
+	void execute(const Operator &op, const Query &query) {
+		result.costs += totalCosts(op);
+		request(op, query);
+	}
+
+private:
+	void request(const Operator &op, const Query &query) {
+		result.requests++;
+		if (cache.lookup(op.semantic_id, query)) {
+			result.hits++;
+			result.saved_costs += totalCosts(op);
+			return;
+		}
+		for (auto &source : op.sources)
+			request(source, query);
+		cache.insert(op.semantic_id, query, op.bytes_per_pixel * TILE_PIXELS * TILE_PIXELS, totalCosts(op));
+	}
+
+	Cache &cache;
+	Result &result;
+};
+
+CacheEntry entry(uint64_t size, double costs) {
+	ProfilingData profile;
+	profile.uncached_cpu = costs;
+	return CacheEntry(CacheCube(SpatioTemporalReference(SpatialReference(CrsId::from_epsg_code(4326), 0, 0, 1, 1),
+			TemporalReference(TIMETYPE_UNIX, 0, 1))), size, profile);
+}
+
+/*
+ * A NodeCache managed by the given replacement. Tiles are only answered by their own
+ * entries, so the results depend on the replacement alone.
+ */
+class ReplacementCache {
+public:
+	ReplacementCache(size_t capacity, LocalReplacement<PointCollection> &replacement)
+		: cache(CacheType::POINT, capacity), replacement(replacement),
+		  item(std::make_unique<PointCollection>(SpatioTemporalReference::unreferenced())) {}
+
+	bool lookup(const std::string &semantic_id, const Query &query) {
+		replacement.queried(semantic_id, query.rect);
+		auto it = cached.find(Key(semantic_id, query.tile));
+		if (it == cached.end())
+			return false;
+		replacement.accessed(it->second);
+		return true;
+	}
+
+	void insert(const std::string &semantic_id, const Query &query, uint64_t size, double costs) {
+		std::vector<NodeCacheKey> removals;
+		if (!replacement.get_removals(cache, semantic_id, query.rect, size, removals))
+			return;
+		for (auto &r : removals) {
+			cache.remove(r);
+			cached.erase(keys.at(r.entry_id));
+			keys.erase(r.entry_id);
+		}
+		auto e = entry(size, costs);
+		auto meta = cache.put(semantic_id, item, e);
+		replacement.inserted(meta, query.rect, e);
+		cached.emplace(Key(semantic_id, query.tile), meta);
+		keys.emplace(meta.entry_id, Key(semantic_id, query.tile));
+	}
+
+private:
+	NodeCache<PointCollection> cache;
+	LocalReplacement<PointCollection> &replacement;
+	std::shared_ptr<const PointCollection> item;
+	std::map<Key, NodeCacheKey> cached;
+	std::map<uint64_t, Key> keys; // by entry id
+};
+
+/*
+ * The former replacement: collect all entries and sort them by their last access on every eviction.
+ */
+class SortedLruCache {
+public:
+	SortedLruCache(size_t capacity) : capacity(capacity), used(0), now(0) {}
+
+	bool lookup(const std::string &semantic_id, const Query &query) {
+		now++;
+		auto it = entries.find(Key(semantic_id, query.tile));
+		if (it == entries.end())
+			return false;
+		it->second.last_access = now;
+		return true;
+	}
+
+	void insert(const std::string &semantic_id, const Query &query, uint64_t size, double) {
+		if (size > capacity)
+			return;
+		while (used + size > capacity) {
+			std::vector<std::pair<uint64_t, Key>> order; // by last access
+			for (auto &e : entries)
+				order.emplace_back(e.second.last_access, e.first);
+			std::sort(order.begin(), order.end());
+			used -= entries.at(order.front().second).size;
+			entries.erase(order.front().second);
+		}
+		entries[Key(semantic_id, query.tile)] = Entry{size, now};
+		used += size;
+	}
+
+private:
+	struct Entry {
+		uint64_t size;
+		uint64_t last_access;
+	};
+	std::map<Key, Entry> entries;
+	size_t capacity, used;
+	uint64_t now;
+};
+
+}
+
+/*
+ * Replays the queries of the relevance experiment of the cache experiments against the
+ * local cache replacement: the former sorting of all entries, the incremental LRU and
+ * cost-aware LRU, each with and without admission control. Like the experiment, every
+ * run starts with an empty cache whose capacity is a fraction of the size of all results
+ * of all tiles.
+ */
+REGISTER_BENCHMARK(cache_replacement) {
+	const size_t runs = 200;
+	std::vector<std::vector<Query>> queries;
+	for (size_t run = 0; run < runs; run++)
+		queries.push_back(createQueries(run));
+
+	std::vector<std::pair<std::string, Operator>> workflows {
+		std::make_pair("avg_temp", averageTemperature()),
+		std::make_pair("srtm_ex", srtmExpression())
+	};
+	for (auto &workflow : workflows) {
+		auto &op = workflow.second;
+		size_t all_tiles = totalSize(op, TILE_PIXELS * TILE_PIXELS) * 16 * 5;
+		for (double ratio : {0.01, 0.02, 0.05, 0.1, 0.2}) {
+			size_t capacity = all_tiles * ratio;
+			std::string variant = workflow.first + ", " + std::to_string((int) (ratio * 100)) + "% capacity";
+
+			auto report = [&](const std::string &benchmark, double time, const Result &result) {
+				Benchmark::report(benchmark, variant, time * 1000 / result.requests, "us/request");
+				Benchmark::report(benchmark, variant, 100.0 * result.hits / result.requests, "% hits");
+				Benchmark::report(benchmark, variant, 100.0 * result.saved_costs / result.costs, "% costs saved");
+			};
+
+			Result result;
+			double time = Benchmark::measure(1, [&]() {
+				result = Result();
+				for (auto &run : queries) {
+					SortedLruCache cache(capacity);
+					Replay<SortedLruCache> replay(cache, result);
+					for (auto &q : run)
+						replay.execute(op, q);
+				}
+			});
+			report("cache_replacement/sorted_lru", time, result);
+
+			for (auto name : {"lru", "costlru"}) {
+				for (bool admission : {false, true}) {
+					double time = Benchmark::measure(1, [&]() {
+						result = Result();
+						for (auto &run : queries) {
+							LocalReplacement<PointCollection> replacement(LocalRelevanceFunction::by_name(name), admission);
+							ReplacementCache cache(capacity, replacement);
+							Replay<ReplacementCache> replay(cache, result);
+							for (auto &q : run)
+								replay.execute(op, q);
+						}
+					});
+					report(std::string("cache_replacement/") + name + (admission ? "+admission" : ""), time, result);
+				}
+			}
+		}
+	}
+}
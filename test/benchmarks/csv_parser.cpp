@@ -0,0 +1,93 @@
+#include "benchmark.h"
+
+#include "util/csvparser.h"
+#include "util/mapped_csvparser.h"
+#include "util/csv_source_util.h"
+#include "operators/queryrectangle.h"
+#include "util/threadpool.h"
+#include "util/concat.h"
+
+#include <fstream>
+#include <random>
+#include <atomic>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/*
+ * Compares the throughput of CSVParser, reading from a stream, with MappedCSVParser, sequentially and
+ * on the default thread pool, and csv_source's point parsing with both parsers.
+ */
+REGISTER_BENCHMARK(csv_parser) {
+	std::string filename = concat("/tmp/benchmark_csv_parser.", getpid(), ".csv");
+	{
+		std::mt19937 gen(1);
+		std::uniform_real_distribution<double> coordinate(-180, 180);
+		std::ofstream out(filename);
+		out << "x,y,time,value,name\n";
+		for (size_t i = 0; i < 1000000; i++)
+			out << coordinate(gen) << "," << coordinate(gen) / 2 << "," << 1262304000 + i << "," << i * 0.25 << ",\"station " << i % 1000 << "\"\n";
+	}
+	struct stat st;
+	stat(filename.c_str(), &st);
+	const double megabytes = st.st_size / (1024.0 * 1024.0);
+
+	size_t tuples = 0;
+	double stream = Benchmark::measure(3, [&]() {
+		std::ifstream data(filename);
+		CSVParser parser(data, ',');
+		parser.readHeaders();
+		tuples = 0;
+		while (!parser.readTuple().empty())
+			tuples++;
+	});
+	Benchmark::report("csv_parser/tuples", "CSVParser", megabytes / (stream / 1000), "MB/s");
+
+	double mapped = Benchmark::measure(3, [&]() {
+		MappedCSVParser parser(filename, ',', (size_t) st.st_size);
+		size_t count = 0;
+		for (size_t chunk = 0; chunk < parser.getChunkCount(); chunk++)
+			parser.parseChunk(chunk, [&](const std::vector<MappedCSVParser::Field> &) { count++; });
+		if (count != tuples)
+			Benchmark::report("csv_parser/MISMATCH", "MappedCSVParser", count, "tuples");
+	});
+	Benchmark::report("csv_parser/tuples", "MappedCSVParser", megabytes / (mapped / 1000), "MB/s");
+
+	double parallel = Benchmark::measure(3, [&]() {
+		MappedCSVParser parser(filename, ',');
+		std::atomic<size_t> count(0);
+		ThreadPool::getDefault().parallelFor(parser.getChunkCount(), [&](size_t chunk) {
+			size_t chunk_count = 0;
+			parser.parseChunk(chunk, [&](const std::vector<MappedCSVParser::Field> &) { chunk_count++; });
+			count += chunk_count;
+		});
+		if (count != tuples)
+			Benchmark::report("csv_parser/MISMATCH", "MappedCSVParser parallel", count, "tuples");
+	});
+	Benchmark::report("csv_parser/tuples", concat("MappedCSVParser parallel, ", ThreadPool::getDefault().size(), " threads"), megabytes / (parallel / 1000), "MB/s");
+
+	Json::Value params(Json::ValueType::objectValue);
+	params["geometry"] = "xy";
+	params["time"] = "start";
+	params["duration"] = 3600;
+	params["time1_format"]["format"] = "seconds";
+	params["columns"]["time1"] = "time";
+	params["columns"]["numeric"].append("value");
+	params["columns"]["textual"].append("name");
+	CSVSourceUtil util(params);
+	QueryRectangle rect(SpatialReference(CrsId::from_epsg_code(4326)), TemporalReference(TIMETYPE_UNIX, 1262304000, 1262404000), QueryResolution::none());
+
+	size_t features = 0;
+	double points_stream = Benchmark::measure(3, [&]() {
+		std::ifstream data(filename);
+		features = util.getPointCollection(data, rect)->getFeatureCount();
+	});
+	Benchmark::report("csv_parser/points", "CSVParser", megabytes / (points_stream / 1000), "MB/s");
+
+	double points_mapped = Benchmark::measure(3, [&]() {
+		if (util.getPointCollectionFromFile(filename, rect)->getFeatureCount() != features)
+			Benchmark::report("csv_parser/MISMATCH", "getPointCollectionFromFile", 1, "");
+	});
+	Benchmark::report("csv_parser/points", "MappedCSVParser parallel", megabytes / (points_mapped / 1000), "MB/s");
+
+	unlink(filename.c_str());
+}
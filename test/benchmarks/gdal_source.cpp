@@ -0,0 +1,44 @@
+#include "benchmark.h"
+
+#include "datatypes/raster.h"
+#include "operators/operator.h"
+#include "cache/manager.h"
+#include "util/concat.h"
+#include "util/configuration.h"
+#include "util/gdal_dataset_cache.h"
+
+/*
+ * Bytes read and latency of the gdal_source per zoom level, for a world raster of 3600x1800 pixels
+ * with overviews. Queries with lower resolutions are served from the overviews. Run from the
+ * repository root.
+ */
+REGISTER_BENCHMARK(gdal_source) {
+	Configuration::loadFromString("[gdalsource.datasets]\npath=\"test/systemtests/data/gdal_files\"");
+	static NopCacheManager cache_manager;
+	CacheManager::init(&cache_manager);
+
+	auto source = GenericOperator::fromJSON(R"({"type": "gdal_source", "params": {"sourcename": "TestMonth6", "channel": 1}})");
+
+	for (int zoom = 0; zoom <= 4; zoom++) {
+		uint32_t width = 3600 >> zoom, height = 1800 >> zoom;
+		QueryRectangle qrect(
+			SpatialReference(CrsId::from_epsg_code(4326), -180, -90, 180, 90),
+			TemporalReference(TIMETYPE_UNIX, 1409875200, 1409875201),
+			QueryResolution::pixels(width, height)
+		);
+		std::string variant = concat("zoom ", zoom, " (", width, "x", height, ")");
+
+		QueryProfiler profiler;
+		source->getCachedRaster(qrect, QueryTools(profiler), GenericOperator::RasterQM::EXACT);
+		Benchmark::report("gdal_source/bytes", variant, profiler.self_io / 1024.0, "KiB");
+
+		// the dataset stays open between the runs
+		double latency = Benchmark::measure(10, [&]() {
+			QueryProfiler profiler;
+			source->getCachedRaster(qrect, QueryTools(profiler), GenericOperator::RasterQM::EXACT);
+		});
+		Benchmark::report("gdal_source/latency", variant, latency, "ms");
+	}
+
+	GDALDatasetCache::clear();
+}
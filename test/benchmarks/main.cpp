@@ -0,0 +1,12 @@
+#include "benchmark.h"
+
+#include <cstdio>
+
+int main(int argc, char **argv) {
+	std::string prefix = argc > 1 ? argv[1] : "";
+	if (Benchmark::runAll(prefix) == 0) {
+		fprintf(stderr, "No benchmark matching '%s'\n", prefix.c_str());
+		return 1;
+	}
+	return 0;
+}
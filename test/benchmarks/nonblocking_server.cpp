@@ -0,0 +1,122 @@
+#include "benchmark.h"
+
+#include "util/server_nonblocking.h"
+#include "util/log.h"
+#include "util/concat.h"
+
+#include <thread>
+#include <atomic>
+#include <vector>
+
+#include <sys/select.h> // FD_SETSIZE
+#include <sys/resource.h>
+#include <unistd.h>
+
+/*
+ * Measures the round trip time of small requests to a NonblockingServer while it
+ * holds an increasing number of idle connections, with one or several clients
+ * sending requests at the same time.
+ *
+ * The select() loop visits every connection on every iteration, the epoll loop
+ * only the ones that are ready.
+ */
+namespace {
+
+class PingConnection : public NonblockingServer::Connection {
+	public:
+		PingConnection(NonblockingServer &server, int fd, int id) : Connection(server, fd, id) {}
+	private:
+		virtual void processData(std::unique_ptr<BinaryReadBuffer> request) {
+			auto response = std::make_unique<BinaryWriteBuffer>();
+			response->write(request->read<uint64_t>());
+			startWritingData(std::move(response));
+		}
+};
+
+class PingServer : public NonblockingServer {
+	private:
+		virtual std::unique_ptr<Connection> createConnection(int fd, int id) {
+			return std::make_unique<PingConnection>(*this, fd, id);
+		}
+};
+
+}
+
+static bool ping(BinaryStream &stream, uint64_t value) {
+	BinaryWriteBuffer request;
+	request.write(value);
+	stream.write(request);
+	BinaryReadBuffer response;
+	stream.read(response);
+	return response.read<uint64_t>() == value;
+}
+
+REGISTER_BENCHMARK(nonblocking_server) {
+	Log::off();
+	const size_t REQUESTS = 2000;
+
+	// every connection needs two fds in this process, one for each end
+	struct rlimit limit;
+	getrlimit(RLIMIT_NOFILE, &limit);
+	limit.rlim_cur = limit.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &limit);
+	getrlimit(RLIMIT_NOFILE, &limit);
+
+	std::string socket_path = concat("/tmp/mapping_benchmark_nonblocking_server.", getpid(), ".socket");
+
+	for (auto backend : {NonblockingServer::Backend::SELECT, NonblockingServer::Backend::EPOLL}) {
+		std::string name = backend == NonblockingServer::Backend::SELECT ? "nonblocking_server/select" : "nonblocking_server/epoll";
+		for (size_t idle : {0, 100, 400, 2000, 10000}) {
+			size_t fds_needed = 2 * idle + 64;
+			// select() cannot watch fds above FD_SETSIZE
+			if ((backend == NonblockingServer::Backend::SELECT && fds_needed >= FD_SETSIZE) || fds_needed >= limit.rlim_cur)
+				continue;
+
+			for (size_t active : {1, 8}) {
+				PingServer server;
+				server.setBackend(backend);
+				server.listen(socket_path, 0700);
+				std::thread server_thread([&]() { server.start(); });
+
+				// a round trip on every connection makes sure the server has accepted it
+				std::atomic<size_t> failed(0);
+				std::vector<BinaryStream> idle_streams, active_streams;
+				for (size_t i = 0; i < idle; i++) {
+					idle_streams.push_back(BinaryStream::connectUNIX(socket_path.c_str()));
+					failed += !ping(idle_streams.back(), i);
+				}
+				for (size_t i = 0; i < active; i++) {
+					active_streams.push_back(BinaryStream::connectUNIX(socket_path.c_str()));
+					failed += !ping(active_streams.back(), i);
+				}
+
+				// every client sends its requests one after another, so the time per request is the latency
+				double ms = Benchmark::measure(1, [&]() {
+					std::vector<std::thread> clients;
+					for (size_t c = 0; c < active; c++) {
+						clients.emplace_back([&, c]() {
+							try {
+								for (size_t r = 0; r < REQUESTS; r++)
+									failed += !ping(active_streams[c], r);
+							}
+							catch (...) {
+								failed++;
+							}
+						});
+					}
+					for (auto &client : clients)
+						client.join();
+				});
+
+				server.stop();
+				server_thread.join();
+				unlink(socket_path.c_str());
+
+				std::string variant = concat(idle, " idle, ", active, " active");
+				Benchmark::report(name, variant, ms * 1000 / REQUESTS, "us/request");
+				if (failed > 0)
+					Benchmark::report(name + "/FAILED", variant, failed, "requests");
+			}
+		}
+	}
+}
@@ -0,0 +1,65 @@
+#include "benchmark.h"
+
+#include "pointvisualization/CircleClusteringQuadTree.h"
+#include "pointvisualization/FlatCircleClustering.h"
+#include "pointvisualization/Grid.h"
+
+#include <random>
+
+/*
+ * Compares the point clustering of the WFS cluster mode with pv::Grid and pv::CircleClusteringQuadTree
+ * to pv::FlatCircleClustering, for a million points with one numeric and one textual attribute.
+ */
+REGISTER_BENCHMARK(point_clustering) {
+	const size_t count = 1000000;
+	std::mt19937 gen(1);
+	std::uniform_real_distribution<double> coordinate(0, 1024);
+	std::normal_distribution<double> city(0, 10);
+	std::vector<double> xs(count), ys(count), values(count);
+	std::vector<std::string> names(count);
+	for (size_t i = 0; i < count; i++) {
+		// half of the points are spread, the other half is gathered around a few centers
+		double x = coordinate(gen), y = coordinate(gen);
+		if (i % 2 == 0) {
+			x = std::min(1023.0, std::max(0.0, (i % 20) * 50 + city(gen)));
+			y = std::min(1023.0, std::max(0.0, (i % 13) * 75 + city(gen)));
+		}
+		xs[i] = x;
+		ys[i] = y;
+		values[i] = i * 0.25;
+		names[i] = "city " + std::to_string(i % 1000);
+	}
+
+	pv::BoundingBox bounding_box{pv::Coordinate{512, 512}, pv::Dimension{512, 512}, 1};
+	pv::Circle::CommonAttributes common_attributes{5, 1};
+
+	size_t circles = 0;
+	double objects = Benchmark::measure(3, [&]() {
+		pv::Grid grid{bounding_box, 0, 0, common_attributes};
+		pv::CircleClusteringQuadTree tree{bounding_box, 1};
+		for (size_t i = 0; i < count; i++) {
+			pv::Coordinate center{xs[i], ys[i]};
+			grid.insert(std::make_shared<pv::Circle>(
+					center,
+					common_attributes,
+					std::map<std::string, pv::Circle::TextAttribute>{{"name", pv::Circle::TextAttribute{names[i], center, common_attributes}}},
+					std::map<std::string, pv::Circle::NumericAttribute>{{"value", pv::Circle::NumericAttribute{values[i]}}}
+			));
+		}
+		grid.insert_into(tree);
+		circles = tree.getCircles().size();
+	});
+	Benchmark::report("point_clustering/1M points", "Grid + CircleClusteringQuadTree", objects, "ms");
+
+	double flat = Benchmark::measure(3, [&]() {
+		pv::FlatCircleClustering clustering{bounding_box, 0, 0, 5, 1, 1, 1};
+		for (size_t i = 0; i < count; i++) {
+			uint32_t name = clustering.getTextKey(names[i]);
+			clustering.insert(xs[i], ys[i], &values[i], &name);
+		}
+		clustering.cluster();
+		if (clustering.getCircleCount() != circles)
+			Benchmark::report("point_clustering/MISMATCH", "FlatCircleClustering", clustering.getCircleCount(), "circles");
+	});
+	Benchmark::report("point_clustering/1M points", "FlatCircleClustering", flat, "ms");
+}
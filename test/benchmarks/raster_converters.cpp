@@ -0,0 +1,60 @@
+#include "benchmark.h"
+
+#include "datatypes/raster.h"
+#include "rasterdb/converters/converter.h"
+
+#include <gdal_priv.h>
+#include <cstring>
+
+/*
+ * Encodes and decodes the test rasters with every RasterConverter and reports throughput
+ * (relative to the uncompressed size) and compression ratio. Run from the repository root.
+ */
+REGISTER_BENCHMARK(raster_converters) {
+	GDALAllRegister();
+
+	const std::vector<std::string> files {
+		"test/systemtests/data/gdal_files/MOD13A2_M_NDVI_2014-01-01.TIFF",
+		"test/systemtests/data/ndvi/MOD13A2_M_NDVI_2014-01-01_rgb_3600x1800.TIFF"
+	};
+	const std::vector<std::string> methods {
+		"RAW", "GZIP", "BZIP",
+		"LZ4", "LZ4:9", "LZ4_DELTA",
+		"ZSTD:1", "ZSTD", "ZSTD:9", "ZSTD:19", "ZSTD_DELTA"
+	};
+
+	for (auto &file : files) {
+		std::unique_ptr<GenericRaster> raster;
+		try {
+			raster = GenericRaster::fromGDAL(file.c_str(), 1);
+		}
+		catch (const std::exception &e) {
+			fprintf(stderr, "Skipping %s: %s\n", file.c_str(), e.what());
+			continue;
+		}
+		raster->setRepresentation(GenericRaster::Representation::CPU);
+		const double megabytes = raster->getDataSize() / (1024.0 * 1024.0);
+		const std::string name = file.substr(file.find_last_of('/') + 1);
+
+		for (auto &method : methods) {
+			auto converter = RasterConverter::getConverter(method);
+			std::unique_ptr<ByteBuffer> encoded;
+			std::unique_ptr<GenericRaster> decoded;
+			const size_t runs = method == "BZIP" || method == "ZSTD:19" ? 1 : 3;
+
+			double encode = Benchmark::measure(runs, [&]() {
+				encoded = converter->encode(raster.get());
+			});
+			double decode = Benchmark::measure(runs, [&]() {
+				decoded = converter->decode(*encoded, raster->dd, raster->stref, raster->width, raster->height, 0);
+			});
+
+			std::string variant = method + " " + name;
+			Benchmark::report("raster_converters/encode", variant, megabytes / (encode / 1000), "MB/s");
+			Benchmark::report("raster_converters/decode", variant, megabytes / (decode / 1000), "MB/s");
+			Benchmark::report("raster_converters/ratio", variant, (double) raster->getDataSize() / encoded->size, "x");
+			if (memcmp(decoded->getData(), raster->getData(), raster->getDataSize()) != 0)
+				Benchmark::report("raster_converters/MISMATCH", variant, 1, "");
+		}
+	}
+}
@@ -0,0 +1,52 @@
+#include "benchmark.h"
+
+#include "datatypes/raster/raster_priv.h"
+#include "raster/expression.h"
+#include "raster/opencl.h"
+
+/*
+ * Throughput of the expression operator's engines on typical band math: the CPU engine,
+ * and the OpenCL kernels (including the transfer of the result), which on nodes without
+ * a GPU run on a CPU OpenCL runtime.
+ */
+REGISTER_BENCHMARK(raster_expression) {
+	const uint32_t size = 4096;
+	const double megapixels = size * size / 1e6;
+	SpatioTemporalReference stref(
+		SpatialReference(CrsId::from_epsg_code(4326), 0, 0, size, size),
+		TemporalReference(TIMETYPE_UNIX, 0, 1)
+	);
+
+	auto a_guard = GenericRaster::create(DataDescription(GDT_UInt16, Unit::unknown(), true, 0), stref, size, size, 0, GenericRaster::Representation::CPU);
+	auto b_guard = GenericRaster::create(DataDescription(GDT_UInt16, Unit::unknown(), true, 0), stref, size, size, 0, GenericRaster::Representation::CPU);
+	auto a = (Raster2D<uint16_t> *) a_guard.get();
+	auto b = (Raster2D<uint16_t> *) b_guard.get();
+	for (uint32_t y = 0; y < size; y++)
+		for (uint32_t x = 0; x < size; x++) {
+			a->set(x, y, (x * 7 + y) % 4000);
+			b->set(x, y, (x + y * 3) % 3000);
+		}
+	std::vector<GenericRaster *> inputs{a, b};
+	DataDescription out_dd(GDT_Float32, Unit::unknown(), true, -9999);
+
+	std::vector<std::pair<std::string, std::string>> expressions = {
+		{"sum", "A + B"},
+		{"ndvi", "(B - A) / (B + A + 0.0)"},
+		{"threshold", "A > 1000 && B < 2000 ? sqrt(A * 1.0) : log(B + 1.0)"}
+	};
+
+	for (auto &e : expressions) {
+		double cpu = Benchmark::measure(5, [&]() {
+			RasterExpression::evaluateCPU(e.second, inputs, out_dd, stref);
+		});
+		Benchmark::report("raster_expression/cpu", e.first, megapixels / cpu * 1000, "MPixel/s");
+
+#ifndef MAPPING_NO_OPENCL
+		double opencl = Benchmark::measure(5, [&]() {
+			auto result = RasterExpression::evaluateOpenCL(e.second, inputs, out_dd, stref);
+			result->setRepresentation(GenericRaster::Representation::CPU);
+		});
+		Benchmark::report("raster_expression/opencl", e.first, megapixels / opencl * 1000, "MPixel/s");
+#endif
+	}
+}
@@ -0,0 +1,95 @@
+#include "benchmark.h"
+
+#include "datatypes/raster/raster_priv.h"
+#include "datatypes/raster/raster_kernels.h"
+#include "operators/queryrectangle.h"
+
+#include <cmath>
+
+using RasterKernels::InstructionSet;
+
+static const char *instructionSetName(InstructionSet set) {
+	switch (set) {
+		case InstructionSet::SCALAR: return "scalar";
+		case InstructionSet::SSSE3: return "ssse3";
+		case InstructionSet::AVX2: return "avx2";
+	}
+	return "?";
+}
+
+/*
+ * Throughput of the Raster2D pixel loops for every supported instruction set, and of the
+ * former per-pixel implementations of scale() and flip() for comparison.
+ */
+template<typename T>
+static void benchmarkRasterKernels(GDALDataType type, const std::string &typename_) {
+	const uint32_t size = 2048;
+	const double megapixels = size * size / 1e6;
+	DataDescription dd(type, Unit::unknown());
+	SpatioTemporalReference stref(
+		SpatialReference(CrsId::from_epsg_code(4326), 0, 0, size, size),
+		TemporalReference(TIMETYPE_UNIX, 0, 1)
+	);
+	auto raster = GenericRaster::create(dd, stref, size, size, 0, GenericRaster::Representation::CPU);
+	auto in = (Raster2D<T> *) raster.get();
+	for (uint32_t y = 0; y < size; y++)
+		for (uint32_t x = 0; x < size; x++)
+			in->set(x, y, (T) ((x + y) % 100));
+
+	QueryRectangle qrect(
+		SpatialReference(CrsId::from_epsg_code(4326), -100.5, 200.25, size - 600.5, size - 299.75),
+		TemporalReference(TIMETYPE_UNIX, 0, 1),
+		QueryResolution::pixels(1024, 1024)
+	);
+
+	auto per_pixel_scale = Benchmark::measure(3, [&]() {
+		auto out_guard = GenericRaster::create(dd, stref, size / 2, size / 2);
+		auto out = (Raster2D<T> *) out_guard.get();
+		for (uint32_t y = 0; y < size / 2; y++)
+			for (uint32_t x = 0; x < size / 2; x++) {
+				int px = (int) round(((x+0.5) * size / (size / 2)) - 0.5);
+				int py = (int) round(((y+0.5) * size / (size / 2)) - 0.5);
+				out->set(x, y, in->get(px, py));
+			}
+	});
+	Benchmark::report("raster_kernels/scale_down", typename_ + " per_pixel", megapixels / 4 / (per_pixel_scale / 1000), "MPixel/s");
+
+	auto per_pixel_flip = Benchmark::measure(3, [&]() {
+		auto out_guard = GenericRaster::create(dd, stref, size, size);
+		auto out = (Raster2D<T> *) out_guard.get();
+		for (uint32_t y = 0; y < size; y++)
+			for (uint32_t x = 0; x < size; x++)
+				out->set(x, y, in->get(size-x-1, y));
+	});
+	Benchmark::report("raster_kernels/flip_x", typename_ + " per_pixel", megapixels / (per_pixel_flip / 1000), "MPixel/s");
+
+	auto previous = RasterKernels::getInstructionSet();
+	for (auto set : {InstructionSet::SCALAR, InstructionSet::SSSE3, InstructionSet::AVX2}) {
+		if (!RasterKernels::isSupported(set))
+			continue;
+		RasterKernels::setInstructionSet(set);
+		std::string variant = typename_ + " " + instructionSetName(set);
+
+		auto clear = Benchmark::measure(10, [&]() { raster->clear(1); });
+		Benchmark::report("raster_kernels/clear", variant, megapixels / (clear / 1000), "MPixel/s");
+		auto flip_x = Benchmark::measure(10, [&]() { raster->flip(true, false); });
+		Benchmark::report("raster_kernels/flip_x", variant, megapixels / (flip_x / 1000), "MPixel/s");
+		auto flip_y = Benchmark::measure(10, [&]() { raster->flip(false, true); });
+		Benchmark::report("raster_kernels/flip_y", variant, megapixels / (flip_y / 1000), "MPixel/s");
+		auto scale_down = Benchmark::measure(10, [&]() { raster->scale(size / 2, size / 2); });
+		Benchmark::report("raster_kernels/scale_down", variant, megapixels / 4 / (scale_down / 1000), "MPixel/s");
+		auto scale_up = Benchmark::measure(3, [&]() { raster->scale(size * 2, size * 2); });
+		Benchmark::report("raster_kernels/scale_up", variant, megapixels * 4 / (scale_up / 1000), "MPixel/s");
+		auto fit = Benchmark::measure(10, [&]() { raster->fitToQueryRectangle(qrect); });
+		Benchmark::report("raster_kernels/fit", variant, 1024 * 1024 / 1e6 / (fit / 1000), "MPixel/s");
+	}
+	RasterKernels::setInstructionSet(previous);
+}
+
+REGISTER_BENCHMARK(raster_kernels) {
+	benchmarkRasterKernels<uint8_t>(GDT_Byte, "uint8");
+	benchmarkRasterKernels<int16_t>(GDT_Int16, "int16");
+	benchmarkRasterKernels<uint32_t>(GDT_UInt32, "uint32");
+	benchmarkRasterKernels<float>(GDT_Float32, "float32");
+	benchmarkRasterKernels<double>(GDT_Float64, "float64");
+}
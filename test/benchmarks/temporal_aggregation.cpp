@@ -0,0 +1,83 @@
+#include "benchmark.h"
+
+#include "datatypes/raster/raster_priv.h"
+#include "datatypes/raster/raster_kernels.h"
+#include "raster/temporal_aggregation.h"
+
+#include <cmath>
+#include <random>
+
+/*
+ * Throughput of aggregating a year of daily rasters: the former accumulation, which visited
+ * the pixels column by column through getAsDouble(), and the aggregator for every aggregation.
+ * The year cycles through a week of distinct rasters, so the inputs do not dominate the memory.
+ */
+REGISTER_BENCHMARK(temporal_aggregation) {
+	const uint32_t size = 1024;
+	const size_t days = 365;
+	const double megapixels = size * size * days / 1e6;
+	DataDescription dd(GDT_Int16, Unit::unknown(), true, -1);
+	SpatioTemporalReference stref(
+		SpatialReference(CrsId::from_epsg_code(4326), 0, 0, size, size),
+		TemporalReference(TIMETYPE_UNIX, 0, 1)
+	);
+
+	std::mt19937 gen(3);
+	std::normal_distribution<double> distribution(1000, 100);
+	std::vector<std::unique_ptr<GenericRaster>> week;
+	for (size_t day = 0; day < 7; day++) {
+		week.push_back(GenericRaster::create(dd, stref, size, size, 0, GenericRaster::Representation::CPU));
+		auto raster = (Raster2D<int16_t> *) week.back().get();
+		for (uint32_t y = 0; y < size; y++)
+			for (uint32_t x = 0; x < size; x++)
+				raster->set(x, y, (x + y + day) % 97 == 0 ? -1 : (int16_t) distribution(gen));
+	}
+
+	auto former = Benchmark::measure(1, [&]() {
+		DataDescription accumulator_dd(GDT_Float64, Unit::unknown());
+		auto accumulator_guard = GenericRaster::create(accumulator_dd, stref, size, size, 0, GenericRaster::Representation::CPU);
+		auto accumulator = (Raster2D<double> *) accumulator_guard.get();
+		for (uint32_t x = 0; x < size; ++x)
+			for (uint32_t y = 0; y < size; ++y)
+				accumulator->set(x, y, week[0]->getAsDouble(x, y));
+		for (size_t day = 1; day < days; day++) {
+			auto raster = (Raster2D<int16_t> *) week[day % 7].get();
+			for (uint32_t x = 0; x < size; ++x)
+				for (uint32_t y = 0; y < size; ++y) {
+					int16_t value = raster->get(x, y);
+					double sum = accumulator->get(x, y);
+					accumulator->set(x, y, raster->dd.is_no_data(value) || std::isnan(sum) ? NAN : value + sum);
+				}
+		}
+	});
+	Benchmark::report("temporal_aggregation/former", "avg", megapixels / (former / 1000), "MPixel/s");
+
+	auto aggregate = [&](TemporalAggregator::Type type) {
+		TemporalAggregator aggregator(type, 0.9);
+		for (size_t day = 0; day < days; day++)
+			aggregator.add(*week[day % 7]);
+		aggregator.getResult(stref);
+	};
+
+	std::vector<std::pair<TemporalAggregator::Type, std::string>> types = {
+		{TemporalAggregator::Type::COUNT, "count"},
+		{TemporalAggregator::Type::SUM, "sum"},
+		{TemporalAggregator::Type::MIN, "min"},
+		{TemporalAggregator::Type::MAX, "max"},
+		{TemporalAggregator::Type::AVG, "avg"},
+		{TemporalAggregator::Type::STDDEV, "stddev"},
+		{TemporalAggregator::Type::MEDIAN, "median"},
+		{TemporalAggregator::Type::PERCENTILE, "percentile"}
+	};
+	for (auto &type : types) {
+		auto time = Benchmark::measure(1, [&]() { aggregate(type.first); });
+		Benchmark::report("temporal_aggregation/aggregator", type.second, megapixels / (time / 1000), "MPixel/s");
+	}
+
+	// the accumulators without SIMD
+	auto previous = RasterKernels::getInstructionSet();
+	RasterKernels::setInstructionSet(RasterKernels::InstructionSet::SCALAR);
+	auto scalar = Benchmark::measure(1, [&]() { aggregate(TemporalAggregator::Type::STDDEV); });
+	Benchmark::report("temporal_aggregation/aggregator", "stddev scalar", megapixels / (scalar / 1000), "MPixel/s");
+	RasterKernels::setInstructionSet(previous);
+}
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+
+#include "cache/priv/cache_index.h"
+
+#include <random>
+#include <set>
+
+namespace {
+
+Cube3 random_cube( std::mt19937 &gen ) {
+	std::uniform_real_distribution<double> pos(0, 1000);
+	std::uniform_real_distribution<double> ext(0, 50);
+	double x = pos(gen), y = pos(gen), t = pos(gen);
+	return Cube3( x, x + ext(gen), y, y + ext(gen), t, t + ext(gen) );
+}
+
+std::set<uint64_t> search( const CubeIndex<uint64_t> &index, const Cube3 &query ) {
+	std::set<uint64_t> result;
+	index.search( query, [&result]( const uint64_t &key ) {
+		result.insert(key);
+		return true;
+	});
+	return result;
+}
+
+std::set<uint64_t> scan( const std::map<uint64_t,Cube3> &entries, const Cube3 &query ) {
+	std::set<uint64_t> result;
+	for ( auto &e : entries )
+		if ( e.second.intersects(query) )
+			result.insert(e.first);
+	return result;
+}
+
+}
+
+TEST(CubeIndex, matches_linear_scan) {
+	std::mt19937 gen(42);
+	CubeIndex<uint64_t> index;
+	std::map<uint64_t,Cube3> entries;
+
+	for ( uint64_t i = 0; i < 2000; i++ ) {
+		auto c = random_cube(gen);
+		index.insert(i, c);
+		entries.emplace(i, c);
+	}
+	EXPECT_EQ(2000u, index.size());
+
+	for ( int i = 0; i < 200; i++ ) {
+		auto q = random_cube(gen);
+		EXPECT_EQ( scan(entries,q), search(index,q) );
+	}
+}
+
+TEST(CubeIndex, remove) {
+	std::mt19937 gen(4711);
+	CubeIndex<uint64_t> index;
+	std::map<uint64_t,Cube3> entries;
+
+	for ( uint64_t i = 0; i < 1000; i++ ) {
+		auto c = random_cube(gen);
+		index.insert(i, c);
+		entries.emplace(i, c);
+	}
+
+	// Remove every other entry
+	for ( uint64_t i = 0; i < 1000; i += 2 ) {
+		EXPECT_TRUE( index.remove(i, entries.at(i)) );
+		entries.erase(i);
+	}
+	EXPECT_FALSE( index.remove(0, Cube3(0,1,0,1,0,1)) );
+	EXPECT_EQ(500, index.size());
+
+	for ( int i = 0; i < 200; i++ ) {
+		auto q = random_cube(gen);
+		EXPECT_EQ( scan(entries,q), search(index,q) );
+	}
+
+	for ( auto &e : entries )
+		EXPECT_TRUE( index.remove(e.first, e.second) );
+	EXPECT_TRUE( index.empty() );
+	EXPECT_TRUE( search(index, Cube3(0,1000,0,1000,0,1000)).empty() );
+}
+
+TEST(CubeIndex, stop_search) {
+	CubeIndex<uint64_t> index;
+	for ( uint64_t i = 0; i < 100; i++ )
+		index.insert(i, Cube3(0,10,0,10,0,10));
+
+	size_t visited = 0;
+	EXPECT_FALSE( index.search( Cube3(5,6,5,6,5,6), [&visited]( const uint64_t & ) {
+		return ++visited < 3;
+	}));
+	EXPECT_EQ(3, visited);
+}
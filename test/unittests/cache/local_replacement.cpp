@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+
+#include "cache/node/manager/local_replacement.h"
+#include "datatypes/pointcollection.h"
+
+#include <vector>
+
+namespace {
+
+CacheEntry entry( uint64_t size, double cpu ) {
+	ProfilingData profile;
+	profile.uncached_cpu = cpu;
+	profile.all_cpu = cpu;
+	return CacheEntry( CacheCube(SpatioTemporalReference(SpatialReference(CrsId::from_epsg_code(4326), 0, 0, 1, 1),
+			TemporalReference(TIMETYPE_UNIX, 0, 1))), size, profile );
+}
+
+std::vector<uint64_t> victims( const LocalRelevanceFunction &f ) {
+	std::vector<uint64_t> result;
+	f.visit( [&result]( const NodeCacheKey &key, uint64_t ) {
+		result.push_back(key.entry_id);
+		return true;
+	});
+	return result;
+}
+
+QueryRectangle tile( double x ) {
+	return QueryRectangle( SpatialReference(CrsId::from_epsg_code(4326), x, 0, x + 1, 1),
+			TemporalReference(TIMETYPE_UNIX, 0, 1), QueryResolution::none() );
+}
+
+}
+
+TEST(LocalReplacement, lru) {
+	LocalLRU lru;
+	for ( uint64_t i = 1; i <= 4; i++ )
+		lru.inserted(NodeCacheKey("op", i), entry(10, 1));
+	EXPECT_EQ( (std::vector<uint64_t>{1, 2, 3, 4}), victims(lru) );
+
+	lru.accessed(1);
+	lru.accessed(3);
+	lru.removed(2);
+	EXPECT_EQ( (std::vector<uint64_t>{4, 1, 3}), victims(lru) );
+}
+
+TEST(LocalReplacement, costLruPrefersExpensiveEntries) {
+	LocalCostLRU lru;
+	lru.inserted(NodeCacheKey("op", 1), entry(10, 5));
+	lru.inserted(NodeCacheKey("op", 2), entry(10, 1));
+	lru.inserted(NodeCacheKey("op", 3), entry(10, 3));
+	EXPECT_EQ( (std::vector<uint64_t>{2, 3, 1}), victims(lru) );
+
+	// after evicting the cheap entries, new entries overtake the expensive one
+	lru.removed(2);
+	lru.removed(3);
+	lru.inserted(NodeCacheKey("op", 4), entry(10, 3));
+	EXPECT_EQ( (std::vector<uint64_t>{1, 4}), victims(lru) );
+
+	// until it is accessed again
+	lru.accessed(1);
+	EXPECT_EQ( (std::vector<uint64_t>{4, 1}), victims(lru) );
+}
+
+TEST(LocalReplacement, frequencySketch) {
+	FrequencySketch sketch(1024, 1000);
+	for ( int i = 0; i < 5; i++ )
+		sketch.increment(42);
+	sketch.increment(7);
+	EXPECT_EQ(5, sketch.estimate(42));
+	EXPECT_EQ(1, sketch.estimate(7));
+	EXPECT_EQ(0, sketch.estimate(13));
+
+	// counters saturate
+	for ( int i = 0; i < 100; i++ )
+		sketch.increment(42);
+	EXPECT_EQ(FrequencySketch::MAX_COUNT, sketch.estimate(42));
+
+	// and fade out
+	for ( uint64_t i = 0; i < 1000; i++ )
+		sketch.increment(1000 + i);
+	EXPECT_LT(sketch.estimate(42), FrequencySketch::MAX_COUNT);
+}
+
+TEST(LocalReplacement, evictsLeastRecentlyUsed) {
+	NodeCache<PointCollection> cache(CacheType::POINT, 100);
+	LocalReplacement<PointCollection> replacement(std::make_unique<LocalLRU>());
+
+	// the replacement only looks at the sizes, so the cache may stay empty
+	for ( uint64_t i = 1; i <= 4; i++ )
+		replacement.inserted(NodeCacheKey("op", i), tile(i), entry(25, 1));
+	replacement.accessed(NodeCacheKey("op", 1));
+
+	std::vector<NodeCacheKey> removals;
+	EXPECT_TRUE(replacement.get_removals(cache, "op", tile(5), 10, removals));
+	EXPECT_TRUE(removals.empty());
+
+	cache.put("op", std::shared_ptr<const PointCollection>(std::make_unique<PointCollection>(SpatioTemporalReference::unreferenced())), entry(100, 1));
+	EXPECT_TRUE(replacement.get_removals(cache, "op", tile(5), 40, removals));
+	ASSERT_EQ(2u, removals.size());
+	EXPECT_EQ(2u, removals[0].entry_id);
+	EXPECT_EQ(3u, removals[1].entry_id);
+}
+
+TEST(LocalReplacement, admissionControl) {
+	NodeCache<PointCollection> cache(CacheType::POINT, 100);
+	cache.put("op", std::shared_ptr<const PointCollection>(std::make_unique<PointCollection>(SpatioTemporalReference::unreferenced())), entry(100, 1));
+	LocalReplacement<PointCollection> replacement(std::make_unique<LocalLRU>(), true);
+
+	// a popular entry
+	replacement.queried("op", tile(1));
+	replacement.inserted(NodeCacheKey("op", 1), tile(1), entry(50, 1));
+	for ( int i = 0; i < 3; i++ ) {
+		replacement.queried("op", tile(1));
+		replacement.accessed(NodeCacheKey("op", 1));
+	}
+
+	// a result requested once does not replace it
+	std::vector<NodeCacheKey> removals;
+	replacement.queried("op", tile(2));
+	EXPECT_FALSE(replacement.get_removals(cache, "op", tile(2), 50, removals));
+	EXPECT_TRUE(removals.empty());
+
+	// a result requested more often does
+	for ( int i = 0; i < 10; i++ )
+		replacement.queried("op", tile(3));
+	EXPECT_TRUE(replacement.get_removals(cache, "op", tile(3), 50, removals));
+	ASSERT_EQ(1u, removals.size());
+	EXPECT_EQ(1u, removals[0].entry_id);
+}
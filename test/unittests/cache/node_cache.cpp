@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+
+#include "cache/node/node_cache.h"
+#include "datatypes/pointcollection.h"
+#include "datatypes/raster.h"
+
+namespace {
+
+std::unique_ptr<PointCollection> points( size_t count ) {
+	auto result = std::make_unique<PointCollection>(SpatioTemporalReference(
+			SpatialReference(CrsId::from_epsg_code(4326), 0, 0, 10, 10), TemporalReference(TIMETYPE_UNIX, 0, 10)));
+	for ( size_t i = 0; i < count; i++ )
+		result->addSinglePointFeature(Coordinate(i, i));
+	return result;
+}
+
+std::shared_ptr<const GenericRaster> raster( uint32_t pixels ) {
+	SpatioTemporalReference stref(SpatialReference(CrsId::from_epsg_code(4326), 0, 0, 10, 10), TemporalReference(TIMETYPE_UNIX, 0, 10));
+	return GenericRaster::create(DataDescription(GDT_Byte, Unit::unknown()), stref, pixels, pixels, 0, GenericRaster::Representation::CPU);
+}
+
+QueryRectangle tile( uint32_t pixels ) {
+	return QueryRectangle(SpatialReference(CrsId::from_epsg_code(4326), 0, 0, 10, 10),
+			TemporalReference(TIMETYPE_UNIX, 2, 3), QueryResolution::pixels(pixels, pixels));
+}
+
+}
+
+TEST(NodeCache, sharedItemsAreNotCopied) {
+	NodeCache<PointCollection> cache(CacheType::POINT, 1 << 20);
+
+	std::shared_ptr<const PointCollection> shared = points(5);
+	auto meta = cache.put("op", shared, CacheEntry(CacheCube(*shared), 1000, ProfilingData()));
+	auto entry = cache.get(NodeCacheKey("op", meta.entry_id));
+	EXPECT_EQ(shared.get(), entry->data.get());
+
+	// copies are independent of the cached item
+	auto copy = entry->copy_data();
+	EXPECT_NE(shared.get(), copy.get());
+	copy->addSinglePointFeature(Coordinate(1, 1));
+	EXPECT_EQ(5u, entry->data->getFeatureCount());
+}
+
+TEST(NodeCache, uniqueItemsAreCopied) {
+	NodeCache<PointCollection> cache(CacheType::POINT, 1 << 20);
+
+	auto unique = points(5);
+	auto meta = cache.put("op", unique, CacheEntry(CacheCube(*unique), 1000, ProfilingData()));
+	auto entry = cache.get(NodeCacheKey("op", meta.entry_id));
+	EXPECT_NE(unique.get(), entry->data.get());
+	EXPECT_EQ(5u, entry->data->getFeatureCount());
+}
+
+TEST(NodeCache, sharedResultsAreCopiedOnWrite) {
+	NodeCache<PointCollection> cache(CacheType::POINT, 1 << 20);
+
+	// nobody else holds the result, so it is handed back
+	auto unique = points(5);
+	auto address = unique.get();
+	EXPECT_EQ(address, take_result(share_result(std::move(unique))).get());
+
+	// the cache holds the result, so it is copied
+	auto shared = share_result(points(5));
+	cache.put("op", shared, CacheEntry(CacheCube(*shared), 1000, ProfilingData()));
+	auto copy = take_result(shared);
+	EXPECT_NE(shared.get(), copy.get());
+	copy->addSinglePointFeature(Coordinate(1, 1));
+	EXPECT_EQ(5u, shared->getFeatureCount());
+}
+
+TEST(NodeCache, finerRastersAreResampled) {
+	NodeCache<GenericRaster> exact(CacheType::RASTER, 1 << 24);
+	NodeCache<GenericRaster> resampling(CacheType::RASTER, 1 << 24, 4);
+
+	auto item = raster(256);
+	for ( auto cache : {&exact, &resampling} )
+		cache->put("op", item, CacheEntry(CacheCube(*item), 1000, ProfilingData()));
+
+	auto res = resampling.query("op", tile(256));
+	EXPECT_FALSE(res.has_remainder());
+	EXPECT_FALSE(res.resampled);
+
+	res = resampling.query("op", tile(64));
+	EXPECT_FALSE(res.has_remainder());
+	EXPECT_TRUE(res.resampled);
+	EXPECT_EQ(item.get(), res.items.front()->data.get());
+
+	// beyond the maximum factor and without resampling
+	EXPECT_FALSE(resampling.query("op", tile(32)).has_hit());
+	EXPECT_FALSE(exact.query("op", tile(64)).has_hit());
+	// coarser entries are never used
+	EXPECT_FALSE(resampling.query("op", tile(512)).has_hit());
+}
+
+TEST(NodeCache, exactResolutionIsPreferred) {
+	NodeCache<GenericRaster> cache(CacheType::RASTER, 1 << 24, 4);
+
+	auto fine = raster(256), matching = raster(128);
+	cache.put("op", fine, CacheEntry(CacheCube(*fine), 1000, ProfilingData()));
+	cache.put("op", matching, CacheEntry(CacheCube(*matching), 1000, ProfilingData()));
+
+	auto res = cache.query("op", tile(128));
+	ASSERT_EQ(1u, res.items.size());
+	EXPECT_FALSE(res.resampled);
+	EXPECT_EQ(matching.get(), res.items.front()->data.get());
+}
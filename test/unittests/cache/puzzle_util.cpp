@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+
+#include "cache/node/puzzle_util.h"
+#include "cache/node/manager/local_manager.h"
+#include "datatypes/raster.h"
+#include "datatypes/pointcollection.h"
+#include "datatypes/linecollection.h"
+#include "datatypes/polygoncollection.h"
+#include "datatypes/plot.h"
+#include "operators/provenance.h"
+#include "util/exceptions.h"
+
+#include <map>
+
+namespace {
+
+/*
+ * The query covers four strips of 10x10 with a point in the middle of each,
+ * the source names them a to d.
+ */
+const std::string points_graph = R"({
+	"type": "csv_source",
+	"params": {
+		"filename": "data:text/plain,X,Y,Name\n5,5,a\n15,5,b\n25,5,c\n35,5,d",
+		"geometry": "xy",
+		"time": "none",
+		"columns": {"x": "X", "y": "Y", "textual": ["Name"]}
+	}
+})";
+
+const size_t PIECE_IO = 1000;
+
+QueryRectangle query() {
+	return QueryRectangle(SpatialReference(CrsId::from_epsg_code(4326), 0, 0, 40, 10),
+			TemporalReference(TIMETYPE_UNIX, 0, 10), QueryResolution::none());
+}
+
+Cube<3> strips( int first, int last ) {
+	Cube<3> cube;
+	cube.set_dimension(0, first * 10, (last + 1) * 10);
+	cube.set_dimension(1, 0, 10);
+	cube.set_dimension(2, 0, 10);
+	return cube;
+}
+
+/*
+ * Retriever serving pieces named "piece". Pieces with the host "local" are local,
+ * pieces that were not added are gone.
+ */
+class StubRetriever : public PieceRetriever<PointCollection> {
+public:
+	CacheRef add( const std::string &host, uint64_t id, int strip ) {
+		auto piece = std::make_shared<PointCollection>(SpatioTemporalReference(
+				SpatialReference(CrsId::from_epsg_code(4326), strip * 10, 0, (strip + 1) * 10, 10),
+				TemporalReference(TIMETYPE_UNIX, 0, 10)));
+		piece->addSinglePointFeature(Coordinate(strip * 10 + 5, 5));
+		piece->feature_attributes.addTextualAttribute("Name", Unit::unknown()).set(0, "piece");
+		pieces[id] = piece;
+		return gone(host, id, strip);
+	}
+
+	CacheRef gone( const std::string &host, uint64_t id, int strip ) const {
+		return CacheRef(host, 0, id, strips(strip, strip));
+	}
+
+	std::shared_ptr<const PointCollection> fetch(const std::string &semantic_id,
+			const CacheRef &ref, QueryProfiler &qp) const {
+		auto it = pieces.find(ref.entry_id);
+		if ( it == pieces.end() )
+			throw NoSuchElementException("Entry gone");
+		qp.addIOCost(PIECE_IO);
+		return it->second;
+	}
+
+	bool is_local(const CacheRef &ref) const {
+		return ref.host == "local";
+	}
+private:
+	std::map<uint64_t, std::shared_ptr<const PointCollection>> pieces;
+};
+
+class PuzzleUtilTest : public ::testing::Test {
+protected:
+	PuzzleUtilTest() : mgr("never", "lru", 1 << 20, 1 << 20, 1 << 20, 1 << 20, 1 << 20, 1 << 20) {
+		static NopCacheManager cache_manager;
+		CacheManager::init(&cache_manager);
+		op = GenericOperator::fromJSON(points_graph);
+	}
+
+	// the names of the points of the result, by strip
+	std::string process( const std::vector<Cube<3>> &remainder, const std::vector<CacheRef> &parts ) {
+		PuzzleRequest request(CacheType::POINT, op->getSemanticId(), query(), remainder, parts);
+		std::unique_ptr<PointCollection> result;
+		{
+			QueryProfilerSimpleGuard guard(profiler);
+			result = PuzzleUtil::process(mgr, *op, request, retriever, profiler);
+		}
+		std::vector<std::string> names(4);
+		auto &textual = result->feature_attributes.textual("Name");
+		for ( size_t i = 0; i < result->getFeatureCount(); i++ ) {
+			auto &name = names.at((size_t) result->coordinates[i].x / 10);
+			EXPECT_EQ("", name);
+			name = textual.get(i);
+		}
+		return names[0] + " " + names[1] + " " + names[2] + " " + names[3];
+	}
+
+	LocalCacheManager mgr;
+	std::unique_ptr<GenericOperator> op;
+	StubRetriever retriever;
+	QueryProfiler profiler;
+};
+
+}
+
+TEST_F(PuzzleUtilTest, localAndForeignPieces) {
+	auto parts = std::vector<CacheRef>{
+		retriever.add("local", 1, 0),
+		retriever.add("node1", 2, 1),
+		retriever.add("node2", 3, 2)
+	};
+	EXPECT_EQ("piece piece piece d", process({strips(3, 3)}, parts));
+	// the foreign pieces are fetched on the thread-pool, their profilers are merged
+	EXPECT_EQ(3 * PIECE_IO, profiler.self_io);
+}
+
+TEST_F(PuzzleUtilTest, gonePiecesAreComputed) {
+	auto parts = std::vector<CacheRef>{
+		retriever.add("local", 1, 0),
+		retriever.gone("local", 2, 1),
+		retriever.gone("node1", 3, 2)
+	};
+	EXPECT_EQ("piece b c d", process({strips(3, 3)}, parts));
+	EXPECT_EQ(PIECE_IO, profiler.self_io);
+}
+
+TEST_F(PuzzleUtilTest, foreignPieceIsTheReference) {
+	// without local pieces, the remainders are computed once the foreign piece arrived
+	auto parts = std::vector<CacheRef>{
+		retriever.gone("local", 1, 0),
+		retriever.add("node1", 2, 1)
+	};
+	EXPECT_EQ("a piece c d", process({strips(2, 3)}, parts));
+	EXPECT_EQ(PIECE_IO, profiler.self_io);
+}
+
+TEST_F(PuzzleUtilTest, allPiecesGone) {
+	auto parts = std::vector<CacheRef>{
+		retriever.gone("local", 1, 0),
+		retriever.gone("node1", 2, 1)
+	};
+	EXPECT_THROW(process({strips(2, 3)}, parts), NoSuchElementException);
+}
@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+
+#include "cache/priv/single_flight.h"
+#include "datatypes/pointcollection.h"
+#include "util/exceptions.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace {
+
+QueryRectangle rectangle( double x1, double y1, double x2, double y2 ) {
+	return QueryRectangle( SpatialReference(CrsId::from_epsg_code(4326), x1, y1, x2, y2),
+			TemporalReference(TIMETYPE_UNIX, 0, 10), QueryResolution::none() );
+}
+
+QueryRectangle tile( double x1, double y1, double x2, double y2, uint32_t pixels ) {
+	return QueryRectangle( SpatialReference(CrsId::from_epsg_code(4326), x1, y1, x2, y2),
+			TemporalReference(TIMETYPE_UNIX, 0, 10), QueryResolution::pixels(pixels, pixels) );
+}
+
+std::unique_ptr<PointCollection> points( size_t count ) {
+	auto result = std::make_unique<PointCollection>(SpatioTemporalReference::unreferenced());
+	for ( size_t i = 0; i < count; i++ )
+		result->addSinglePointFeature(Coordinate(i, i));
+	return result;
+}
+
+std::unique_ptr<PointCollection> miss() {
+	throw NoSuchElementException("MISS");
+}
+
+}
+
+TEST(SingleFlight, covers) {
+	using SF = SingleFlight<PointCollection>;
+	EXPECT_TRUE( SF::covers(rectangle(0, 0, 10, 10), rectangle(2, 2, 5, 5)) );
+	EXPECT_FALSE( SF::covers(rectangle(2, 2, 5, 5), rectangle(0, 0, 10, 10)) );
+	EXPECT_TRUE( SF::equals(rectangle(0, 0, 10, 10), rectangle(0, 0, 10, 10)) );
+	EXPECT_FALSE( SF::equals(rectangle(0, 0, 10, 10), rectangle(2, 2, 5, 5)) );
+
+	// rasters have to match in resolution
+	EXPECT_TRUE( SF::covers(tile(0, 0, 10, 10, 100), tile(0, 0, 5, 5, 50)) );
+	EXPECT_FALSE( SF::covers(tile(0, 0, 10, 10, 100), tile(0, 0, 5, 5, 100)) );
+	EXPECT_FALSE( SF::covers(tile(0, 0, 10, 10, 100), rectangle(0, 0, 5, 5)) );
+}
+
+TEST(SingleFlight, identicalRequestsShareTheResult) {
+	std::atomic<int> coalesced(0);
+	SingleFlight<PointCollection> single_flight([&coalesced]() { coalesced++; });
+	auto rect = rectangle(0, 0, 10, 10);
+
+	SingleFlight<PointCollection>::Ticket ticket;
+	ASSERT_EQ(nullptr, single_flight.join("op", rect, miss, ticket));
+
+	const int waiters = 4;
+	std::vector<std::unique_ptr<PointCollection>> results(waiters);
+	std::vector<std::thread> threads;
+	for ( int i = 0; i < waiters; i++ ) {
+		threads.emplace_back([&, i]() {
+			SingleFlight<PointCollection>::Ticket own_ticket;
+			results[i] = single_flight.join("op", rect, miss, own_ticket);
+		});
+	}
+	// a different operator is not affected
+	SingleFlight<PointCollection>::Ticket other_ticket;
+	EXPECT_EQ(nullptr, single_flight.join("other", rect, miss, other_ticket));
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	auto result = points(3);
+	ticket.complete(*result);
+	for ( auto &thread : threads )
+		thread.join();
+
+	for ( auto &r : results ) {
+		ASSERT_NE(nullptr, r);
+		EXPECT_EQ(3u, r->getFeatureCount());
+		EXPECT_NE(result.get(), r.get());
+	}
+	EXPECT_EQ(waiters, coalesced);
+}
+
+TEST(SingleFlight, coveredRequestsQueryTheCacheAgain) {
+	std::atomic<int> coalesced(0);
+	SingleFlight<PointCollection> single_flight([&coalesced]() { coalesced++; });
+
+	SingleFlight<PointCollection>::Ticket ticket;
+	ASSERT_EQ(nullptr, single_flight.join("op", rectangle(0, 0, 10, 10), miss, ticket));
+
+	std::atomic<bool> cached(false);
+	std::unique_ptr<PointCollection> result;
+	std::thread waiter([&]() {
+		SingleFlight<PointCollection>::Ticket own_ticket;
+		result = single_flight.join("op", rectangle(2, 2, 5, 5), [&cached]() {
+			return cached ? points(1) : miss();
+		}, own_ticket);
+	});
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	cached = true;
+	auto computed = points(3);
+	ticket.complete(*computed);
+	waiter.join();
+
+	ASSERT_NE(nullptr, result);
+	EXPECT_EQ(1u, result->getFeatureCount());
+	EXPECT_EQ(1, coalesced);
+}
+
+TEST(SingleFlight, failedComputationIsRetried) {
+	std::atomic<int> coalesced(0);
+	SingleFlight<PointCollection> single_flight([&coalesced]() { coalesced++; });
+	auto rect = rectangle(0, 0, 10, 10);
+
+	auto ticket = std::make_unique<SingleFlight<PointCollection>::Ticket>();
+	ASSERT_EQ(nullptr, single_flight.join("op", rect, miss, *ticket));
+
+	std::unique_ptr<PointCollection> result = points(1);
+	std::thread waiter([&]() {
+		SingleFlight<PointCollection>::Ticket own_ticket;
+		result = single_flight.join("op", rect, miss, own_ticket);
+	});
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	// the computation failed, so the waiting request has to compute the result itself
+	ticket.reset();
+	waiter.join();
+
+	EXPECT_EQ(nullptr, result);
+	EXPECT_EQ(0, coalesced);
+}
+
+TEST(SingleFlight, cancelledRequestsStopWaiting) {
+	SingleFlight<PointCollection> single_flight(nullptr);
+	auto rect = rectangle(0, 0, 10, 10);
+
+	SingleFlight<PointCollection>::Ticket ticket;
+	ASSERT_EQ(nullptr, single_flight.join("op", rect, miss, ticket));
+
+	std::atomic<bool> cancelled(false), aborted(false);
+	std::thread waiter([&]() {
+		SingleFlight<PointCollection>::Ticket own_ticket;
+		try {
+			single_flight.join("op", rect, miss, own_ticket, [&cancelled]() {
+				if ( cancelled )
+					throw QueryCancelledException("The query was cancelled");
+			});
+		} catch ( const QueryCancelledException &e ) {
+			aborted = true;
+		}
+	});
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	cancelled = true;
+	// the waiting request notices the cancellation while the computation is still running
+	waiter.join();
+	EXPECT_TRUE(aborted);
+
+	// the computation is completed as usual
+	auto result = points(3);
+	ticket.complete(*result);
+}
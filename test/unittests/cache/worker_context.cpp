@@ -0,0 +1,38 @@
+#include <gtest/gtest.h>
+
+#include "cache/node/node_manager.h"
+#include "util/exceptions.h"
+
+#include <thread>
+
+TEST(WorkerContext, delegationSharesThePuzzleDepth) {
+	WorkerContext worker;
+	PuzzleGuard pg(worker);
+	PuzzleGuard pg2(worker);
+
+	std::thread helper([&worker]() {
+		WorkerContext ctx;
+		{
+			DelegationGuard dg(ctx, worker, 2);
+			EXPECT_EQ(2, ctx.get_puzzle_depth());
+			// the index-connection of the worker is shared, but not configured here
+			EXPECT_THROW(ctx.get_index_connection(), IllegalStateException);
+			PuzzleGuard nested(ctx);
+			EXPECT_EQ(3, ctx.get_puzzle_depth());
+		}
+		EXPECT_FALSE(ctx.is_puzzling());
+	});
+	helper.join();
+	EXPECT_EQ(2, worker.get_puzzle_depth());
+}
+
+TEST(WorkerContext, delegationToTheWorkerItselfChangesNothing) {
+	WorkerContext worker;
+	PuzzleGuard pg(worker);
+	{
+		DelegationGuard dg(worker, worker, 0);
+		PuzzleGuard nested(worker);
+		EXPECT_EQ(2, worker.get_puzzle_depth());
+	}
+	EXPECT_EQ(1, worker.get_puzzle_depth());
+}
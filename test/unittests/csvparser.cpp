@@ -1,9 +1,13 @@
 #include "util/csvparser.h"
+#include "util/mapped_csvparser.h"
 #include "util/exceptions.h"
 
 #include <gtest/gtest.h>
 #include <string>
 #include <sstream>
+#include <fstream>
+#include <cmath>
+#include <unistd.h>
 
 static void toCSV(std::stringstream& ss, const std::vector<std::vector<std::string>>& result, const std::string& delim, const std::string& endl) {
 	for(auto fields : result ){
@@ -188,3 +192,94 @@ TEST(CSVParser, tooManyFieldsFields) {
 	EXPECT_THROW(checkParseResult(parser, input), CSVParser::parse_error);
 }
 
+
+
+/*
+ * MappedCSVParser must return the same tuples as CSVParser, regardless of where the file is split into chunks
+ */
+static std::vector<std::vector<std::string>> parseMapped(const std::string &content, char delim, size_t chunk_size) {
+	std::string filename = concat("/tmp/gtest_mapped_csvparser.", getpid(), ".csv");
+	{
+		std::ofstream out(filename, std::ios::binary);
+		out << content;
+	}
+	std::vector<std::vector<std::string>> result;
+	try {
+		MappedCSVParser parser(filename, delim, chunk_size);
+		result.push_back(parser.getHeaders());
+		for (size_t chunk = 0; chunk < parser.getChunkCount(); chunk++) {
+			parser.parseChunk(chunk, [&](const std::vector<MappedCSVParser::Field> &fields) {
+				std::vector<std::string> tuple;
+				for (auto &field : fields)
+					tuple.push_back(field.toString());
+				result.push_back(tuple);
+			});
+		}
+	}
+	catch (...) {
+		unlink(filename.c_str());
+		throw;
+	}
+	unlink(filename.c_str());
+	return result;
+}
+
+static void checkMapped(const std::vector<std::vector<std::string>> &input, const std::string &delim, const std::string &endl) {
+	std::stringstream ss;
+	toCSV(ss, input, delim, endl);
+	// repeat the records, so that there is something to split
+	for (int i = 0; i < 5; i++)
+		toCSV(ss, std::vector<std::vector<std::string>>(input.begin() + 1, input.end()), delim, endl);
+	std::string content = ss.str();
+
+	std::stringstream in(content);
+	CSVParser parser(in, delim.at(0));
+	std::vector<std::vector<std::string>> expected;
+	while (true) {
+		auto tuple = parser.readTuple();
+		if (tuple.empty())
+			break;
+		expected.push_back(tuple);
+	}
+
+	for (size_t chunk_size : {1, 7, 64, 1 << 20})
+		EXPECT_EQ(expected, parseMapped(content, delim.at(0), chunk_size)) << "chunk size " << chunk_size;
+}
+
+TEST(MappedCSVParser, sameAsCSVParser) {
+	checkMapped(simple.input, ",", "\n");
+	checkMapped(simple.input, ";", "\r\n");
+	checkMapped(quotes.input, ",", "\n");
+	checkMapped(lineBreaksInQuotes("\n").input, ",", "\n");
+	checkMapped(lineBreaksInQuotes("\r\n").input, ",", "\r\n");
+	checkMapped(delimInQuotes(",").input, ",", "\n");
+	checkMapped(delimInQuotes(";").input, ";", "\n");
+}
+
+TEST(MappedCSVParser, errors) {
+	std::stringstream ss;
+	toCSV(ss, missingFields, ",", "\n");
+	EXPECT_THROW(parseMapped(ss.str(), ',', 1 << 20), MappedCSVParser::parse_error);
+	EXPECT_THROW(parseMapped("a,b\n\"c,d\n", ',', 1 << 20), MappedCSVParser::parse_error);
+	EXPECT_THROW(parseMapped("a,b\nc\"d,e\n", ',', 1 << 20), MappedCSVParser::parse_error);
+	EXPECT_THROW(parseMapped("a,b\n\"c\"d,e\n", ',', 1 << 20), MappedCSVParser::parse_error);
+}
+
+TEST(MappedCSVParser, toDouble) {
+	auto toDouble = [](const std::string &value) {
+		return MappedCSVParser::Field(value.data(), value.size(), false).toDouble();
+	};
+	for (std::string value : {"0", "-0", "1", "-17", "3.25", ".5", "5.", "+2", "1e3", "1.5E-7", "123456789.123456789",
+			"0.1", "9007199254740993", "1e300", "1e-300", " 42", "12abc", "inf", "nan", "0x1A"}) {
+		double expected = std::stod(value), actual = toDouble(value);
+		if (std::isnan(expected))
+			EXPECT_TRUE(std::isnan(actual)) << value;
+		else {
+			EXPECT_EQ(expected, actual) << value;
+			EXPECT_EQ(std::signbit(expected), std::signbit(actual)) << value;
+		}
+	}
+	EXPECT_THROW(toDouble(""), std::invalid_argument);
+	EXPECT_THROW(toDouble("abc"), std::invalid_argument);
+	EXPECT_THROW(toDouble("1e999"), std::out_of_range);
+}
@@ -338,6 +338,7 @@ TEST(Serialization, QueryStats) {
 	qs.multi_remote_partials = 5;
 	qs.single_local_hits = 6;
 	qs.single_remote_hits = 7;
+	qs.coalesced = 8;
 	checkSerializationConstructor(qs);
 }
 
@@ -1,6 +1,10 @@
 #include <gtest/gtest.h>
 
 #include "pointvisualization/CircleClusteringQuadTree.h"
+#include "pointvisualization/FlatCircleClustering.h"
+#include "pointvisualization/Grid.h"
+
+#include <random>
 
 TEST(CircleClusteringQuadTree, numeric_aggregate) {
     pv::Circle::CommonAttributes commonAttributes{5, 1};
@@ -93,4 +97,63 @@ TEST(CircleClusteringQuadTree, text_aggregate_large) {
     std::vector<std::string> textsExpected = {"test1", "test2", "test3", "test4", "test5"};
 
     EXPECT_EQ(textsExpected, texts);
-}
\ No newline at end of file
+}
+
+TEST(FlatCircleClustering, sameAsGridAndQuadTree) {
+    std::mt19937 generator(4711);
+    std::uniform_real_distribution<double> coordinate(0, 1000);
+    std::normal_distribution<double> cluster(0, 20);
+    std::uniform_real_distribution<double> number(-100, 100);
+    std::uniform_int_distribution<int> text(0, 20);
+
+    pv::BoundingBox boundingBox{pv::Coordinate{500, 500}, pv::Dimension{500, 500}, 1};
+    pv::Circle::CommonAttributes commonAttributes{5, 1};
+
+    pv::Grid grid{boundingBox, 0, 0, commonAttributes};
+    pv::CircleClusteringQuadTree tree{boundingBox, 1};
+    pv::FlatCircleClustering clustering{boundingBox, 0, 0, 5, 1, 1, 2};
+
+    for (int i = 0; i < 5000; ++i) {
+        double x = coordinate(generator);
+        double y = coordinate(generator);
+        // add some dense areas
+        if (i % 2 == 0) {
+            x = std::min(999.0, std::max(0.0, 300 + cluster(generator)));
+            y = std::min(999.0, std::max(0.0, 700 + cluster(generator)));
+        }
+        double value = number(generator);
+        std::string text1 = "text" + std::to_string(text(generator));
+        std::string text2 = "text" + std::to_string(text(generator));
+
+        pv::Coordinate center{x, y};
+        grid.insert(std::make_shared<pv::Circle>(
+                center,
+                commonAttributes,
+                std::map<std::string, pv::Circle::TextAttribute>{
+                        {"a", pv::Circle::TextAttribute{text1, center, commonAttributes}},
+                        {"b", pv::Circle::TextAttribute{text2, center, commonAttributes}}
+                },
+                std::map<std::string, pv::Circle::NumericAttribute>{{"n", pv::Circle::NumericAttribute{value}}}
+        ));
+
+        uint32_t textKeys[] = {clustering.getTextKey(text1), clustering.getTextKey(text2)};
+        clustering.insert(x, y, &value, textKeys);
+    }
+    grid.insert_into(tree);
+    clustering.cluster();
+
+    auto circles = tree.getCircles();
+    ASSERT_EQ(circles.size(), clustering.getCircleCount());
+    ASSERT_LT(circles.size(), 5000);
+    for (size_t i = 0; i < circles.size(); ++i) {
+        const auto &circle = *circles[i];
+        EXPECT_EQ(circle.getX(), clustering.getX(i));
+        EXPECT_EQ(circle.getY(), clustering.getY(i));
+        EXPECT_EQ(circle.getRadius(), clustering.getRadius(i));
+        EXPECT_EQ(circle.getNumberOfPoints(), clustering.getNumberOfPoints(i));
+        EXPECT_EQ(circle.getNumericAttributes().at("n").getAverage(), clustering.getAverage(i, 0));
+        EXPECT_EQ(circle.getNumericAttributes().at("n").getVariance(), clustering.getVariance(i, 0));
+        EXPECT_EQ(circle.getTextAttributes().at("a").getTexts(), clustering.getTexts(i, 0));
+        EXPECT_EQ(circle.getTextAttributes().at("b").getTexts(), clustering.getTexts(i, 1));
+    }
+}
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include "processing/queryprocessor.h"
+#include "cache/manager.h"
+#include "util/configuration.h"
+
+#include <atomic>
+
+static const std::string points_graph = R"({
+	"type": "csv_source",
+	"params": {
+		"filename": "data:text/plain,X,Y,Name\n1,2,test\n3,4,test2",
+		"geometry": "xy",
+		"time": "none",
+		"columns": {"x": "X", "y": "Y", "textual": ["Name"]}
+	}
+})";
+
+static Query pointsQuery(Query::Priority priority = Query::Priority::INTERACTIVE) {
+	return Query(points_graph, Query::ResultType::POINTS, QueryRectangle(
+			SpatialReference(CrsId::from_epsg_code(4326)),
+			TemporalReference(TIMETYPE_UNIX, 0),
+			QueryResolution::none()
+	), priority);
+}
+
+static std::unique_ptr<QueryProcessor> createAsyncProcessor() {
+	static NopCacheManager cache_manager;
+	CacheManager::init(&cache_manager);
+	Configuration::loadFromString("[processing.async]\nworkers=2\nbulk_workers=1");
+	return QueryProcessor::create("async", Configuration::getSubTable("processing.async"));
+}
+
+TEST(AsyncQueryProcessor, process) {
+	auto processor = createAsyncProcessor();
+
+	auto result = processor->process(pointsQuery(), nullptr, false);
+	ASSERT_FALSE(result->isError());
+	EXPECT_EQ(2u, result->getPointCollection()->getFeatureCount());
+}
+
+TEST(AsyncQueryProcessor, processAsync) {
+	auto processor = createAsyncProcessor();
+
+	std::vector<std::unique_ptr<QueryProcessor::QueryProgress>> progresses;
+	for (int i = 0; i < 10; i++)
+		progresses.push_back(processor->processAsync(pointsQuery(i % 2 == 0 ? Query::Priority::BULK : Query::Priority::INTERACTIVE), nullptr, false));
+
+	for (auto &progress : progresses) {
+		progress->wait();
+		EXPECT_TRUE(progress->isFinished());
+		auto result = progress->getResult();
+		ASSERT_FALSE(result->isError());
+		EXPECT_EQ(2u, result->getPointCollection()->getFeatureCount());
+	}
+	EXPECT_NE(progresses[0]->getID(), progresses[1]->getID());
+}
+
+TEST(AsyncQueryProcessor, errors) {
+	auto processor = createAsyncProcessor();
+
+	auto query = pointsQuery();
+	query.operatorgraph = "{";
+	auto result = processor->processAsync(query, nullptr, false)->getResult();
+	EXPECT_TRUE(result->isError());
+}
+
+TEST(QueryTools, cancelled) {
+	auto op = GenericOperator::fromJSON(points_graph);
+	auto query = pointsQuery();
+
+	auto cancelled = std::make_shared<std::atomic<bool>>(true);
+	QueryProfiler profiler;
+	QueryTools tools(profiler, nullptr, cancelled);
+	EXPECT_THROW(op->getCachedPointCollection(query.rectangle, tools), QueryCancelledException);
+
+	// sub-queries inherit the flag
+	QueryProfiler sub_profiler;
+	EXPECT_THROW(QueryTools(sub_profiler, tools).checkCancelled(), QueryCancelledException);
+
+	*cancelled = false;
+	EXPECT_NO_THROW(tools.checkCancelled());
+}
@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+#include "operators/queryprofiler.h"
+#include "util/threadpool.h"
+#include "util/exceptions.h"
+
+#include <vector>
+#include <cmath>
+
+static double burnCPU() {
+	volatile double sum = 0;
+	for (int i = 0; i < 5000000; i++)
+		sum += std::sqrt((double) i);
+	return sum;
+}
+
+TEST(QueryProfiler, mergeAcrossThreads) {
+	QueryProfiler parent;
+	std::vector<QueryProfiler> profilers(4);
+	ThreadPool pool(4);
+	pool.parallelFor(profilers.size(), [&](size_t i) {
+		QueryProfilerSimpleGuard guard(profilers[i]);
+		burnCPU();
+		profilers[i].addIOCost(100);
+	});
+
+	double cpu = 0;
+	for (auto &profiler : profilers) {
+		EXPECT_GT(profiler.self_cpu, 0);
+		cpu += profiler.self_cpu;
+		parent.merge(profiler);
+	}
+	EXPECT_DOUBLE_EQ(cpu, parent.self_cpu);
+	EXPECT_DOUBLE_EQ(cpu, parent.all_cpu);
+	EXPECT_DOUBLE_EQ(cpu, parent.uncached_cpu);
+	EXPECT_EQ(400u, parent.self_io);
+	EXPECT_EQ(400u, parent.all_io);
+}
+
+TEST(QueryProfiler, mergeRunningTimer) {
+	QueryProfiler parent, child;
+	child.startTimer();
+	EXPECT_THROW(parent.merge(child), OperatorException);
+	child.stopTimer();
+	parent.merge(child);
+}
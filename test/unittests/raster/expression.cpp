@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include "datatypes/raster/raster_priv.h"
+#include "raster/expression.h"
+
+template<typename T>
+static std::unique_ptr<GenericRaster> createRaster(GDALDataType type, bool has_no_data, double no_data, const std::vector<T> &values) {
+	DataDescription dd(type, Unit::unknown(), has_no_data, no_data);
+	SpatioTemporalReference stref(SpatialReference::unreferenced(), TemporalReference::unreferenced());
+	auto raster = GenericRaster::create(dd, stref, values.size(), 1, 0, GenericRaster::Representation::CPU);
+	auto r = (Raster2D<T> *) raster.get();
+	for (size_t x = 0; x < values.size(); x++)
+		r->set(x, 0, values[x]);
+	return raster;
+}
+
+TEST(RasterExpression, noData) {
+	auto a = createRaster<float>(GDT_Float32, true, -1, {1, -1, 3, NAN, 5});
+	auto b = createRaster<int16_t>(GDT_Int16, true, 0, {2, 2, 0, 2, 2});
+	DataDescription out_dd(GDT_Float32, Unit::unknown(), true, -9999);
+
+	auto result = RasterExpression::evaluateCPU("A * B + 0.5", {a.get(), b.get()}, out_dd, a->stref);
+	auto r = (Raster2D<float> *) result.get();
+	EXPECT_FLOAT_EQ(2.5, r->get(0, 0));
+	EXPECT_FLOAT_EQ(-9999, r->get(1, 0));
+	EXPECT_FLOAT_EQ(-9999, r->get(2, 0));
+	EXPECT_FLOAT_EQ(-9999, r->get(3, 0));
+	EXPECT_FLOAT_EQ(10.5, r->get(4, 0));
+}
+
+TEST(RasterExpression, integers) {
+	auto a = createRaster<uint8_t>(GDT_Byte, false, 0, {7, 200, 255});
+	auto b = createRaster<uint8_t>(GDT_Byte, false, 0, {2, 100, 0});
+	DataDescription out_dd(GDT_Int32, Unit::unknown());
+
+	// integer division truncates, the result of a division by zero is no-data
+	auto result = RasterExpression::evaluateCPU("A / B", {a.get(), b.get()}, out_dd, a->stref);
+	auto r = (Raster2D<int32_t> *) result.get();
+	EXPECT_EQ(3, r->get(0, 0));
+	EXPECT_EQ(2, r->get(1, 0));
+	EXPECT_EQ(0, r->get(2, 0));
+
+	// packing colors wraps around like in C
+	DataDescription rgba_dd(GDT_UInt32, Unit::unknown());
+	auto rgba = RasterExpression::evaluateCPU("A | (B << 8) | (255 << 24)", {a.get(), b.get()}, rgba_dd, a->stref);
+	EXPECT_EQ(0xff0064c8u, ((Raster2D<uint32_t> *) rgba.get())->get(1, 0));
+
+	// floating point results saturate
+	DataDescription byte_dd(GDT_Byte, Unit::unknown());
+	auto saturated = RasterExpression::evaluateCPU("A * 2.0", {a.get()}, byte_dd, a->stref);
+	EXPECT_EQ(14, ((Raster2D<uint8_t> *) saturated.get())->get(0, 0));
+	EXPECT_EQ(255, ((Raster2D<uint8_t> *) saturated.get())->get(1, 0));
+}
+
+TEST(RasterExpression, large) {
+	// more pixels than a single chunk, processed in parallel
+	size_t count = 100000;
+	std::vector<int32_t> values(count);
+	for (size_t i = 0; i < count; i++)
+		values[i] = i;
+	auto a = createRaster<int32_t>(GDT_Int32, false, 0, values);
+	DataDescription out_dd(GDT_Float64, Unit::unknown());
+
+	auto result = RasterExpression::evaluateCPU("sqrt(A) + A / 3", {a.get()}, out_dd, a->stref);
+	auto r = (Raster2D<double> *) result.get();
+	for (size_t i = 0; i < count; i += 997)
+		EXPECT_DOUBLE_EQ(std::sqrt((double) i) + (double) (i / 3), r->get(i, 0));
+}
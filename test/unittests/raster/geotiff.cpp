@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+#include "datatypes/raster/raster_priv.h"
+#include "datatypes/raster/tiled_raster.h"
+#include "util/gdal.h"
+
+#include <gdal_priv.h>
+#include <ogr_spatialref.h>
+#include <sstream>
+#include <cstring>
+
+static std::unique_ptr<GenericRaster> createRaster(uint32_t width, uint32_t height) {
+	DataDescription dd(GDT_Float32, Unit::unknown(), true, -1);
+	SpatioTemporalReference stref(
+		SpatialReference(CrsId::from_epsg_code(3857), 1000, 2000, 1000 + width * 30, 2000 + height * 20),
+		TemporalReference(TIMETYPE_UNIX, 0, 1)
+	);
+	auto raster = GenericRaster::create(dd, stref, width, height, 0, GenericRaster::Representation::CPU);
+	auto r = (Raster2D<float> *) raster.get();
+	for (uint32_t y = 0; y < height; y++)
+		for (uint32_t x = 0; x < width; x++)
+			r->set(x, y, y * 0.5f + x);
+	return raster;
+}
+
+// Reads the file with GDAL and compares it to the file toGDAL() writes
+static void expectSameAsGDAL(GenericRaster &raster, const std::string &geotiff) {
+	GDAL::init();
+	std::string streamed = "/vsimem/geotiff_streamed.tif", reference = "/vsimem/geotiff_reference.tif";
+	VSIFCloseL(VSIFileFromMemBuffer(streamed.c_str(), (GByte *) geotiff.data(), geotiff.size(), false));
+	raster.toGDAL(reference.c_str(), "GTiff");
+
+	auto a = (GDALDataset *) GDALOpen(streamed.c_str(), GA_ReadOnly);
+	auto b = (GDALDataset *) GDALOpen(reference.c_str(), GA_ReadOnly);
+	ASSERT_NE(nullptr, a);
+	ASSERT_NE(nullptr, b);
+	EXPECT_EQ(b->GetRasterXSize(), a->GetRasterXSize());
+	EXPECT_EQ(b->GetRasterYSize(), a->GetRasterYSize());
+
+	double ta[6], tb[6];
+	a->GetGeoTransform(ta);
+	b->GetGeoTransform(tb);
+	for (int i = 0; i < 6; i++)
+		EXPECT_DOUBLE_EQ(tb[i], ta[i]);
+
+	OGRSpatialReference sa(a->GetProjectionRef()), sb(b->GetProjectionRef());
+	EXPECT_TRUE(sa.IsSame(&sb));
+
+	auto band_a = a->GetRasterBand(1), band_b = b->GetRasterBand(1);
+	EXPECT_EQ(band_b->GetRasterDataType(), band_a->GetRasterDataType());
+	int has_no_data;
+	EXPECT_EQ(band_b->GetNoDataValue(), band_a->GetNoDataValue(&has_no_data));
+	EXPECT_TRUE(has_no_data);
+
+	size_t size = raster.getDataSize();
+	std::vector<char> pixels_a(size), pixels_b(size);
+	band_a->RasterIO(GF_Read, 0, 0, raster.width, raster.height, pixels_a.data(), raster.width, raster.height, raster.dd.datatype, 0, 0);
+	band_b->RasterIO(GF_Read, 0, 0, raster.width, raster.height, pixels_b.data(), raster.width, raster.height, raster.dd.datatype, 0, 0);
+	EXPECT_EQ(0, memcmp(pixels_a.data(), pixels_b.data(), size));
+
+	GDALClose(a);
+	GDALClose(b);
+	VSIUnlink(streamed.c_str());
+	VSIUnlink(reference.c_str());
+}
+
+TEST(GeoTIFF, sameAsGDAL) {
+	auto raster = createRaster(300, 170);
+	std::ostringstream geotiff;
+	raster->toGeoTIFF(geotiff);
+	expectSameAsGDAL(*raster, geotiff.str());
+}
+
+TEST(GeoTIFF, tiled) {
+	auto raster = createRaster(300, 170);
+	std::ostringstream expected;
+	raster->toGeoTIFF(expected);
+
+	auto tiled = TiledRaster2D<float>::fromRaster(std::move(raster), 64);
+	std::ostringstream geotiff;
+	tiled->toGeoTIFF(geotiff);
+	EXPECT_EQ(expected.str(), geotiff.str());
+}
+
+TEST(GeoTIFF, unsupportedCrsIsRejectedBeforeWriting) {
+	DataDescription dd(GDT_Float32, Unit::unknown(), true, -1);
+	SpatioTemporalReference stref(
+		SpatialReference(CrsId::from_epsg_code(100000), 0, 0, 10, 10),
+		TemporalReference(TIMETYPE_UNIX, 0, 1)
+	);
+	auto raster = GenericRaster::create(dd, stref, 10, 10, 0, GenericRaster::Representation::CPU);
+	EXPECT_THROW(createGeoTIFFHeader(*raster, raster->dd), ExporterException);
+
+	std::ostringstream geotiff;
+	EXPECT_THROW(raster->toGeoTIFF(geotiff), ExporterException);
+	EXPECT_TRUE(geotiff.str().empty());
+
+	auto valid = createRaster(30, 20);
+	std::ostringstream expected;
+	valid->toGeoTIFF(expected);
+	auto header = createGeoTIFFHeader(*valid, valid->dd);
+	EXPECT_EQ(expected.str().substr(0, header.size()), header);
+
+	std::ostringstream reused;
+	valid->toGeoTIFF(reused, false, false, &header);
+	EXPECT_EQ(expected.str(), reused.str());
+}
@@ -0,0 +1,209 @@
+#include <gtest/gtest.h>
+#include "datatypes/raster/raster_priv.h"
+#include "datatypes/raster/raster_kernels.h"
+#include "operators/queryrectangle.h"
+#include "util/concat.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+#include <functional>
+
+using RasterKernels::InstructionSet;
+
+/*
+ * Runs the given check once for every instruction set supported by this CPU
+ */
+static void forAllInstructionSets(const std::function<void()> &check) {
+	auto previous = RasterKernels::getInstructionSet();
+	for (auto set : {InstructionSet::SCALAR, InstructionSet::SSSE3, InstructionSet::AVX2}) {
+		if (!RasterKernels::isSupported(set))
+			continue;
+		SCOPED_TRACE(concat("instruction set ", (int) set));
+		RasterKernels::setInstructionSet(set);
+		check();
+	}
+	RasterKernels::setInstructionSet(previous);
+}
+
+template<typename T>
+static void checkKernels() {
+	std::mt19937 gen(42);
+	// lengths around the vector widths to cover the scalar tails
+	for (size_t n : {0, 1, 3, 7, 15, 16, 17, 31, 32, 33, 63, 64, 65, 1000}) {
+		std::vector<T> src(n);
+		for (auto &v : src)
+			v = (T) (gen() % 1000);
+		std::vector<uint32_t> indices(n);
+		for (auto &i : indices)
+			i = gen() % n;
+
+		std::vector<T> dst(n + 1, (T) 7);
+		RasterKernels::fill(dst.data(), n, (T) 3);
+		for (size_t i = 0; i < n; i++)
+			ASSERT_EQ(dst[i], (T) 3);
+		ASSERT_EQ(dst[n], (T) 7);
+
+		RasterKernels::reverse(dst.data(), src.data(), n);
+		for (size_t i = 0; i < n; i++)
+			ASSERT_EQ(dst[i], src[n-1-i]);
+
+		RasterKernels::gather(dst.data(), src.data(), indices.data(), n);
+		for (size_t i = 0; i < n; i++)
+			ASSERT_EQ(dst[i], src[indices[i]]);
+		ASSERT_EQ(dst[n], (T) 7);
+	}
+}
+
+TEST(RasterKernels, kernels) {
+	forAllInstructionSets([]() {
+		checkKernels<uint8_t>();
+		checkKernels<uint16_t>();
+		checkKernels<int16_t>();
+		checkKernels<uint32_t>();
+		checkKernels<int32_t>();
+		checkKernels<float>();
+		checkKernels<double>();
+	});
+}
+
+
+TEST(RasterKernels, accumulators) {
+	const double nan = std::numeric_limits<double>::quiet_NaN();
+	std::mt19937 gen(42);
+	for (size_t n : {0, 1, 3, 4, 5, 7, 8, 9, 1000}) {
+		std::vector<std::vector<double>> series(10, std::vector<double>(n));
+		for (auto &values : series)
+			for (auto &v : values)
+				v = gen() % 4 == 0 ? nan : (double) (gen() % 1000) / 8;
+
+		// every instruction set yields the same accumulators as the scalar implementation
+		std::vector<std::vector<double>> expected;
+		forAllInstructionSets([&]() {
+			std::vector<double> sums(n, 0), mins(n, INFINITY), maxs(n, -INFINITY), means(n, 0), m2s(n, 0);
+			std::vector<std::vector<double>> counts(4, std::vector<double>(n, 0));
+			for (auto &values : series) {
+				RasterKernels::accumulateSum(sums.data(), counts[0].data(), values.data(), n);
+				RasterKernels::accumulateMin(mins.data(), counts[1].data(), values.data(), n);
+				RasterKernels::accumulateMax(maxs.data(), counts[2].data(), values.data(), n);
+				RasterKernels::accumulateMoments(means.data(), m2s.data(), counts[3].data(), values.data(), n);
+			}
+			std::vector<std::vector<double>> results{sums, mins, maxs, means, m2s, counts[0], counts[1], counts[2], counts[3]};
+			if (expected.empty()) {
+				expected = results;
+				for (size_t i = 0; i < n; i++) {
+					double count = 0, sum = 0, min = INFINITY, max = -INFINITY;
+					for (auto &values : series) {
+						if (std::isnan(values[i]))
+							continue;
+						count++;
+						sum += values[i];
+						min = std::min(min, values[i]);
+						max = std::max(max, values[i]);
+					}
+					double m2 = 0;
+					for (auto &values : series)
+						if (!std::isnan(values[i]))
+							m2 += (values[i] - sum / count) * (values[i] - sum / count);
+					for (size_t c = 0; c < 4; c++)
+						ASSERT_EQ(count, counts[c][i]);
+					ASSERT_EQ(sum, sums[i]);
+					ASSERT_EQ(min, mins[i]);
+					ASSERT_EQ(max, maxs[i]);
+					if (count > 0) {
+						ASSERT_NEAR(sum / count, means[i], 1e-9);
+						ASSERT_NEAR(m2, m2s[i], 1e-6);
+					}
+				}
+			}
+			else {
+				for (size_t r = 0; r < results.size(); r++)
+					for (size_t i = 0; i < n; i++)
+						ASSERT_EQ(0, std::memcmp(&expected[r][i], &results[r][i], sizeof(double)));
+			}
+		});
+	}
+}
+
+template<typename T>
+static std::unique_ptr<GenericRaster> createRaster(GDALDataType type, uint32_t width, uint32_t height) {
+	DataDescription dd(type, Unit::unknown());
+	SpatioTemporalReference stref(
+		SpatialReference(CrsId::from_epsg_code(4326), 0, 0, width, height),
+		TemporalReference(TIMETYPE_UNIX, 0, 1)
+	);
+	auto raster = GenericRaster::create(dd, stref, width, height, 0, GenericRaster::Representation::CPU);
+	auto r = (Raster2D<T> *) raster.get();
+	for (uint32_t y = 0; y < height; y++)
+		for (uint32_t x = 0; x < width; x++)
+			r->set(x, y, (T) ((x * 7 + y * 13) % 100 + 1));
+	return raster;
+}
+
+template<typename T>
+static void checkRasterOperations(GDALDataType type) {
+	const int width = 77, height = 35;
+	auto raster = createRaster<T>(type, width, height);
+	auto in = (Raster2D<T> *) raster.get();
+
+	// flip
+	for (bool flipx : {false, true})
+		for (bool flipy : {false, true}) {
+			auto flipped = raster->flip(flipx, flipy);
+			auto out = (Raster2D<T> *) flipped.get();
+			for (int y = 0; y < height; y++)
+				for (int x = 0; x < width; x++)
+					ASSERT_EQ(out->get(x, y), in->get(flipx ? width-x-1 : x, flipy ? height-y-1 : y));
+		}
+
+	// scale, both up and down
+	for (auto size : {std::make_pair(13, 9), std::make_pair(200, 101), std::make_pair(width, height)}) {
+		auto scaled = raster->scale(size.first, size.second);
+		auto out = (Raster2D<T> *) scaled.get();
+		for (int y = 0; y < size.second; y++)
+			for (int x = 0; x < size.first; x++) {
+				int px = (int) round(((x+0.5) * width / size.first) - 0.5);
+				int py = (int) round(((y+0.5) * height / size.second) - 0.5);
+				ASSERT_EQ(out->get(x, y), in->get(px, py));
+			}
+	}
+
+	// cut
+	auto cutout = raster->cut(5, 3, 40, 20);
+	auto cut = (Raster2D<T> *) cutout.get();
+	for (int y = 0; y < 20; y++)
+		for (int x = 0; x < 40; x++)
+			ASSERT_EQ(cut->get(x, y), in->get(x + 5, y + 3));
+
+	// fitToQueryRectangle, partially outside of the raster
+	QueryRectangle qrect(
+		SpatialReference(CrsId::from_epsg_code(4326), -10, 5, width - 10, height + 5),
+		TemporalReference(TIMETYPE_UNIX, 0, 1),
+		QueryResolution::pixels(width, height)
+	);
+	auto fitted = raster->fitToQueryRectangle(qrect);
+	auto fit = (Raster2D<T> *) fitted.get();
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			ASSERT_EQ(fit->get(x, y), in->getSafe(x - 10, y + 5));
+
+	// clear
+	raster->clear(42);
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			ASSERT_EQ(in->get(x, y), (T) 42);
+}
+
+TEST(RasterKernels, raster2d) {
+	forAllInstructionSets([]() {
+		checkRasterOperations<uint8_t>(GDT_Byte);
+		checkRasterOperations<uint16_t>(GDT_UInt16);
+		checkRasterOperations<int16_t>(GDT_Int16);
+		checkRasterOperations<uint32_t>(GDT_UInt32);
+		checkRasterOperations<int32_t>(GDT_Int32);
+		checkRasterOperations<float>(GDT_Float32);
+		checkRasterOperations<double>(GDT_Float64);
+	});
+}
@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+#include "datatypes/raster/raster_priv.h"
+#include "raster/temporal_aggregation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+template<typename T>
+static std::unique_ptr<GenericRaster> createRaster(GDALDataType type, bool has_no_data, double no_data, const std::vector<T> &values) {
+	DataDescription dd(type, Unit::unknown(), has_no_data, no_data);
+	SpatioTemporalReference stref(SpatialReference::unreferenced(), TemporalReference::unreferenced());
+	auto raster = GenericRaster::create(dd, stref, values.size(), 1, 0, GenericRaster::Representation::CPU);
+	auto r = (Raster2D<T> *) raster.get();
+	for (size_t x = 0; x < values.size(); x++)
+		r->set(x, 0, values[x]);
+	return raster;
+}
+
+template<typename T>
+static std::vector<T> aggregate(TemporalAggregator::Type type, const std::vector<std::vector<int16_t>> &series,
+		TemporalAggregator::NoData no_data = TemporalAggregator::NoData::FIRST_AS_VALUE, double quantile = 0.5) {
+	TemporalAggregator aggregator(type, quantile, no_data);
+	for (auto &values : series) {
+		auto raster = createRaster<int16_t>(GDT_Int16, true, -1, values);
+		aggregator.add(*raster);
+	}
+	EXPECT_EQ(series.size(), aggregator.getRasterCount());
+
+	auto result = aggregator.getResult(SpatioTemporalReference::unreferenced());
+	auto r = (Raster2D<T> *) result.get();
+	std::vector<T> values;
+	for (uint32_t x = 0; x < result->width; x++)
+		values.push_back(r->get(x, 0));
+	return values;
+}
+
+TEST(TemporalAggregator, aggregations) {
+	using Type = TemporalAggregator::Type;
+	const auto propagate = TemporalAggregator::NoData::PROPAGATE;
+	// -1 is no-data
+	std::vector<std::vector<int16_t>> series {
+		{1, 10, -1, 7},
+		{3, 20, 5, 7},
+		{2, 60, -1, 7}
+	};
+
+	EXPECT_EQ(std::vector<int16_t>({1, 10, -1, 7}), aggregate<int16_t>(Type::MIN, series, propagate));
+	EXPECT_EQ(std::vector<int16_t>({3, 60, -1, 7}), aggregate<int16_t>(Type::MAX, series, propagate));
+	EXPECT_EQ(std::vector<int16_t>({2, 30, -1, 7}), aggregate<int16_t>(Type::AVG, series, propagate));
+	EXPECT_EQ(std::vector<int16_t>({2, 20, -1, 7}), aggregate<int16_t>(Type::MEDIAN, series, propagate));
+	EXPECT_EQ(std::vector<int16_t>({3, 60, -1, 7}), aggregate<int16_t>(Type::PERCENTILE, series, propagate, 1));
+	EXPECT_EQ(std::vector<uint32_t>({3, 3, 1, 3}), aggregate<uint32_t>(Type::COUNT, series, propagate));
+
+	auto sums = aggregate<float>(Type::SUM, series, propagate);
+	EXPECT_EQ(6, sums[0]);
+	EXPECT_EQ(90, sums[1]);
+	EXPECT_TRUE(std::isnan(sums[2]));
+
+	auto stddevs = aggregate<float>(Type::STDDEV, series, propagate);
+	EXPECT_NEAR(std::sqrt(2.0 / 3), stddevs[0], 1e-6);
+	EXPECT_NEAR(std::sqrt(1400.0 / 3), stddevs[1], 1e-3);
+	EXPECT_TRUE(std::isnan(stddevs[2]));
+	EXPECT_EQ(0, stddevs[3]);
+}
+
+TEST(TemporalAggregator, firstNoDataIsAggregatedByDefault) {
+	using Type = TemporalAggregator::Type;
+	std::vector<std::vector<int16_t>> series {
+		{-1, 4, 3},
+		{5, 6, -1}
+	};
+
+	EXPECT_EQ(std::vector<int16_t>({2, 5, -1}), aggregate<int16_t>(Type::AVG, series));
+	EXPECT_EQ(std::vector<int16_t>({-1, 4, -1}), aggregate<int16_t>(Type::MIN, series));
+	EXPECT_EQ(std::vector<uint32_t>({1, 2, 1}), aggregate<uint32_t>(Type::COUNT, series));
+	EXPECT_EQ(std::vector<int16_t>({-1, 5, -1}), aggregate<int16_t>(Type::AVG, series, TemporalAggregator::NoData::PROPAGATE));
+}
+
+TEST(TemporalAggregator, ignoreNoData) {
+	using Type = TemporalAggregator::Type;
+	const auto ignore = TemporalAggregator::NoData::IGNORE;
+	std::vector<std::vector<int16_t>> series {
+		{-1, 4},
+		{5, -1},
+		{-1, -1}
+	};
+
+	EXPECT_EQ(std::vector<int16_t>({5, 4}), aggregate<int16_t>(Type::MIN, series, ignore));
+	EXPECT_EQ(std::vector<int16_t>({5, 4}), aggregate<int16_t>(Type::AVG, series, ignore));
+	EXPECT_EQ(std::vector<uint32_t>({1, 1}), aggregate<uint32_t>(Type::COUNT, series, ignore));
+	EXPECT_EQ(std::vector<int16_t>({-1, -1}), aggregate<int16_t>(Type::MAX, {{-1, -1}}, ignore));
+}
+
+TEST(TemporalAggregator, percentilesAreEstimated) {
+	using Type = TemporalAggregator::Type;
+	const size_t days = 365, pixels = 8;
+	std::mt19937 gen(7);
+	std::normal_distribution<double> distribution(1000, 100);
+	std::vector<std::vector<int16_t>> series(days, std::vector<int16_t>(pixels));
+	for (auto &values : series)
+		for (auto &v : values)
+			v = (int16_t) distribution(gen);
+
+	for (double quantile : {0.1, 0.5, 0.9}) {
+		auto estimates = aggregate<int16_t>(quantile == 0.5 ? Type::MEDIAN : Type::PERCENTILE, series, TemporalAggregator::NoData::PROPAGATE, quantile);
+		for (size_t i = 0; i < pixels; i++) {
+			std::vector<int16_t> values;
+			for (auto &day : series)
+				values.push_back(day[i]);
+			std::sort(values.begin(), values.end());
+			int16_t exact = values[(size_t) std::round(quantile * (days - 1))];
+			// within a fifth of the standard deviation
+			EXPECT_NEAR(exact, estimates[i], 20);
+		}
+	}
+}
+
+TEST(TemporalAggregator, dimensionsMustMatch) {
+	TemporalAggregator aggregator(TemporalAggregator::Type::SUM);
+	auto a = createRaster<int16_t>(GDT_Int16, true, -1, {1, 2, 3});
+	auto b = createRaster<int16_t>(GDT_Int16, true, -1, {1, 2});
+	aggregator.add(*a);
+	EXPECT_THROW(aggregator.add(*b), ArgumentException);
+}
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include "datatypes/raster/raster_priv.h"
+#include "datatypes/raster/tiled_raster.h"
+#include "operators/queryrectangle.h"
+
+#include <atomic>
+#include <cstring>
+
+static std::unique_ptr<GenericRaster> createRaster(uint32_t width, uint32_t height) {
+	DataDescription dd(GDT_Int32, Unit::unknown());
+	SpatioTemporalReference stref(
+		SpatialReference(CrsId::from_epsg_code(4326), 0, 0, width, height),
+		TemporalReference(TIMETYPE_UNIX, 0, 1)
+	);
+	auto raster = GenericRaster::create(dd, stref, width, height, 0, GenericRaster::Representation::CPU);
+	auto r = (Raster2D<int32_t> *) raster.get();
+	for (uint32_t y = 0; y < height; y++)
+		for (uint32_t x = 0; x < width; x++)
+			r->set(x, y, y * width + x);
+	return raster;
+}
+
+static void expectEqual(GenericRaster &expected, GenericRaster &actual) {
+	ASSERT_EQ(expected.width, actual.width);
+	ASSERT_EQ(expected.height, actual.height);
+	EXPECT_DOUBLE_EQ(expected.stref.x1, actual.stref.x1);
+	EXPECT_DOUBLE_EQ(expected.stref.y2, actual.stref.y2);
+	EXPECT_EQ(0, memcmp(expected.getData(), actual.getData(), expected.getDataSize()));
+}
+
+TEST(TiledRaster, materialize) {
+	auto raster = createRaster(300, 170);
+	auto copy = raster->clone();
+	auto tiled = TiledRaster2D<int32_t>::fromRaster(std::move(raster), 64);
+	EXPECT_EQ(5u, tiled->getTilesX());
+	EXPECT_EQ(3u, tiled->getTilesY());
+	EXPECT_EQ(44u, tiled->getTileWidth(4));
+	auto result = tiled->materialize();
+	expectEqual(*copy, *result);
+}
+
+TEST(TiledRaster, lazy) {
+	std::atomic<int> produced(0);
+	SpatioTemporalReference stref(SpatialReference::unreferenced(), TemporalReference::unreferenced());
+	auto tiled = std::make_shared<TiledRaster2D<uint8_t>>(DataDescription(GDT_Byte, Unit::unknown()), stref, 100, 100,
+		[&](uint32_t x, uint32_t y, uint32_t width, uint32_t height, uint8_t *buffer) {
+			produced++;
+			memset(buffer, 7, (size_t) width * height);
+		}, 32);
+
+	EXPECT_EQ(0, produced);
+	EXPECT_EQ(7, tiled->getSafe(40, 99));
+	EXPECT_EQ(0, tiled->getSafe(100, 0));
+	EXPECT_EQ(1, produced);
+	tiled->getTile(1, 3);
+	EXPECT_EQ(1, produced);
+	tiled->releaseTile(1, 3);
+	tiled->getTile(1, 3);
+	EXPECT_EQ(2, produced);
+}
+
+TEST(TiledRaster, cut) {
+	auto raster = createRaster(300, 170);
+	auto expected = raster->cut(33, 70, 200, 90);
+	auto tiled = TiledRaster2D<int32_t>::fromRaster(std::move(raster), 64);
+	auto view = tiled->cut(33, 70, 200, 90);
+	auto result = view->materialize();
+	expectEqual(*expected, *result);
+}
+
+TEST(TiledRaster, fitToQueryRectangle) {
+	auto raster = createRaster(300, 170);
+	QueryRectangle qrect(
+		SpatialReference(CrsId::from_epsg_code(4326), -20.5, 10, 250, 190.25),
+		TemporalReference(TIMETYPE_UNIX, 0, 1),
+		QueryResolution::pixels(123, 77)
+	);
+	auto expected = raster->fitToQueryRectangle(qrect);
+	auto tiled = TiledRaster2D<int32_t>::fromRaster(std::move(raster), 64);
+	auto result = tiled->fitToQueryRectangle(qrect)->materialize();
+	expectEqual(*expected, *result);
+}
@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+#include "datatypes/raster.h"
+#include "rasterdb/converters/converter.h"
+#include "util/exceptions.h"
+
+#include <cstring>
+
+template<typename T>
+static std::unique_ptr<GenericRaster> createRaster(GDALDataType type) {
+	DataDescription dd(type, Unit::unknown());
+	SpatioTemporalReference stref(SpatialReference::unreferenced(), TemporalReference::unreferenced());
+	auto raster = GenericRaster::create(dd, stref, 123, 45, 0, GenericRaster::Representation::CPU);
+	T *data = (T *) raster->getDataForWriting();
+	// a smooth gradient with some wrap-arounds and negative values
+	for (uint32_t y = 0; y < raster->height; y++)
+		for (uint32_t x = 0; x < raster->width; x++)
+			data[y * raster->width + x] = (T) ((int) (x * 3) - (int) (y * 7) + (int) (x * y % 5));
+	return raster;
+}
+
+static void checkRoundtrip(GenericRaster &raster, const std::string &method) {
+	auto encoded = RasterConverter::direct_encode(&raster, method);
+	auto decoded = RasterConverter::direct_decode(*encoded, raster.dd, raster.stref, raster.width, raster.height, 0, method);
+	ASSERT_EQ(decoded->getDataSize(), raster.getDataSize()) << method;
+	EXPECT_EQ(memcmp(decoded->getData(), raster.getData(), raster.getDataSize()), 0) << method;
+}
+
+TEST(RasterConverters, roundtrip) {
+	std::vector<std::unique_ptr<GenericRaster>> rasters;
+	rasters.push_back(createRaster<uint8_t>(GDT_Byte));
+	rasters.push_back(createRaster<int16_t>(GDT_Int16));
+	rasters.push_back(createRaster<uint16_t>(GDT_UInt16));
+	rasters.push_back(createRaster<int32_t>(GDT_Int32));
+	rasters.push_back(createRaster<uint32_t>(GDT_UInt32));
+	rasters.push_back(createRaster<float>(GDT_Float32));
+	rasters.push_back(createRaster<double>(GDT_Float64));
+
+	for (auto &raster : rasters)
+		for (auto method : {"RAW", "GZIP", "BZIP", "LZ4", "LZ4:-5", "LZ4:9", "LZ4_DELTA", "ZSTD", "ZSTD:19", "ZSTD_DELTA:1"})
+			checkRoundtrip(*raster, method);
+}
+
+TEST(RasterConverters, levels) {
+	EXPECT_THROW(RasterConverter::getConverter("ZSTD:abc"), ConverterException);
+	EXPECT_THROW(RasterConverter::getConverter("ZSTD:1000"), ConverterException);
+	EXPECT_THROW(RasterConverter::getConverter("GZIP:5"), ConverterException);
+	EXPECT_THROW(RasterConverter::getConverter("FOO"), ConverterException);
+}
+
+TEST(RasterConverters, delta_improves_ratio) {
+	auto raster = createRaster<int16_t>(GDT_Int16);
+	auto plain = RasterConverter::direct_encode(raster.get(), "ZSTD");
+	auto delta = RasterConverter::direct_encode(raster.get(), "ZSTD_DELTA");
+	EXPECT_LT(delta->size, plain->size);
+}
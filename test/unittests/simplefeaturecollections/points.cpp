@@ -169,6 +169,30 @@ TEST(PointCollection, toCSV) {
 	EXPECT_EQ(expected, points.toCSV());
 }
 
+TEST(PointCollection, streaming) {
+	// enough features that the serializers flush several chunks to the stream
+	PointCollection points(SpatioTemporalReference::unreferenced());
+	auto &test = points.feature_attributes.addNumericAttribute("test", Unit::unknown());
+	for (size_t i = 0; i < 10000; i++) {
+		points.addCoordinate(i, i * 0.5);
+		if (i % 3 == 0)
+			points.addCoordinate(i, -1);
+		points.finishFeature();
+		test.set(i, i * 1.1);
+	}
+
+	std::ostringstream json, csv;
+	points.toGeoJSON(json, true);
+	points.toCSV(csv);
+	EXPECT_EQ(points.toGeoJSON(true), json.str());
+	EXPECT_EQ(points.toCSV(), csv.str());
+
+	Json::Reader reader(Json::Features::strictMode());
+	Json::Value root;
+	ASSERT_TRUE(reader.parse(json.str(), root));
+	EXPECT_EQ(10000u, root["features"].size());
+}
+
 TEST(PointCollection, toWKT) {
 	PointCollection points(SpatioTemporalReference::unreferenced());
 	auto &test = points.feature_attributes.addNumericAttribute("test", Unit::unknown());
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include "util/binary_cache.h"
+#include "util/concat.h"
+
+#include <boost/filesystem.hpp>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static std::string getDirectory() {
+	auto directory = concat("/tmp/gtest_binary_cache.", getpid());
+	boost::filesystem::remove_all(directory);
+	return directory;
+}
+
+TEST(BinaryCache, keyCoversAllParts) {
+	BinaryCache cache("/tmp/binary_cache");
+	std::vector<std::string> key {"platform", "device", "driver", "source"};
+	auto filename = cache.getFilename(key);
+	EXPECT_EQ(0, filename.find("/tmp/binary_cache/"));
+	EXPECT_EQ(filename, cache.getFilename(key));
+
+	for (size_t i = 0; i < key.size(); i++) {
+		auto changed = key;
+		changed[i] += "'";
+		EXPECT_NE(filename, cache.getFilename(changed));
+	}
+
+	// the parts are not simply concatenated
+	EXPECT_NE(cache.getFilename({"ab", "c"}), cache.getFilename({"a", "bc"}));
+	EXPECT_NE(cache.getFilename({"abc"}), cache.getFilename({"abc", ""}));
+}
+
+TEST(BinaryCache, disabled) {
+	BinaryCache cache("");
+	EXPECT_FALSE(cache.isTrusted());
+	EXPECT_EQ("", cache.getFilename({"source"}));
+	EXPECT_FALSE(cache.store({"source"}, "binary", 6));
+
+	std::vector<char> binary;
+	EXPECT_FALSE(cache.load({"source"}, binary));
+
+	EXPECT_FALSE(BinaryCache("relative_cache").isTrusted());
+}
+
+TEST(BinaryCache, roundtrip) {
+	auto directory = getDirectory();
+	BinaryCache cache(directory);
+	EXPECT_TRUE(cache.isTrusted());
+
+	std::vector<char> binary;
+	EXPECT_FALSE(cache.load({"source"}, binary));
+
+	std::string data("\x7f" "ELF\0binary", 10);
+	EXPECT_TRUE(cache.store({"source"}, data.data(), data.size()));
+	EXPECT_TRUE(cache.load({"source"}, binary));
+	EXPECT_EQ(data, std::string(binary.begin(), binary.end()));
+	EXPECT_FALSE(cache.load({"other source"}, binary));
+
+	// the directory and the files are private
+	struct stat st;
+	ASSERT_EQ(0, stat(directory.c_str(), &st));
+	EXPECT_EQ(0, st.st_mode & (S_IRWXG | S_IRWXO));
+	ASSERT_EQ(0, stat(cache.getFilename({"source"}).c_str(), &st));
+	EXPECT_EQ(0, st.st_mode & (S_IRWXG | S_IRWXO));
+
+	// entries are replaced
+	EXPECT_TRUE(cache.store({"source"}, "new", 3));
+	EXPECT_TRUE(cache.load({"source"}, binary));
+	EXPECT_EQ("new", std::string(binary.begin(), binary.end()));
+
+	boost::filesystem::remove_all(directory);
+}
+
+TEST(BinaryCache, writableByOthersIsRefused) {
+	auto directory = getDirectory();
+	BinaryCache cache(directory);
+	ASSERT_TRUE(cache.store({"source"}, "binary", 6));
+	std::vector<char> binary;
+
+	// a file somebody else could have replaced
+	auto filename = cache.getFilename({"source"});
+	chmod(filename.c_str(), 0666);
+	EXPECT_FALSE(cache.load({"source"}, binary));
+	chmod(filename.c_str(), 0600);
+	EXPECT_TRUE(cache.load({"source"}, binary));
+
+	// a directory somebody else could have put files into
+	chmod(directory.c_str(), 0777);
+	EXPECT_FALSE(cache.isTrusted());
+	EXPECT_FALSE(cache.load({"source"}, binary));
+	EXPECT_FALSE(cache.store({"other source"}, "binary", 6));
+
+	boost::filesystem::remove_all(directory);
+}
@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+#include "util/bufferpool.h"
+
+#include <thread>
+#include <cstring>
+
+static bool isZero(const char *buffer, size_t size) {
+	for (size_t i = 0; i < size; i++)
+		if (buffer[i] != 0)
+			return false;
+	return true;
+}
+
+TEST(BufferPool, reuse) {
+	BufferPool::trim();
+	auto before = BufferPool::getStatistics();
+
+	char *a = (char *) BufferPool::allocate(100000);
+	EXPECT_EQ(0u, (uintptr_t) a % BufferPool::ALIGNMENT);
+	EXPECT_TRUE(isZero(a, 100000));
+	memset(a, 1, 100000);
+	BufferPool::release(a, 100000);
+	EXPECT_GT(BufferPool::getStatistics().bytes_retained, 0u);
+
+	// a slightly larger buffer falls into the same size class
+	char *b = (char *) BufferPool::allocate(110000);
+	EXPECT_EQ(a, b);
+	EXPECT_TRUE(isZero(b, 110000));
+	BufferPool::release(b, 110000);
+
+	auto after = BufferPool::getStatistics();
+	EXPECT_EQ(before.hits + 1, after.hits);
+	EXPECT_EQ(before.misses + 1, after.misses);
+
+	BufferPool::trim();
+	EXPECT_EQ(0u, BufferPool::getStatistics().bytes_retained);
+}
+
+TEST(BufferPool, sizes) {
+	// every size must be usable up to its end, including unpooled ones
+	for (size_t size : {1, 4095, 4096, 4097, 5 * 4096, 123457, 1 << 20, (1 << 20) + 1}) {
+		char *buffer = (char *) BufferPool::allocate(size);
+		EXPECT_TRUE(isZero(buffer, size));
+		buffer[size-1] = 1;
+		BufferPool::release(buffer, size);
+	}
+	BufferPool::trim();
+}
+
+TEST(BufferPool, threads) {
+	// buffers released by one thread can be reused by another
+	char *buffer = (char *) BufferPool::allocate(50000);
+	std::thread t([buffer]() { BufferPool::release(buffer, 50000); });
+	t.join();
+	char *reused = (char *) BufferPool::allocate(50000);
+	EXPECT_EQ(buffer, reused);
+	BufferPool::release(reused, 50000);
+	BufferPool::trim();
+}
@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+#include "util/csv_sidecar.h"
+#include "util/csv_source_util.h"
+#include "util/concat.h"
+
+#include <fstream>
+#include <thread>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static std::string writeCSV(size_t count) {
+	std::string filename = concat("/tmp/gtest_csv_sidecar.", getpid(), ".csv");
+	std::ofstream out(filename);
+	out << "x,y,start,end,value,name\n";
+	for (size_t i = 0; i < count; i++) {
+		// spread the points unevenly, with a few rows lacking coordinates
+		double x = (i * 7919 % 1000) / 10.0;
+		double y = (i * i % 997) / 10.0;
+		if (i % 101 == 0)
+			out << ",," << i << "," << i + 10 << "," << i * 0.5 << ",n" << i << "\n";
+		else
+			out << x << "," << y << "," << i << "," << i + 10 << "," << i * 0.5 << ",\"n," << i << "\"\n";
+	}
+	return filename;
+}
+
+static Json::Value getParameters() {
+	Json::Value params(Json::ValueType::objectValue);
+	params["geometry"] = "xy";
+	params["time"] = "start+end";
+	params["time1_format"]["format"] = "seconds";
+	params["time2_format"]["format"] = "seconds";
+	params["columns"]["time1"] = "start";
+	params["columns"]["time2"] = "end";
+	params["columns"]["numeric"].append("value");
+	params["columns"]["textual"].append("name");
+	return params;
+}
+
+static void checkEqual(const PointCollection &expected, const PointCollection &actual) {
+	ASSERT_EQ(expected.getFeatureCount(), actual.getFeatureCount());
+	auto &expected_values = expected.feature_attributes.numeric("value");
+	auto &actual_values = actual.feature_attributes.numeric("value");
+	auto &expected_names = expected.feature_attributes.textual("name");
+	auto &actual_names = actual.feature_attributes.textual("name");
+	for (size_t i = 0; i < expected.getFeatureCount(); i++) {
+		EXPECT_EQ(expected.coordinates[i].x, actual.coordinates[i].x);
+		EXPECT_EQ(expected.coordinates[i].y, actual.coordinates[i].y);
+		EXPECT_EQ(expected.time[i].t1, actual.time[i].t1);
+		EXPECT_EQ(expected.time[i].t2, actual.time[i].t2);
+		EXPECT_EQ(expected_values.get(i), actual_values.get(i));
+		EXPECT_EQ(expected_names.get(i), actual_names.get(i));
+	}
+}
+
+TEST(CSVSidecar, matchesParsing) {
+	std::string filename = writeCSV(5000);
+	auto params = getParameters();
+	CSVSourceUtil util(params);
+
+	EXPECT_EQ(nullptr, CSVSidecar::open(filename, util));
+	ASSERT_TRUE(CSVSidecar::build(filename, util));
+	auto sidecar = CSVSidecar::open(filename, util);
+	ASSERT_NE(nullptr, sidecar);
+	EXPECT_EQ(5000u - 50u, sidecar->getFeatureCount());
+
+	std::vector<QueryRectangle> rects {
+		QueryRectangle(SpatialReference(CrsId::unreferenced(), 0, 0, 100, 100), TemporalReference(TIMETYPE_UNIX, 0, 10000), QueryResolution::none()),
+		QueryRectangle(SpatialReference(CrsId::unreferenced(), 12.5, 30, 40, 55.5), TemporalReference(TIMETYPE_UNIX, 0, 10000), QueryResolution::none()),
+		QueryRectangle(SpatialReference(CrsId::unreferenced(), 0, 0, 50, 50), TemporalReference(TIMETYPE_UNIX, 1000, 1200), QueryResolution::none()),
+		QueryRectangle(SpatialReference(CrsId::unreferenced(), 200, 200, 300, 300), TemporalReference(TIMETYPE_UNIX, 0, 10000), QueryResolution::none())
+	};
+	for (auto &rect : rects) {
+		std::ifstream data(filename);
+		auto expected = util.getPointCollection(data, rect);
+		size_t bytes_read = 0;
+		auto actual = sidecar->getPointCollection(rect, bytes_read);
+		checkEqual(*expected, *actual);
+	}
+
+	// a smaller query reads fewer blocks
+	size_t all_bytes = 0, some_bytes = 0;
+	sidecar->getPointCollection(rects[0], all_bytes);
+	sidecar->getPointCollection(rects[1], some_bytes);
+	EXPECT_LT(some_bytes, all_bytes);
+
+	unlink(filename.c_str());
+	unlink(CSVSidecar::getFilename(filename).c_str());
+}
+
+TEST(CSVSidecar, invalidation) {
+	std::string filename = writeCSV(100);
+	auto params = getParameters();
+	CSVSourceUtil util(params);
+	ASSERT_TRUE(CSVSidecar::build(filename, util));
+	EXPECT_NE(nullptr, CSVSidecar::open(filename, util));
+
+	// other parameters
+	auto other_params = getParameters();
+	other_params["columns"]["numeric"] = Json::Value(Json::ValueType::arrayValue);
+	CSVSourceUtil other_util(other_params);
+	EXPECT_EQ(nullptr, CSVSidecar::open(filename, other_util));
+
+	// a modified file
+	{
+		std::ofstream out(filename, std::ios::app);
+		out << "1,2,3,4,5,six\n";
+	}
+	EXPECT_EQ(nullptr, CSVSidecar::open(filename, util));
+
+	unlink(filename.c_str());
+	unlink(CSVSidecar::getFilename(filename).c_str());
+}
+
+TEST(CSVSidecar, failedBuildIsRemembered) {
+	std::string filename = writeCSV(100);
+	std::string sidecar_filename = CSVSidecar::getFilename(filename);
+	auto params = getParameters();
+	CSVSourceUtil util(params);
+
+	// a directory in place of the sidecar cannot be replaced
+	ASSERT_EQ(0, mkdir(sidecar_filename.c_str(), 0700));
+	EXPECT_EQ(nullptr, CSVSidecar::openOrBuild(filename, util));
+	rmdir(sidecar_filename.c_str());
+
+	// not tried again for the same file
+	EXPECT_EQ(nullptr, CSVSidecar::openOrBuild(filename, util));
+	EXPECT_NE(0, access(sidecar_filename.c_str(), F_OK));
+
+	// but once it changes
+	{
+		std::ofstream out(filename, std::ios::app);
+		out << "1,2,3,4,5,six\n";
+	}
+	auto sidecar = CSVSidecar::openOrBuild(filename, util);
+	ASSERT_NE(nullptr, sidecar);
+	EXPECT_EQ(100u, sidecar->getFeatureCount());
+
+	unlink(filename.c_str());
+	unlink(sidecar_filename.c_str());
+}
+
+TEST(CSVSidecar, concurrentBuilds) {
+	std::string filename = writeCSV(5000);
+	auto params = getParameters();
+	CSVSourceUtil util(params);
+
+	std::vector<size_t> counts(8, 0);
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < counts.size(); i++) {
+		threads.emplace_back([&, i]() {
+			CSVSourceUtil thread_util(params);
+			auto sidecar = CSVSidecar::openOrBuild(filename, thread_util);
+			if (sidecar)
+				counts[i] = sidecar->getFeatureCount();
+		});
+	}
+	for (auto &thread : threads)
+		thread.join();
+	for (auto count : counts)
+		EXPECT_EQ(5000u - 50u, count);
+
+	unlink(filename.c_str());
+	unlink(CSVSidecar::getFilename(filename).c_str());
+}
@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 #include "util/formula.h"
 
+#include <vector>
+
 
 static void goodFormula(const std::string &formula) {
 	Formula f(formula);
@@ -40,3 +42,84 @@ TEST(Formula, DISABLED_morebad) {
 	badFormula("*(0x0042)");
 	badFormula("statement(), 42");
 }
+
+static double evaluate(const std::string &formula, double a, double b = 0, Formula::Type type = Formula::Type::FLOAT) {
+	Formula f(formula);
+	f.addCLFunctions();
+	f.addVariable("A", "", type);
+	f.addVariable("B", "", type);
+	auto program = f.compile();
+	const double *variables[] = {&a, &b};
+	double result;
+	program.evaluate(variables, &result, 1);
+	return result;
+}
+
+TEST(Formula, compile) {
+	EXPECT_DOUBLE_EQ(7, evaluate("1 + 2 * 3", 0));
+	EXPECT_DOUBLE_EQ(9, evaluate("(1 + 2) * 3", 0));
+	EXPECT_DOUBLE_EQ(-4, evaluate("-A * 2", 2));
+	EXPECT_DOUBLE_EQ(8, evaluate("pow(A, B)", 2, 3));
+	EXPECT_DOUBLE_EQ(1, evaluate("mod(A, 2)", 7));
+	EXPECT_DOUBLE_EQ(2.5, evaluate("abs(A / B)", 5, -2));
+	EXPECT_DOUBLE_EQ(2, evaluate("A / B", 5, 2, Formula::Type::INTEGER));
+	EXPECT_DOUBLE_EQ(2.5, evaluate("A / 2.0", 5, 0, Formula::Type::INTEGER));
+	EXPECT_DOUBLE_EQ(1, evaluate("A < B && !(A == 3) || B >= 10", 2, 3));
+	EXPECT_DOUBLE_EQ(20, evaluate("A > B ? A * 2 : B * 2", 10, 3));
+	EXPECT_DOUBLE_EQ(0.25, evaluate("fract(A)", -1.75));
+	EXPECT_DOUBLE_EQ(1e3, evaluate("1e3", 0));
+}
+
+TEST(Formula, compileErrors) {
+	Formula f("A + C");
+	f.addVariable("A");
+	EXPECT_THROW(f.compile(), Formula::parse_error);
+
+	std::string nested(1000, '(');
+	for (auto formula : {"A +", "A A", "sin(A, A)", "foo(A)", "A = 3", "A %", "A[7]", "(A", "1.2.3", nested.c_str()}) {
+		Formula g(formula);
+		g.addCLFunctions();
+		g.addVariable("A");
+		EXPECT_THROW(g.compile(), Formula::parse_error) << formula;
+	}
+}
+
+TEST(Formula, batches) {
+	Formula f("A * B + 1");
+	f.addVariable("A");
+	f.addVariable("B");
+	auto program = f.compile();
+
+	size_t count = FormulaProgram::BATCH_SIZE * 3 + 17;
+	std::vector<double> a(count), b(count), result(count);
+	for (size_t i = 0; i < count; i++) {
+		a[i] = i;
+		b[i] = 0.5;
+	}
+	const double *variables[] = {a.data(), b.data()};
+	program.evaluate(variables, result.data(), count);
+	for (size_t i = 0; i < count; i++)
+		EXPECT_DOUBLE_EQ(i * 0.5 + 1, result[i]);
+}
+
+TEST(Formula, bitwise) {
+	EXPECT_DOUBLE_EQ(0x04030201, evaluate("A | (B << 8) | (3 << 16) | (4 << 24)", 1, 2, Formula::Type::INTEGER));
+	EXPECT_DOUBLE_EQ(2, evaluate("(A >> 4) & 3", 0x2f, 0, Formula::Type::INTEGER));
+	EXPECT_DOUBLE_EQ(6, evaluate("A ^ B", 5, 3, Formula::Type::INTEGER));
+	EXPECT_DOUBLE_EQ(-6, evaluate("~A", 5, 0, Formula::Type::INTEGER));
+	EXPECT_DOUBLE_EQ(1, evaluate("A < B << 1", 3, 2, Formula::Type::INTEGER));
+
+	Formula f("A | 1");
+	f.addVariable("A", "", Formula::Type::FLOAT);
+	EXPECT_THROW(f.compile(), Formula::parse_error);
+}
+
+TEST(Formula, modulo) {
+	EXPECT_DOUBLE_EQ(1, evaluate("A % 3", 7, 0, Formula::Type::INTEGER));
+	EXPECT_DOUBLE_EQ(-1, evaluate("A % B", -7, 3, Formula::Type::INTEGER));
+	EXPECT_DOUBLE_EQ(1.5, evaluate("A % 2", 5.5));
+	EXPECT_DOUBLE_EQ(evaluate("mod(A, B)", -5.5, 2), evaluate("A % B", -5.5, 2));
+	// the same precedence as * and /
+	EXPECT_DOUBLE_EQ(3, evaluate("1 + A % 4 * 2", 5, 0, Formula::Type::INTEGER));
+	EXPECT_DOUBLE_EQ(2, evaluate("7 % 5", 0));
+}
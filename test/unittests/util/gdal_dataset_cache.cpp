@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include "datatypes/raster/raster_priv.h"
+#include "util/gdal_dataset_cache.h"
+#include "util/gdal_source_datasets.h"
+#include "util/configuration.h"
+#include "util/concat.h"
+
+#include <gdal_priv.h>
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <unistd.h>
+
+static void writeGeoTiff(const std::string &filename, uint32_t width, uint32_t height) {
+	DataDescription dd(GDT_Byte, Unit::unknown());
+	SpatioTemporalReference stref(
+		SpatialReference(CrsId::from_epsg_code(4326), 0, 0, width, height),
+		TemporalReference(TIMETYPE_UNIX, 0, 1)
+	);
+	auto raster = GenericRaster::create(dd, stref, width, height, 0, GenericRaster::Representation::CPU);
+	raster->toGDAL(filename.c_str(), "GTiff");
+}
+
+TEST(GDALDatasetCache, reuse) {
+	std::string filename = concat("/tmp/gtest_gdal_dataset_cache.", getpid(), ".tif");
+	writeGeoTiff(filename, 10, 10);
+	GDALDatasetCache::clear();
+	auto before = GDALDatasetCache::getStatistics();
+
+	GDALDataset *first;
+	{
+		auto lease = GDALDatasetCache::open(filename);
+		ASSERT_TRUE((bool) lease);
+		first = lease.get();
+	}
+	EXPECT_EQ(1u, GDALDatasetCache::getStatistics().idle);
+
+	auto lease = GDALDatasetCache::open(filename);
+	EXPECT_EQ(first, lease.get());
+	EXPECT_EQ(10, lease->GetRasterXSize());
+
+	// a second concurrent user gets a handle of its own
+	auto concurrent = GDALDatasetCache::open(filename);
+	EXPECT_NE(lease.get(), concurrent.get());
+
+	auto after = GDALDatasetCache::getStatistics();
+	EXPECT_EQ(before.hits + 1, after.hits);
+	EXPECT_EQ(before.misses + 2, after.misses);
+
+	lease = GDALDatasetCache::Lease();
+	concurrent = GDALDatasetCache::Lease();
+	EXPECT_EQ(2u, GDALDatasetCache::getStatistics().idle);
+
+	GDALDatasetCache::clear();
+	EXPECT_EQ(0u, GDALDatasetCache::getStatistics().idle);
+	unlink(filename.c_str());
+}
+
+TEST(GDALDatasetCache, modifiedFile) {
+	std::string filename = concat("/tmp/gtest_gdal_dataset_cache_modified.", getpid(), ".tif");
+	writeGeoTiff(filename, 10, 10);
+	{
+		auto lease = GDALDatasetCache::open(filename);
+		ASSERT_TRUE((bool) lease);
+	}
+
+	writeGeoTiff(filename, 20, 10);
+	auto evictions = GDALDatasetCache::getStatistics().evictions;
+	{
+		auto lease = GDALDatasetCache::open(filename);
+		ASSERT_TRUE((bool) lease);
+		EXPECT_EQ(20, lease->GetRasterXSize());
+	}
+	EXPECT_EQ(evictions + 1, GDALDatasetCache::getStatistics().evictions);
+
+	unlink(filename.c_str());
+	EXPECT_FALSE((bool) GDALDatasetCache::open(filename));
+	GDALDatasetCache::clear();
+}
+
+TEST(GDALDatasetCache, overviewsBuiltLater) {
+	std::string filename = concat("/tmp/gtest_gdal_dataset_cache_overviews.", getpid(), ".tif");
+	writeGeoTiff(filename, 512, 512);
+	{
+		auto lease = GDALDatasetCache::open(filename);
+		ASSERT_TRUE((bool) lease);
+		EXPECT_EQ(0, lease->GetRasterBand(1)->GetOverviewCount());
+	}
+
+	// like mapping_manager buildgdaloverviews, which leaves the file itself untouched
+	{
+		auto dataset = (GDALDataset *) GDALOpen(filename.c_str(), GA_ReadOnly);
+		ASSERT_NE(nullptr, dataset);
+		int level = 2;
+		EXPECT_EQ(CE_None, dataset->BuildOverviews("NEAREST", 1, &level, 0, nullptr, nullptr, nullptr));
+		GDALClose(dataset);
+	}
+
+	auto evictions = GDALDatasetCache::getStatistics().evictions;
+	{
+		auto lease = GDALDatasetCache::open(filename);
+		ASSERT_TRUE((bool) lease);
+		EXPECT_EQ(1, lease->GetRasterBand(1)->GetOverviewCount());
+	}
+	EXPECT_EQ(evictions + 1, GDALDatasetCache::getStatistics().evictions);
+
+	GDALDatasetCache::clear();
+	unlink(filename.c_str());
+	unlink((filename + ".ovr").c_str());
+}
+
+TEST(GDALSourceDataSets, descriptionCache) {
+	namespace bf = boost::filesystem;
+	bf::path directory = bf::temp_directory_path() / bf::unique_path("gtest_gdalsource_%%%%%%%%");
+	bf::create_directories(directory);
+	Configuration::loadFromString(concat("[gdalsource.datasets]\npath=\"", directory.string(), "\""));
+
+	std::string filename = (directory / "test.json").string();
+	std::ofstream(filename) << R"({"name": "first"})";
+
+	auto before = GDALSourceDataSets::getDescriptionCacheStatistics();
+	EXPECT_EQ("first", GDALSourceDataSets::getDataSetDescription("test")["name"].asString());
+	EXPECT_EQ("first", GDALSourceDataSets::getDataSetDescription("test")["name"].asString());
+	auto after = GDALSourceDataSets::getDescriptionCacheStatistics();
+	EXPECT_EQ(before.misses + 1, after.misses);
+	EXPECT_EQ(before.hits + 1, after.hits);
+
+	// the size differs, so the modification is noticed even within the resolution of the timestamps
+	std::ofstream(filename) << R"({"name": "second"})";
+	EXPECT_EQ("second", GDALSourceDataSets::getDataSetDescription("test")["name"].asString());
+
+	bf::remove_all(directory);
+	EXPECT_THROW(GDALSourceDataSets::getDataSetDescription("test"), ArgumentException);
+}
@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+#include "util/threadpool.h"
+#include "util/exceptions.h"
+
+#include <atomic>
+
+TEST(ThreadPool, enqueue) {
+	ThreadPool pool(2);
+	auto a = pool.enqueue([]() { return 21; });
+	auto b = pool.enqueue([]() { return 21; });
+	EXPECT_EQ(42, a.get() + b.get());
+}
+
+TEST(ThreadPool, parallelFor) {
+	ThreadPool pool(4);
+	std::vector<int> values(1000, 0);
+	pool.parallelFor(values.size(), [&](size_t i) { values[i] = (int) i; });
+	for (size_t i = 0; i < values.size(); i++)
+		EXPECT_EQ((int) i, values[i]);
+}
+
+TEST(ThreadPool, nestedParallelFor) {
+	// nested calls must not dead-lock, even on a single worker
+	ThreadPool pool(1);
+	std::atomic<int> count(0);
+	pool.parallelFor(8, [&](size_t) {
+		pool.parallelFor(8, [&](size_t) { count++; });
+	});
+	EXPECT_EQ(64, count);
+}
+
+TEST(ThreadPool, exception) {
+	ThreadPool pool(2);
+	std::atomic<int> count(0);
+	EXPECT_THROW(pool.parallelFor(10, [&](size_t i) {
+		count++;
+		if (i == 3)
+			throw ArgumentException("fail");
+	}), ArgumentException);
+	EXPECT_EQ(10, count);
+}